@@ -0,0 +1,88 @@
+#ifndef SERIAL_PORT_AUTO_DETECT_H
+#define SERIAL_PORT_AUTO_DETECT_H
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "serial_port.h"
+
+namespace serial_port
+{
+	/// @brief Options of DetectSettings()
+	struct AutoDetectOptions
+	{
+		/// @brief Baud rates to try, most likely first
+		std::vector<int> baud_rates{ 115200, 9600, 57600, 38400, 19200, 230400, 4800, 2400, 1200, 460800, 921600 };
+		/// @brief Parity settings to try with each baud rate
+		std::vector<Parity> parities{ Parity::kNone, Parity::kEven, Parity::kOdd };
+		/// @brief Stop bit settings to try with each baud rate and parity
+		/// @details Receivers only check the first stop bit, so the device's stop bits can only be told
+		/// apart if it answers a probe (see probe).
+		std::vector<NumStopBits> stop_bits{ NumStopBits::kOne };
+		/// @brief Sent after switching to each candidate, for devices that only talk when asked (empty: just listen)
+		std::string probe;
+		/// @brief Bytes that the device is known to send (e.g. the start of its messages)
+		/// @details If set, a candidate is only accepted once the preamble has been received, and a clean
+		/// sample containing it ends the search without waiting for sample_size bytes.
+		std::string preamble;
+		/// @brief Whether the device sends text. Non-printable bytes then count against a candidate.
+		bool text{ true };
+		/// @brief Number of bytes to receive before a candidate is scored
+		std::size_t sample_size{ 32 };
+		/// @brief Maximum time to listen to each candidate
+		std::chrono::milliseconds listen_time{ 100 };
+		/// @brief A candidate with at least this score ends the search early
+		double stop_score{ 0.98 };
+		/// @brief The best candidate is only accepted with at least this score
+		double accept_score{ 0.8 };
+	};
+
+	/// @brief Result of DetectSettings()
+	struct AutoDetectResult
+	{
+		/// @brief Whether a candidate was accepted
+		bool found{ false };
+		/// @brief The accepted settings (the port's original settings if none was accepted)
+		Settings settings;
+		/// @brief Score of the accepted candidate between 0 and 1
+		double score{ 0.0 };
+		/// @brief Number of candidates tried (settings that the driver rejects are skipped)
+		std::size_t num_candidates{ 0 };
+		/// @brief Time the search took
+		std::chrono::nanoseconds elapsed{ 0 };
+
+		/// @brief Overloaded stream output operator
+		friend std::ostream& operator<<(std::ostream& os, const AutoDetectResult& obj)
+		{
+			if (obj.found)
+			{
+				os << "Detected " << obj.settings.baud_rate << " baud, parity " << static_cast<int>(obj.settings.parity)
+					<< ", stop bits " << static_cast<int>(obj.settings.num_stop_bits) << " (score " << obj.score << ")";
+			}
+			else
+			{
+				os << "No settings detected";
+			}
+			return os << " after " << obj.num_candidates << " candidates in "
+				<< std::chrono::duration_cast<std::chrono::milliseconds>(obj.elapsed).count() << " ms";
+		}
+	};
+
+	/// @brief Find the baud rate and framing of the device connected to a port
+	/// @details The candidate settings are applied to the open port in place (see SerialPort::ApplySettings()),
+	/// so no time is lost reopening it. For each candidate, the received bytes are scored by the driver's
+	/// framing and parity error counters, or by the NUL bytes that the driver delivers for such errors if
+	/// it keeps no counters (on Linux, input parity checking is enabled for this while detecting), by the
+	/// ratio of printable characters and by the preamble. A candidate whose first bytes are mostly errors
+	/// is abandoned at once, and the search stops at the first confident match.
+	/// @param port An open port. It must not be read by anyone else meanwhile.
+	/// @param options Candidates and scoring
+	/// @return The detected settings. The port is left configured with them, or with its original settings
+	/// if none was accepted.
+	AutoDetectResult DetectSettings(const SerialPort& port, const AutoDetectOptions& options = {});
+}
+
+#endif // SERIAL_PORT_AUTO_DETECT_H
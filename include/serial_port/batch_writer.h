@@ -0,0 +1,169 @@
+#ifndef SERIAL_PORT_BATCH_WRITER_H
+#define SERIAL_PORT_BATCH_WRITER_H
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "io_thread.h"
+#include "serial_port.h"
+
+namespace serial_port
+{
+	/// @brief Options of a BatchWriter
+	struct BatchWriterOptions
+	{
+		/// @brief Number of threads writing in parallel, each to a slice of the ports (1: only the calling thread)
+		std::size_t num_workers{ 1 };
+		/// @brief Maximum time for a batch. Ports whose data has not been handed to the driver by then fail with Errc::kTimeout.
+		std::chrono::milliseconds timeout{ 1000 };
+		/// @brief Scheduling settings of the additional worker threads
+		IoThreadConfig io_thread;
+	};
+
+	/// @brief Outcome of a batch on one port
+	struct PortWriteResult
+	{
+		/// @brief Whether all bytes were handed to the driver
+		bool success{ false };
+		/// @brief The error if not
+		std::error_code error;
+		/// @brief Number of bytes handed to the driver
+		std::size_t num_written{ 0 };
+		/// @brief When the first bytes were handed to the driver, i.e. when transmission could start
+		std::chrono::steady_clock::time_point submitted;
+		/// @brief When the last byte was handed to the driver
+		std::chrono::steady_clock::time_point completed;
+
+		/// @brief Overloaded stream output operator
+		friend std::ostream& operator<<(std::ostream& os, const PortWriteResult& obj)
+		{
+			os << obj.num_written << " bytes " << (obj.success ? "written" : "failed");
+			if (!obj.success)
+			{
+				os << " (" << obj.error.message() << ")";
+			}
+			return os;
+		}
+	};
+
+	/// @brief Outcome of a batch
+	struct BatchWriteResult
+	{
+		/// @brief One result per port, in the order of the ports
+		std::vector<PortWriteResult> ports;
+		/// @brief When the batch started
+		std::chrono::steady_clock::time_point start;
+
+		/// @brief Whether all ports succeeded
+		[[nodiscard]] bool Success() const
+		{
+			for (const auto& port : ports)
+			{
+				if (!port.success)
+				{
+					return false;
+				}
+			}
+			return !ports.empty();
+		}
+		/// @brief Time between the first and the last port receiving its first bytes (over the ports that got any)
+		[[nodiscard]] std::chrono::nanoseconds Skew() const
+		{
+			std::chrono::steady_clock::time_point first = std::chrono::steady_clock::time_point::max();
+			std::chrono::steady_clock::time_point last = std::chrono::steady_clock::time_point::min();
+			for (const auto& port : ports)
+			{
+				if (port.num_written > 0)
+				{
+					first = std::min(first, port.submitted);
+					last = std::max(last, port.submitted);
+				}
+			}
+			return first <= last ? last - first : std::chrono::nanoseconds(0);
+		}
+
+		/// @brief Overloaded stream output operator
+		friend std::ostream& operator<<(std::ostream& os, const BatchWriteResult& obj)
+		{
+			std::size_t num_failed = 0;
+			for (const auto& port : obj.ports)
+			{
+				num_failed += port.success ? 0 : 1;
+			}
+			return os << obj.ports.size() << " ports, " << num_failed << " failed, skew "
+				<< std::chrono::duration_cast<std::chrono::microseconds>(obj.Skew()).count() << " us";
+		}
+	};
+
+	/// @brief Writes to many ports at once with minimal skew between them (e.g. sync or trigger frames)
+	/// @details The first write of every port is issued back to back, without blocking on ports whose
+	/// transmit buffer is full: a single poll() finds the ports that can take data before the batch
+	/// starts. Ports that could not take everything are completed afterwards. With several workers, each
+	/// writes a slice of the ports, and the workers start together from a barrier. Each port gets the
+	/// time at which its first and last bytes were handed to the driver. A write larger than the free
+	/// space of a port's transmit buffer still blocks its worker until the data fits, so keep the frames
+	/// small or use several workers. The ports must be open and outlive the writer, which does not own them.
+	class BatchWriter
+	{
+	public:
+		/// @brief Start the workers
+		/// @param ports The ports
+		/// @param options Number of workers and timeout
+		explicit BatchWriter(std::vector<const SerialPort*> ports, const BatchWriterOptions& options = {});
+		/// @brief Stops the workers
+		~BatchWriter();
+
+		/// @brief BatchWriter objects may not be copied or moved
+		BatchWriter(const BatchWriter&) = delete;
+		BatchWriter& operator=(const BatchWriter&) = delete;
+
+		/// @brief Write the same data to all ports
+		BatchWriteResult Broadcast(std::string_view data);
+		/// @brief Write one buffer per port
+		/// @param buffers The data for each port, in the order of the ports. Empty buffers skip their port.
+		BatchWriteResult Write(const std::vector<std::string_view>& buffers);
+
+		/// @brief Number of ports
+		[[nodiscard]] std::size_t NumPorts() const { return ports_.size(); }
+
+	private:
+		// Write to the ports of a worker
+		void WriteSlice(std::size_t worker);
+		void Work(std::size_t worker);
+
+		std::vector<const SerialPort*> ports_;
+		std::vector<int> handles_;
+		BatchWriterOptions options_;
+
+		// One batch at a time
+		std::mutex batch_mutex_;
+		std::vector<std::string_view> buffers_;
+		BatchWriteResult result_;
+		std::chrono::steady_clock::time_point deadline_;
+		// Number of workers that are ready to start writing
+		std::atomic<std::size_t> num_ready_{ 0 };
+
+		std::mutex mutex_;
+		std::condition_variable batch_started_;
+		std::condition_variable batch_finished_;
+		std::uint64_t batch_{ 0 };
+		std::size_t num_busy_{ 0 };
+		bool running_{ true };
+		std::vector<std::thread> workers_;
+	};
+}
+
+#endif // __linux__
+
+#endif // SERIAL_PORT_BATCH_WRITER_H
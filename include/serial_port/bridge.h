@@ -0,0 +1,105 @@
+#ifndef SERIAL_PORT_BRIDGE_H
+#define SERIAL_PORT_BRIDGE_H
+
+#if defined(__linux__)
+
+#include <array>
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+#include "serial_port.h"
+
+namespace serial_port
+{
+	/// @brief How a Bridge moves data
+	enum class BridgeMode
+	{
+		/// @brief Use splice()/tee() and fall back to copying where the kernel does not support it
+		kAuto,
+		/// @brief Only use splice()/tee(). Throws if the kernel does not support it for the descriptors.
+		kSplice,
+		/// @brief Copy through a user space buffer with read() and write()
+		kCopy
+	};
+
+	/// @brief Statistics of a Bridge
+	struct BridgeStats
+	{
+		/// @brief Number of bytes taken from the source
+		unsigned long long num_bytes{ 0 };
+		/// @brief Number of system calls that moved data
+		unsigned long long num_syscalls{ 0 };
+		/// @brief Time spent in Transfer()
+		std::chrono::nanoseconds elapsed{ 0 };
+
+		/// @brief Bytes taken from the source per second spent in Transfer()
+		[[nodiscard]] double Throughput() const
+		{
+			return elapsed.count() == 0 ? 0.0 : 1e9 * static_cast<double>(num_bytes) / static_cast<double>(elapsed.count());
+		}
+
+		/// @brief Overloaded stream output operator
+		friend std::ostream& operator<<(std::ostream& os, const BridgeStats& obj)
+		{
+			return os << obj.num_bytes << " bytes in " << obj.num_syscalls << " system calls, "
+				<< obj.Throughput() / 1e6 << " MB/s";
+		}
+	};
+
+	/// @brief Moves data from a port to files, pipes or sockets (or from a file, pipe or socket to a port)
+	/// inside the kernel with splice(), duplicating it with tee() if there are several sinks
+	/// @details All descriptors must be in blocking mode. The bridge does not own them. A bridge reading
+	/// from a port reads its handle directly, bypassing the port's internal line buffer, so do not mix it
+	/// with ReadString() and friends on the same port.
+	class Bridge
+	{
+	public:
+		/// @brief Create a bridge between arbitrary file descriptors
+		/// @param source The descriptor data is read from
+		/// @param sinks The descriptors every byte is written to
+		/// @param mode How to move the data
+		Bridge(int source, std::vector<int> sinks, BridgeMode mode = BridgeMode::kAuto);
+		/// @brief Create a bridge from an (opened) port to files, pipes or sockets
+		Bridge(const SerialPort& source, std::vector<int> sinks, BridgeMode mode = BridgeMode::kAuto);
+		/// @brief Create a bridge from a file, pipe or socket to an (opened) port
+		Bridge(int source, const SerialPort& sink, BridgeMode mode = BridgeMode::kAuto);
+		~Bridge();
+
+		/// @brief Bridge objects may not be copied
+		Bridge(const Bridge&) = delete;
+		Bridge& operator=(const Bridge&) = delete;
+
+		/// @brief Move data until max_bytes were moved, the source reached its end or no data arrived for idle_timeout
+		/// @return The number of bytes moved
+		std::size_t Transfer(std::size_t max_bytes, std::chrono::milliseconds idle_timeout);
+
+		/// @brief Returns whether data is moved inside the kernel (false after falling back to copying)
+		[[nodiscard]] bool IsZeroCopy() const { return zero_copy_; }
+		/// @brief Get the statistics
+		[[nodiscard]] const BridgeStats& GetStats() const { return stats_; }
+
+	private:
+		std::size_t SpliceChunk(std::size_t max_bytes);
+		std::size_t CopyChunk(std::size_t max_bytes);
+		void Drain(int pipe, std::size_t sink, std::size_t num_bytes);
+		void WriteAll(int fd, const char* data, std::size_t num_bytes);
+		void ClosePipes() noexcept;
+
+		int source_;
+		std::vector<int> sinks_;
+		BridgeMode mode_;
+		bool zero_copy_;
+		// Sinks that do not support splice() are fed by copying from their pipe
+		std::vector<bool> sink_splices_;
+		std::array<int, 2> pipe_{ -1, -1 };
+		std::vector<std::array<int, 2>> tee_pipes_;
+		std::size_t pipe_size_{ 0 };
+		std::vector<char> buffer_;
+		BridgeStats stats_;
+	};
+}
+
+#endif // __linux__
+
+#endif // SERIAL_PORT_BRIDGE_H
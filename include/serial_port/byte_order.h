@@ -0,0 +1,141 @@
+#ifndef SERIAL_PORT_BYTE_ORDER_H
+#define SERIAL_PORT_BYTE_ORDER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+namespace serial_port
+{
+	/// @brief Byte order of multi-byte values on the wire
+	enum class Endian
+	{
+		kLittle,
+		kBig,
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		kNative = kBig
+#else
+		kNative = kLittle
+#endif
+	};
+
+	/// @brief Reverse the bytes of an unsigned integer (compiles to a single instruction where available)
+	template <typename T>
+	constexpr T ByteSwap(T value)
+	{
+		static_assert(std::is_integral_v<T> && std::is_unsigned_v<T>, "ByteSwap() requires an unsigned integer type.");
+		if constexpr (sizeof(T) == 1)
+		{
+			return value;
+		}
+		else if constexpr (sizeof(T) == 2)
+		{
+			return static_cast<T>(value << 8 | value >> 8);
+		}
+		else if constexpr (sizeof(T) == 4)
+		{
+			return static_cast<T>((value & 0x000000FFu) << 24 | (value & 0x0000FF00u) << 8
+				| (value & 0x00FF0000u) >> 8 | (value & 0xFF000000u) >> 24);
+		}
+		else
+		{
+			static_assert(sizeof(T) == 8, "ByteSwap() supports 1, 2, 4 and 8 byte integers.");
+			return static_cast<T>((value & 0x00000000000000FFull) << 56 | (value & 0x000000000000FF00ull) << 40
+				| (value & 0x0000000000FF0000ull) << 24 | (value & 0x00000000FF000000ull) << 8
+				| (value & 0x000000FF00000000ull) >> 8 | (value & 0x0000FF0000000000ull) >> 24
+				| (value & 0x00FF000000000000ull) >> 40 | (value & 0xFF00000000000000ull) >> 56);
+		}
+	}
+
+	namespace detail
+	{
+		template <std::size_t kSize> struct UnsignedOfSize;
+		template <> struct UnsignedOfSize<1> { using type = std::uint8_t; };
+		template <> struct UnsignedOfSize<2> { using type = std::uint16_t; };
+		template <> struct UnsignedOfSize<4> { using type = std::uint32_t; };
+		template <> struct UnsignedOfSize<8> { using type = std::uint64_t; };
+
+		template <typename T, typename = void>
+		struct HasSwapEndian : std::false_type {};
+		template <typename T>
+		struct HasSwapEndian<T, std::void_t<decltype(SwapEndian(std::declval<T&>()))>> : std::true_type {};
+
+		template <typename T>
+		struct IsStdArray : std::false_type {};
+		template <typename T, std::size_t kSize>
+		struct IsStdArray<std::array<T, kSize>> : std::true_type {};
+	}
+
+	/// @brief Reverse the bytes of a value in place
+	/// @details Arithmetic types and enumerations are swapped as a whole, arrays element by element.
+	/// Other types (e.g. packed structs) must provide a SwapEndian(T&) function, found by argument-dependent
+	/// lookup, that swaps their members with SwapBytes().
+	template <typename T>
+	void SwapBytes(T& value)
+	{
+		if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>)
+		{
+			using Unsigned = typename detail::UnsignedOfSize<sizeof(T)>::type;
+			Unsigned bits;
+			std::memcpy(&bits, &value, sizeof(T));
+			bits = ByteSwap(bits);
+			std::memcpy(&value, &bits, sizeof(T));
+		}
+		else if constexpr (std::is_array_v<T> || detail::IsStdArray<T>::value)
+		{
+			for (auto& element : value)
+			{
+				SwapBytes(element);
+			}
+		}
+		else
+		{
+			static_assert(detail::HasSwapEndian<T>::value,
+				"Provide a SwapEndian(T&) function to convert the byte order of this type.");
+			SwapEndian(value);
+		}
+	}
+
+	/// @brief Reverse the bytes of every value in an array
+	/// @details For arithmetic types this is a plain loop over unsigned integers that compilers vectorize
+	/// (e.g. GCC with -O3 turns it into byte shuffles if SSSE3 or AVX2 is enabled).
+	template <typename T>
+	void SwapBytes(T* values, const std::size_t count)
+	{
+		if constexpr ((std::is_arithmetic_v<T> || std::is_enum_v<T>) && sizeof(T) > 1)
+		{
+			using Unsigned = typename detail::UnsignedOfSize<sizeof(T)>::type;
+			auto* bytes = reinterpret_cast<unsigned char*>(values);
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				Unsigned bits;
+				std::memcpy(&bits, bytes + i * sizeof(T), sizeof(T));
+				bits = ByteSwap(bits);
+				std::memcpy(bytes + i * sizeof(T), &bits, sizeof(T));
+			}
+		}
+		else if constexpr (!std::is_arithmetic_v<T> && !std::is_enum_v<T>)
+		{
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				SwapBytes(values[i]);
+			}
+		}
+	}
+
+	/// @brief Convert a value between native byte order and kOrder (the conversion is its own inverse)
+	template <Endian kOrder, typename T>
+	T ConvertEndian(T value)
+	{
+		if constexpr (kOrder != Endian::kNative)
+		{
+			SwapBytes(value);
+		}
+		return value;
+	}
+}
+
+#endif // SERIAL_PORT_BYTE_ORDER_H
@@ -0,0 +1,133 @@
+#ifndef SERIAL_PORT_COMPRESSION_H
+#define SERIAL_PORT_COMPRESSION_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "serial_port.h"
+
+namespace serial_port
+{
+	/// @brief Options of a CompressedChannel. Both ends of a link must use the same options.
+	struct CompressionOptions
+	{
+		/// @brief Keep the history of previous messages as context for the next one (streaming compression).
+		/// If false, every message is compressed on its own (only using the dictionary).
+		bool streaming{ true };
+		/// @brief Data that is known to occur in messages (e.g. typical JSON keys or a sample message).
+		/// It primes the history whenever the context is reset.
+		std::string dictionary;
+		/// @brief Reset the context every this many messages so that a receiver that lost a frame can resynchronize (0: never)
+		unsigned long reset_interval{ 64 };
+		/// @brief Largest message that will be accepted by ReadMessage()
+		std::size_t max_message_size{ 1 << 20 };
+	};
+
+	/// @brief Statistics of a CompressedChannel
+	struct CompressionStats
+	{
+		/// @brief Number of messages written
+		unsigned long messages_written{ 0 };
+		/// @brief Number of message bytes written (before compression)
+		unsigned long long raw_bytes_written{ 0 };
+		/// @brief Number of bytes put on the wire for the written messages (including framing)
+		unsigned long long wire_bytes_written{ 0 };
+		/// @brief Time spent compressing
+		std::chrono::nanoseconds compression_time{ 0 };
+
+		/// @brief Number of messages read
+		unsigned long messages_read{ 0 };
+		/// @brief Number of message bytes read (after decompression)
+		unsigned long long raw_bytes_read{ 0 };
+		/// @brief Number of bytes taken from the wire for the read messages (including framing)
+		unsigned long long wire_bytes_read{ 0 };
+		/// @brief Time spent decompressing
+		std::chrono::nanoseconds decompression_time{ 0 };
+		/// @brief Number of corrupted or undecodable frames that were dropped
+		unsigned long frames_dropped{ 0 };
+
+		/// @brief Ratio of message bytes to wire bytes on the TX side. This is the effective throughput gain of the link.
+		[[nodiscard]] double CompressionRatio() const
+		{
+			return wire_bytes_written == 0 ? 0.0 : static_cast<double>(raw_bytes_written) / static_cast<double>(wire_bytes_written);
+		}
+		/// @brief Compression speed in message bytes per second of CPU time
+		[[nodiscard]] double CompressionSpeed() const
+		{
+			return compression_time.count() == 0 ? 0.0 : 1e9 * static_cast<double>(raw_bytes_written) / static_cast<double>(compression_time.count());
+		}
+		/// @brief Decompression speed in message bytes per second of CPU time
+		[[nodiscard]] double DecompressionSpeed() const
+		{
+			return decompression_time.count() == 0 ? 0.0 : 1e9 * static_cast<double>(raw_bytes_read) / static_cast<double>(decompression_time.count());
+		}
+
+		/// @brief Overloaded stream output operator
+		friend std::ostream& operator<<(std::ostream& os, const CompressionStats& obj)
+		{
+			return os
+				<< "TX: " << obj.messages_written << " messages, " << obj.raw_bytes_written << " -> " << obj.wire_bytes_written
+				<< " bytes (ratio " << obj.CompressionRatio() << ", " << obj.CompressionSpeed() / 1e6 << " MB/s)" << std::endl
+				<< "RX: " << obj.messages_read << " messages, " << obj.wire_bytes_read << " -> " << obj.raw_bytes_read
+				<< " bytes (" << obj.DecompressionSpeed() / 1e6 << " MB/s), " << obj.frames_dropped << " frames dropped";
+		}
+	};
+
+	/// @brief Message-oriented channel that compresses messages with an LZ77 (LZ4-style) streaming compressor
+	/// @details Every message is sent as one frame with a sequence number and a CRC-32, so the compressor
+	/// flushes on message boundaries. With streaming enabled, matches may refer to previous messages (up to 64 KiB back),
+	/// which compresses small, repetitive telemetry messages much better than compressing them one by one.
+	/// The channel does not own the port. The port must be open and outlive the channel.
+	class CompressedChannel
+	{
+	public:
+		/// @brief Create a channel on an (opened) port
+		explicit CompressedChannel(SerialPort& port, CompressionOptions options = {});
+		~CompressedChannel();
+
+		/// @brief CompressedChannel objects may not be copied
+		CompressedChannel(const CompressedChannel&) = delete;
+		CompressedChannel& operator=(const CompressedChannel&) = delete;
+
+		/// @brief Compress and send a message
+		/// @details Throws an IoException if the frame cannot be written completely.
+		/// @return The number of bytes put on the wire
+		std::size_t WriteMessage(const std::string& message);
+		/// @brief Receive and decompress the next message
+		/// @details Corrupted frames are dropped. Until the sender resets its context, subsequent frames
+		/// cannot be decoded and are dropped as well.
+		/// @param message Receives the message (its capacity is reused)
+		/// @param timeout Maximum time to wait for a complete frame
+		/// @return False if no complete message was received in time
+		bool ReadMessage(std::string& message, std::chrono::milliseconds timeout);
+
+		/// @brief Get the compression statistics
+		[[nodiscard]] const CompressionStats& GetStats() const { return stats_; }
+
+	private:
+		class Encoder;
+		class Decoder;
+
+		// Try to decode one frame from the receive buffer. Returns false if more data is needed.
+		bool DecodeFrame(std::string& message, bool& decoded);
+
+		SerialPort& port_;
+		CompressionOptions options_;
+		std::unique_ptr<Encoder> encoder_;
+		std::unique_ptr<Decoder> decoder_;
+		std::vector<std::uint8_t> frame_;
+		std::vector<std::uint8_t> payload_;
+		std::string rx_buffer_;
+		std::vector<char> chunk_;
+		std::uint8_t tx_sequence_{ 0 };
+		std::uint8_t rx_sequence_{ 0 };
+		bool rx_synchronized_{ false };
+		CompressionStats stats_;
+	};
+}
+
+#endif // SERIAL_PORT_COMPRESSION_H
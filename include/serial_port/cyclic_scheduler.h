@@ -0,0 +1,168 @@
+#ifndef SERIAL_PORT_CYCLIC_SCHEDULER_H
+#define SERIAL_PORT_CYCLIC_SCHEDULER_H
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <queue>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "io_thread.h"
+#include "serial_port.h"
+
+namespace serial_port
+{
+	/// @brief Produces the frame of a cycle. Leaving the frame empty skips the cycle.
+	using FrameProducer = std::function<void(std::string& frame)>;
+
+	/// @brief Timing statistics of a cyclic stream
+	struct CyclicStreamStats
+	{
+		/// @brief The configured period
+		std::chrono::nanoseconds period{ 0 };
+		/// @brief Number of frames sent
+		unsigned long num_sent{ 0 };
+		/// @brief Number of cycles that were skipped because their deadline had already passed
+		unsigned long num_missed{ 0 };
+		/// @brief Number of frames that could not be produced (the producer threw) or written completely
+		unsigned long num_write_errors{ 0 };
+		/// @brief Time from the deadline of each cycle until its frame was written
+		LatencyHistogram lateness;
+		/// @brief Shortest time between two consecutive frames
+		std::chrono::nanoseconds min_interval{ std::chrono::nanoseconds::max() };
+		/// @brief Longest time between two consecutive frames (not counting skipped cycles)
+		std::chrono::nanoseconds max_interval{ 0 };
+
+		/// @brief Largest deviation of the time between two frames from the period
+		[[nodiscard]] std::chrono::nanoseconds PeriodJitter() const
+		{
+			if (num_sent < 2)
+			{
+				return std::chrono::nanoseconds(0);
+			}
+			return std::max(max_interval - period, period - min_interval);
+		}
+
+		/// @brief Overloaded stream output operator
+		friend std::ostream& operator<<(std::ostream& os, const CyclicStreamStats& obj)
+		{
+			const auto us = [](const std::chrono::nanoseconds duration) { return std::chrono::duration<double, std::micro>(duration).count(); };
+			return os
+				<< obj.num_sent << " frames every " << us(obj.period) << " us, " << obj.num_missed << " missed, "
+				<< obj.num_write_errors << " write errors, period jitter " << us(obj.PeriodJitter()) << " us, lateness [us]: p50 < "
+				<< us(obj.lateness.Percentile(0.5)) << ", p99 < " << us(obj.lateness.Percentile(0.99)) << ", max " << us(obj.lateness.max);
+		}
+	};
+
+	/// @brief Sends frames on fixed periods on many ports from a single thread
+	/// @details Every stream has an absolute schedule: the deadline of cycle n is start + phase + n * period.
+	/// The thread sleeps on a timerfd armed with the earliest deadline, so the schedule does not drift
+	/// regardless of how long sending takes. Cycles whose deadline has already passed when the previous
+	/// one was sent are skipped and counted as missed rather than sent in a burst. Writes block, so a port
+	/// whose transmit buffer is full delays the other streams; this shows up in their statistics. The
+	/// scheduler's lock is not held while a frame is produced or written, so the other methods do not wait
+	/// for a blocked port. Exceptions thrown by a producer or by a write count as write errors of the stream
+	/// and do not stop the scheduler.
+	class CyclicScheduler
+	{
+	public:
+		/// @brief Identifies a stream
+		using StreamId = std::size_t;
+
+		CyclicScheduler();
+		/// @brief Stops sending
+		~CyclicScheduler();
+
+		/// @brief CyclicScheduler objects may not be copied or moved
+		CyclicScheduler(const CyclicScheduler&) = delete;
+		CyclicScheduler& operator=(const CyclicScheduler&) = delete;
+
+		/// @brief Send a fixed frame periodically
+		/// @param port An open port. It must outlive the stream.
+		/// @param period Time between two frames
+		/// @param frame The frame
+		/// @param phase Offset of the first deadline from the start (or from now if already running)
+		StreamId AddStream(SerialPort& port, std::chrono::nanoseconds period, std::string frame,
+			std::chrono::nanoseconds phase = std::chrono::nanoseconds(0));
+		/// @brief Send a frame produced by a callback periodically
+		/// @param producer Called on the scheduler's thread right before each frame is due. Must not call
+		/// Stop() and should return quickly, as it delays all streams.
+		StreamId AddStream(SerialPort& port, std::chrono::nanoseconds period, FrameProducer producer,
+			std::chrono::nanoseconds phase = std::chrono::nanoseconds(0));
+		/// @brief Stop sending a stream
+		/// @details If a frame of the stream is being produced or written, waits until that is done, so that
+		/// the port may be closed or destroyed afterwards. Called from a producer, it does not wait.
+		void RemoveStream(StreamId stream);
+
+		/// @brief Start sending in the background
+		/// @param io_thread Scheduling settings of the sending thread
+		void Start(const IoThreadConfig& io_thread = {});
+		/// @brief Stop sending
+		void Stop();
+		/// @brief Returns whether the scheduler is sending
+		[[nodiscard]] bool IsRunning() const { return running_; }
+		/// @brief The error that stopped the sending thread (e.g. the timer could not be armed), or an empty error code
+		[[nodiscard]] std::error_code Error() const;
+
+		/// @brief Get the timing statistics of a stream
+		[[nodiscard]] CyclicStreamStats GetStats(StreamId stream) const;
+
+	private:
+		using TimePoint = std::chrono::steady_clock::time_point;
+
+		struct Stream
+		{
+			SerialPort* port;
+			std::chrono::nanoseconds period;
+			std::chrono::nanoseconds phase;
+			std::string frame;
+			FrameProducer producer;
+			TimePoint last_sent;
+			CyclicStreamStats stats;
+		};
+
+		StreamId Add(Stream stream);
+		void Run();
+		std::error_code ArmTimer(const TimePoint* deadline) const;
+		void Wake() const;
+		// Write frame_, or the frame of the producer if any. Returns when it was sent, an empty time point if
+		// the producer skipped the cycle, or nothing if the write failed.
+		std::optional<TimePoint> Send(const SerialPort& port, const FrameProducer& producer);
+		// Update the statistics of a stream after its cycle and return its next deadline
+		TimePoint Record(Stream& stream, TimePoint deadline, std::optional<TimePoint> sent);
+
+		int timer_fd_{ -1 };
+		int wake_fd_{ -1 };
+
+		mutable std::mutex mutex_;
+		std::map<StreamId, Stream> streams_;
+		StreamId next_id_{ 0 };
+		// Deadlines of the streams, earliest first. Entries of removed streams are skipped.
+		std::priority_queue<std::pair<TimePoint, StreamId>, std::vector<std::pair<TimePoint, StreamId>>, std::greater<>> deadlines_;
+		std::error_code error_;
+		// The stream whose frame is being produced or written without the lock
+		std::optional<StreamId> sending_;
+		std::condition_variable send_finished_;
+		// The frame being sent. Only used by the scheduler's thread.
+		std::string frame_;
+
+		std::atomic<bool> running_{ false };
+		std::thread thread_;
+	};
+}
+
+#endif // __linux__
+
+#endif // SERIAL_PORT_CYCLIC_SCHEDULER_H
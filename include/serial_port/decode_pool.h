@@ -0,0 +1,185 @@
+#ifndef SERIAL_PORT_DECODE_POOL_H
+#define SERIAL_PORT_DECODE_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "io_thread.h"
+#include "serial_port.h"
+#include "transaction.h"
+
+namespace serial_port
+{
+	/// @brief Does the CPU-heavy work on a received frame in place (e.g. decrypting, decompressing, parsing)
+	/// @details Called on any worker thread, also concurrently for frames of the same stream. Throwing
+	/// discards the frame.
+	using FrameDecoder = std::function<void(std::string& frame)>;
+	/// @brief Receives the decoded frames of each stream in the order in which they were received
+	/// @details Called on a worker thread, never concurrently for the same stream.
+	using DecodedFrameHandler = std::function<void(std::size_t stream, std::string& frame)>;
+
+	/// @brief Options of a DecodePool
+	struct DecodePoolOptions
+	{
+		/// @brief Number of worker threads (0: one per core)
+		std::size_t num_workers{ 0 };
+		/// @brief Maximum number of frames submitted but not yet handled. Submitting blocks while it is reached.
+		std::size_t max_in_flight{ 4096 };
+		/// @brief Scheduling settings of the threads that read the ports
+		IoThreadConfig reader_thread;
+		/// @brief Scheduling settings of the worker threads
+		IoThreadConfig worker_thread;
+	};
+
+	/// @brief Statistics of a DecodePool
+	struct DecodePoolStats
+	{
+		/// @brief Number of frames submitted
+		std::uint64_t num_submitted{ 0 };
+		/// @brief Number of frames handed to the handler
+		std::uint64_t num_handled{ 0 };
+		/// @brief Number of frames discarded because the decoder or the handler threw
+		std::uint64_t num_errors{ 0 };
+		/// @brief Number of frames a worker took from another worker's queue
+		std::uint64_t num_stolen{ 0 };
+		/// @brief Largest number of decoded frames of a stream that waited for an earlier frame
+		std::size_t max_reorder_depth{ 0 };
+		/// @brief Number of frames decoded by each worker
+		std::vector<std::uint64_t> num_decoded;
+
+		/// @brief Overloaded stream output operator
+		friend std::ostream& operator<<(std::ostream& os, const DecodePoolStats& obj)
+		{
+			os << obj.num_submitted << " frames submitted, " << obj.num_handled << " handled, " << obj.num_errors << " errors, "
+				<< obj.num_stolen << " stolen, max reorder depth " << obj.max_reorder_depth << ", decoded per worker:";
+			for (const auto num_decoded : obj.num_decoded)
+			{
+				os << " " << num_decoded;
+			}
+			return os;
+		}
+	};
+
+	/// @brief Decodes the frames received on many streams (e.g. ports) on a pool of threads
+	/// @details Frames are spread over the workers' queues, and workers that run out of work steal from
+	/// the others, so a few busy ports keep all cores busy. Frames of a stream are numbered when they are
+	/// submitted. Decoded frames that overtook an earlier frame of their stream wait until it has been
+	/// handled, so the handler sees every stream in its original order.
+	class DecodePool
+	{
+	public:
+		/// @brief Identifies a stream of frames
+		using StreamId = std::size_t;
+
+		/// @brief Start the workers
+		/// @param decoder Decodes a frame
+		/// @param handler Receives the decoded frames
+		/// @param options Number of workers and limits
+		DecodePool(FrameDecoder decoder, DecodedFrameHandler handler, const DecodePoolOptions& options = {});
+		/// @brief Stops reading the ports. Frames that have been submitted are still decoded and handled.
+		~DecodePool();
+
+		/// @brief DecodePool objects may not be copied or moved
+		DecodePool(const DecodePool&) = delete;
+		DecodePool& operator=(const DecodePool&) = delete;
+
+		/// @brief Add a stream whose frames are submitted with Submit()
+		StreamId AddStream();
+		/// @brief Read frames from a port on a background thread and submit them as a new stream
+		/// @param port An open port. It must outlive the pool and must not be read by anyone else meanwhile.
+		/// @param framer Splits the received data into frames
+		StreamId AddPort(SerialPort& port, Framer framer = DelimiterFramer());
+		/// @brief Submit a frame. Blocks while max_in_flight frames are in flight.
+		/// @details Frames of the same stream must be submitted from one thread at a time.
+		void Submit(StreamId stream, std::string frame);
+		/// @brief Wait until all submitted frames have been handled
+		/// @param timeout Maximum time to wait
+		/// @return False if the timeout expired
+		bool Drain(std::chrono::milliseconds timeout);
+
+		/// @brief Get the statistics
+		[[nodiscard]] DecodePoolStats GetStats() const;
+
+	private:
+		struct Stream
+		{
+			// Number of the next frame submitted
+			std::uint64_t next_sequence{ 0 };
+
+			std::mutex mutex;
+			// Number of the next frame to hand to the handler
+			std::uint64_t next_handled{ 0 };
+			// Decoded frames waiting for an earlier frame (empty if the frame was discarded)
+			std::map<std::uint64_t, std::optional<std::string>> decoded;
+			// Whether a worker is calling the handler for this stream
+			bool handling{ false };
+
+			SerialPort* port{ nullptr };
+			Framer framer;
+			std::thread reader;
+		};
+
+		struct Task
+		{
+			Stream* stream{ nullptr };
+			StreamId id{ 0 };
+			std::uint64_t sequence{ 0 };
+			std::string frame;
+		};
+
+		struct Worker
+		{
+			std::mutex mutex;
+			std::deque<Task> tasks;
+			std::atomic<std::uint64_t> num_decoded{ 0 };
+			std::thread thread;
+		};
+
+		void Read(StreamId id, Stream& stream);
+		void Work(std::size_t index);
+		// Take a task from a worker's own queue, or steal one from another worker
+		bool Take(std::size_t index, Task& task);
+		// Decode a frame and hand over the frames of its stream that are ready
+		void Process(std::size_t index, Task& task);
+		void Handle(StreamId id, Stream& stream);
+		[[nodiscard]] Stream& GetStream(StreamId id) const;
+
+		FrameDecoder decoder_;
+		DecodedFrameHandler handler_;
+		DecodePoolOptions options_;
+
+		mutable std::mutex streams_mutex_;
+		std::vector<std::unique_ptr<Stream>> streams_;
+
+		std::vector<std::unique_ptr<Worker>> workers_;
+		std::atomic<std::size_t> next_worker_{ 0 };
+
+		mutable std::mutex mutex_;
+		std::condition_variable work_available_;
+		std::condition_variable space_available_;
+		std::size_t num_queued_{ 0 };
+		std::size_t num_in_flight_{ 0 };
+		bool stopping_{ false };
+
+		std::atomic<std::uint64_t> num_submitted_{ 0 };
+		std::atomic<std::uint64_t> num_handled_{ 0 };
+		std::atomic<std::uint64_t> num_errors_{ 0 };
+		std::atomic<std::uint64_t> num_stolen_{ 0 };
+		std::atomic<std::size_t> max_reorder_depth_{ 0 };
+
+		std::atomic<bool> reading_{ true };
+	};
+}
+
+#endif // SERIAL_PORT_DECODE_POOL_H
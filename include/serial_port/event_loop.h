@@ -0,0 +1,244 @@
+#ifndef SERIAL_PORT_EVENT_LOOP_H
+#define SERIAL_PORT_EVENT_LOOP_H
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#include <exception>
+#endif
+
+#include "serial_port.h"
+
+namespace serial_port
+{
+	/// @brief Timeout value for operations that never time out
+	constexpr std::chrono::milliseconds kNoTimeout{ -1 };
+
+	/// @brief Result of an asynchronous operation
+	struct IoResult
+	{
+		/// @brief std::errc::timed_out, std::errc::operation_canceled, or the error reported by the system
+		std::error_code error;
+		/// @brief Number of bytes transferred
+		std::size_t num_bytes{ 0 };
+	};
+
+	/// @brief Receives the result of an asynchronous operation
+	using IoHandler = std::function<void(const IoResult&)>;
+
+	/// @brief A single-threaded event loop waiting for many ports at once (based on epoll)
+	/// @details All operations are dispatched on the thread that calls Run() or RunOnce(). Only Post(),
+	/// Stop() and AsyncPort::Cancel() may be called from other threads. Use one loop per thread to
+	/// spread many ports over a handful of threads.
+	class EventLoop
+	{
+	public:
+		/// @brief Identifies a pending wait
+		using OperationId = std::uint64_t;
+
+		EventLoop();
+		~EventLoop();
+
+		/// @brief EventLoop objects may not be copied or moved
+		EventLoop(const EventLoop&) = delete;
+		EventLoop& operator=(const EventLoop&) = delete;
+
+		/// @brief Dispatch events until Stop() is called
+		void Run();
+		/// @brief Dispatch the events that are ready, waiting at most timeout for the first one
+		/// @return The number of dispatched events
+		std::size_t RunOnce(std::chrono::milliseconds timeout);
+		/// @brief Make Run() return. May be called from any thread.
+		void Stop();
+		/// @brief Run a function on the loop thread. May be called from any thread.
+		void Post(std::function<void()> function);
+		/// @brief Returns whether the calling thread is currently dispatching events of this loop
+		[[nodiscard]] bool IsLoopThread() const { return loop_thread_ == std::this_thread::get_id(); }
+
+		/// @brief Point in time after which a wait fails with std::errc::timed_out
+		using Deadline = std::chrono::steady_clock::time_point;
+		/// @brief Convert a timeout (or kNoTimeout) into a deadline
+		static Deadline MakeDeadline(std::chrono::milliseconds timeout);
+
+		/// @brief Wait until a file descriptor is readable (or reports an error or hang up)
+		/// @param fd The file descriptor. Only one read wait per descriptor may be pending.
+		/// @param deadline Time after which the callback receives std::errc::timed_out (Deadline::max(): wait forever)
+		/// @param callback Called exactly once on the loop thread
+		OperationId WaitReadable(int fd, Deadline deadline, std::function<void(std::error_code)> callback);
+		/// @brief Wait until a file descriptor is writable. Same semantics as WaitReadable().
+		OperationId WaitWritable(int fd, Deadline deadline, std::function<void(std::error_code)> callback);
+		/// @brief Cancel a pending wait. Must be called on the loop thread.
+		/// @param id The wait to cancel. Waits that have already completed are ignored.
+		/// @param notify Whether to call the callback with std::errc::operation_canceled
+		void Cancel(OperationId id, bool notify = true);
+
+	private:
+		struct Operation
+		{
+			int fd;
+			bool write;
+			std::function<void(std::error_code)> callback;
+			bool has_deadline;
+			std::multimap<Deadline, OperationId>::iterator deadline;
+		};
+
+		struct Descriptor
+		{
+			OperationId read_op{ 0 };
+			OperationId write_op{ 0 };
+		};
+
+		OperationId Wait(int fd, bool write, Deadline deadline, std::function<void(std::error_code)> callback);
+		void Complete(OperationId id, std::error_code error, bool notify = true);
+		void UpdateInterest(int fd);
+		void RunPosted();
+
+		int epoll_fd_{ -1 };
+		int wake_fd_{ -1 };
+		std::atomic<bool> stopped_{ false };
+		std::thread::id loop_thread_;
+
+		OperationId next_id_{ 1 };
+		std::unordered_map<OperationId, Operation> operations_;
+		std::unordered_map<int, Descriptor> descriptors_;
+		std::multimap<Deadline, OperationId> deadlines_;
+
+		std::mutex posted_mutex_;
+		std::vector<std::function<void()>> posted_;
+	};
+
+#if defined(__cpp_impl_coroutine)
+	/// @brief Awaitable wrapper of an asynchronous operation. co_await yields the IoResult.
+	class IoAwaitable
+	{
+	public:
+		/// @brief Starts the operation and arranges for the handler to be called on completion
+		using Starter = std::function<void(IoHandler)>;
+
+		explicit IoAwaitable(Starter start) : start_(std::move(start)) {}
+
+		bool await_ready() const noexcept { return false; }
+		bool await_suspend(std::coroutine_handle<> handle)
+		{
+			handle_ = handle;
+			start_([this](const IoResult& result)
+			{
+				result_ = result;
+				if (suspended_)
+				{
+					handle_.resume();
+				}
+				else
+				{
+					completed_inline_ = true;
+				}
+			});
+			// Do not suspend if the operation completed right away
+			suspended_ = !completed_inline_;
+			return suspended_;
+		}
+		IoResult await_resume() const noexcept { return result_; }
+
+	private:
+		Starter start_;
+		std::coroutine_handle<> handle_;
+		IoResult result_;
+		bool suspended_{ false };
+		bool completed_inline_{ false };
+	};
+
+	/// @brief A coroutine return type for fire-and-forget coroutines that run on an event loop
+	struct DetachedTask
+	{
+		struct promise_type
+		{
+			DetachedTask get_return_object() noexcept { return {}; }
+			std::suspend_never initial_suspend() noexcept { return {}; }
+			std::suspend_never final_suspend() noexcept { return {}; }
+			void return_void() noexcept {}
+			void unhandled_exception() noexcept { std::terminate(); }
+		};
+	};
+#endif
+
+	/// @brief Asynchronous operations on a port, driven by an event loop
+	/// @details The port must be open and outlive the AsyncPort. While attached, the port's handle is
+	/// switched to non-blocking mode. Handlers are called on the loop thread; if an operation can
+	/// complete immediately, the handler is called before the starting function returns.
+	/// Only one read and one write may be pending at a time.
+	class AsyncPort
+	{
+	public:
+		/// @brief Attach a port to an event loop
+		AsyncPort(EventLoop& loop, SerialPort& port);
+		/// @brief Detach the port. Must be called on the loop thread. Pending handlers are not called.
+		~AsyncPort();
+
+		/// @brief AsyncPort objects may not be copied or moved
+		AsyncPort(const AsyncPort&) = delete;
+		AsyncPort& operator=(const AsyncPort&) = delete;
+
+		/// @brief Read at least one and at most num_bytes bytes
+		void AsyncRead(char* data, std::size_t num_bytes, IoHandler handler, std::chrono::milliseconds timeout = kNoTimeout);
+		/// @brief Read a string terminated with a '\\n' symbol into line (reusing its capacity)
+		void AsyncReadLine(std::string& line, IoHandler handler, std::chrono::milliseconds timeout = kNoTimeout);
+		/// @brief Write all num_bytes bytes. The data must stay valid until the handler is called.
+		void AsyncWrite(const char* data, std::size_t num_bytes, IoHandler handler, std::chrono::milliseconds timeout = kNoTimeout);
+		/// @brief Cancel the pending operations. Their handlers receive std::errc::operation_canceled. May be called from any thread.
+		/// @details From another thread, the cancellation runs on the loop thread later, and does nothing if the
+		/// port has been destroyed by then.
+		void Cancel();
+
+#if defined(__cpp_impl_coroutine)
+		/// @brief co_await a read of at least one and at most num_bytes bytes
+		IoAwaitable AsyncRead(char* data, std::size_t num_bytes, std::chrono::milliseconds timeout = kNoTimeout)
+		{
+			return IoAwaitable([this, data, num_bytes, timeout](IoHandler handler) { AsyncRead(data, num_bytes, std::move(handler), timeout); });
+		}
+		/// @brief co_await a string terminated with a '\\n' symbol
+		IoAwaitable AsyncReadLine(std::string& line, std::chrono::milliseconds timeout = kNoTimeout)
+		{
+			return IoAwaitable([this, &line, timeout](IoHandler handler) { AsyncReadLine(line, std::move(handler), timeout); });
+		}
+		/// @brief co_await writing all num_bytes bytes
+		IoAwaitable AsyncWrite(const char* data, std::size_t num_bytes, std::chrono::milliseconds timeout = kNoTimeout)
+		{
+			return IoAwaitable([this, data, num_bytes, timeout](IoHandler handler) { AsyncWrite(data, num_bytes, std::move(handler), timeout); });
+		}
+#endif
+
+	private:
+		using Deadline = EventLoop::Deadline;
+
+		void ContinueRead(char* data, std::size_t num_bytes, IoHandler handler, Deadline deadline);
+		void ContinueReadLine(std::string& line, IoHandler handler, Deadline deadline);
+		void ContinueWrite(const char* data, std::size_t num_bytes, std::size_t num_written, IoHandler handler, Deadline deadline);
+
+		EventLoop& loop_;
+		SerialPort& port_;
+		int fd_;
+		int saved_flags_;
+		EventLoop::OperationId read_op_{ 0 };
+		EventLoop::OperationId write_op_{ 0 };
+		// Cleared by the destructor. Only accessed on the loop thread.
+		std::shared_ptr<bool> alive_{ std::make_shared<bool>(true) };
+	};
+}
+
+#endif // __linux__
+
+#endif // SERIAL_PORT_EVENT_LOOP_H
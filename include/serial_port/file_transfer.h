@@ -0,0 +1,119 @@
+#ifndef SERIAL_PORT_FILE_TRANSFER_H
+#define SERIAL_PORT_FILE_TRANSFER_H
+
+#if defined(__linux__)
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "serial_port.h"
+
+namespace serial_port
+{
+	/// @brief Options of a FileTransfer. Both sides should use the same block size.
+	struct TransferOptions
+	{
+		/// @brief Number of file bytes per data packet (at most 32768)
+		std::size_t block_size{ 1024 };
+		/// @brief Number of bytes the sender may send ahead of the last acknowledgment. Should cover the
+		/// round trip time of the link, so that the sender never waits for acknowledgments.
+		std::size_t window_size{ 16 * 1024 };
+		/// @brief Number of received bytes after which the receiver acknowledges
+		std::size_t ack_interval{ 4 * 1024 };
+		/// @brief Time without progress after which the missing data is requested again
+		std::chrono::milliseconds timeout{ 1000 };
+		/// @brief Number of consecutive timeouts after which the transfer fails
+		int max_retries{ 10 };
+	};
+
+	/// @brief Statistics of a file transfer
+	struct TransferStats
+	{
+		/// @brief Size of the file
+		unsigned long long file_size{ 0 };
+		/// @brief Number of bytes sent and received on the wire, including protocol overhead
+		unsigned long long wire_bytes{ 0 };
+		/// @brief Number of file bytes sent more than once (sender)
+		unsigned long long retransmitted_bytes{ 0 };
+		/// @brief Number of retransmission requests sent (receiver) or received (sender)
+		unsigned long naks{ 0 };
+		/// @brief Number of packets dropped because of a wrong CRC (receiver)
+		unsigned long corrupted_packets{ 0 };
+		/// @brief Number of timeouts
+		unsigned long timeouts{ 0 };
+		/// @brief Duration of the transfer
+		std::chrono::nanoseconds elapsed{ 0 };
+		/// @brief Maximum number of bytes per second the line can carry with the port's settings
+		double line_capacity{ 0.0 };
+
+		/// @brief File bytes per second
+		[[nodiscard]] double Throughput() const
+		{
+			return elapsed.count() == 0 ? 0.0 : 1e9 * static_cast<double>(file_size) / static_cast<double>(elapsed.count());
+		}
+		/// @brief Ratio of the achieved throughput to the line capacity
+		[[nodiscard]] double Efficiency() const
+		{
+			return line_capacity == 0.0 ? 0.0 : Throughput() / line_capacity;
+		}
+
+		/// @brief Overloaded stream output operator
+		friend std::ostream& operator<<(std::ostream& os, const TransferStats& obj)
+		{
+			return os
+				<< obj.file_size << " bytes in " << std::chrono::duration<double>(obj.elapsed).count() << " s: "
+				<< obj.Throughput() / 1e3 << " kB/s of " << obj.line_capacity / 1e3 << " kB/s line capacity ("
+				<< 100.0 * obj.Efficiency() << " %), " << obj.wire_bytes << " bytes on the wire, "
+				<< obj.retransmitted_bytes << " bytes retransmitted, " << obj.naks << " NAKs, "
+				<< obj.corrupted_packets << " corrupted packets, " << obj.timeouts << " timeouts";
+		}
+	};
+
+	/// @brief Transfers files over a port with a windowed streaming protocol (in the style of ZMODEM)
+	/// @details The sender streams CRC-32 protected data packets without waiting for a reply, as long as
+	/// no more than window_size bytes are unacknowledged. The receiver acknowledges every ack_interval bytes
+	/// and asks the sender to go back to the first missing byte if a packet is lost or corrupted. The sender
+	/// memory-maps the file, so it is never copied as a whole. The port must be open and must not be used
+	/// by anyone else during a transfer.
+	class FileTransfer
+	{
+	public:
+		/// @brief Prepare transfers over an (opened) port
+		explicit FileTransfer(SerialPort& port, TransferOptions options = {});
+
+		/// @brief Send a file. Throws an IoException if the transfer fails.
+		TransferStats Send(const std::string& path);
+		/// @brief Receive a file and store it under path. Throws an IoException if the transfer fails.
+		TransferStats Receive(const std::string& path);
+
+	private:
+		struct Packet
+		{
+			std::uint8_t type;
+			std::uint64_t offset;
+			std::string_view payload;
+		};
+
+		void WritePacket(TransferStats& stats, std::uint8_t type, std::uint64_t offset);
+		void AppendPacket(std::vector<char>& out, std::uint8_t type, std::uint64_t offset, const char* payload, std::size_t num_bytes) const;
+		void WriteBuffer(TransferStats& stats);
+		// Wait at most timeout for data and pass all complete packets to the handler. Returns false on timeout.
+		bool ReadPackets(std::chrono::milliseconds timeout, TransferStats& stats, const std::function<void(const Packet&)>& handler);
+		double LineCapacity() const;
+
+		SerialPort& port_;
+		TransferOptions options_;
+		std::string rx_buffer_;
+		std::vector<char> chunk_;
+		std::vector<char> tx_buffer_;
+	};
+}
+
+#endif // __linux__
+
+#endif // SERIAL_PORT_FILE_TRANSFER_H
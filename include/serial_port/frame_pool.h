@@ -0,0 +1,169 @@
+#ifndef SERIAL_PORT_FRAME_POOL_H
+#define SERIAL_PORT_FRAME_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <utility>
+
+#include "result.h"
+#include "serial_port.h"
+
+namespace serial_port
+{
+	/// @brief Shared state of a FramePool (defined in the implementation)
+	struct FramePoolCore;
+
+	/// @brief Header of a buffer of a FramePool (internal)
+	struct FrameBlock
+	{
+		/// @brief Number of FrameBuffer objects referring to the block
+		std::atomic<std::uint32_t> num_refs{ 1 };
+		/// @brief Index of the next free block while the block is in the pool
+		std::atomic<std::uint32_t> next_free{ 0 };
+		/// @brief Index of the block in the pool
+		std::uint32_t index{ 0 };
+		/// @brief Number of bytes used
+		std::size_t size{ 0 };
+		/// @brief Number of bytes available
+		std::size_t capacity{ 0 };
+		/// @brief The pool, or nullptr for a block that was allocated because the pool was empty
+		FramePoolCore* core{ nullptr };
+		/// @brief The bytes
+		char* data{ nullptr };
+	};
+
+	/// @brief A reference-counted buffer from a FramePool
+	/// @details Copies share the same bytes, so a frame can be handed to several consumers without copying
+	/// it. The buffer returns to its pool when the last copy is destroyed. Fill the buffer before sharing
+	/// it: the bytes are not protected against concurrent modification.
+	class FrameBuffer
+	{
+	public:
+		/// @brief An empty buffer
+		FrameBuffer() noexcept = default;
+		/// @brief Share the bytes of another buffer
+		FrameBuffer(const FrameBuffer& other) noexcept : block_(other.block_)
+		{
+			if (block_ != nullptr)
+			{
+				block_->num_refs.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		/// @brief Take over another buffer, which becomes empty
+		FrameBuffer(FrameBuffer&& other) noexcept : block_(std::exchange(other.block_, nullptr)) {}
+		/// @brief Share the bytes of another buffer
+		FrameBuffer& operator=(FrameBuffer other) noexcept
+		{
+			std::swap(block_, other.block_);
+			return *this;
+		}
+		/// @brief Releases the buffer
+		~FrameBuffer() { Reset(); }
+
+		/// @brief Release the buffer and become empty
+		void Reset() noexcept;
+
+		/// @brief Returns whether the object refers to a buffer
+		explicit operator bool() const noexcept { return block_ != nullptr; }
+		/// @brief Pointer to the bytes
+		[[nodiscard]] char* Data() noexcept { return block_->data; }
+		/// @brief Pointer to the bytes
+		[[nodiscard]] const char* Data() const noexcept { return block_->data; }
+		/// @brief Number of bytes used
+		[[nodiscard]] std::size_t Size() const noexcept { return block_ != nullptr ? block_->size : 0; }
+		/// @brief Number of bytes available
+		[[nodiscard]] std::size_t Capacity() const noexcept { return block_ != nullptr ? block_->capacity : 0; }
+		/// @brief Set the number of bytes used
+		/// @param size The size. Must not exceed the capacity.
+		void Resize(std::size_t size);
+		/// @brief View of the bytes used
+		[[nodiscard]] std::string_view View() const noexcept { return { Data(), Size() }; }
+		/// @brief Number of FrameBuffer objects sharing the bytes
+		[[nodiscard]] std::uint32_t UseCount() const noexcept
+		{
+			return block_ != nullptr ? block_->num_refs.load(std::memory_order_relaxed) : 0;
+		}
+
+	private:
+		friend class FramePool;
+		explicit FrameBuffer(FrameBlock* block) noexcept : block_(block) {}
+
+		FrameBlock* block_{ nullptr };
+	};
+
+	/// @brief Options of a FramePool
+	struct FramePoolOptions
+	{
+		/// @brief Size of each buffer in bytes
+		std::size_t buffer_size{ 4096 };
+		/// @brief Number of buffers allocated up front
+		std::size_t num_buffers{ 256 };
+	};
+
+	/// @brief Statistics of a FramePool
+	struct FramePoolStats
+	{
+		/// @brief Number of buffers taken from the pool
+		std::uint64_t num_hits{ 0 };
+		/// @brief Number of buffers allocated because the pool was empty
+		std::uint64_t num_misses{ 0 };
+		/// @brief Number of buffers of the pool
+		std::size_t num_buffers{ 0 };
+		/// @brief Number of buffers currently in the pool
+		std::size_t num_free{ 0 };
+
+		/// @brief Fraction of the buffers that were taken from the pool
+		[[nodiscard]] double HitRate() const
+		{
+			const auto total = num_hits + num_misses;
+			return total > 0 ? static_cast<double>(num_hits) / static_cast<double>(total) : 0.0;
+		}
+
+		/// @brief Overloaded stream output operator
+		friend std::ostream& operator<<(std::ostream& os, const FramePoolStats& obj)
+		{
+			return os << obj.num_hits << " hits, " << obj.num_misses << " misses (hit rate " << obj.HitRate() * 100.0 << " %), "
+				<< obj.num_free << " of " << obj.num_buffers << " buffers free";
+		}
+	};
+
+	/// @brief A pool of fixed-size, reference-counted buffers for received frames
+	/// @details The buffers are allocated in one block up front. Taking and returning a buffer is lock-free,
+	/// so buffers can be released on any thread. When the pool is empty, a buffer is allocated on the heap
+	/// instead and freed when released (counted as a miss). Use one pool per port, sized for the frames
+	/// the consumers hold at the same time. Buffers stay valid after the pool has been destroyed.
+	class FramePool
+	{
+	public:
+		/// @brief Allocate the buffers
+		/// @param options Size and number of the buffers
+		explicit FramePool(const FramePoolOptions& options = {});
+		/// @brief The memory is freed once the last buffer has been released
+		~FramePool();
+
+		/// @brief FramePool objects may not be copied or moved
+		FramePool(const FramePool&) = delete;
+		FramePool& operator=(const FramePool&) = delete;
+
+		/// @brief Take an empty buffer (size 0)
+		[[nodiscard]] FrameBuffer Acquire();
+		/// @brief Read from a port straight into a buffer
+		/// @param port An open port
+		/// @param timeout Maximum time to wait for data (see SerialPort::TryReadData())
+		/// @return A buffer holding the bytes read, at most the buffer size
+		[[nodiscard]] Result<FrameBuffer> ReadFrom(const SerialPort& port, std::chrono::milliseconds timeout);
+
+		/// @brief Size of each buffer in bytes
+		[[nodiscard]] std::size_t BufferSize() const;
+		/// @brief Get the statistics
+		[[nodiscard]] FramePoolStats GetStats() const;
+
+	private:
+		FramePoolCore* core_;
+	};
+}
+
+#endif // SERIAL_PORT_FRAME_POOL_H
@@ -0,0 +1,121 @@
+#ifndef SERIAL_PORT_IO_THREAD_H
+#define SERIAL_PORT_IO_THREAD_H
+
+#include <chrono>
+#include <exception>
+#include <future>
+#include <ostream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+namespace serial_port
+{
+	/// @brief Scheduling and memory settings of a thread that serves ports
+	/// @details The default configuration leaves threads as the operating system creates them. All threads the
+	/// library starts can be configured with it: those of TransactionManager, Multiplexer, ModemLineMonitor,
+	/// modbus::PollScheduler, CyclicScheduler, ShmRingPublisher, LinkEmulator, PriorityWriter, DecodePool and
+	/// BatchWriter, and the worker threads of SerialPort::OpenAll(). Real-time settings are only supported on Linux.
+	struct IoThreadConfig
+	{
+		/// @brief SCHED_FIFO priority (1 to 99). 0 keeps the normal time-sharing scheduler.
+		/// @details Requires CAP_SYS_NICE or a sufficient RLIMIT_RTPRIO.
+		int realtime_priority{ 0 };
+		/// @brief The CPUs the thread may run on. Empty allows all CPUs.
+		std::vector<int> cpus;
+		/// @brief Lock all current and future memory of the process (mlockall()) so that no page faults
+		/// occur. Memory allocated later (e.g. for buffers) is then faulted in when it is allocated.
+		bool lock_memory{ false };
+		/// @brief Number of bytes of the thread's stack to fault in when it starts
+		std::size_t prefault_stack{ 0 };
+
+		/// @brief Overloaded equality operator
+		friend bool operator==(const IoThreadConfig& lhs, const IoThreadConfig& rhs)
+		{
+			return lhs.realtime_priority == rhs.realtime_priority && lhs.cpus == rhs.cpus
+				&& lhs.lock_memory == rhs.lock_memory && lhs.prefault_stack == rhs.prefault_stack;
+		}
+		/// @brief Overloaded inequality operator
+		friend bool operator!=(const IoThreadConfig& lhs, const IoThreadConfig& rhs)
+		{
+			return !(lhs == rhs);
+		}
+	};
+
+	/// @brief How late a thread woke up from timed sleeps
+	struct SchedulingLatencyStats
+	{
+		/// @brief Number of wake-ups measured
+		std::size_t num_samples{ 0 };
+		/// @brief Smallest delay
+		std::chrono::nanoseconds min{ 0 };
+		/// @brief Average delay
+		std::chrono::nanoseconds average{ 0 };
+		/// @brief 99th percentile of the delays
+		std::chrono::nanoseconds p99{ 0 };
+		/// @brief Largest delay, the figure that matters for deterministic operation
+		std::chrono::nanoseconds max{ 0 };
+
+		/// @brief Overloaded stream output operator
+		friend std::ostream& operator<<(std::ostream& os, const SchedulingLatencyStats& obj)
+		{
+			return os
+				<< obj.num_samples << " wake-ups, latency [us]: min " << obj.min.count() / 1e3
+				<< ", average " << obj.average.count() / 1e3 << ", p99 " << obj.p99.count() / 1e3
+				<< ", max " << obj.max.count() / 1e3;
+		}
+	};
+
+	/// @brief Apply a configuration to the calling thread
+	/// @details Throws std::invalid_argument for invalid CPUs or priorities and an IoException if the
+	/// operating system refuses a setting (e.g. missing privileges for real-time scheduling).
+	void ApplyIoThreadConfig(const IoThreadConfig& config);
+
+	/// @brief Start a thread with a configuration
+	/// @details The configuration is applied by the new thread before it runs the function. If that fails,
+	/// the function is not run and the error is thrown here.
+	template <typename Function>
+	std::thread StartIoThread(const IoThreadConfig& config, Function function)
+	{
+		std::promise<void> configured;
+		auto result = configured.get_future();
+		std::thread thread([config, function = std::move(function), configured = std::move(configured)]() mutable
+		{
+			try
+			{
+				ApplyIoThreadConfig(config);
+			}
+			catch (...)
+			{
+				configured.set_exception(std::current_exception());
+				return;
+			}
+			configured.set_value();
+			function();
+		});
+
+		try
+		{
+			result.get();
+		}
+		catch (...)
+		{
+			thread.join();
+			throw;
+		}
+		return thread;
+	}
+
+	/// @brief Measure how late a thread with a configuration wakes up from periodic sleeps (like cyclictest)
+	/// @details Use it to check that a configuration achieves the required response time on a machine,
+	/// ideally while the application's load is running.
+	/// @param config The configuration of the measuring thread
+	/// @param period Time between wake-ups
+	/// @param num_samples Number of wake-ups
+	SchedulingLatencyStats MeasureSchedulingLatency(const IoThreadConfig& config,
+		std::chrono::microseconds period = std::chrono::microseconds(1000), std::size_t num_samples = 1000);
+}
+
+#endif // SERIAL_PORT_IO_THREAD_H
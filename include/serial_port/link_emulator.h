@@ -0,0 +1,156 @@
+#ifndef SERIAL_PORT_LINK_EMULATOR_H
+#define SERIAL_PORT_LINK_EMULATOR_H
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "io_thread.h"
+#include "serial_port.h"
+
+namespace serial_port
+{
+	/// @brief Properties of an emulated serial link. Both directions behave the same but independently.
+	struct LinkEmulatorOptions
+	{
+		/// @brief Baud rate of the line. 0 uses the baud rate, character size and stop bits that the sending port
+		/// configured, like a real UART would; otherwise the line runs at this rate with num_stop_bits.
+		int baud_rate{ 0 };
+		/// @brief Parity of the line. Pseudo terminals do not keep the parity a port configures, so it is always taken from here.
+		Parity parity{ Parity::kNone };
+		/// @brief Number of stop bits of the line if the baud rate is set
+		NumStopBits num_stop_bits{ NumStopBits::kOne };
+		/// @brief Propagation delay added to every byte on top of its character time
+		std::chrono::microseconds latency{ 0 };
+		/// @brief Probability of a byte being lost on the line
+		double drop_probability{ 0.0 };
+		/// @brief Probability of a byte arriving with one flipped bit
+		double bit_flip_probability{ 0.0 };
+		/// @brief Number of bytes the receiving port buffers before further bytes are lost to an overrun
+		/// (0: limited only by the pseudo terminal)
+		std::size_t rx_buffer_size{ 0 };
+		/// @brief Number of bytes the sending UART buffers before writes to the port block
+		std::size_t tx_buffer_size{ 4096 };
+		/// @brief Seed of the random faults, so that runs can be repeated
+		std::uint32_t seed{ 1 };
+		/// @brief Scheduling settings of the thread that relays the data
+		IoThreadConfig io_thread;
+	};
+
+	/// @brief Direction of an emulated link
+	enum class LinkDirection { kAToB, kBToA };
+
+	/// @brief What happened to the bytes sent in one direction of an emulated link
+	struct LinkStats
+	{
+		/// @brief Number of bytes taken from the sending port and put on the line
+		std::uint64_t num_sent{ 0 };
+		/// @brief Number of bytes handed to the receiving port
+		std::uint64_t num_delivered{ 0 };
+		/// @brief Number of bytes lost on the line
+		std::uint64_t num_dropped{ 0 };
+		/// @brief Number of bytes that got a flipped bit on the line
+		std::uint64_t num_corrupted{ 0 };
+		/// @brief Number of bytes lost because the receiving port's buffer was full
+		std::uint64_t num_overruns{ 0 };
+
+		/// @brief Overloaded stream output operator
+		friend std::ostream& operator<<(std::ostream& os, const LinkStats& obj)
+		{
+			return os << obj.num_sent << " bytes sent, " << obj.num_delivered << " delivered (" << obj.num_corrupted
+				<< " corrupted), " << obj.num_dropped << " dropped, " << obj.num_overruns << " overruns";
+		}
+	};
+
+	/// @brief Two pseudo terminals connected by an emulated serial line
+	/// @details Open one SerialPort on PortNameA() and another one on PortNameB(). A background thread
+	/// moves the bytes between them no faster than a real line would: every byte occupies the line for
+	/// its character time, so throughput, write blocking and timeouts behave as with hardware even
+	/// though pseudo terminals themselves ignore the baud rate. Latency, lost and corrupted bytes and
+	/// receiver overruns can be injected to test how an application copes with them. Timing is as
+	/// accurate as the relay thread's wake-ups, i.e. tens of microseconds on an idle system.
+	class LinkEmulator
+	{
+	public:
+		/// @brief Create the pseudo terminals and start relaying
+		/// @param options Properties of the line
+		explicit LinkEmulator(const LinkEmulatorOptions& options = {});
+		/// @brief Stops relaying and closes the pseudo terminals
+		~LinkEmulator();
+
+		/// @brief LinkEmulator objects may not be copied or moved
+		LinkEmulator(const LinkEmulator&) = delete;
+		LinkEmulator& operator=(const LinkEmulator&) = delete;
+
+		/// @brief Name of the port at one end of the line
+		[[nodiscard]] const std::string& PortNameA() const { return ends_[0].slave_name; }
+		/// @brief Name of the port at the other end of the line
+		[[nodiscard]] const std::string& PortNameB() const { return ends_[1].slave_name; }
+
+		/// @brief Get the statistics of one direction
+		[[nodiscard]] LinkStats GetStats(LinkDirection direction) const;
+
+	private:
+		using TimePoint = std::chrono::steady_clock::time_point;
+
+		// One end of the line: the pseudo terminal a port is opened on
+		struct End
+		{
+			int master{ -1 };
+			// Kept open so that the pseudo terminal does not hang up while no port is open, and to query the
+			// receive buffer
+			int slave{ -1 };
+			std::string slave_name;
+		};
+
+		// A byte on the line
+		struct InFlight
+		{
+			TimePoint arrival;
+			char byte;
+		};
+
+		// Bytes travelling from one end to the other
+		struct Line
+		{
+			const End* from;
+			const End* to;
+			std::deque<InFlight> in_flight;
+			// When the line has finished sending the last byte
+			TimePoint free_at;
+			std::chrono::nanoseconds character_time{ 0 };
+			LinkStats stats;
+		};
+
+		void Run();
+		// Number of bytes waiting for the line to become free
+		[[nodiscard]] std::size_t NumQueued(const Line& line, TimePoint now) const;
+		// Put the bytes written by the sending port on the line
+		void Transmit(Line& line, TimePoint now);
+		// Hand the bytes that have arrived to the receiving port
+		void Deliver(Line& line, TimePoint now);
+		void Close();
+
+		LinkEmulatorOptions options_;
+		End ends_[2];
+		Line lines_[2];
+		std::mt19937 random_;
+		std::string delivered_;
+
+		mutable std::mutex mutex_;
+		std::atomic<bool> running_{ true };
+		std::thread thread_;
+	};
+}
+
+#endif // __linux__
+
+#endif // SERIAL_PORT_LINK_EMULATOR_H
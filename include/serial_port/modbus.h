@@ -0,0 +1,260 @@
+#ifndef SERIAL_PORT_MODBUS_H
+#define SERIAL_PORT_MODBUS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "io_thread.h"
+#include "serial_port.h"
+
+namespace serial_port::modbus
+{
+	/// @brief Modbus function codes supported by the master
+	enum class FunctionCode : std::uint8_t
+	{
+		kReadHoldingRegisters = 0x03,
+		kReadInputRegisters = 0x04,
+		kWriteSingleRegister = 0x06,
+		kWriteMultipleRegisters = 0x10
+	};
+
+	/// @brief Outcome of a single Modbus transaction
+	/// @details kPortError means that the port itself failed, e.g. because the device was unplugged.
+	enum class Status { kOk, kTimeout, kCrcError, kException, kInvalidResponse, kPortError };
+
+	/// @brief The maximum number of registers that may be read with a single request
+	constexpr std::uint16_t kMaxReadRegisters = 125;
+	/// @brief The maximum number of registers that may be written with a single request
+	constexpr std::uint16_t kMaxWriteRegisters = 123;
+
+	/// @brief Response statistics of a single slave
+	struct SlaveStats
+	{
+		/// @brief Number of requests sent to the slave
+		unsigned long requests{ 0 };
+		/// @brief Number of valid responses (including exception responses)
+		unsigned long responses{ 0 };
+		/// @brief Number of requests that were not answered in time
+		unsigned long timeouts{ 0 };
+		/// @brief Number of responses with a bad CRC or an unexpected layout
+		unsigned long errors{ 0 };
+		/// @brief Number of exception responses
+		unsigned long exceptions{ 0 };
+		/// @brief Number of requests that failed because the port could not be written or read
+		unsigned long port_errors{ 0 };
+		/// @brief Shortest time between sending a request and receiving the complete response
+		std::chrono::microseconds min_latency{ std::chrono::microseconds::max() };
+		/// @brief Longest time between sending a request and receiving the complete response
+		std::chrono::microseconds max_latency{ 0 };
+		/// @brief Sum of all response latencies
+		std::chrono::microseconds total_latency{ 0 };
+
+		/// @brief Average response latency
+		[[nodiscard]] std::chrono::microseconds MeanLatency() const
+		{
+			return responses == 0 ? std::chrono::microseconds(0) : total_latency / static_cast<long>(responses);
+		}
+
+		/// @brief Overloaded stream output operator
+		friend std::ostream& operator<<(std::ostream& os, const SlaveStats& obj)
+		{
+			return os
+				<< "Requests: " << obj.requests
+				<< "\tResponses: " << obj.responses
+				<< "\tTimeouts: " << obj.timeouts
+				<< "\tErrors: " << obj.errors
+				<< "\tExceptions: " << obj.exceptions
+				<< "\tPort errors: " << obj.port_errors
+				<< "\tLatency [us] min/mean/max: "
+				<< (obj.responses == 0 ? 0 : obj.min_latency.count()) << "/"
+				<< obj.MeanLatency().count() << "/"
+				<< obj.max_latency.count();
+		}
+	};
+
+	/// @brief A Modbus RTU master on a single bus
+	/// @details The master does not own the port. The port must be open and outlive the master.
+	/// Responses are read by their expected length, so the next request can be sent as soon as the
+	/// inter-frame delay has elapsed.
+	class Master
+	{
+	public:
+		/// @brief Create a master on an (opened) port
+		/// @param port The port the bus is connected to
+		/// @param response_timeout Maximum time to wait for a complete response
+		explicit Master(SerialPort& port, std::chrono::milliseconds response_timeout = std::chrono::milliseconds(100));
+
+		/// @brief Read holding registers (function code 0x03). Throws an IoException on failure.
+		std::vector<std::uint16_t> ReadHoldingRegisters(std::uint8_t slave, std::uint16_t address, std::uint16_t count);
+		/// @brief Read input registers (function code 0x04). Throws an IoException on failure.
+		std::vector<std::uint16_t> ReadInputRegisters(std::uint8_t slave, std::uint16_t address, std::uint16_t count);
+		/// @brief Write a single holding register (function code 0x06). Throws an IoException on failure.
+		void WriteSingleRegister(std::uint8_t slave, std::uint16_t address, std::uint16_t value);
+		/// @brief Write consecutive holding registers (function code 0x10). Throws an IoException on failure.
+		void WriteMultipleRegisters(std::uint8_t slave, std::uint16_t address, const std::vector<std::uint16_t>& values);
+
+		/// @brief Send a complete request frame (including CRC) and receive the response. Does not throw on protocol
+		/// or port errors.
+		/// @param request The request frame
+		/// @param response Receives the response frame. Its capacity is reused between calls.
+		/// @param expected_length The length of a regular (non-exception) response in bytes
+		/// @return The outcome of the transaction. For kException, response[2] holds the exception code.
+		Status Transact(const std::vector<std::uint8_t>& request, std::vector<std::uint8_t>& response, std::size_t expected_length);
+
+		/// @brief Build a read request frame for function codes 0x03 and 0x04
+		static std::vector<std::uint8_t> MakeReadRequest(std::uint8_t slave, FunctionCode function, std::uint16_t address, std::uint16_t count);
+
+		/// @brief Set the minimum silent interval between two frames (t3.5). Defaults to the value required for the port's baud rate.
+		void SetInterFrameDelay(std::chrono::microseconds delay) { inter_frame_delay_ = delay; }
+		/// @brief Get the minimum silent interval between two frames
+		[[nodiscard]] std::chrono::microseconds GetInterFrameDelay() const { return inter_frame_delay_; }
+
+		/// @brief Get a snapshot of the response statistics of all slaves addressed so far
+		[[nodiscard]] std::map<std::uint8_t, SlaveStats> GetSlaveStats() const;
+
+	private:
+		std::vector<std::uint16_t> ReadRegisters(std::uint8_t slave, FunctionCode function, std::uint16_t address, std::uint16_t count);
+		void Execute(const std::vector<std::uint8_t>& request, std::size_t expected_length);
+
+		SerialPort& port_;
+		std::chrono::milliseconds response_timeout_;
+		std::chrono::microseconds inter_frame_delay_;
+		std::chrono::steady_clock::time_point last_frame_end_{};
+		std::vector<std::uint8_t> response_;
+
+		mutable std::mutex stats_mutex_;
+		std::map<std::uint8_t, SlaveStats> stats_;
+	};
+
+	/// @brief Result of a polled register block, passed to the block's callback
+	struct PollResult
+	{
+		/// @brief Address of the slave
+		std::uint8_t slave{ 0 };
+		/// @brief Function code used to read the registers
+		FunctionCode function{ FunctionCode::kReadHoldingRegisters };
+		/// @brief First register of the block
+		std::uint16_t address{ 0 };
+		/// @brief Number of registers in the block
+		std::uint16_t count{ 0 };
+		/// @brief Outcome of the request the block was read with
+		Status status{ Status::kOk };
+		/// @brief Modbus exception code if status is kException
+		std::uint8_t exception_code{ 0 };
+		/// @brief The register values (count elements) if status is kOk. Only valid during the callback.
+		const std::uint16_t* values{ nullptr };
+	};
+
+	/// @brief Callback receiving the result of a polled register block
+	using PollCallback = std::function<void(const PollResult&)>;
+
+	/// @brief Cyclically polls register blocks on many buses
+	/// @details Each bus is served by its own thread, so all buses are polled in parallel. On each bus,
+	/// reads of adjacent (or nearly adjacent) registers of the same slave are coalesced into as few
+	/// requests as possible, and the request frames are precomputed so that requests are sent back to back.
+	/// When the port of a bus fails, the rest of the cycle's blocks on that bus are reported with
+	/// Status::kPortError without being sent, and background polling of that bus backs off for a while.
+	/// The other buses are not affected.
+	class PollScheduler
+	{
+	public:
+		/// @brief Create a scheduler
+		/// @param response_timeout Maximum time to wait for a complete response
+		explicit PollScheduler(std::chrono::milliseconds response_timeout = std::chrono::milliseconds(100));
+		/// @brief Stops polling
+		~PollScheduler();
+
+		/// @brief PollScheduler objects may not be copied or moved
+		PollScheduler(const PollScheduler&) = delete;
+		PollScheduler& operator=(const PollScheduler&) = delete;
+
+		/// @brief Add a bus. The port must be open and outlive the scheduler.
+		/// @return The index of the bus
+		std::size_t AddBus(SerialPort& port);
+		/// @brief Get the master of a bus, e.g. to adjust the inter-frame delay
+		Master& GetMaster(std::size_t bus);
+
+		/// @brief Register a block of registers to be polled. May not be called while polling.
+		/// @param bus The bus index returned by AddBus()
+		/// @param slave Address of the slave
+		/// @param function kReadHoldingRegisters or kReadInputRegisters
+		/// @param address First register
+		/// @param count Number of registers
+		/// @param callback Called with the values after every poll of the block
+		void AddRead(std::size_t bus, std::uint8_t slave, FunctionCode function,
+			std::uint16_t address, std::uint16_t count, PollCallback callback);
+
+		/// @brief Allow coalescing of blocks that are up to this many registers apart (default: 0, only adjacent or overlapping blocks)
+		void SetMaxGap(std::uint16_t num_registers);
+
+		/// @brief Get the number of requests that are sent on a bus during one cycle (after coalescing)
+		[[nodiscard]] std::size_t NumRequests(std::size_t bus);
+
+		/// @brief Poll every block once on all buses in parallel and return when done
+		/// @details The calling thread serves the first bus.
+		/// @param io_thread Scheduling settings of the threads serving the other buses
+		void PollOnce(const IoThreadConfig& io_thread = {});
+		/// @brief Start polling continuously in the background
+		/// @param cycle_period Minimum duration of one polling cycle on each bus (0: poll back to back)
+		/// @param io_thread Scheduling settings of the polling threads
+		void Start(std::chrono::milliseconds cycle_period = std::chrono::milliseconds(0), const IoThreadConfig& io_thread = {});
+		/// @brief Stop background polling
+		void Stop();
+		/// @brief Returns whether background polling is active
+		[[nodiscard]] bool IsRunning() const { return running_; }
+
+		/// @brief Get the response statistics of all slaves, keyed by (bus, slave address)
+		[[nodiscard]] std::map<std::pair<std::size_t, std::uint8_t>, SlaveStats> GetSlaveStats() const;
+
+	private:
+		struct Item
+		{
+			std::uint8_t slave;
+			FunctionCode function;
+			std::uint16_t address;
+			std::uint16_t count;
+			PollCallback callback;
+		};
+
+		struct Request
+		{
+			std::uint8_t slave;
+			FunctionCode function;
+			std::uint16_t address;
+			std::uint16_t count;
+			std::vector<std::uint8_t> frame;
+			std::vector<std::size_t> items;
+		};
+
+		struct Bus
+		{
+			std::unique_ptr<Master> master;
+			std::vector<Item> items;
+			std::vector<Request> requests;
+			std::vector<std::uint8_t> response;
+			std::vector<std::uint16_t> values;
+			bool planned{ false };
+		};
+
+		void Plan(Bus& bus) const;
+		// Returns false if the port failed
+		bool RunCycle(Bus& bus) const;
+
+		std::chrono::milliseconds response_timeout_;
+		std::uint16_t max_gap_{ 0 };
+		std::vector<std::unique_ptr<Bus>> buses_;
+		std::vector<std::thread> threads_;
+		std::atomic<bool> running_{ false };
+	};
+}
+
+#endif // SERIAL_PORT_MODBUS_H
@@ -0,0 +1,68 @@
+#ifndef SERIAL_PORT_MODEM_MONITOR_H
+#define SERIAL_PORT_MODEM_MONITOR_H
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "io_thread.h"
+#include "serial_port.h"
+
+namespace serial_port
+{
+	/// @brief Called with the new state of all modem lines and the watched lines that changed
+	using ModemLineHandler = std::function<void(ModemLine lines, ModemLine changed)>;
+
+	/// @brief Calls a handler whenever watched modem status lines change
+	/// @details A thread sleeps in SerialPort::WaitForModemLineChange(), so no CPU time is spent between
+	/// changes. If the driver keeps line counters, short pulses that are over before the thread wakes up
+	/// are reported as well. To stop the thread, it is woken with the signal SIGRTMIN, for which a handler
+	/// that does nothing is installed. The application must therefore leave SIGRTMIN alone; the constructor
+	/// throws an IoException if a handler is already installed for it.
+	class ModemLineMonitor
+	{
+	public:
+		/// @brief Start monitoring an (opened) port. Throws an IoException if the port has no modem lines.
+		/// @param port The port. It must outlive the monitor.
+		/// @param handler Called from the monitor's thread. Must not call Stop().
+		/// @param lines A mask of the status lines (CTS, DSR, DCD, RI) to watch
+		/// @param io_thread Scheduling settings of the monitor's thread
+		ModemLineMonitor(SerialPort& port, ModemLineHandler handler, ModemLine lines = ModemLine::kAllStatus,
+			const IoThreadConfig& io_thread = {});
+		/// @brief Stops monitoring
+		~ModemLineMonitor();
+
+		ModemLineMonitor(const ModemLineMonitor&) = delete;
+		ModemLineMonitor& operator=(const ModemLineMonitor&) = delete;
+
+		/// @brief Stop monitoring. Rethrows the error that ended the monitoring early, if any.
+		void Stop();
+
+	private:
+		void Run();
+		void Join();
+
+		SerialPort& port_;
+		ModemLineHandler handler_;
+		ModemLine lines_;
+		bool has_counters_{ false };
+		ModemLine state_{ ModemLine::kNone };
+		LineCounters counters_;
+
+		std::atomic<bool> running_{ true };
+		std::mutex mutex_;
+		std::condition_variable finished_condition_;
+		bool finished_{ false };
+		std::exception_ptr error_;
+		std::thread thread_;
+	};
+}
+
+#endif // __linux__
+
+#endif // SERIAL_PORT_MODEM_MONITOR_H
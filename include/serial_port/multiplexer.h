@@ -0,0 +1,159 @@
+#ifndef SERIAL_PORT_MULTIPLEXER_H
+#define SERIAL_PORT_MULTIPLEXER_H
+
+#if defined(__linux__)
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "event_loop.h"
+#include "io_thread.h"
+#include "serial_port.h"
+#include "transaction.h"
+
+namespace serial_port
+{
+	/// @brief What to do with a client that does not read the received data fast enough
+	enum class SlowClientPolicy
+	{
+		/// @brief Disconnect the client
+		kDisconnect,
+		/// @brief Drop the oldest data queued for the client (the client sees a gap in the stream)
+		kDropOldest
+	};
+
+	/// @brief Options of a Multiplexer
+	struct MultiplexerOptions
+	{
+		/// @brief Maximum number of bytes queued per client and direction (in addition to the socket buffers)
+		std::size_t max_client_buffer{ 64 * 1024 };
+		/// @brief What to do when a client's receive queue is full
+		SlowClientPolicy slow_client_policy{ SlowClientPolicy::kDisconnect };
+		/// @brief Splits the data sent by a client into frames. Every frame is written to the port in one
+		/// piece, so frames of different clients are never interleaved. An empty framer forwards data as it arrives.
+		Framer tx_framer{ DelimiterFramer() };
+		/// @brief Maximum number of connected clients. Further connections are closed right away.
+		std::size_t max_clients{ 64 };
+		/// @brief Scheduling settings of the thread that serves the port and the clients
+		IoThreadConfig io_thread;
+	};
+
+	/// @brief Statistics of a Multiplexer
+	struct MultiplexerStats
+	{
+		/// @brief Number of currently connected clients
+		std::size_t num_clients{ 0 };
+		/// @brief Number of accepted connections
+		unsigned long clients_accepted{ 0 };
+		/// @brief Number of connections closed because max_clients were connected
+		unsigned long clients_rejected{ 0 };
+		/// @brief Number of clients disconnected because they did not keep up (SlowClientPolicy::kDisconnect)
+		unsigned long slow_clients_disconnected{ 0 };
+		/// @brief Number of bytes received from the port
+		unsigned long long rx_bytes{ 0 };
+		/// @brief Number of received bytes dropped for slow clients (SlowClientPolicy::kDropOldest), summed over all clients
+		unsigned long long rx_bytes_dropped{ 0 };
+		/// @brief Number of bytes written to the port
+		unsigned long long tx_bytes{ 0 };
+		/// @brief Number of frames written to the port
+		unsigned long tx_frames{ 0 };
+
+		/// @brief Overloaded stream output operator
+		friend std::ostream& operator<<(std::ostream& os, const MultiplexerStats& obj)
+		{
+			return os
+				<< "Clients: " << obj.num_clients << " connected, " << obj.clients_accepted << " accepted, "
+				<< obj.clients_rejected << " rejected, " << obj.slow_clients_disconnected << " disconnected as slow" << std::endl
+				<< "RX: " << obj.rx_bytes << " bytes, " << obj.rx_bytes_dropped << " bytes dropped" << std::endl
+				<< "TX: " << obj.tx_bytes << " bytes in " << obj.tx_frames << " frames";
+		}
+	};
+
+	/// @brief Shares one port between many local processes over a Unix domain socket
+	/// @details Every byte received from the port is sent to all connected clients. Data sent by clients
+	/// is split into frames, which are written to the port in round-robin order between the clients.
+	/// A client that sends faster than the port can transmit is not read until its queue drains.
+	/// All work is done by an internal event loop thread. The multiplexer does not own the port, but
+	/// the port must be open and outlive the multiplexer, and must not be used by anyone else meanwhile.
+	class Multiplexer
+	{
+	public:
+		/// @brief Start serving a port
+		/// @param port The (opened) port
+		/// @param socket_path Path of the listening socket. An existing socket at this path is replaced.
+		/// @param options Buffering, slow client and framing options
+		Multiplexer(SerialPort& port, std::string socket_path, MultiplexerOptions options = {});
+		/// @brief Disconnects all clients and removes the socket
+		~Multiplexer();
+
+		/// @brief Multiplexer objects may not be copied or moved
+		Multiplexer(const Multiplexer&) = delete;
+		Multiplexer& operator=(const Multiplexer&) = delete;
+
+		/// @brief Get the path of the listening socket
+		[[nodiscard]] const std::string& GetSocketPath() const { return socket_path_; }
+		/// @brief Get the number of connected clients
+		[[nodiscard]] std::size_t NumClients() const;
+		/// @brief Get the statistics
+		[[nodiscard]] MultiplexerStats GetStats() const;
+
+	private:
+		using ClientId = std::uint64_t;
+
+		struct Client
+		{
+			int fd;
+			std::string rx_queue;
+			std::size_t rx_sent{ 0 };
+			std::string tx_partial;
+			std::deque<std::string> tx_frames;
+			std::size_t tx_queued{ 0 };
+			EventLoop::OperationId read_op{ 0 };
+			EventLoop::OperationId write_op{ 0 };
+		};
+
+		void Accept();
+		void ReadPort();
+		void WritePort();
+		bool NextFrame();
+		void Broadcast(const char* data, std::size_t num_bytes);
+		void ReadClient(ClientId id);
+		void FlushClient(ClientId id);
+		void QueueFrame(ClientId id, Client& client, std::string frame);
+		void WaitForClient(ClientId id, Client& client);
+		void CloseClient(ClientId id);
+
+		SerialPort& port_;
+		std::string socket_path_;
+		MultiplexerOptions options_;
+		int port_fd_;
+		int saved_flags_;
+		int listen_fd_{ -1 };
+
+		EventLoop loop_;
+		EventLoop::OperationId accept_op_{ 0 };
+		EventLoop::OperationId port_read_op_{ 0 };
+		EventLoop::OperationId port_write_op_{ 0 };
+		std::vector<char> rx_chunk_;
+		std::string tx_frame_;
+		std::size_t tx_written_{ 0 };
+		ClientId next_client_id_{ 1 };
+		std::map<ClientId, std::unique_ptr<Client>> clients_;
+		std::deque<ClientId> tx_ready_;
+
+		mutable std::mutex stats_mutex_;
+		MultiplexerStats stats_;
+		std::thread thread_;
+	};
+}
+
+#endif // __linux__
+
+#endif // SERIAL_PORT_MULTIPLEXER_H
@@ -0,0 +1,146 @@
+#ifndef SERIAL_PORT_PRIORITY_WRITER_H
+#define SERIAL_PORT_PRIORITY_WRITER_H
+
+#if defined(__linux__)
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+#include "io_thread.h"
+#include "serial_port.h"
+
+namespace serial_port
+{
+	/// @brief Priority of a frame sent with a PriorityWriter, most urgent first
+	enum class TxPriority { kUrgent, kHigh, kNormal, kBulk };
+
+	/// @brief Number of TxPriority values
+	constexpr std::size_t kNumTxPriorities = 4;
+
+	/// @brief Options of a PriorityWriter
+	struct PriorityWriterOptions
+	{
+		/// @brief Maximum number of bytes in the driver's output queue. An urgent frame waits for at most
+		/// this many bytes plus the rest of the frame being written.
+		std::size_t max_queued_bytes{ 256 };
+		/// @brief Also estimate the output queue from the baud rate. Needed for devices whose driver does not
+		/// report the queue (TIOCOUTQ), like pseudo terminals and many USB adapters. Limits the throughput to
+		/// the baud rate.
+		bool estimate_queue{ false };
+		/// @brief Maximum number of bytes waiting in each priority. Frames that do not fit are rejected.
+		std::size_t max_pending_bytes{ 16 << 20 };
+		/// @brief Scheduling settings of the writing thread
+		IoThreadConfig io_thread;
+	};
+
+	/// @brief Statistics of one priority of a PriorityWriter
+	struct PriorityWriterStats
+	{
+		/// @brief Number of frames written
+		unsigned long num_frames{ 0 };
+		/// @brief Number of bytes written
+		unsigned long num_bytes{ 0 };
+		/// @brief Number of frames rejected because the priority's queue was full
+		unsigned long num_rejected{ 0 };
+		/// @brief Number of frames that could not be written completely
+		unsigned long num_write_errors{ 0 };
+		/// @brief Time from Send() until the last byte of a frame was handed to the driver
+		LatencyHistogram latency;
+
+		/// @brief Overloaded stream output operator
+		friend std::ostream& operator<<(std::ostream& os, const PriorityWriterStats& obj)
+		{
+			const auto us = [](const std::chrono::nanoseconds duration) { return std::chrono::duration<double, std::micro>(duration).count(); };
+			return os
+				<< obj.num_frames << " frames, " << obj.num_bytes << " bytes, " << obj.num_rejected << " rejected, "
+				<< obj.num_write_errors << " write errors, latency [us]: p50 < " << us(obj.latency.Percentile(0.5))
+				<< ", p99 < " << us(obj.latency.Percentile(0.99)) << ", max " << us(obj.latency.max);
+		}
+	};
+
+	/// @brief Writes frames to a port from a background thread, more urgent frames first
+	/// @details Every priority has its own queue. Frames are never interleaved: the writer always finishes
+	/// the frame it is writing and then takes the oldest frame of the most urgent non-empty queue. To let
+	/// urgent frames overtake data that has already left the queues, the writer keeps the driver's output
+	/// queue below max_queued_bytes and hands over each frame in pieces as the queue drains. The worst-case
+	/// latency of an urgent frame is therefore the rest of the frame being written plus max_queued_bytes
+	/// character times, so split large transfers into frames of moderate size.
+	/// The port must be open, must outlive the writer and must not be written by anyone else meanwhile.
+	class PriorityWriter
+	{
+	public:
+		/// @brief Start writing
+		/// @param port The port
+		/// @param options Queue limits
+		explicit PriorityWriter(SerialPort& port, const PriorityWriterOptions& options = {});
+		/// @brief Stops writing. Frames that have not been written are discarded.
+		~PriorityWriter();
+
+		/// @brief PriorityWriter objects may not be copied or moved
+		PriorityWriter(const PriorityWriter&) = delete;
+		PriorityWriter& operator=(const PriorityWriter&) = delete;
+
+		/// @brief Queue a frame
+		/// @param frame The frame
+		/// @param priority Its priority
+		/// @return False if the frame was rejected because its queue is full
+		bool Send(std::string frame, TxPriority priority = TxPriority::kNormal);
+		/// @brief Wait until all queued frames have been handed to the driver
+		/// @param timeout Maximum time to wait
+		/// @return False if the timeout expired
+		bool WaitUntilSent(std::chrono::milliseconds timeout);
+
+		/// @brief Number of bytes waiting in a queue (not counting the frame being written)
+		[[nodiscard]] std::size_t NumPendingBytes(TxPriority priority) const;
+		/// @brief Get the statistics of a priority
+		[[nodiscard]] PriorityWriterStats GetStats(TxPriority priority) const;
+
+	private:
+		using TimePoint = std::chrono::steady_clock::time_point;
+
+		struct Frame
+		{
+			std::string data;
+			TimePoint queued;
+		};
+
+		struct Lane
+		{
+			std::deque<Frame> frames;
+			std::size_t num_pending_bytes{ 0 };
+			PriorityWriterStats stats;
+		};
+
+		void Run();
+		// Write a frame in pieces that keep the output queue short. Returns false on a write error.
+		bool Write(const std::string& data);
+		// Number of bytes in the driver's output queue (or the estimate, if larger)
+		[[nodiscard]] std::size_t NumQueued(TimePoint now) const;
+
+		SerialPort& port_;
+		PriorityWriterOptions options_;
+		std::chrono::nanoseconds character_time_;
+		// When the line is expected to have sent everything written so far
+		TimePoint drained_at_;
+
+		mutable std::mutex mutex_;
+		std::condition_variable queued_;
+		std::condition_variable sent_;
+		std::array<Lane, kNumTxPriorities> lanes_;
+		bool writing_{ false };
+
+		std::atomic<bool> running_{ true };
+		std::thread thread_;
+	};
+}
+
+#endif // __linux__
+
+#endif // SERIAL_PORT_PRIORITY_WRITER_H
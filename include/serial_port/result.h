@@ -0,0 +1,88 @@
+#ifndef SERIAL_PORT_RESULT_H
+#define SERIAL_PORT_RESULT_H
+
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+namespace serial_port
+{
+	/// @brief Errors reported by the non-throwing (Try...) methods
+	/// @details Errors that do not fit one of these are reported with their system error code (std::system_category()).
+	enum class Errc
+	{
+		/// @brief No data arrived within the timeout
+		kTimeout = 1,
+		/// @brief The operation would have to wait (EAGAIN), e.g. a read without a timeout while no data is available
+		kWouldBlock,
+		/// @brief The call was interrupted by a signal (EINTR) and can be retried
+		kInterrupted,
+		/// @brief The device hung up or went away (e.g. a USB adapter was unplugged). The port must be reopened.
+		kDisconnected,
+		/// @brief The port is not open
+		kNotOpen
+	};
+
+	/// @brief The error category of Errc
+	const std::error_category& ErrorCategory() noexcept;
+
+	/// @brief Make an error code from an Errc (found by argument-dependent lookup, hence the name)
+	inline std::error_code make_error_code(const Errc error) noexcept
+	{
+		return { static_cast<int>(error), ErrorCategory() };
+	}
+
+	/// @brief The outcome of a non-throwing operation: either a value or an error code
+	/// @details Checking a Result costs a comparison, so it is suitable for hot loops where exceptions
+	/// are too expensive or an error is an expected outcome (e.g. a timeout).
+	/// @tparam T The type of the value. Must be default constructible.
+	template <typename T>
+	class Result
+	{
+	public:
+		/// @brief A successful result
+		Result(T value) : value_(std::move(value)) {}  // NOLINT(google-explicit-constructor)
+		/// @brief A failed result
+		Result(const std::error_code error) : error_(error) {}  // NOLINT(google-explicit-constructor)
+		/// @brief A failed result
+		Result(const Errc error) : error_(make_error_code(error)) {}  // NOLINT(google-explicit-constructor)
+
+		/// @brief Returns whether the operation succeeded
+		[[nodiscard]] bool HasValue() const noexcept { return !error_; }
+		/// @brief Returns whether the operation succeeded
+		explicit operator bool() const noexcept { return HasValue(); }
+
+		/// @brief Get the value. Throws a std::system_error (an IoException) if the operation failed.
+		[[nodiscard]] const T& Value() const
+		{
+			if (error_)
+			{
+				throw std::system_error(error_);
+			}
+			return value_;
+		}
+		/// @brief Get the value, or a fallback if the operation failed
+		[[nodiscard]] T ValueOr(T fallback) const { return error_ ? std::move(fallback) : value_; }
+		/// @brief Get the value without checking for an error
+		const T& operator*() const noexcept { return value_; }
+
+		/// @brief Get the error (false if the operation succeeded)
+		[[nodiscard]] std::error_code Error() const noexcept { return error_; }
+
+	private:
+		T value_{};
+		std::error_code error_;
+	};
+}
+
+namespace std
+{
+	/// @brief Allow comparing error codes with Errc values
+	template <>
+	struct is_error_code_enum<serial_port::Errc> : true_type
+	{
+	};
+}
+
+#endif // SERIAL_PORT_RESULT_H
@@ -1,12 +1,22 @@
 #ifndef SERIAL_PORT_H
 #define SERIAL_PORT_H
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
 #include <memory>
+#include <memory_resource>
 #include <ostream>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 #include <string>
 
 #include "../src/interface.h"
+#include "byte_order.h"
+#include "io_thread.h"
+#include "result.h"
 #include "types.h"
 
 namespace serial_port
@@ -49,25 +59,106 @@ namespace serial_port
         /// @return A list of PortInfo objects describing the available ports
         static std::vector<PortInfo> EnumeratePorts();
 
+        /// @brief Open many ports concurrently
+        /// @details The ports are opened and configured by a bounded pool of worker threads, so the total
+        /// time is governed by the slowest ports rather than the sum of all ports. Errors do not throw
+        /// but are reported in the results. The calling thread acts as one of the workers.
+        /// @param ports The ports to open. Ports that are already open are reopened.
+        /// @param max_workers Maximum number of worker threads
+        /// @param io_thread Scheduling settings of the additional worker threads. Throws if they cannot be applied.
+        /// @return One result per port, in the order of the ports
+        static std::vector<OpenResult> OpenAll(std::vector<SerialPort>& ports, std::size_t max_workers = 16,
+            const IoThreadConfig& io_thread = {});
+
         /// @brief Open the port with the current settings. If a port was opened through this object previously, it will be closed first.
+        /// Data that was read ahead into the internal line buffer is discarded.
         void Open() const;
-        /// @brief Close the port.
+        /// @brief Close the port and discard the data in the internal line buffer.
         void Close() const;
         /// @brief Returns whether or not the port is currently open
         [[nodiscard]] bool IsOpen() const;
+        /// @brief Get the operating system's handle of the port, e.g. to wait for it in an event loop
+        /// @details Reading from the handle directly bypasses the port's internal line buffer.
+        [[nodiscard]] NativeHandle GetNativeHandle() const;
         /// @brief Get the currently defined settings
         [[nodiscard]] const Settings& GetSettings() const;
-        /// @brief Return the number of bytes available in the RX buffer
+        /// @brief Change baud rate, parity, stop bits and flow control of the port
+        /// @details An open port is reconfigured in place with a single call (on Linux), without closing it.
+        /// Closed ports just store the settings for the next Open().
+        /// @param settings The new settings. The port name of an open port cannot be changed.
+        /// @param drain Wait until all pending output has been transmitted before changing the settings
+        void ApplySettings(const Settings& settings, bool drain = false) const;
+        /// @brief Return the number of bytes available in the RX buffer (including bytes already read into the internal line buffer)
         [[nodiscard]] unsigned long NumBytesAvailable() const;
         /// @brief Flush the RX and TX buffers
         void FlushBuffer() const;
+        /// @brief Wait until data is available in the RX buffer
+        /// @param timeout The maximum time to wait
+        /// @return True if data is available or the device hung up (the next read reports it), false if the timeout expired
+        [[nodiscard]] bool WaitForData(std::chrono::milliseconds timeout) const;
+        /// @brief Get the driver's traffic and error counters (Linux only, and only for real UARTs)
+        /// @details Overruns, framing and parity errors are counted by the driver even though the affected
+        /// bytes never reach the application. Throws an IoException if the device does not keep counters.
+        [[nodiscard]] LineCounters GetLineCounters() const;
+        /// @brief Get the current state of the modem lines
+        /// @return A mask of the lines that are asserted. Throws an IoException if the device has no modem lines.
+        [[nodiscard]] ModemLine GetModemLines() const;
+        /// @brief Block until one of the given status lines changes (Linux only)
+        /// @details The thread sleeps in the driver until the change is reported, so no polling is involved.
+        /// The wait may end early if the thread receives a signal. See ModemLineMonitor for a callback-based wait.
+        /// @param lines A mask of the status lines (CTS, DSR, DCD, RI) to watch
+        /// @return The new state of all modem lines
+        ModemLine WaitForModemLineChange(ModemLine lines = ModemLine::kAllStatus) const;
+        /// @brief Spin before sleeping when a read has to wait for data (Linux only)
+        /// @details A blocking read sleeps in the kernel and pays the wake-up latency of the scheduler when
+        /// data arrives. With a spin budget, reads and WaitForData() first poll the number of available bytes
+        /// in a loop and only go to sleep when the budget is used up. This trades one CPU core for latency
+        /// while waiting, so enable it on chosen ports only and pin the reading thread (see IoThreadConfig).
+        /// @param spin_budget Maximum time to spin per wait. 0 disables spinning.
+        void SetBusyPoll(std::chrono::nanoseconds spin_budget) const;
+        /// @brief Get the spin/sleep counts and the wait latency distribution of busy-poll reads
+        [[nodiscard]] BusyPollStats GetBusyPollStats() const;
         /// @brief Read data from the port.
         /// @param data A pointer to a char array. Must be at least num_bytes elements long!
         /// @param num_bytes The number of bytes to attempt to read from the port
-        /// @return The actual number of bytes read
+        /// @return The actual number of bytes read. Errors show up as a count larger than num_bytes; use TryReadData() to tell them apart.
         unsigned long ReadData(char* data, unsigned long num_bytes) const;
         /// @brief Read a string from the port terminated with a '\\n' symbol.
+        /// @details Throws an IoException if the port fails (e.g. the device hangs up) before the line is complete.
         [[nodiscard]] std::string ReadString() const;
+        /// @brief Read a string terminated with a '\\n' symbol into an existing string, reusing its capacity.
+        /// @param str Receives the string
+        /// @return The length of the string
+        std::size_t ReadString(std::string& str) const;
+        /// @brief Read a string terminated with a '\\n' symbol into an existing string, reusing its capacity.
+        /// @param str Receives the string. Any additional memory is allocated from the string's memory resource.
+        /// @return The length of the string
+        std::size_t ReadString(std::pmr::string& str) const;
+        /// @brief Read all complete lines (terminated with a '\\n' symbol) that are currently available. Does not block.
+        /// @details Available data is read with a single call. Incomplete lines are kept for the next read.
+        /// @param lines Receives the lines. Existing strings are overwritten so that their capacity is reused.
+        /// The vector never shrinks: only the first N strings (N being the return value) are valid, the ones
+        /// after them are empty and kept for larger bursts.
+        /// @param max_lines The maximum number of lines to return. Further lines are kept for the next read.
+        /// @return The number of lines read
+        std::size_t ReadLines(std::vector<std::string>& lines,
+            std::size_t max_lines = std::numeric_limits<std::size_t>::max()) const;
+        /// @brief Read all complete lines that are currently available into strings allocated from a memory resource. Does not block.
+        /// @param lines Receives the lines. New strings are allocated from the vector's memory resource. As with the
+        /// overload above, only the first N strings are valid and the vector never shrinks.
+        /// @param max_lines The maximum number of lines to return. Further lines are kept for the next read.
+        /// @return The number of lines read
+        std::size_t ReadLines(std::pmr::vector<std::pmr::string>& lines,
+            std::size_t max_lines = std::numeric_limits<std::size_t>::max()) const;
+        /// @brief Read all complete lines that are currently available without copying them. Does not block.
+        /// @param max_lines The maximum number of lines to return. Further lines are kept for the next read.
+        /// @return Views of the lines. They are only valid until the next read from the port.
+        [[nodiscard]] const std::pmr::vector<std::string_view>& ReadLineViews(
+            std::size_t max_lines = std::numeric_limits<std::size_t>::max()) const;
+        /// @brief Allocate the port's internal read buffers from a memory resource
+        /// @details Once the buffers have grown to the size of the largest burst, reading does not allocate any more.
+        /// @param resource The memory resource. It must outlive the port.
+        void SetMemoryResource(std::pmr::memory_resource* resource) const;
         /// @brief Write data to the port
         /// @param data An array of bytes to write
         /// @param num_bytes the number of bytes in the array
@@ -77,6 +168,101 @@ namespace serial_port
         /// @param str A string terminated by a '\\n' symbol
         /// @return The number of bytes actually written
         unsigned long WriteString(const std::string& str) const;  // NOLINT(modernize-use-nodiscard)
+
+        /// @name Non-throwing API
+        /// @brief Variants that report errors as a std::error_code instead of throwing or returning an
+        /// invalid byte count, for hot loops and for code that treats errors as expected outcomes.
+        /// Compare the errors with Errc (e.g. result.Error() == Errc::kTimeout); other errors carry their
+        /// system error code.
+        /// @{
+        /// @brief Open the port with the current settings (see Open())
+        /// @return The error, or an empty error code if the port was opened
+        [[nodiscard]] std::error_code TryOpen() const noexcept;
+        /// @brief Get the number of bytes available, including those already read into the internal line buffer
+        [[nodiscard]] Result<std::size_t> TryNumBytesAvailable() const noexcept;
+        /// @brief Flush the RX and TX buffers and the internal line buffer
+        [[nodiscard]] std::error_code TryFlushBuffer() const noexcept;
+        /// @brief Get the driver's traffic and error counters (see GetLineCounters())
+        [[nodiscard]] Result<LineCounters> TryGetLineCounters() const noexcept;
+        /// @brief Get the current state of the modem lines
+        [[nodiscard]] Result<ModemLine> TryGetModemLines() const noexcept;
+        /// @brief Wait for data and read what is available
+        /// @details Unlike ReadData(), a failed read is never mistaken for data: Errc::kTimeout if nothing
+        /// arrived within the timeout, Errc::kWouldBlock if the timeout is 0 and nothing is available,
+        /// Errc::kInterrupted on a signal and Errc::kDisconnected if the device hung up. Bytes already read
+        /// into the internal line buffer (e.g. by ReadString()) are returned first, without waiting.
+        /// @param data A pointer to a char array. Must be at least num_bytes elements long!
+        /// @param num_bytes The maximum number of bytes to read
+        /// @param timeout Maximum time to wait for data. 0 does not wait, a negative timeout waits forever.
+        /// @return The number of bytes read (at least 1, unless num_bytes is 0)
+        [[nodiscard]] Result<std::size_t> TryReadData(char* data, std::size_t num_bytes,
+            std::chrono::milliseconds timeout = std::chrono::milliseconds(-1)) const noexcept;
+        /// @brief Write data to the port
+        /// @return The number of bytes written, which may be less than num_bytes
+        [[nodiscard]] Result<std::size_t> TryWriteData(const char* data, std::size_t num_bytes) const noexcept;
+        /// @}
+
+        /// @brief Write a value in binary form
+        /// @tparam kOrder The byte order on the wire
+        /// @param value An arithmetic value, an enumeration, an array, or a struct that provides SwapEndian() (see SwapBytes())
+        template <Endian kOrder = Endian::kLittle, typename T>
+        void Write(const T& value) const
+        {
+            Write<kOrder>(&value, 1);
+        }
+        /// @brief Write an array of values in binary form
+        /// @details In the native byte order the values are written with a single call. Otherwise they are
+        /// converted in chunks of about 1 KiB on the stack, each written as soon as it is converted.
+        /// @tparam kOrder The byte order on the wire
+        /// @param values Pointer to the values
+        /// @param count The number of values
+        template <Endian kOrder = Endian::kLittle, typename T>
+        void Write(const T* values, std::size_t count) const
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be written in binary form.");
+            if constexpr (kOrder == Endian::kNative)
+            {
+                WriteAll(reinterpret_cast<const char*>(values), count * sizeof(T));
+            }
+            else
+            {
+                // Convert in chunks on the stack, without allocating or touching the caller's values
+                constexpr std::size_t kChunkSize = std::max<std::size_t>(1, 1024 / sizeof(T));
+                alignas(T) char chunk[kChunkSize * sizeof(T)];
+                for (std::size_t offset = 0; offset < count; offset += kChunkSize)
+                {
+                    const auto num_values = std::min(kChunkSize, count - offset);
+                    std::memcpy(chunk, values + offset, num_values * sizeof(T));
+                    SwapBytes(reinterpret_cast<T*>(chunk), num_values);
+                    WriteAll(chunk, num_values * sizeof(T));
+                }
+            }
+        }
+        /// @brief Read a value in binary form. Blocks until all its bytes have been received.
+        /// @tparam T The type of the value (see Write())
+        /// @tparam kOrder The byte order on the wire
+        template <typename T, Endian kOrder = Endian::kLittle>
+        [[nodiscard]] T Read() const
+        {
+            T value;
+            Read<kOrder>(&value, 1);
+            return value;
+        }
+        /// @brief Read an array of values in binary form. Blocks until all their bytes have been received.
+        /// @details The bytes are read straight into the array and converted in place.
+        /// @tparam kOrder The byte order on the wire
+        /// @param values Pointer to the values. Must be at least count elements long!
+        /// @param count The number of values
+        template <Endian kOrder = Endian::kLittle, typename T>
+        void Read(T* values, std::size_t count) const
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be read in binary form.");
+            ReadAll(reinterpret_cast<char*>(values), count * sizeof(T));
+            if constexpr (kOrder != Endian::kNative)
+            {
+                SwapBytes(values, count);
+            }
+        }
         /// @brief Overloaded stream output operator to print the port settings
         friend std::ostream& operator<<(std::ostream& os, const SerialPort& obj)
         {
@@ -86,6 +272,11 @@ namespace serial_port
         }
 
     private:
+        /// @brief Write all bytes, throwing an IoException on failure
+        void WriteAll(const char* data, std::size_t num_bytes) const;
+        /// @brief Read exactly num_bytes bytes, throwing an IoException on failure
+        void ReadAll(char* data, std::size_t num_bytes) const;
+
         /// @brief Pointer to implementation (PIMPL idiom)
         std::unique_ptr<Interface> sp_;
     };
@@ -0,0 +1,150 @@
+#ifndef SERIAL_PORT_SHM_RING_H
+#define SERIAL_PORT_SHM_RING_H
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "io_thread.h"
+#include "serial_port.h"
+
+namespace serial_port
+{
+	/// @brief Layout of the start of the shared memory (defined in the implementation)
+	struct ShmRingHeader;
+
+	/// @brief Options of a ShmRingPublisher
+	struct ShmRingOptions
+	{
+		/// @brief Size of the ring in bytes. Subscribers that fall behind by more than this are overrun.
+		std::size_t capacity{ 4 << 20 };
+		/// @brief Maximum number of bytes read from the port into one chunk
+		std::size_t max_chunk{ 64 * 1024 };
+		/// @brief Scheduling settings of the thread that reads the port
+		IoThreadConfig io_thread;
+	};
+
+	/// @brief A chunk of received data in the ring
+	struct ShmChunk
+	{
+		/// @brief Number of the chunk, counting from 0. Gaps mean that chunks were lost to an overrun.
+		std::uint64_t sequence{ 0 };
+		/// @brief When the chunk was read from the port (std::chrono::steady_clock, which is the same in all processes)
+		std::chrono::steady_clock::time_point timestamp;
+		/// @brief The data. Points into the shared memory and is only valid as long as ShmRingSubscriber::IsValid() says so.
+		std::string_view data;
+		/// @brief Position of the chunk in the stream of the ring (used by IsValid())
+		std::uint64_t position{ 0 };
+	};
+
+	/// @brief Outcome of ShmRingSubscriber::Next()
+	enum class ShmReadStatus
+	{
+		/// @brief A chunk was returned
+		kOk,
+		/// @brief No new chunk arrived within the timeout
+		kEmpty,
+		/// @brief The subscriber fell behind by more than the capacity and continues with the newest data
+		kOverrun,
+		/// @brief The publisher has gone away and all chunks have been read
+		kClosed
+	};
+
+	/// @brief Publishes the data received on a port into a POSIX shared-memory ring
+	/// @details A background thread reads the port straight into the ring. Any number of ShmRingSubscriber
+	/// objects, in this or other processes on the same host, read the chunks without copying them. The
+	/// publisher never waits for subscribers: slow subscribers are overrun and notice it themselves.
+	/// The port must be open, must outlive the publisher and must not be read by anyone else meanwhile.
+	class ShmRingPublisher
+	{
+	public:
+		/// @brief Create the shared memory object and start publishing
+		/// @param port The port
+		/// @param name Name of the shared memory object, starting with '/' (e.g. "/gnss_rx"). An existing object is replaced.
+		/// @param options Size of the ring and of the chunks
+		ShmRingPublisher(SerialPort& port, std::string name, const ShmRingOptions& options = {});
+		/// @brief Stops publishing, tells the subscribers and removes the name of the shared memory object
+		~ShmRingPublisher();
+
+		/// @brief ShmRingPublisher objects may not be copied or moved
+		ShmRingPublisher(const ShmRingPublisher&) = delete;
+		ShmRingPublisher& operator=(const ShmRingPublisher&) = delete;
+
+		/// @brief Number of chunks published
+		[[nodiscard]] std::uint64_t NumChunks() const;
+		/// @brief Number of bytes published
+		[[nodiscard]] std::uint64_t NumBytes() const { return num_bytes_; }
+
+	private:
+		void Run();
+		// Make room for a chunk of max_chunk bytes and return where its data goes
+		char* Reserve();
+		void Commit(std::size_t num_bytes);
+
+		SerialPort& port_;
+		std::string name_;
+		std::size_t max_chunk_;
+		std::size_t mapping_size_{ 0 };
+		void* mapping_{ nullptr };
+		ShmRingHeader* header_{ nullptr };
+		char* data_{ nullptr };
+		std::uint64_t position_{ 0 };
+		std::atomic<std::uint64_t> num_bytes_{ 0 };
+
+		std::atomic<bool> running_{ true };
+		std::thread thread_;
+	};
+
+	/// @brief Reads the chunks of a ShmRingPublisher, possibly in another process
+	/// @details Chunks are returned as views into the shared memory. The publisher may overwrite a chunk
+	/// at any time once the subscriber has fallen behind by the ring's capacity, so check IsValid() after
+	/// using the data (and discard the results if it was overwritten), or copy the data and then check.
+	class ShmRingSubscriber
+	{
+	public:
+		/// @brief Attach to a ring. Only chunks published from now on are read.
+		/// @param name Name of the shared memory object
+		explicit ShmRingSubscriber(const std::string& name);
+		~ShmRingSubscriber();
+
+		/// @brief ShmRingSubscriber objects may not be copied or moved
+		ShmRingSubscriber(const ShmRingSubscriber&) = delete;
+		ShmRingSubscriber& operator=(const ShmRingSubscriber&) = delete;
+
+		/// @brief Get the next chunk
+		/// @param chunk Receives the chunk if the result is ShmReadStatus::kOk
+		/// @param timeout Maximum time to wait for a chunk (negative: wait forever). Waiting does not spin.
+		ShmReadStatus Next(ShmChunk& chunk, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+		/// @brief Returns whether a chunk is still intact, i.e. has not been overwritten by the publisher
+		[[nodiscard]] bool IsValid(const ShmChunk& chunk) const;
+
+		/// @brief Number of published bytes that have not been read yet
+		[[nodiscard]] std::uint64_t Lag() const;
+		/// @brief Number of times the subscriber was overrun
+		[[nodiscard]] std::uint64_t NumOverruns() const { return num_overruns_; }
+		/// @brief Number of chunks skipped because of overruns
+		[[nodiscard]] std::uint64_t NumLostChunks() const { return num_lost_chunks_; }
+
+	private:
+		void Wait(std::chrono::milliseconds timeout) const;
+
+		std::size_t mapping_size_{ 0 };
+		void* mapping_{ nullptr };
+		ShmRingHeader* header_{ nullptr };
+		const char* data_{ nullptr };
+		std::uint64_t capacity_{ 0 };
+		std::uint64_t position_{ 0 };
+		std::uint64_t next_sequence_{ 0 };
+		std::uint64_t num_overruns_{ 0 };
+		std::uint64_t num_lost_chunks_{ 0 };
+	};
+}
+
+#endif // __linux__
+
+#endif // SERIAL_PORT_SHM_RING_H
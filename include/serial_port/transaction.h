@@ -0,0 +1,129 @@
+#ifndef SERIAL_PORT_TRANSACTION_H
+#define SERIAL_PORT_TRANSACTION_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include "io_thread.h"
+#include "serial_port.h"
+
+namespace serial_port
+{
+	/// @brief Splits the received byte stream into frames
+	/// @details Receives the bytes that have not been consumed yet and returns the length of the first
+	/// complete frame in them, or 0 if no complete frame has been received yet.
+	using Framer = std::function<std::size_t(const std::string& buffer)>;
+	/// @brief Decides whether a received frame is the response to a request
+	using Matcher = std::function<bool(const std::string& frame)>;
+	/// @brief Receives frames that did not match any pending request
+	using FrameHandler = std::function<void(const std::string& frame)>;
+
+	/// @brief Create a framer for frames terminated by a delimiter (the delimiter is part of the frame)
+	Framer DelimiterFramer(char delimiter = '\n');
+	/// @brief Create a matcher that accepts frames starting with a prefix
+	Matcher PrefixMatcher(const std::string& prefix);
+
+	/// @brief Request/response transactions on a port
+	/// @details A background thread reads the port, splits the data into frames and hands every frame to
+	/// the oldest pending request whose matcher accepts it. Frames that match no pending request (e.g.
+	/// unsolicited status messages) are routed to a side channel. The manager does not own the port.
+	/// The port must be open and outlive the manager, and must not be read by anyone else meanwhile.
+	class TransactionManager
+	{
+	public:
+		/// @brief Start managing transactions on an (opened) port
+		/// @param port The port
+		/// @param framer Splits the received data into frames
+		/// @param max_in_flight Maximum number of requests awaiting a response at the same time
+		/// @param io_thread Scheduling settings of the reader thread
+		explicit TransactionManager(SerialPort& port, Framer framer = DelimiterFramer(), std::size_t max_in_flight = 1,
+			const IoThreadConfig& io_thread = {});
+		/// @brief Stops reading. Pending transactions complete without a response.
+		~TransactionManager();
+
+		/// @brief TransactionManager objects may not be copied or moved
+		TransactionManager(const TransactionManager&) = delete;
+		TransactionManager& operator=(const TransactionManager&) = delete;
+
+		/// @brief Send a request and wait for the response
+		/// @param request The request to send
+		/// @param matcher Decides which received frame is the response
+		/// @param timeout Maximum time to wait for the response (measured from the call)
+		/// @return The response, or nothing if the deadline expired or the port failed
+		/// @throws IoException if the request could not be sent or the port has failed
+		std::optional<std::string> Transact(const std::string& request, Matcher matcher, std::chrono::milliseconds timeout);
+		/// @brief Send a request without waiting for the response
+		/// @details Blocks while the maximum number of requests are already in flight. The reader expires
+		/// pending requests within a few milliseconds after their deadline.
+		/// @return A future that receives the response, or nothing if the deadline expired or the port failed
+		/// @throws IoException if the request could not be sent or the port has failed
+		std::future<std::optional<std::string>> Submit(const std::string& request, Matcher matcher, std::chrono::milliseconds timeout);
+
+		/// @brief Call a handler (on the reader thread) for every frame that matches no pending request
+		/// @details While no handler is set, these frames are queued and can be fetched with ReadUnsolicited().
+		void SetUnsolicitedHandler(FrameHandler handler);
+		/// @brief Fetch the oldest queued frame that matched no pending request
+		/// @param timeout Maximum time to wait for such a frame
+		std::optional<std::string> ReadUnsolicited(std::chrono::milliseconds timeout);
+
+		/// @brief Limit the number of queued unsolicited frames. The oldest frames are dropped first. (default: 1024)
+		void SetMaxUnsolicited(std::size_t num_frames);
+		/// @brief Number of unsolicited frames dropped because the queue was full
+		[[nodiscard]] unsigned long NumUnsolicitedDropped() const { return num_unsolicited_dropped_; }
+		/// @brief Number of requests currently awaiting a response
+		[[nodiscard]] std::size_t NumInFlight() const;
+		/// @brief The error that stopped the reader (e.g. Errc::kDisconnected), or an empty error code while it runs
+		[[nodiscard]] std::error_code Error() const;
+
+	private:
+		struct Pending
+		{
+			std::uint64_t id;
+			Matcher matcher;
+			std::chrono::steady_clock::time_point deadline;
+			std::promise<std::optional<std::string>> promise;
+		};
+
+		std::future<std::optional<std::string>> Submit(const std::string& request, Matcher matcher,
+			std::chrono::steady_clock::time_point deadline, std::uint64_t& id);
+		// Complete a pending request without a response
+		void Cancel(std::uint64_t id);
+		// Complete all pending requests without a response after a port error
+		void Fail(std::error_code error);
+		void Run();
+		void Dispatch(std::string frame);
+		void ExpireDeadlines(std::chrono::steady_clock::time_point now);
+
+		SerialPort& port_;
+		Framer framer_;
+		std::size_t max_in_flight_;
+
+		mutable std::mutex mutex_;
+		std::condition_variable slot_available_;
+		std::condition_variable unsolicited_available_;
+		std::list<Pending> pending_;
+		std::uint64_t next_id_{ 0 };
+		std::error_code error_;
+		FrameHandler unsolicited_handler_;
+		std::deque<std::string> unsolicited_;
+		std::size_t max_unsolicited_{ 1024 };
+		std::atomic<unsigned long> num_unsolicited_dropped_{ 0 };
+
+		std::mutex write_mutex_;
+		std::atomic<bool> running_{ true };
+		std::thread reader_;
+	};
+}
+
+#endif // SERIAL_PORT_TRANSACTION_H
@@ -1,9 +1,13 @@
 #ifndef TYPES_H
 #define TYPES_H
 
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <ostream>
 #include <stdexcept>
 #include <string>
+#include <utility>
 
 
 #if defined (__linux__)
@@ -14,6 +18,14 @@ constexpr auto kDefaultName = "COM1";
 
 namespace serial_port
 {
+#if defined (__linux__)
+	/// @brief The operating system's handle of an open port (a file descriptor)
+	using NativeHandle = int;
+#elif (_WIN32)
+	/// @brief The operating system's handle of an open port (a HANDLE)
+	using NativeHandle = void*;
+#endif
+
 	/// @brief Parity modes
 	enum class Parity { kNone, kOdd, kEven };
 	/// @brief Number of stop bits used
@@ -125,6 +137,221 @@ namespace serial_port
 		}
 	};
 
+	/// @brief Duration of one character on the line: start bit, 8 data bits, parity bit and stop bits
+	/// @param baud_rate Baud rate
+	/// @param parity Parity
+	/// @param num_stop_bits Number of stop bits
+	inline std::chrono::nanoseconds CharacterTime(const int baud_rate, const Parity parity = Parity::kNone,
+		const NumStopBits num_stop_bits = NumStopBits::kOne)
+	{
+		if (baud_rate <= 0)
+		{
+			throw std::invalid_argument("[CharacterTime()] The baud rate must be positive.");
+		}
+		const auto num_bits = 1 + 8 + (parity == Parity::kNone ? 0 : 1) + (num_stop_bits == NumStopBits::kOne ? 1 : 2);
+		return std::chrono::nanoseconds(1'000'000'000LL * num_bits / baud_rate);
+	}
+
+	/// @brief Outcome of opening one port with SerialPort::OpenAll()
+	struct OpenResult
+	{
+		/// @brief Name of the port
+		std::string port_name;
+		/// @brief Whether the port was opened successfully
+		bool success{ false };
+		/// @brief Description of the error if the port could not be opened
+		std::string error;
+		/// @brief Time it took to open and configure the port
+		std::chrono::microseconds latency{ 0 };
+		/// @brief Overloaded stream output operator
+		friend std::ostream& operator<<(std::ostream& os, const OpenResult& obj)
+		{
+			os << obj.port_name << ": " << (obj.success ? "opened" : "failed") << " in " << obj.latency.count() << " us";
+			if (!obj.success)
+			{
+				os << " (" << obj.error << ")";
+			}
+			return os;
+		}
+	};
+
+	/// @brief Modem control lines (DTR, RTS) and status lines (CTS, DSR, DCD, RI). Values can be combined into a mask with |.
+	enum class ModemLine : unsigned
+	{
+		kNone = 0,
+		kDtr = 1 << 0,
+		kRts = 1 << 1,
+		kCts = 1 << 2,
+		kDsr = 1 << 3,
+		kDcd = 1 << 4,
+		kRing = 1 << 5,
+		/// @brief All status lines, i.e. all lines whose changes can be waited for
+		kAllStatus = kCts | kDsr | kDcd | kRing
+	};
+	/// @brief Combine modem lines into a mask
+	constexpr ModemLine operator|(const ModemLine lhs, const ModemLine rhs)
+	{
+		return static_cast<ModemLine>(static_cast<unsigned>(lhs) | static_cast<unsigned>(rhs));
+	}
+	/// @brief Intersect masks of modem lines
+	constexpr ModemLine operator&(const ModemLine lhs, const ModemLine rhs)
+	{
+		return static_cast<ModemLine>(static_cast<unsigned>(lhs) & static_cast<unsigned>(rhs));
+	}
+	/// @brief Returns whether any of the lines is set in the mask
+	constexpr bool IsSet(const ModemLine mask, const ModemLine lines)
+	{
+		return (mask & lines) != ModemLine::kNone;
+	}
+	/// @brief Overloaded stream output operator listing the lines of a mask
+	inline std::ostream& operator<<(std::ostream& os, const ModemLine mask)
+	{
+		constexpr std::pair<ModemLine, const char*> kNames[] = {
+			{ ModemLine::kDtr, "DTR" }, { ModemLine::kRts, "RTS" }, { ModemLine::kCts, "CTS" },
+			{ ModemLine::kDsr, "DSR" }, { ModemLine::kDcd, "DCD" }, { ModemLine::kRing, "RI" } };
+		bool first = true;
+		for (const auto& [line, name] : kNames)
+		{
+			if (IsSet(mask, line))
+			{
+				os << (first ? "" : "|") << name;
+				first = false;
+			}
+		}
+		return first ? os << "none" : os;
+	}
+
+	/// @brief Counters kept by the driver since the port was set up (Linux TIOCGICOUNT)
+	/// @details The counters only ever increase, so the difference of two snapshots gives the events in between.
+	/// The driver keeps them in 32 bits, so they wrap around; differences are computed modulo 2^32.
+	struct LineCounters
+	{
+		/// @brief Number of bytes received
+		unsigned long rx{ 0 };
+		/// @brief Number of bytes transmitted
+		unsigned long tx{ 0 };
+		/// @brief Number of bytes lost because the UART's receive FIFO overflowed
+		unsigned long overrun{ 0 };
+		/// @brief Number of framing errors (e.g. a wrong baud rate)
+		unsigned long frame{ 0 };
+		/// @brief Number of parity errors
+		unsigned long parity{ 0 };
+		/// @brief Number of break conditions
+		unsigned long brk{ 0 };
+		/// @brief Number of bytes lost because the driver's buffer was full (the application reads too slowly)
+		unsigned long buffer_overrun{ 0 };
+		/// @brief Number of transitions of the CTS line
+		unsigned long cts{ 0 };
+		/// @brief Number of transitions of the DSR line
+		unsigned long dsr{ 0 };
+		/// @brief Number of transitions of the DCD line
+		unsigned long dcd{ 0 };
+		/// @brief Number of transitions of the RI line
+		unsigned long ring{ 0 };
+
+		/// @brief Total number of errors that lost or corrupted received data
+		[[nodiscard]] unsigned long Errors() const { return overrun + frame + parity + buffer_overrun; }
+
+		/// @brief Events between two snapshots
+		friend LineCounters operator-(const LineCounters& lhs, const LineCounters& rhs)
+		{
+			const auto delta = [](const unsigned long now, const unsigned long before)
+			{
+				return static_cast<unsigned long>(static_cast<std::uint32_t>(now - before));
+			};
+			return { delta(lhs.rx, rhs.rx), delta(lhs.tx, rhs.tx), delta(lhs.overrun, rhs.overrun), delta(lhs.frame, rhs.frame),
+				delta(lhs.parity, rhs.parity), delta(lhs.brk, rhs.brk), delta(lhs.buffer_overrun, rhs.buffer_overrun),
+				delta(lhs.cts, rhs.cts), delta(lhs.dsr, rhs.dsr), delta(lhs.dcd, rhs.dcd), delta(lhs.ring, rhs.ring) };
+		}
+		/// @brief Overloaded stream output operator
+		friend std::ostream& operator<<(std::ostream& os, const LineCounters& obj)
+		{
+			return os
+				<< "rx: " << obj.rx << ", tx: " << obj.tx << ", overrun: " << obj.overrun << ", frame: " << obj.frame
+				<< ", parity: " << obj.parity << ", break: " << obj.brk << ", buffer overrun: " << obj.buffer_overrun
+				<< ", CTS: " << obj.cts << ", DSR: " << obj.dsr << ", DCD: " << obj.dcd << ", RI: " << obj.ring;
+		}
+	};
+
+	/// @brief A histogram of durations with power-of-two buckets, from nanoseconds to minutes
+	struct LatencyHistogram
+	{
+		/// @brief Number of buckets
+		static constexpr std::size_t kNumBuckets = 40;
+		/// @brief Bucket i counts the durations from 2^i to 2^(i+1) nanoseconds (bucket 0 also counts 0 ns)
+		std::array<unsigned long, kNumBuckets> buckets{};
+		/// @brief Number of durations added
+		unsigned long count{ 0 };
+		/// @brief Largest duration added
+		std::chrono::nanoseconds max{ 0 };
+
+		/// @brief Add a duration
+		void Add(const std::chrono::nanoseconds duration)
+		{
+			auto ns = static_cast<unsigned long long>(duration.count() > 0 ? duration.count() : 0);
+			std::size_t bucket = 0;
+			while (ns > 1 && bucket + 1 < kNumBuckets)
+			{
+				ns >>= 1;
+				++bucket;
+			}
+			++buckets[bucket];
+			++count;
+			max = duration > max ? duration : max;
+		}
+		/// @brief Upper bound of the given fraction of durations (e.g. 0.99 for the 99th percentile)
+		[[nodiscard]] std::chrono::nanoseconds Percentile(const double fraction) const
+		{
+			const auto rank = static_cast<unsigned long>(fraction * static_cast<double>(count));
+			unsigned long seen = 0;
+			for (std::size_t i = 0; i < kNumBuckets; ++i)
+			{
+				seen += buckets[i];
+				if (seen > rank)
+				{
+					const std::chrono::nanoseconds upper_bound(2LL << i);
+					return upper_bound < max ? upper_bound : max;
+				}
+			}
+			return max;
+		}
+	};
+
+	/// @brief Statistics of busy-poll reads (see SerialPort::SetBusyPoll())
+	/// @details Only reads that had to wait for data are counted.
+	struct BusyPollStats
+	{
+		/// @brief Number of times a read or WaitForData() had to wait for data
+		unsigned long num_waits{ 0 };
+		/// @brief Number of waits that ended while spinning
+		unsigned long num_spin_hits{ 0 };
+		/// @brief Number of waits that used up the spin budget and went to sleep in poll()
+		unsigned long num_sleeps{ 0 };
+		/// @brief Number of waits of WaitForData() that expired without data
+		unsigned long num_timeouts{ 0 };
+		/// @brief Total time spent spinning, i.e. the CPU time traded for latency
+		std::chrono::nanoseconds spin_time{ 0 };
+		/// @brief Time from the start of each wait until the data was available
+		LatencyHistogram latency;
+
+		/// @brief Fraction of waits that ended while spinning
+		[[nodiscard]] double SpinHitRate() const
+		{
+			return num_waits == 0 ? 0.0 : static_cast<double>(num_spin_hits) / static_cast<double>(num_waits);
+		}
+		/// @brief Overloaded stream output operator
+		friend std::ostream& operator<<(std::ostream& os, const BusyPollStats& obj)
+		{
+			return os
+				<< obj.num_waits << " waits: " << obj.num_spin_hits << " spinning, " << obj.num_sleeps << " sleeping ("
+				<< 100.0 * obj.SpinHitRate() << " % spin hits), " << obj.num_timeouts << " timeouts, "
+				<< std::chrono::duration<double, std::micro>(obj.spin_time).count() << " us spent spinning; latency [us]: p50 < "
+				<< std::chrono::duration<double, std::micro>(obj.latency.Percentile(0.5)).count() << ", p99 < "
+				<< std::chrono::duration<double, std::micro>(obj.latency.Percentile(0.99)).count() << ", max "
+				<< std::chrono::duration<double, std::micro>(obj.latency.max).count();
+		}
+	};
+
 	/// @brief An exception that is thrown when input or output operations go wrong
 	using IoException = std::runtime_error;
 }
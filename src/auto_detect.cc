@@ -0,0 +1,205 @@
+#include "serial_port/auto_detect.h"
+
+#include <algorithm>
+#include <cctype>
+#include <optional>
+
+#if defined(__linux__)
+#include <termios.h>
+#endif
+
+namespace
+{
+	// A candidate is abandoned as soon as this many bytes score below kRejectScore
+	constexpr std::size_t kMinBytesToReject = 8;
+	constexpr double kRejectScore = 0.5;
+
+	struct Candidate
+	{
+		serial_port::Settings settings;
+		double score{ 0.0 };
+		// Whether the preamble (if any) was received
+		bool matched{ false };
+		bool confident{ false };
+	};
+
+	bool is_text(const unsigned char c)
+	{
+		return std::isprint(c) != 0 || c == '\r' || c == '\n' || c == '\t';
+	}
+
+	std::optional<unsigned long> count_errors(const serial_port::Result<serial_port::LineCounters>& before,
+		const serial_port::SerialPort& port)
+	{
+		if (!before)
+		{
+			return std::nullopt;
+		}
+		const auto after = port.TryGetLineCounters();
+		if (!after)
+		{
+			return std::nullopt;
+		}
+		const auto delta = *after - *before;
+		return delta.frame + delta.parity;
+	}
+
+	// Score between 0 (garbage) and 1 (clean)
+	double score(const std::string& bytes, const std::optional<unsigned long> num_errors, const serial_port::AutoDetectOptions& options)
+	{
+		// The first byte may have been cut off when the settings were switched
+		const std::size_t skip = bytes.size() > 1 ? 1 : 0;
+		const auto num_bytes = bytes.size() - skip;
+		if (num_bytes == 0)
+		{
+			return 0.0;
+		}
+
+		// Without counters, rely on the NUL bytes that the driver delivers for framing and parity errors
+		std::size_t num_bad = num_errors ? *num_errors
+			: static_cast<std::size_t>(std::count(bytes.begin() + skip, bytes.end(), '\0'));
+		if (options.text)
+		{
+			num_bad += static_cast<std::size_t>(std::count_if(bytes.begin() + skip, bytes.end(), [](const char c)
+			{
+				return c != '\0' && !is_text(static_cast<unsigned char>(c));
+			}));
+		}
+		return 1.0 - std::min(1.0, static_cast<double>(num_bad) / static_cast<double>(num_bytes));
+	}
+
+	// Drivers only deliver framing and parity errors as NUL bytes with input checking enabled, which the port
+	// itself does not enable. The next ApplySettings() disables it again.
+	void enable_input_check(const serial_port::SerialPort& port)
+	{
+#if defined(__linux__)
+		termios tty{};
+		if (tcgetattr(port.GetNativeHandle(), &tty) == 0 && (tty.c_iflag & INPCK) == 0)
+		{
+			tty.c_iflag |= INPCK;
+			(void)tcsetattr(port.GetNativeHandle(), TCSANOW, &tty);
+		}
+#else
+		(void)port;
+#endif
+	}
+
+	// Listen to the settings that have just been applied
+	Candidate try_candidate(const serial_port::SerialPort& port, const serial_port::Settings& settings,
+		const serial_port::AutoDetectOptions& options)
+	{
+		// Discard what was received with the previous settings, including bytes that were read ahead
+		port.FlushBuffer();
+		const auto counters = port.TryGetLineCounters();
+		for (std::size_t written = 0; written < options.probe.size();)
+		{
+			const auto result = port.TryWriteData(options.probe.data() + written, options.probe.size() - written);
+			if (!result)
+			{
+				throw serial_port::IoException("[DetectSettings()] Could not send the probe: " + result.Error().message());
+			}
+			written += *result;
+		}
+
+		Candidate candidate{ settings };
+		std::string bytes;
+		char chunk[256];
+		const auto end = std::chrono::steady_clock::now() + options.listen_time;
+		while (true)
+		{
+			const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(end - std::chrono::steady_clock::now());
+			if (remaining.count() <= 0)
+			{
+				break;
+			}
+			const auto result = port.TryReadData(chunk, sizeof(chunk), remaining);
+			if (!result)
+			{
+				if (result.Error() == serial_port::Errc::kTimeout)
+				{
+					break;
+				}
+				if (result.Error() == serial_port::Errc::kInterrupted)
+				{
+					continue;
+				}
+				throw serial_port::IoException("[DetectSettings()] Could not read from the port: " + result.Error().message());
+			}
+
+			bytes.append(chunk, *result);
+			candidate.score = score(bytes, count_errors(counters, port), options);
+			candidate.matched = options.preamble.empty() || bytes.find(options.preamble) != std::string::npos;
+			const auto complete = bytes.size() >= options.sample_size;
+			candidate.confident = candidate.matched && candidate.score >= options.stop_score && (complete || !options.preamble.empty());
+			if (candidate.confident || complete)
+			{
+				break;
+			}
+			if (bytes.size() >= kMinBytesToReject && candidate.score < kRejectScore)
+			{
+				break;
+			}
+		}
+		return candidate;
+	}
+}
+
+serial_port::AutoDetectResult serial_port::DetectSettings(const SerialPort& port, const AutoDetectOptions& options)
+{
+	if (!port.IsOpen())
+	{
+		throw IoException("[DetectSettings()] The port is not open.");
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	const auto original = port.GetSettings();
+	AutoDetectResult result;
+	std::vector<Settings> candidates;
+	for (const auto baud_rate : options.baud_rates)
+	{
+		for (const auto parity : options.parities)
+		{
+			for (const auto stop_bits : options.stop_bits)
+			{
+				auto settings = original;
+				settings.baud_rate = baud_rate;
+				settings.parity = parity;
+				settings.num_stop_bits = stop_bits;
+				candidates.push_back(settings);
+			}
+		}
+	}
+
+	Candidate best{ original };
+	for (const auto& settings : candidates)
+	{
+		try
+		{
+			port.ApplySettings(settings);
+		}
+		catch (const std::exception&)
+		{
+			// Not supported by the driver (e.g. the baud rate)
+			continue;
+		}
+		enable_input_check(port);
+		const auto candidate = try_candidate(port, settings, options);
+		++result.num_candidates;
+		if (candidate.matched && candidate.score > best.score)
+		{
+			best = candidate;
+		}
+		if (candidate.confident)
+		{
+			break;
+		}
+	}
+
+	result.found = best.score >= options.accept_score;
+	result.settings = result.found ? best.settings : original;
+	result.score = result.found ? best.score : 0.0;
+	port.ApplySettings(result.settings);
+	port.FlushBuffer();
+	result.elapsed = std::chrono::steady_clock::now() - start;
+	return result;
+}
@@ -0,0 +1,246 @@
+#if defined(__linux__)
+
+#include <poll.h>
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+
+#include "serial_port/batch_writer.h"
+
+namespace
+{
+	// First port of a worker's slice
+	std::size_t slice_begin(const std::size_t worker, const std::size_t num_workers, const std::size_t num_ports)
+	{
+		return num_ports * worker / num_workers;
+	}
+}
+
+serial_port::BatchWriter::BatchWriter(std::vector<const SerialPort*> ports, const BatchWriterOptions& options)
+	: ports_(std::move(ports)), options_(options)
+{
+	if (options_.num_workers == 0)
+	{
+		throw std::invalid_argument("[BatchWriter::BatchWriter()] At least one worker is needed.");
+	}
+	for (const auto* port : ports_)
+	{
+		if (port == nullptr || !port->IsOpen())
+		{
+			throw std::invalid_argument("[BatchWriter::BatchWriter()] All ports must be open.");
+		}
+		handles_.push_back(port->GetNativeHandle());
+	}
+
+	// The calling thread is the first worker
+	options_.num_workers = std::min(options_.num_workers, std::max<std::size_t>(ports_.size(), 1));
+	try
+	{
+		for (std::size_t i = 1; i < options_.num_workers; ++i)
+		{
+			workers_.push_back(StartIoThread(options_.io_thread, [this, i] { Work(i); }));
+		}
+	}
+	catch (...)
+	{
+		{
+			const std::lock_guard<std::mutex> lock(mutex_);
+			running_ = false;
+		}
+		batch_started_.notify_all();
+		for (auto& worker : workers_)
+		{
+			worker.join();
+		}
+		throw;
+	}
+}
+
+serial_port::BatchWriter::~BatchWriter()
+{
+	{
+		const std::lock_guard<std::mutex> lock(mutex_);
+		running_ = false;
+	}
+	batch_started_.notify_all();
+	for (auto& worker : workers_)
+	{
+		worker.join();
+	}
+}
+
+serial_port::BatchWriteResult serial_port::BatchWriter::Broadcast(const std::string_view data)
+{
+	return Write(std::vector<std::string_view>(ports_.size(), data));
+}
+
+serial_port::BatchWriteResult serial_port::BatchWriter::Write(const std::vector<std::string_view>& buffers)
+{
+	if (buffers.size() != ports_.size())
+	{
+		throw std::invalid_argument("[BatchWriter::Write()] Expected " + std::to_string(ports_.size()) + " buffers, got "
+			+ std::to_string(buffers.size()) + ".");
+	}
+
+	const std::lock_guard<std::mutex> batch_lock(batch_mutex_);
+	buffers_ = buffers;
+	result_.ports.assign(ports_.size(), {});
+	result_.start = std::chrono::steady_clock::now();
+	deadline_ = result_.start + options_.timeout;
+	num_ready_ = 0;
+	{
+		const std::lock_guard<std::mutex> lock(mutex_);
+		++batch_;
+		num_busy_ = workers_.size();
+	}
+	batch_started_.notify_all();
+
+	WriteSlice(0);
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		batch_finished_.wait(lock, [this] { return num_busy_ == 0; });
+	}
+	auto result = std::move(result_);
+	result_ = {};
+	return result;
+}
+
+void serial_port::BatchWriter::Work(const std::size_t worker)
+{
+	std::uint64_t batch = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			batch_started_.wait(lock, [this, batch] { return !running_ || batch_ != batch; });
+			if (!running_)
+			{
+				return;
+			}
+			batch = batch_;
+		}
+
+		WriteSlice(worker);
+		{
+			const std::lock_guard<std::mutex> lock(mutex_);
+			--num_busy_;
+		}
+		batch_finished_.notify_one();
+	}
+}
+
+void serial_port::BatchWriter::WriteSlice(const std::size_t worker)
+{
+	const auto num_workers = workers_.size() + 1;
+	const auto begin = slice_begin(worker, num_workers, ports_.size());
+	const auto end = slice_begin(worker + 1, num_workers, ports_.size());
+
+	// Hands as much as possible to the driver. Returns whether the port is done.
+	const auto write_some = [this](const std::size_t i)
+	{
+		auto& port = result_.ports[i];
+		const auto& buffer = buffers_[i];
+		const auto written = ports_[i]->TryWriteData(buffer.data() + port.num_written, buffer.size() - port.num_written);
+		const auto now = std::chrono::steady_clock::now();
+		if (!written)
+		{
+			if (written.Error() == Errc::kWouldBlock || written.Error() == Errc::kInterrupted)
+			{
+				return false;
+			}
+			port.error = written.Error();
+			return true;
+		}
+		if (port.num_written == 0)
+		{
+			port.submitted = now;
+		}
+		port.num_written += *written;
+		if (port.num_written == buffer.size())
+		{
+			port.success = true;
+			port.completed = now;
+			return true;
+		}
+		return false;
+	};
+
+	// Find the ports that can take data without blocking before starting, so that full ones do not
+	// hold up the others
+	std::vector<pollfd> fds;
+	std::vector<std::size_t> pending;
+	for (auto i = begin; i < end; ++i)
+	{
+		if (buffers_[i].empty())
+		{
+			result_.ports[i].success = true;
+			continue;
+		}
+		fds.push_back({ handles_[i], POLLOUT, 0 });
+		pending.push_back(i);
+	}
+	poll(fds.data(), fds.size(), 0);
+
+	// Start all workers together
+	num_ready_.fetch_add(1, std::memory_order_acq_rel);
+	while (num_ready_.load(std::memory_order_acquire) < num_workers)
+	{
+		std::this_thread::yield();
+	}
+
+	// Back to back, as this decides the skew
+	std::size_t num_left = 0;
+	for (std::size_t k = 0; k < pending.size(); ++k)
+	{
+		if ((fds[k].revents & POLLOUT) == 0 || !write_some(pending[k]))
+		{
+			pending[num_left++] = pending[k];
+		}
+	}
+	pending.resize(num_left);
+
+	// Complete the rest as the ports drain
+	while (!pending.empty())
+	{
+		const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline_ - std::chrono::steady_clock::now());
+		if (remaining.count() <= 0)
+		{
+			for (const auto i : pending)
+			{
+				result_.ports[i].error = make_error_code(Errc::kTimeout);
+			}
+			break;
+		}
+
+		fds.clear();
+		for (const auto i : pending)
+		{
+			fds.push_back({ handles_[i], POLLOUT, 0 });
+		}
+		if (poll(fds.data(), fds.size(), static_cast<int>(remaining.count())) < 0 && errno != EINTR)
+		{
+			for (const auto i : pending)
+			{
+				result_.ports[i].error = std::error_code(errno, std::system_category());
+			}
+			break;
+		}
+
+		num_left = 0;
+		for (std::size_t k = 0; k < pending.size(); ++k)
+		{
+			const auto i = pending[k];
+			if ((fds[k].revents & POLLNVAL) != 0)
+			{
+				result_.ports[i].error = make_error_code(Errc::kNotOpen);
+			}
+			else if (fds[k].revents == 0 || !write_some(i))
+			{
+				pending[num_left++] = i;
+			}
+		}
+		pending.resize(num_left);
+	}
+}
+
+#endif // __linux__
@@ -0,0 +1,253 @@
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "serial_port/bridge.h"
+
+namespace
+{
+	// Pipes are enlarged to this size if possible (the unprivileged limit is 1 MiB by default)
+	constexpr int kPipeSize = 1 << 20;
+
+	std::array<int, 2> make_pipe()
+	{
+		std::array<int, 2> fds{ -1, -1 };
+		if (pipe2(fds.data(), O_CLOEXEC) != 0)
+		{
+			throw serial_port::IoException("[Bridge::Bridge()] Could not create pipe: " + std::string(strerror(errno)));
+		}
+		fcntl(fds[1], F_SETPIPE_SZ, kPipeSize);
+		return fds;
+	}
+}
+
+serial_port::Bridge::Bridge(const int source, std::vector<int> sinks, const BridgeMode mode)
+	: source_(source), sinks_(std::move(sinks)), mode_(mode), zero_copy_(mode != BridgeMode::kCopy),
+	sink_splices_(sinks_.size(), true)
+{
+	if (sinks_.empty())
+	{
+		throw std::invalid_argument("[Bridge::Bridge()] A bridge needs at least one sink.");
+	}
+
+	try
+	{
+		pipe_ = make_pipe();
+		pipe_size_ = static_cast<std::size_t>(std::max(fcntl(pipe_[1], F_GETPIPE_SZ), 4096));
+		// tee() only duplicates what fits into the target, so the tee pipes must be as large as the main pipe
+		tee_pipes_.reserve(sinks_.size() - 1);
+		for (std::size_t i = 0; i + 1 < sinks_.size(); ++i)
+		{
+			tee_pipes_.push_back(make_pipe());
+			fcntl(tee_pipes_.back()[1], F_SETPIPE_SZ, static_cast<int>(pipe_size_));
+		}
+		buffer_.resize(pipe_size_);
+	}
+	catch (...)
+	{
+		// The destructor does not run for a partially constructed bridge
+		ClosePipes();
+		throw;
+	}
+}
+
+serial_port::Bridge::Bridge(const SerialPort& source, std::vector<int> sinks, const BridgeMode mode)
+	: Bridge(source.GetNativeHandle(), std::move(sinks), mode)
+{
+}
+
+serial_port::Bridge::Bridge(const int source, const SerialPort& sink, const BridgeMode mode)
+	: Bridge(source, std::vector<int>{ sink.GetNativeHandle() }, mode)
+{
+}
+
+serial_port::Bridge::~Bridge()
+{
+	ClosePipes();
+}
+
+std::size_t serial_port::Bridge::Transfer(const std::size_t max_bytes, const std::chrono::milliseconds idle_timeout)
+{
+	const auto started = std::chrono::steady_clock::now();
+	std::size_t num_moved = 0;
+	while (num_moved < max_bytes)
+	{
+		pollfd pfd{ source_, POLLIN, 0 };
+		int result;
+		do
+		{
+			result = poll(&pfd, 1, static_cast<int>(idle_timeout.count()));
+		} while (result < 0 && errno == EINTR);
+		if (result <= 0)
+		{
+			break;
+		}
+
+		const auto chunk = std::min(max_bytes - num_moved, pipe_size_);
+		const auto num_bytes = zero_copy_ ? SpliceChunk(chunk) : CopyChunk(chunk);
+		if (num_bytes == 0)
+		{
+			break;
+		}
+		num_moved += num_bytes;
+	}
+
+	stats_.num_bytes += num_moved;
+	stats_.elapsed += std::chrono::steady_clock::now() - started;
+	return num_moved;
+}
+
+std::size_t serial_port::Bridge::SpliceChunk(const std::size_t max_bytes)
+{
+	ssize_t num_bytes;
+	do
+	{
+		num_bytes = splice(source_, nullptr, pipe_[1], nullptr, max_bytes, SPLICE_F_MOVE);
+		++stats_.num_syscalls;
+	} while (num_bytes < 0 && errno == EINTR);
+
+	if (num_bytes < 0)
+	{
+		if (errno == EINVAL && mode_ == BridgeMode::kAuto)
+		{
+			// The source does not support splice(). Nothing was moved, so just continue by copying.
+			zero_copy_ = false;
+			return CopyChunk(max_bytes);
+		}
+		// A port whose other side hung up reports EIO, which ends the transfer like the end of a file
+		if (errno == EIO)
+		{
+			return 0;
+		}
+		throw IoException("[Bridge::Transfer()] Could not read from the source: " + std::string(strerror(errno)));
+	}
+
+	const auto moved = static_cast<std::size_t>(num_bytes);
+	for (std::size_t i = 0; i < tee_pipes_.size(); ++i)
+	{
+		// The tee pipe is empty and as large as the main pipe, so it takes everything at once
+		ssize_t num_duplicated;
+		do
+		{
+			num_duplicated = tee(pipe_[0], tee_pipes_[i][1], moved, 0);
+			++stats_.num_syscalls;
+		} while (num_duplicated < 0 && errno == EINTR);
+		if (num_duplicated != num_bytes)
+		{
+			throw IoException("[Bridge::Transfer()] Could not duplicate the data: " + std::string(strerror(errno)));
+		}
+		Drain(tee_pipes_[i][0], i, moved);
+	}
+	Drain(pipe_[0], sinks_.size() - 1, moved);
+	return moved;
+}
+
+std::size_t serial_port::Bridge::CopyChunk(const std::size_t max_bytes)
+{
+	ssize_t num_bytes;
+	do
+	{
+		num_bytes = read(source_, buffer_.data(), std::min(max_bytes, buffer_.size()));
+		++stats_.num_syscalls;
+	} while (num_bytes < 0 && errno == EINTR);
+
+	if (num_bytes < 0)
+	{
+		if (errno == EIO)
+		{
+			return 0;
+		}
+		throw IoException("[Bridge::Transfer()] Could not read from the source: " + std::string(strerror(errno)));
+	}
+
+	for (const auto sink : sinks_)
+	{
+		WriteAll(sink, buffer_.data(), static_cast<std::size_t>(num_bytes));
+	}
+	return static_cast<std::size_t>(num_bytes);
+}
+
+void serial_port::Bridge::Drain(const int pipe, const std::size_t sink, std::size_t num_bytes)
+{
+	while (num_bytes > 0 && sink_splices_[sink])
+	{
+		const auto result = splice(pipe, nullptr, sinks_[sink], nullptr, num_bytes, SPLICE_F_MOVE);
+		++stats_.num_syscalls;
+		if (result > 0)
+		{
+			num_bytes -= static_cast<std::size_t>(result);
+		}
+		else if (result == 0)
+		{
+			// The data was put into the pipe before, so it cannot run dry
+			throw IoException("[Bridge::Transfer()] Unexpected end of data in pipe.");
+		}
+		else if (result < 0 && errno == EINVAL && mode_ == BridgeMode::kAuto)
+		{
+			// E.g. files opened with O_APPEND. Copy from the pipe for this sink from now on.
+			sink_splices_[sink] = false;
+		}
+		else if (result < 0 && errno != EINTR)
+		{
+			throw IoException("[Bridge::Transfer()] Could not write to a sink: " + std::string(strerror(errno)));
+		}
+	}
+
+	while (num_bytes > 0)
+	{
+		const auto result = read(pipe, buffer_.data(), std::min(num_bytes, buffer_.size()));
+		++stats_.num_syscalls;
+		if (result < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (result <= 0)
+		{
+			throw IoException("[Bridge::Transfer()] Could not read from pipe: " + std::string(strerror(errno)));
+		}
+		WriteAll(sinks_[sink], buffer_.data(), static_cast<std::size_t>(result));
+		num_bytes -= static_cast<std::size_t>(result);
+	}
+}
+
+void serial_port::Bridge::WriteAll(const int fd, const char* data, std::size_t num_bytes)
+{
+	while (num_bytes > 0)
+	{
+		const auto result = write(fd, data, num_bytes);
+		++stats_.num_syscalls;
+		if (result < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (result <= 0)
+		{
+			throw IoException("[Bridge::Transfer()] Could not write to a sink: " + std::string(strerror(errno)));
+		}
+		data += result;
+		num_bytes -= static_cast<std::size_t>(result);
+	}
+}
+
+void serial_port::Bridge::ClosePipes() noexcept
+{
+	for (const auto fd : pipe_)
+	{
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+	}
+	for (const auto& tee_pipe : tee_pipes_)
+	{
+		close(tee_pipe[0]);
+		close(tee_pipe[1]);
+	}
+}
+
+#endif // __linux__
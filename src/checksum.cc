@@ -0,0 +1,60 @@
+#include "checksum.h"
+
+#include <array>
+
+namespace
+{
+	constexpr std::array<std::uint16_t, 256> make_crc16_modbus_table()
+	{
+		std::array<std::uint16_t, 256> table{};
+		for (std::uint16_t i = 0; i < 256; ++i)
+		{
+			std::uint16_t crc = i;
+			for (int bit = 0; bit < 8; ++bit)
+			{
+				crc = (crc & 1) ? static_cast<std::uint16_t>((crc >> 1) ^ 0xA001) : static_cast<std::uint16_t>(crc >> 1);
+			}
+			table[i] = crc;
+		}
+		return table;
+	}
+
+	constexpr auto kCrc16ModbusTable = make_crc16_modbus_table();
+
+	constexpr std::array<std::uint32_t, 256> make_crc32_table()
+	{
+		std::array<std::uint32_t, 256> table{};
+		for (std::uint32_t i = 0; i < 256; ++i)
+		{
+			std::uint32_t crc = i;
+			for (int bit = 0; bit < 8; ++bit)
+			{
+				crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+			}
+			table[i] = crc;
+		}
+		return table;
+	}
+
+	constexpr auto kCrc32Table = make_crc32_table();
+}
+
+std::uint16_t serial_port::checksum::Crc16Modbus(const std::uint8_t* data, const std::size_t num_bytes, std::uint16_t crc)
+{
+	for (std::size_t i = 0; i < num_bytes; ++i)
+	{
+		crc = static_cast<std::uint16_t>((crc >> 8) ^ kCrc16ModbusTable[(crc ^ data[i]) & 0xFF]);
+	}
+	return crc;
+}
+
+std::uint32_t serial_port::checksum::Crc32(const void* data, const std::size_t num_bytes, std::uint32_t crc)
+{
+	const auto* bytes = static_cast<const std::uint8_t*>(data);
+	crc = ~crc;
+	for (std::size_t i = 0; i < num_bytes; ++i)
+	{
+		crc = (crc >> 8) ^ kCrc32Table[(crc ^ bytes[i]) & 0xFF];
+	}
+	return ~crc;
+}
@@ -0,0 +1,22 @@
+#ifndef SERIAL_PORT_CHECKSUM_H
+#define SERIAL_PORT_CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace serial_port::checksum
+{
+	/// @brief CRC-16 as used by Modbus RTU (polynomial 0xA001, initial value 0xFFFF)
+	/// @param data Pointer to the data
+	/// @param num_bytes Number of bytes to process
+	/// @param crc The running CRC value (pass the result of a previous call to continue a calculation)
+	std::uint16_t Crc16Modbus(const std::uint8_t* data, std::size_t num_bytes, std::uint16_t crc = 0xFFFF);
+
+	/// @brief CRC-32 as used by Ethernet, zlib and ZMODEM (reflected polynomial 0xEDB88320)
+	/// @param data Pointer to the data
+	/// @param num_bytes Number of bytes to process
+	/// @param crc The result of a previous call to continue a calculation (0 to start a new one)
+	std::uint32_t Crc32(const void* data, std::size_t num_bytes, std::uint32_t crc = 0);
+}
+
+#endif // SERIAL_PORT_CHECKSUM_H
@@ -0,0 +1,512 @@
+#include "serial_port/compression.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+#include "checksum.h"
+
+namespace
+{
+	// Frame layout: magic (2 bytes), flags, sequence number, varint message length, varint payload length,
+	// payload, CRC-32 of flags to payload (little endian)
+	constexpr std::uint8_t kMagic0 = 0xC5;
+	constexpr std::uint8_t kMagic1 = 0x7A;
+	constexpr std::uint8_t kFlagCompressed = 0x01;
+	constexpr std::uint8_t kFlagReset = 0x02;
+
+	constexpr std::size_t kMinMatch = 4;
+	constexpr std::size_t kMaxOffset = 65535;
+	// The history is trimmed back to kMaxOffset bytes when it grows beyond this
+	constexpr std::size_t kHistoryCapacity = 4 * kMaxOffset;
+	constexpr int kHashBits = 14;
+
+	std::uint32_t read32(const std::uint8_t* data)
+	{
+		std::uint32_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	std::size_t hash(const std::uint8_t* data)
+	{
+		return (read32(data) * 2654435761u) >> (32 - kHashBits);
+	}
+
+	// Worst case size of a compressed block
+	std::size_t compress_bound(const std::size_t num_bytes)
+	{
+		return num_bytes + num_bytes / 255 + 16;
+	}
+
+	void write_length(std::vector<std::uint8_t>& out, std::size_t length)
+	{
+		while (length >= 255)
+		{
+			out.push_back(255);
+			length -= 255;
+		}
+		out.push_back(static_cast<std::uint8_t>(length));
+	}
+
+	void write_varint(std::vector<std::uint8_t>& out, std::uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back(static_cast<std::uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back(static_cast<std::uint8_t>(value));
+	}
+
+	enum class Parse { kOk, kIncomplete, kInvalid };
+
+	Parse read_varint(const std::string& buffer, std::size_t& pos, std::uint64_t& value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			if (pos >= buffer.size())
+			{
+				return Parse::kIncomplete;
+			}
+			const auto byte = static_cast<std::uint8_t>(buffer[pos++]);
+			value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+			{
+				return Parse::kOk;
+			}
+		}
+		return Parse::kInvalid;
+	}
+
+	// Keep the last kMaxOffset bytes of the dictionary, older ones could never be referenced
+	std::string_view dictionary_tail(const std::string& dictionary)
+	{
+		std::string_view tail(dictionary);
+		return tail.substr(tail.size() - std::min(tail.size(), kMaxOffset));
+	}
+}
+
+// LZ4-style block compressor whose history (dictionary and previous messages) persists across blocks
+class serial_port::CompressedChannel::Encoder
+{
+public:
+	explicit Encoder(const std::string& dictionary) : dictionary_(dictionary_tail(dictionary)), table_(std::size_t{ 1 } << kHashBits) {}
+
+	void Reset()
+	{
+		history_.assign(dictionary_.begin(), dictionary_.end());
+		Rehash();
+	}
+
+	// Append the message to the history and compress it into out
+	void Compress(const std::string& message, std::vector<std::uint8_t>& out)
+	{
+		if (history_.size() + message.size() > kHistoryCapacity && history_.size() > kMaxOffset)
+		{
+			history_.erase(history_.begin(), history_.end() - kMaxOffset);
+			Rehash();
+		}
+
+		const auto start = history_.size();
+		history_.insert(history_.end(), message.begin(), message.end());
+		const auto end = history_.size();
+		const auto* data = history_.data();
+
+		// The last bytes of the previous message could not be indexed before
+		for (auto pos = start - std::min<std::size_t>(start, kMinMatch - 1); pos < start && pos + kMinMatch <= end; ++pos)
+		{
+			table_[hash(data + pos)] = static_cast<std::int64_t>(pos);
+		}
+
+		auto anchor = start;
+		auto pos = start;
+		while (pos + kMinMatch <= end)
+		{
+			auto& entry = table_[hash(data + pos)];
+			const auto candidate = entry;
+			entry = static_cast<std::int64_t>(pos);
+			if (candidate < 0 || pos - static_cast<std::size_t>(candidate) > kMaxOffset
+				|| read32(data + candidate) != read32(data + pos))
+			{
+				++pos;
+				continue;
+			}
+
+			const auto match = static_cast<std::size_t>(candidate);
+			auto length = kMinMatch;
+			while (pos + length < end && data[match + length] == data[pos + length])
+			{
+				++length;
+			}
+			WriteSequence(out, anchor, pos - anchor, pos - match, length);
+
+			for (auto next = pos + 1; next < pos + length && next + kMinMatch <= end; ++next)
+			{
+				table_[hash(data + next)] = static_cast<std::int64_t>(next);
+			}
+			pos += length;
+			anchor = pos;
+		}
+
+		// The block always ends with a sequence of literals only (possibly empty)
+		const auto num_literals = end - anchor;
+		out.push_back(static_cast<std::uint8_t>(std::min<std::size_t>(num_literals, 15) << 4));
+		if (num_literals >= 15)
+		{
+			write_length(out, num_literals - 15);
+		}
+		out.insert(out.end(), data + anchor, data + end);
+	}
+
+private:
+	void Rehash()
+	{
+		std::fill(table_.begin(), table_.end(), -1);
+		for (std::size_t pos = 0; pos + kMinMatch <= history_.size(); ++pos)
+		{
+			table_[hash(history_.data() + pos)] = static_cast<std::int64_t>(pos);
+		}
+	}
+
+	void WriteSequence(std::vector<std::uint8_t>& out, const std::size_t literals, const std::size_t num_literals,
+		const std::size_t offset, const std::size_t length) const
+	{
+		const auto match_length = length - kMinMatch;
+		out.push_back(static_cast<std::uint8_t>(std::min<std::size_t>(num_literals, 15) << 4 | std::min<std::size_t>(match_length, 15)));
+		if (num_literals >= 15)
+		{
+			write_length(out, num_literals - 15);
+		}
+		out.insert(out.end(), history_.begin() + static_cast<std::ptrdiff_t>(literals),
+			history_.begin() + static_cast<std::ptrdiff_t>(literals + num_literals));
+		out.push_back(static_cast<std::uint8_t>(offset & 0xFF));
+		out.push_back(static_cast<std::uint8_t>(offset >> 8));
+		if (match_length >= 15)
+		{
+			write_length(out, match_length - 15);
+		}
+	}
+
+	std::string dictionary_;
+	std::vector<std::uint8_t> history_;
+	std::vector<std::int64_t> table_;
+};
+
+// Counterpart of the Encoder. Rejects malformed input instead of reading or writing out of bounds.
+class serial_port::CompressedChannel::Decoder
+{
+public:
+	explicit Decoder(const std::string& dictionary) : dictionary_(dictionary_tail(dictionary)) {}
+
+	void Reset()
+	{
+		history_.assign(dictionary_.begin(), dictionary_.end());
+	}
+
+	// Decompress a block of num_bytes bytes that holds a message of message_size bytes
+	bool Decompress(const std::uint8_t* in, const std::size_t num_bytes, const std::size_t message_size, std::string& message)
+	{
+		const auto start = Prepare(message_size);
+		const auto* const in_end = in + num_bytes;
+		const auto end = start + message_size;
+
+		const auto read_length = [&in, in_end](std::size_t& length)
+		{
+			if (length != 15)
+			{
+				return true;
+			}
+			std::uint8_t byte;
+			do
+			{
+				if (in == in_end)
+				{
+					return false;
+				}
+				byte = *in++;
+				length += byte;
+			} while (byte == 255);
+			return true;
+		};
+
+		while (in != in_end)
+		{
+			const auto token = *in++;
+			std::size_t num_literals = token >> 4;
+			if (!read_length(num_literals) || num_literals > static_cast<std::size_t>(in_end - in)
+				|| history_.size() + num_literals > end)
+			{
+				return false;
+			}
+			history_.insert(history_.end(), in, in + num_literals);
+			in += num_literals;
+			if (in == in_end)
+			{
+				break;
+			}
+
+			if (in_end - in < 2)
+			{
+				return false;
+			}
+			const std::size_t offset = in[0] | static_cast<std::size_t>(in[1]) << 8;
+			in += 2;
+			std::size_t length = token & 0x0F;
+			if (!read_length(length) || offset == 0 || offset > history_.size())
+			{
+				return false;
+			}
+			length += kMinMatch;
+			if (history_.size() + length > end)
+			{
+				return false;
+			}
+			// Byte by byte, because the match may overlap the bytes being produced
+			for (auto from = history_.size() - offset; length > 0; --length)
+			{
+				history_.push_back(history_[from++]);
+			}
+		}
+
+		if (history_.size() != end)
+		{
+			return false;
+		}
+		message.assign(reinterpret_cast<const char*>(history_.data() + start), message_size);
+		return true;
+	}
+
+	// Append a message that was sent uncompressed
+	void Store(const std::uint8_t* in, const std::size_t num_bytes, std::string& message)
+	{
+		Prepare(num_bytes);
+		history_.insert(history_.end(), in, in + num_bytes);
+		message.assign(reinterpret_cast<const char*>(in), num_bytes);
+	}
+
+private:
+	std::size_t Prepare(const std::size_t message_size)
+	{
+		if (history_.size() + message_size > kHistoryCapacity && history_.size() > kMaxOffset)
+		{
+			history_.erase(history_.begin(), history_.end() - kMaxOffset);
+		}
+		history_.reserve(history_.size() + message_size);
+		return history_.size();
+	}
+
+	std::string dictionary_;
+	std::vector<std::uint8_t> history_;
+};
+
+serial_port::CompressedChannel::CompressedChannel(SerialPort& port, CompressionOptions options)
+	: port_(port), options_(std::move(options)),
+	encoder_(std::make_unique<Encoder>(options_.dictionary)),
+	decoder_(std::make_unique<Decoder>(options_.dictionary)),
+	chunk_(4096)
+{
+}
+
+serial_port::CompressedChannel::~CompressedChannel() = default;
+
+std::size_t serial_port::CompressedChannel::WriteMessage(const std::string& message)
+{
+	// Resetting now and then lets a receiver that lost a frame resynchronize
+	const bool reset = !options_.streaming || stats_.messages_written == 0
+		|| (options_.reset_interval != 0 && stats_.messages_written % options_.reset_interval == 0);
+
+	const auto started = std::chrono::steady_clock::now();
+	if (reset)
+	{
+		encoder_->Reset();
+	}
+
+	frame_.clear();
+	frame_.push_back(kMagic0);
+	frame_.push_back(kMagic1);
+	frame_.push_back(0);
+	frame_.push_back(tx_sequence_++);
+	write_varint(frame_, message.size());
+
+	payload_.clear();
+	payload_.reserve(compress_bound(message.size()));
+	encoder_->Compress(message, payload_);
+
+	std::uint8_t flags = reset ? kFlagReset : 0;
+	if (payload_.size() < message.size())
+	{
+		flags |= kFlagCompressed;
+		write_varint(frame_, payload_.size());
+		frame_.insert(frame_.end(), payload_.begin(), payload_.end());
+	}
+	else
+	{
+		// Incompressible: send the message as it is (the history still includes it)
+		write_varint(frame_, message.size());
+		frame_.insert(frame_.end(), message.begin(), message.end());
+	}
+	frame_[2] = flags;
+
+	const auto crc = checksum::Crc32(frame_.data() + 2, frame_.size() - 2);
+	for (int shift = 0; shift < 32; shift += 8)
+	{
+		frame_.push_back(static_cast<std::uint8_t>(crc >> shift));
+	}
+	stats_.compression_time += std::chrono::steady_clock::now() - started;
+
+	std::size_t num_written = 0;
+	while (num_written < frame_.size())
+	{
+		const auto remaining = frame_.size() - num_written;
+		const auto result = port_.WriteData(reinterpret_cast<const char*>(frame_.data() + num_written), static_cast<unsigned long>(remaining));
+		if (result == 0 || result > remaining)
+		{
+			throw IoException("[CompressedChannel::WriteMessage()] Error writing to the port.");
+		}
+		num_written += result;
+	}
+
+	++stats_.messages_written;
+	stats_.raw_bytes_written += message.size();
+	stats_.wire_bytes_written += frame_.size();
+	return frame_.size();
+}
+
+bool serial_port::CompressedChannel::ReadMessage(std::string& message, const std::chrono::milliseconds timeout)
+{
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+	while (true)
+	{
+		bool decoded = false;
+		while (DecodeFrame(message, decoded))
+		{
+			if (decoded)
+			{
+				return true;
+			}
+		}
+
+		const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+		if (remaining.count() <= 0 || !port_.WaitForData(remaining))
+		{
+			return false;
+		}
+		const auto num_bytes = std::clamp<unsigned long>(port_.NumBytesAvailable(), 1, static_cast<unsigned long>(chunk_.size()));
+		const auto num_bytes_read = port_.ReadData(chunk_.data(), num_bytes);
+		// Nothing after WaitForData() means that the device hung up
+		if (num_bytes_read == 0 || num_bytes_read > num_bytes)
+		{
+			throw IoException("[CompressedChannel::ReadMessage()] Error reading from the port.");
+		}
+		rx_buffer_.append(chunk_.data(), num_bytes_read);
+	}
+}
+
+bool serial_port::CompressedChannel::DecodeFrame(std::string& message, bool& decoded)
+{
+	decoded = false;
+
+	// Skip anything in front of the magic bytes
+	const char magic[] = { static_cast<char>(kMagic0), static_cast<char>(kMagic1) };
+	const auto frame_start = rx_buffer_.find(std::string_view(magic, 2));
+	if (frame_start == std::string::npos)
+	{
+		const bool keep_last = !rx_buffer_.empty() && static_cast<std::uint8_t>(rx_buffer_.back()) == kMagic0;
+		rx_buffer_.erase(0, rx_buffer_.size() - (keep_last ? 1 : 0));
+		return false;
+	}
+	rx_buffer_.erase(0, frame_start);
+
+	// A corrupted header is skipped by searching for the next magic bytes
+	const auto skip = [this]
+	{
+		rx_buffer_.erase(0, 1);
+		return true;
+	};
+
+	if (rx_buffer_.size() < 4)
+	{
+		return false;
+	}
+	const auto flags = static_cast<std::uint8_t>(rx_buffer_[2]);
+	const auto sequence = static_cast<std::uint8_t>(rx_buffer_[3]);
+	std::size_t pos = 4;
+	std::uint64_t message_size;
+	std::uint64_t payload_size;
+	for (auto* value : { &message_size, &payload_size })
+	{
+		const auto result = read_varint(rx_buffer_, pos, *value);
+		if (result == Parse::kIncomplete)
+		{
+			return false;
+		}
+		if (result == Parse::kInvalid)
+		{
+			return skip();
+		}
+	}
+	if ((flags & ~(kFlagCompressed | kFlagReset)) != 0 || message_size > options_.max_message_size
+		|| payload_size > compress_bound(message_size) || ((flags & kFlagCompressed) == 0 && payload_size != message_size))
+	{
+		return skip();
+	}
+
+	const auto frame_size = pos + payload_size + 4;
+	if (rx_buffer_.size() < frame_size)
+	{
+		return false;
+	}
+	const auto* const frame = reinterpret_cast<const std::uint8_t*>(rx_buffer_.data());
+	std::uint32_t crc = 0;
+	for (int i = 3; i >= 0; --i)
+	{
+		crc = crc << 8 | frame[pos + payload_size + static_cast<std::size_t>(i)];
+	}
+	if (crc != checksum::Crc32(frame + 2, pos + payload_size - 2))
+	{
+		++stats_.frames_dropped;
+		return skip();
+	}
+
+	// The frame is intact. Decode it if the context is in sync with the sender.
+	const auto started = std::chrono::steady_clock::now();
+	if (flags & kFlagReset)
+	{
+		decoder_->Reset();
+		rx_synchronized_ = true;
+	}
+	else if (sequence != rx_sequence_)
+	{
+		// A frame was lost, so the context is missing data
+		rx_synchronized_ = false;
+	}
+	rx_sequence_ = static_cast<std::uint8_t>(sequence + 1);
+
+	if (rx_synchronized_)
+	{
+		if (flags & kFlagCompressed)
+		{
+			rx_synchronized_ = decoder_->Decompress(frame + pos, payload_size, message_size, message);
+		}
+		else
+		{
+			decoder_->Store(frame + pos, payload_size, message);
+		}
+	}
+	stats_.decompression_time += std::chrono::steady_clock::now() - started;
+
+	rx_buffer_.erase(0, frame_size);
+	if (!rx_synchronized_)
+	{
+		++stats_.frames_dropped;
+		return true;
+	}
+
+	decoded = true;
+	++stats_.messages_read;
+	stats_.raw_bytes_read += message.size();
+	stats_.wire_bytes_read += frame_size;
+	return true;
+}
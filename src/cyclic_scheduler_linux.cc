@@ -0,0 +1,314 @@
+#if defined(__linux__)
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#include "serial_port/cyclic_scheduler.h"
+
+serial_port::CyclicScheduler::CyclicScheduler()
+{
+	// steady_clock is CLOCK_MONOTONIC, so its time points can be used as absolute timer deadlines
+	timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+	wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (timer_fd_ < 0 || wake_fd_ < 0)
+	{
+		const auto error = errno;
+		close(timer_fd_);
+		close(wake_fd_);
+		throw IoException("[CyclicScheduler::CyclicScheduler()] Could not create timer: " + std::string(strerror(error)));
+	}
+}
+
+serial_port::CyclicScheduler::~CyclicScheduler()
+{
+	Stop();
+	close(timer_fd_);
+	close(wake_fd_);
+}
+
+serial_port::CyclicScheduler::StreamId serial_port::CyclicScheduler::AddStream(SerialPort& port, const std::chrono::nanoseconds period,
+	std::string frame, const std::chrono::nanoseconds phase)
+{
+	if (frame.empty())
+	{
+		throw std::invalid_argument("[CyclicScheduler::AddStream()] The frame must not be empty.");
+	}
+	return Add({ &port, period, phase, std::move(frame), {}, {}, {} });
+}
+
+serial_port::CyclicScheduler::StreamId serial_port::CyclicScheduler::AddStream(SerialPort& port, const std::chrono::nanoseconds period,
+	FrameProducer producer, const std::chrono::nanoseconds phase)
+{
+	if (!producer)
+	{
+		throw std::invalid_argument("[CyclicScheduler::AddStream()] The producer must not be empty.");
+	}
+	return Add({ &port, period, phase, {}, std::move(producer), {}, {} });
+}
+
+serial_port::CyclicScheduler::StreamId serial_port::CyclicScheduler::Add(Stream stream)
+{
+	if (stream.period.count() <= 0 || stream.phase.count() < 0)
+	{
+		throw std::invalid_argument("[CyclicScheduler::AddStream()] The period must be positive and the phase must not be negative.");
+	}
+	stream.stats.period = stream.period;
+
+	const std::lock_guard<std::mutex> lock(mutex_);
+	const auto id = next_id_++;
+	const auto phase = stream.phase;
+	streams_.emplace(id, std::move(stream));
+	if (running_)
+	{
+		deadlines_.emplace(std::chrono::steady_clock::now() + phase, id);
+		Wake();
+	}
+	return id;
+}
+
+void serial_port::CyclicScheduler::RemoveStream(const StreamId stream)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	streams_.erase(stream);
+	// A producer must not wait for itself
+	if (std::this_thread::get_id() != thread_.get_id())
+	{
+		send_finished_.wait(lock, [this, stream] { return sending_ != stream; });
+	}
+}
+
+void serial_port::CyclicScheduler::Start(const IoThreadConfig& io_thread)
+{
+	if (running_)
+	{
+		return;
+	}
+	// The thread may have stopped by itself after an error
+	if (thread_.joinable())
+	{
+		thread_.join();
+	}
+
+	{
+		const std::lock_guard<std::mutex> lock(mutex_);
+		deadlines_ = {};
+		error_ = {};
+		const auto start = std::chrono::steady_clock::now();
+		for (auto& [id, stream] : streams_)
+		{
+			stream.last_sent = {};
+			deadlines_.emplace(start + stream.phase, id);
+		}
+	}
+
+	running_ = true;
+	try
+	{
+		thread_ = StartIoThread(io_thread, [this] { Run(); });
+	}
+	catch (...)
+	{
+		running_ = false;
+		throw;
+	}
+}
+
+void serial_port::CyclicScheduler::Stop()
+{
+	if (!thread_.joinable())
+	{
+		return;
+	}
+	running_ = false;
+	Wake();
+	thread_.join();
+}
+
+serial_port::CyclicStreamStats serial_port::CyclicScheduler::GetStats(const StreamId stream) const
+{
+	const std::lock_guard<std::mutex> lock(mutex_);
+	const auto it = streams_.find(stream);
+	if (it == streams_.end())
+	{
+		throw std::invalid_argument("[CyclicScheduler::GetStats()] Unknown stream.");
+	}
+	return it->second.stats;
+}
+
+void serial_port::CyclicScheduler::Run()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (running_)
+	{
+		while (!deadlines_.empty() && streams_.count(deadlines_.top().second) == 0)
+		{
+			deadlines_.pop();
+		}
+		if (const auto error = ArmTimer(deadlines_.empty() ? nullptr : &deadlines_.top().first))
+		{
+			// Without a timer nothing can be sent on time anymore
+			error_ = error;
+			running_ = false;
+			break;
+		}
+		lock.unlock();
+
+		pollfd pfds[2]{ { timer_fd_, POLLIN, 0 }, { wake_fd_, POLLIN, 0 } };
+		while (poll(pfds, 2, -1) < 0 && errno == EINTR)
+		{
+		}
+		std::uint64_t count;
+		if ((pfds[0].revents & POLLIN) != 0)
+		{
+			(void)read(timer_fd_, &count, sizeof(count));
+		}
+		if ((pfds[1].revents & POLLIN) != 0)
+		{
+			(void)read(wake_fd_, &count, sizeof(count));
+		}
+
+		lock.lock();
+		const auto now = std::chrono::steady_clock::now();
+		while (running_ && !deadlines_.empty() && deadlines_.top().first <= now)
+		{
+			const auto [deadline, id] = deadlines_.top();
+			deadlines_.pop();
+			const auto it = streams_.find(id);
+			if (it == streams_.end())
+			{
+				continue;
+			}
+
+			// Produce and write without holding the lock, so that a slow producer or a full transmit
+			// buffer does not block the methods called by other threads
+			auto* port = it->second.port;
+			FrameProducer producer;
+			std::optional<TimePoint> sent;
+			sending_ = id;
+			try
+			{
+				producer = it->second.producer;
+				if (!producer)
+				{
+					frame_.assign(it->second.frame);
+				}
+				lock.unlock();
+				sent = Send(*port, producer);
+			}
+			catch (...)
+			{
+				// A throwing producer or write only costs this cycle
+				sent = std::nullopt;
+			}
+			if (!lock.owns_lock())
+			{
+				lock.lock();
+			}
+			sending_.reset();
+			send_finished_.notify_all();
+
+			// The stream may have been removed meanwhile
+			const auto sent_stream = streams_.find(id);
+			if (sent_stream != streams_.end())
+			{
+				deadlines_.emplace(Record(sent_stream->second, deadline, sent), id);
+			}
+		}
+	}
+}
+
+std::error_code serial_port::CyclicScheduler::Error() const
+{
+	const std::lock_guard<std::mutex> lock(mutex_);
+	return error_;
+}
+
+std::error_code serial_port::CyclicScheduler::ArmTimer(const TimePoint* deadline) const
+{
+	itimerspec spec{};
+	if (deadline != nullptr)
+	{
+		const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline->time_since_epoch()).count();
+		spec.it_value.tv_sec = static_cast<time_t>(ns / 1000000000);
+		spec.it_value.tv_nsec = static_cast<long>(ns % 1000000000);
+		// An all-zero value would disarm the timer
+		if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0)
+		{
+			spec.it_value.tv_nsec = 1;
+		}
+	}
+	if (timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr) != 0)
+	{
+		return std::error_code(errno, std::system_category());
+	}
+	return {};
+}
+
+void serial_port::CyclicScheduler::Wake() const
+{
+	const std::uint64_t one = 1;
+	(void)write(wake_fd_, &one, sizeof(one));
+}
+
+std::optional<serial_port::CyclicScheduler::TimePoint> serial_port::CyclicScheduler::Send(const SerialPort& port,
+	const FrameProducer& producer)
+{
+	if (producer)
+	{
+		frame_.clear();
+		producer(frame_);
+	}
+	if (frame_.empty())
+	{
+		return TimePoint{};
+	}
+
+	const auto sent = std::chrono::steady_clock::now();
+	const auto num_bytes = port.WriteData(frame_.data(), static_cast<unsigned long>(frame_.size()));
+	if (num_bytes != frame_.size())
+	{
+		return std::nullopt;
+	}
+	return sent;
+}
+
+serial_port::CyclicScheduler::TimePoint serial_port::CyclicScheduler::Record(Stream& stream, const TimePoint deadline,
+	const std::optional<TimePoint> sent)
+{
+	auto& stats = stream.stats;
+	if (!sent)
+	{
+		++stats.num_write_errors;
+	}
+	else if (*sent != TimePoint{})
+	{
+		++stats.num_sent;
+		stats.lateness.Add(*sent - deadline);
+		if (stream.last_sent != TimePoint{})
+		{
+			const auto interval = *sent - stream.last_sent;
+			stats.min_interval = std::min<std::chrono::nanoseconds>(stats.min_interval, interval);
+			stats.max_interval = std::max<std::chrono::nanoseconds>(stats.max_interval, interval);
+		}
+		stream.last_sent = *sent;
+	}
+
+	// Skip the cycles whose deadlines have already passed instead of sending them in a burst
+	auto next = deadline + stream.period;
+	const auto now = std::chrono::steady_clock::now();
+	if (next <= now)
+	{
+		const auto num_missed = (now - deadline) / stream.period;
+		stats.num_missed += static_cast<unsigned long>(num_missed);
+		next = deadline + (num_missed + 1) * stream.period;
+		// The interval across the skipped cycles says nothing about the jitter
+		stream.last_sent = {};
+	}
+	return next;
+}
+
+#endif // __linux__
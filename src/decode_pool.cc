@@ -0,0 +1,314 @@
+#include "serial_port/decode_pool.h"
+
+#include <algorithm>
+
+namespace
+{
+	constexpr auto kReadTimeout = std::chrono::milliseconds(50);
+	constexpr std::size_t kChunkSize = 4096;
+
+	void update_maximum(std::atomic<std::size_t>& maximum, const std::size_t value)
+	{
+		auto current = maximum.load();
+		while (value > current && !maximum.compare_exchange_weak(current, value))
+		{
+		}
+	}
+}
+
+serial_port::DecodePool::DecodePool(FrameDecoder decoder, DecodedFrameHandler handler, const DecodePoolOptions& options)
+	: decoder_(std::move(decoder)), handler_(std::move(handler)), options_(options)
+{
+	if (!decoder_ || !handler_ || options_.max_in_flight == 0)
+	{
+		throw std::invalid_argument("[DecodePool::DecodePool()] The decoder and the handler must not be empty and max_in_flight must be positive.");
+	}
+
+	const auto num_workers = options_.num_workers > 0 ? options_.num_workers : std::max(std::thread::hardware_concurrency(), 1U);
+	for (std::size_t i = 0; i < num_workers; ++i)
+	{
+		workers_.push_back(std::make_unique<Worker>());
+	}
+	try
+	{
+		for (std::size_t i = 0; i < num_workers; ++i)
+		{
+			workers_[i]->thread = StartIoThread(options_.worker_thread, [this, i] { Work(i); });
+		}
+	}
+	catch (...)
+	{
+		{
+			const std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		work_available_.notify_all();
+		for (const auto& worker : workers_)
+		{
+			if (worker->thread.joinable())
+			{
+				worker->thread.join();
+			}
+		}
+		throw;
+	}
+}
+
+serial_port::DecodePool::~DecodePool()
+{
+	// Stop reading first, so that no more frames are submitted
+	reading_ = false;
+	std::vector<std::thread*> readers;
+	{
+		// Not held while joining, as readers look up their stream when submitting
+		const std::lock_guard<std::mutex> lock(streams_mutex_);
+		for (const auto& stream : streams_)
+		{
+			if (stream->reader.joinable())
+			{
+				readers.push_back(&stream->reader);
+			}
+		}
+	}
+	for (auto* reader : readers)
+	{
+		reader->join();
+	}
+
+	{
+		const std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	work_available_.notify_all();
+	for (const auto& worker : workers_)
+	{
+		worker->thread.join();
+	}
+}
+
+serial_port::DecodePool::StreamId serial_port::DecodePool::AddStream()
+{
+	const std::lock_guard<std::mutex> lock(streams_mutex_);
+	streams_.push_back(std::make_unique<Stream>());
+	return streams_.size() - 1;
+}
+
+serial_port::DecodePool::StreamId serial_port::DecodePool::AddPort(SerialPort& port, Framer framer)
+{
+	if (!framer)
+	{
+		throw std::invalid_argument("[DecodePool::AddPort()] The framer must not be empty.");
+	}
+
+	const std::lock_guard<std::mutex> lock(streams_mutex_);
+	auto stream = std::make_unique<Stream>();
+	stream->port = &port;
+	stream->framer = std::move(framer);
+	const auto id = streams_.size();
+	stream->reader = StartIoThread(options_.reader_thread, [this, id, &stream = *stream] { Read(id, stream); });
+	streams_.push_back(std::move(stream));
+	return id;
+}
+
+serial_port::DecodePool::Stream& serial_port::DecodePool::GetStream(const StreamId id) const
+{
+	const std::lock_guard<std::mutex> lock(streams_mutex_);
+	if (id >= streams_.size())
+	{
+		throw std::invalid_argument("[DecodePool::GetStream()] Unknown stream " + std::to_string(id) + ".");
+	}
+	return *streams_[id];
+}
+
+void serial_port::DecodePool::Submit(const StreamId stream, std::string frame)
+{
+	auto& target = GetStream(stream);
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		space_available_.wait(lock, [this] { return num_in_flight_ < options_.max_in_flight; });
+		++num_in_flight_;
+		// Counted before the task is queued, so that the count never drops below the number of queued tasks
+		++num_queued_;
+	}
+
+	auto& worker = *workers_[next_worker_++ % workers_.size()];
+	{
+		const std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.tasks.push_back({ &target, stream, target.next_sequence++, std::move(frame) });
+	}
+	++num_submitted_;
+	work_available_.notify_one();
+}
+
+bool serial_port::DecodePool::Drain(const std::chrono::milliseconds timeout)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	return space_available_.wait_for(lock, timeout, [this] { return num_in_flight_ == 0; });
+}
+
+serial_port::DecodePoolStats serial_port::DecodePool::GetStats() const
+{
+	DecodePoolStats stats;
+	stats.num_submitted = num_submitted_;
+	stats.num_handled = num_handled_;
+	stats.num_errors = num_errors_;
+	stats.num_stolen = num_stolen_;
+	stats.max_reorder_depth = max_reorder_depth_;
+	for (const auto& worker : workers_)
+	{
+		stats.num_decoded.push_back(worker->num_decoded);
+	}
+	return stats;
+}
+
+void serial_port::DecodePool::Read(const StreamId id, Stream& stream)
+{
+	std::string buffer;
+	char chunk[kChunkSize];
+	while (reading_)
+	{
+		const auto result = stream.port->TryReadData(chunk, sizeof(chunk), kReadTimeout);
+		if (!result)
+		{
+			if (result.Error() == Errc::kTimeout || result.Error() == Errc::kInterrupted)
+			{
+				continue;
+			}
+			// E.g. the device went away
+			break;
+		}
+
+		buffer.append(chunk, *result);
+		std::size_t frame_length;
+		while (!buffer.empty() && (frame_length = stream.framer(buffer)) != 0)
+		{
+			Submit(id, buffer.substr(0, frame_length));
+			buffer.erase(0, frame_length);
+		}
+	}
+}
+
+void serial_port::DecodePool::Work(const std::size_t index)
+{
+	while (true)
+	{
+		Task task;
+		if (Take(index, task))
+		{
+			Process(index, task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (stopping_ && num_queued_ == 0)
+		{
+			return;
+		}
+		work_available_.wait(lock, [this] { return num_queued_ > 0 || stopping_; });
+	}
+}
+
+bool serial_port::DecodePool::Take(const std::size_t index, Task& task)
+{
+	// Both the owner and thieves take the oldest task, which keeps the frames of a stream close to their
+	// order and the reorder buffers small
+	bool found = false;
+	for (std::size_t i = 0; i < workers_.size() && !found; ++i)
+	{
+		auto& worker = *workers_[(index + i) % workers_.size()];
+		const std::lock_guard<std::mutex> lock(worker.mutex);
+		if (!worker.tasks.empty())
+		{
+			task = std::move(worker.tasks.front());
+			worker.tasks.pop_front();
+			found = true;
+			num_stolen_ += i > 0 ? 1 : 0;
+		}
+	}
+	if (found)
+	{
+		const std::lock_guard<std::mutex> lock(mutex_);
+		--num_queued_;
+	}
+	return found;
+}
+
+void serial_port::DecodePool::Process(const std::size_t index, Task& task)
+{
+	bool decoded = true;
+	try
+	{
+		decoder_(task.frame);
+	}
+	catch (...)
+	{
+		decoded = false;
+	}
+	++workers_[index]->num_decoded;
+
+	auto& stream = *task.stream;
+	{
+		const std::lock_guard<std::mutex> lock(stream.mutex);
+		if (decoded)
+		{
+			stream.decoded.emplace(task.sequence, std::move(task.frame));
+		}
+		else
+		{
+			stream.decoded.emplace(task.sequence, std::nullopt);
+		}
+		if (task.sequence != stream.next_handled)
+		{
+			update_maximum(max_reorder_depth_, stream.decoded.size());
+		}
+		// The worker that is already handling the stream also hands over this frame when its turn comes
+		if (stream.handling)
+		{
+			return;
+		}
+		stream.handling = true;
+	}
+	Handle(task.id, stream);
+}
+
+void serial_port::DecodePool::Handle(const StreamId id, Stream& stream)
+{
+	std::unique_lock<std::mutex> lock(stream.mutex);
+	while (!stream.decoded.empty() && stream.decoded.begin()->first == stream.next_handled)
+	{
+		auto frame = std::move(stream.decoded.begin()->second);
+		stream.decoded.erase(stream.decoded.begin());
+		++stream.next_handled;
+		lock.unlock();
+
+		bool handled = false;
+		if (frame)
+		{
+			try
+			{
+				handler_(id, *frame);
+				handled = true;
+			}
+			catch (...)
+			{
+			}
+		}
+		if (handled)
+		{
+			++num_handled_;
+		}
+		else
+		{
+			++num_errors_;
+		}
+
+		{
+			const std::lock_guard<std::mutex> in_flight_lock(mutex_);
+			--num_in_flight_;
+		}
+		// Wakes both blocked submitters and Drain()
+		space_available_.notify_all();
+		lock.lock();
+	}
+	stream.handling = false;
+}
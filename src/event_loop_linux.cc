@@ -0,0 +1,394 @@
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#include "serial_port/event_loop.h"
+
+namespace
+{
+	std::error_code last_error()
+	{
+		return { errno, std::generic_category() };
+	}
+}
+
+serial_port::EventLoop::EventLoop()
+{
+	epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+	wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (epoll_fd_ < 0 || wake_fd_ < 0)
+	{
+		throw IoException("[EventLoop::EventLoop()] Could not create event loop: " + std::string(strerror(errno)));
+	}
+
+	epoll_event event{};
+	event.events = EPOLLIN;
+	event.data.fd = wake_fd_;
+	epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+}
+
+serial_port::EventLoop::~EventLoop()
+{
+	close(wake_fd_);
+	close(epoll_fd_);
+}
+
+void serial_port::EventLoop::Run()
+{
+	stopped_ = false;
+	while (!stopped_)
+	{
+		RunOnce(kNoTimeout);
+	}
+}
+
+std::size_t serial_port::EventLoop::RunOnce(const std::chrono::milliseconds timeout)
+{
+	loop_thread_ = std::this_thread::get_id();
+
+	// Wake up in time for the nearest deadline
+	auto wait_ms = static_cast<int>(timeout.count());
+	if (!deadlines_.empty())
+	{
+		const auto until_deadline = std::chrono::ceil<std::chrono::milliseconds>(
+			deadlines_.begin()->first - std::chrono::steady_clock::now());
+		const auto deadline_ms = static_cast<int>(std::max<std::chrono::milliseconds::rep>(until_deadline.count(), 0));
+		wait_ms = wait_ms < 0 ? deadline_ms : std::min(wait_ms, deadline_ms);
+	}
+
+	constexpr int kMaxEvents = 64;
+	epoll_event events[kMaxEvents];
+	int num_events;
+	do
+	{
+		num_events = epoll_wait(epoll_fd_, events, kMaxEvents, wait_ms);
+	} while (num_events < 0 && errno == EINTR);
+
+	std::size_t num_dispatched = 0;
+	for (int i = 0; i < num_events; ++i)
+	{
+		const int fd = events[i].data.fd;
+		if (fd == wake_fd_)
+		{
+			std::uint64_t value;
+			while (read(wake_fd_, &value, sizeof(value)) > 0)
+			{
+			}
+			RunPosted();
+			++num_dispatched;
+			continue;
+		}
+
+		// Errors and hang ups complete both directions; the next read or write reports the actual error
+		const auto flags = events[i].events;
+		const auto descriptor = descriptors_.find(fd);
+		if (descriptor != descriptors_.end() && descriptor->second.read_op != 0 && (flags & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+		{
+			Complete(descriptor->second.read_op, {});
+			++num_dispatched;
+		}
+		const auto same_descriptor = descriptors_.find(fd);
+		if (same_descriptor != descriptors_.end() && same_descriptor->second.write_op != 0 && (flags & (EPOLLOUT | EPOLLERR | EPOLLHUP)))
+		{
+			Complete(same_descriptor->second.write_op, {});
+			++num_dispatched;
+		}
+	}
+
+	const auto now = std::chrono::steady_clock::now();
+	while (!deadlines_.empty() && deadlines_.begin()->first <= now)
+	{
+		Complete(deadlines_.begin()->second, std::make_error_code(std::errc::timed_out));
+		++num_dispatched;
+	}
+
+	return num_dispatched;
+}
+
+void serial_port::EventLoop::Stop()
+{
+	stopped_ = true;
+	Post([] {});
+}
+
+void serial_port::EventLoop::Post(std::function<void()> function)
+{
+	{
+		std::lock_guard<std::mutex> lock(posted_mutex_);
+		posted_.push_back(std::move(function));
+	}
+	const std::uint64_t one = 1;
+	const auto written = write(wake_fd_, &one, sizeof(one));
+	(void)written;
+}
+
+serial_port::EventLoop::Deadline serial_port::EventLoop::MakeDeadline(const std::chrono::milliseconds timeout)
+{
+	return timeout.count() < 0 ? Deadline::max() : std::chrono::steady_clock::now() + timeout;
+}
+
+serial_port::EventLoop::OperationId serial_port::EventLoop::WaitReadable(const int fd, const Deadline deadline,
+	std::function<void(std::error_code)> callback)
+{
+	return Wait(fd, false, deadline, std::move(callback));
+}
+
+serial_port::EventLoop::OperationId serial_port::EventLoop::WaitWritable(const int fd, const Deadline deadline,
+	std::function<void(std::error_code)> callback)
+{
+	return Wait(fd, true, deadline, std::move(callback));
+}
+
+void serial_port::EventLoop::Cancel(const OperationId id, const bool notify)
+{
+	Complete(id, std::make_error_code(std::errc::operation_canceled), notify);
+}
+
+serial_port::EventLoop::OperationId serial_port::EventLoop::Wait(const int fd, const bool write, const Deadline deadline,
+	std::function<void(std::error_code)> callback)
+{
+	auto& descriptor = descriptors_[fd];
+	auto& slot = write ? descriptor.write_op : descriptor.read_op;
+	if (slot != 0)
+	{
+		throw std::logic_error("Only one wait per direction may be pending on a file descriptor.");
+	}
+
+	const auto id = next_id_++;
+	Operation operation{ fd, write, std::move(callback), deadline != Deadline::max(), deadlines_.end() };
+	if (operation.has_deadline)
+	{
+		operation.deadline = deadlines_.emplace(deadline, id);
+	}
+	operations_.emplace(id, std::move(operation));
+	slot = id;
+	UpdateInterest(fd);
+
+	return id;
+}
+
+void serial_port::EventLoop::Complete(const OperationId id, const std::error_code error, const bool notify)
+{
+	const auto it = operations_.find(id);
+	if (it == operations_.end())
+	{
+		return;
+	}
+
+	auto operation = std::move(it->second);
+	operations_.erase(it);
+	if (operation.has_deadline)
+	{
+		deadlines_.erase(operation.deadline);
+	}
+	auto& descriptor = descriptors_[operation.fd];
+	(operation.write ? descriptor.write_op : descriptor.read_op) = 0;
+	UpdateInterest(operation.fd);
+
+	// Call back last so that the callback may start the next wait right away
+	if (notify)
+	{
+		operation.callback(error);
+	}
+}
+
+void serial_port::EventLoop::UpdateInterest(const int fd)
+{
+	const auto it = descriptors_.find(fd);
+	if (it == descriptors_.end())
+	{
+		return;
+	}
+
+	const auto& descriptor = it->second;
+	if (descriptor.read_op == 0 && descriptor.write_op == 0)
+	{
+		epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+		descriptors_.erase(it);
+		return;
+	}
+
+	epoll_event event{};
+	event.events = (descriptor.read_op != 0 ? EPOLLIN : 0u) | (descriptor.write_op != 0 ? EPOLLOUT : 0u);
+	event.data.fd = fd;
+	if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event) != 0 && errno == ENOENT)
+	{
+		epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+	}
+}
+
+void serial_port::EventLoop::RunPosted()
+{
+	std::vector<std::function<void()>> posted;
+	{
+		std::lock_guard<std::mutex> lock(posted_mutex_);
+		posted.swap(posted_);
+	}
+	for (auto& function : posted)
+	{
+		function();
+	}
+}
+
+serial_port::AsyncPort::AsyncPort(EventLoop& loop, SerialPort& port)
+	: loop_(loop), port_(port), fd_(port.GetNativeHandle())
+{
+	saved_flags_ = fcntl(fd_, F_GETFL);
+	if (saved_flags_ < 0 || fcntl(fd_, F_SETFL, saved_flags_ | O_NONBLOCK) != 0)
+	{
+		throw IoException("[AsyncPort::AsyncPort()] Could not switch port to non-blocking mode: " + std::string(strerror(errno)));
+	}
+}
+
+serial_port::AsyncPort::~AsyncPort()
+{
+	// Cancellations posted from other threads that have not run yet find the port gone
+	*alive_ = false;
+	loop_.Cancel(read_op_, false);
+	loop_.Cancel(write_op_, false);
+	fcntl(fd_, F_SETFL, saved_flags_);
+}
+
+void serial_port::AsyncPort::AsyncRead(char* data, const std::size_t num_bytes, IoHandler handler,
+	const std::chrono::milliseconds timeout)
+{
+	ContinueRead(data, num_bytes, std::move(handler), EventLoop::MakeDeadline(timeout));
+}
+
+void serial_port::AsyncPort::AsyncReadLine(std::string& line, IoHandler handler, const std::chrono::milliseconds timeout)
+{
+	ContinueReadLine(line, std::move(handler), EventLoop::MakeDeadline(timeout));
+}
+
+void serial_port::AsyncPort::AsyncWrite(const char* data, const std::size_t num_bytes, IoHandler handler,
+	const std::chrono::milliseconds timeout)
+{
+	ContinueWrite(data, num_bytes, 0, std::move(handler), EventLoop::MakeDeadline(timeout));
+}
+
+void serial_port::AsyncPort::Cancel()
+{
+	if (loop_.IsLoopThread())
+	{
+		loop_.Cancel(read_op_);
+		loop_.Cancel(write_op_);
+		return;
+	}
+
+	// The port may be destroyed on the loop thread before the loop gets to this
+	loop_.Post([this, alive = alive_]
+	{
+		if (*alive)
+		{
+			loop_.Cancel(read_op_);
+			loop_.Cancel(write_op_);
+		}
+	});
+}
+
+void serial_port::AsyncPort::ContinueRead(char* data, const std::size_t num_bytes, IoHandler handler, const Deadline deadline)
+{
+	// The handle is non-blocking, so this returns right away (served from the line buffer first)
+	const auto num_bytes_read = port_.ReadData(data, static_cast<unsigned long>(num_bytes));
+	if (num_bytes_read > 0 && num_bytes_read <= num_bytes)
+	{
+		handler({ {}, num_bytes_read });
+		return;
+	}
+	if (num_bytes_read == 0)
+	{
+		handler({ std::make_error_code(std::errc::broken_pipe), 0 });
+		return;
+	}
+	if (errno != EAGAIN && errno != EINTR)
+	{
+		handler({ last_error(), 0 });
+		return;
+	}
+
+	read_op_ = loop_.WaitReadable(fd_, deadline, [this, data, num_bytes, handler = std::move(handler), deadline](const std::error_code error) mutable
+	{
+		read_op_ = 0;
+		if (error)
+		{
+			handler({ error, 0 });
+			return;
+		}
+		ContinueRead(data, num_bytes, std::move(handler), deadline);
+	});
+}
+
+void serial_port::AsyncPort::ContinueReadLine(std::string& line, IoHandler handler, const Deadline deadline)
+{
+	const auto& lines = port_.ReadLineViews(1);
+	if (!lines.empty())
+	{
+		line.assign(lines.front());
+		handler({ {}, line.size() });
+		return;
+	}
+
+	read_op_ = loop_.WaitReadable(fd_, deadline, [this, &line, handler = std::move(handler), deadline](const std::error_code error) mutable
+	{
+		read_op_ = 0;
+		if (error)
+		{
+			handler({ error, 0 });
+			return;
+		}
+		// A readable handle without any data means that the other side hung up
+		int num_bytes_available = 0;
+		if (ioctl(fd_, FIONREAD, &num_bytes_available) != 0 || num_bytes_available == 0)
+		{
+			handler({ std::make_error_code(std::errc::broken_pipe), 0 });
+			return;
+		}
+		ContinueReadLine(line, std::move(handler), deadline);
+	});
+}
+
+void serial_port::AsyncPort::ContinueWrite(const char* data, const std::size_t num_bytes, std::size_t num_written,
+	IoHandler handler, const Deadline deadline)
+{
+	while (num_written < num_bytes)
+	{
+		const auto result = write(fd_, data + num_written, num_bytes - num_written);
+		if (result >= 0)
+		{
+			num_written += static_cast<std::size_t>(result);
+			continue;
+		}
+		if (errno == EINTR)
+		{
+			continue;
+		}
+		if (errno != EAGAIN)
+		{
+			handler({ last_error(), num_written });
+			return;
+		}
+
+		write_op_ = loop_.WaitWritable(fd_, deadline,
+			[this, data, num_bytes, num_written, handler = std::move(handler), deadline](const std::error_code error) mutable
+		{
+			write_op_ = 0;
+			if (error)
+			{
+				handler({ error, num_written });
+				return;
+			}
+			ContinueWrite(data, num_bytes, num_written, std::move(handler), deadline);
+		});
+		return;
+	}
+
+	handler({ {}, num_written });
+}
+
+#endif // __linux__
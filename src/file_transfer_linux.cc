@@ -0,0 +1,458 @@
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "serial_port/file_transfer.h"
+#include "checksum.h"
+
+namespace
+{
+	// Packet layout: magic, type, offset (8 bytes), payload length (2 bytes), payload, CRC-32 of type to payload.
+	// All numbers are little endian.
+	constexpr char kMagic = static_cast<char>(0xF7);
+	constexpr std::size_t kHeaderSize = 12;
+	constexpr std::size_t kTrailerSize = 4;
+	constexpr std::size_t kMaxBlockSize = 32768;
+
+	// Sender to receiver
+	constexpr std::uint8_t kFile = 1;  // Offset: file size
+	constexpr std::uint8_t kData = 2;  // Offset: position of the payload in the file
+	constexpr std::uint8_t kEnd = 3;  // Offset: file size
+	// Receiver to sender
+	constexpr std::uint8_t kAck = 4;  // Offset: number of bytes received without gaps
+	constexpr std::uint8_t kNak = 5;  // Offset: position to continue sending from
+	constexpr std::uint8_t kEndAck = 6;
+
+	void put_le(char* out, std::uint64_t value, const std::size_t num_bytes)
+	{
+		for (std::size_t i = 0; i < num_bytes; ++i, value >>= 8)
+		{
+			out[i] = static_cast<char>(value & 0xFF);
+		}
+	}
+
+	std::uint64_t get_le(const char* in, const std::size_t num_bytes)
+	{
+		std::uint64_t value = 0;
+		for (std::size_t i = num_bytes; i > 0; --i)
+		{
+			value = value << 8 | static_cast<std::uint8_t>(in[i - 1]);
+		}
+		return value;
+	}
+
+	// A file mapped into memory for reading
+	class MappedFile
+	{
+	public:
+		explicit MappedFile(const std::string& path)
+		{
+			fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			struct stat status{};
+			if (fd_ < 0 || fstat(fd_, &status) != 0)
+			{
+				const auto error = errno;
+				if (fd_ >= 0)
+				{
+					close(fd_);
+				}
+				throw serial_port::IoException("[FileTransfer::Send()] Could not open " + path + ": " + std::string(strerror(error)));
+			}
+
+			size_ = static_cast<std::size_t>(status.st_size);
+			if (size_ > 0)
+			{
+				void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+				if (data == MAP_FAILED)
+				{
+					const auto error = errno;
+					close(fd_);
+					throw serial_port::IoException("[FileTransfer::Send()] Could not map " + path + ": " + std::string(strerror(error)));
+				}
+				data_ = static_cast<const char*>(data);
+				madvise(data, size_, MADV_SEQUENTIAL);
+			}
+		}
+		~MappedFile()
+		{
+			if (data_ != nullptr)
+			{
+				munmap(const_cast<char*>(data_), size_);
+			}
+			close(fd_);
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		[[nodiscard]] const char* Data() const { return data_; }
+		[[nodiscard]] std::size_t Size() const { return size_; }
+
+	private:
+		int fd_{ -1 };
+		const char* data_{ nullptr };
+		std::size_t size_{ 0 };
+	};
+}
+
+serial_port::FileTransfer::FileTransfer(SerialPort& port, TransferOptions options)
+	: port_(port), options_(options), chunk_(4096)
+{
+	if (options_.block_size == 0 || options_.block_size > kMaxBlockSize)
+	{
+		throw std::invalid_argument("[FileTransfer::FileTransfer()] The block size must be between 1 and "
+			+ std::to_string(kMaxBlockSize) + ".");
+	}
+	options_.window_size = std::max(options_.window_size, options_.block_size);
+	options_.ack_interval = std::clamp<std::size_t>(options_.ack_interval, 1, options_.window_size);
+}
+
+serial_port::TransferStats serial_port::FileTransfer::Send(const std::string& path)
+{
+	const MappedFile file(path);
+	const auto size = static_cast<std::uint64_t>(file.Size());
+	TransferStats stats;
+	stats.file_size = size;
+	stats.line_capacity = LineCapacity();
+	rx_buffer_.clear();
+	const auto started = std::chrono::steady_clock::now();
+
+	std::uint64_t acked = 0;
+	std::uint64_t next = 0;
+	std::uint64_t sent = 0;
+	bool accepted = false;
+	bool finished = false;
+	int retries = 0;
+	const auto on_packet = [&](const Packet& packet)
+	{
+		if (packet.type == kAck && packet.offset <= size)
+		{
+			accepted = true;
+			if (packet.offset > acked)
+			{
+				acked = packet.offset;
+				retries = 0;
+			}
+		}
+		else if (packet.type == kNak && packet.offset <= size && packet.offset >= acked)
+		{
+			// Go back to the first byte the receiver is missing
+			accepted = true;
+			++stats.naks;
+			acked = packet.offset;
+			next = std::min(next, packet.offset);
+			retries = 0;
+		}
+		else if (packet.type == kEndAck)
+		{
+			finished = true;
+		}
+	};
+
+	// Announce the file until the receiver is ready
+	while (!accepted)
+	{
+		WritePacket(stats, kFile, size);
+		if (!ReadPackets(options_.timeout, stats, on_packet) && ++retries > options_.max_retries)
+		{
+			throw IoException("[FileTransfer::Send()] The receiver does not respond.");
+		}
+	}
+
+	auto last_progress = std::chrono::steady_clock::now();
+	auto last_acked = acked;
+	while (acked < size)
+	{
+		// Fill the window in one write
+		tx_buffer_.clear();
+		while (next < size && next - acked < options_.window_size)
+		{
+			const auto num_bytes = static_cast<std::size_t>(std::min<std::uint64_t>(
+				{ options_.block_size, size - next, acked + options_.window_size - next }));
+			AppendPacket(tx_buffer_, kData, next, file.Data() + next, num_bytes);
+			if (next < sent)
+			{
+				stats.retransmitted_bytes += std::min<std::uint64_t>(num_bytes, sent - next);
+			}
+			next += num_bytes;
+			sent = std::max(sent, next);
+		}
+		if (!tx_buffer_.empty())
+		{
+			WriteBuffer(stats);
+		}
+
+		// Collect the replies that have arrived, or wait for one if the window is full
+		const auto now = std::chrono::steady_clock::now();
+		const auto wait = tx_buffer_.empty()
+			? std::max(std::chrono::ceil<std::chrono::milliseconds>(last_progress + options_.timeout - now), std::chrono::milliseconds(1))
+			: std::chrono::milliseconds(0);
+		ReadPackets(wait, stats, on_packet);
+
+		if (acked != last_acked)
+		{
+			last_acked = acked;
+			last_progress = std::chrono::steady_clock::now();
+		}
+		else if (std::chrono::steady_clock::now() - last_progress >= options_.timeout)
+		{
+			// No progress: the data or the acknowledgments were lost, so resend the window
+			++stats.timeouts;
+			if (++retries > options_.max_retries)
+			{
+				throw IoException("[FileTransfer::Send()] Transfer timed out at offset " + std::to_string(acked) + ".");
+			}
+			next = acked;
+			last_progress = std::chrono::steady_clock::now();
+		}
+	}
+
+	// All data was acknowledged, so the end marker is only a courtesy for the receiver
+	for (int i = 0; i < options_.max_retries && !finished; ++i)
+	{
+		WritePacket(stats, kEnd, size);
+		ReadPackets(options_.timeout, stats, on_packet);
+	}
+
+	stats.elapsed = std::chrono::steady_clock::now() - started;
+	return stats;
+}
+
+serial_port::TransferStats serial_port::FileTransfer::Receive(const std::string& path)
+{
+	TransferStats stats;
+	stats.line_capacity = LineCapacity();
+	rx_buffer_.clear();
+
+	const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+	{
+		throw IoException("[FileTransfer::Receive()] Could not create " + path + ": " + std::string(strerror(errno)));
+	}
+	struct FileCloser
+	{
+		int fd;
+		~FileCloser() { close(fd); }
+	} closer{ fd };
+
+	bool announced = false;
+	bool finished = false;
+	bool nak_sent = false;
+	std::uint64_t size = 0;
+	std::uint64_t expected = 0;
+	std::uint64_t last_ack = 0;
+	auto started = std::chrono::steady_clock::now();
+
+	const auto request_missing = [&]
+	{
+		if (!nak_sent)
+		{
+			WritePacket(stats, kNak, expected);
+			++stats.naks;
+			nak_sent = true;
+		}
+	};
+
+	const auto on_packet = [&](const Packet& packet)
+	{
+		if (packet.type == kFile)
+		{
+			if (!announced)
+			{
+				announced = true;
+				size = packet.offset;
+				stats.file_size = size;
+				started = std::chrono::steady_clock::now();
+			}
+			// Repeated if the sender missed the acknowledgment
+			WritePacket(stats, kAck, expected);
+		}
+		else if (!announced)
+		{
+			return;
+		}
+		else if (packet.type == kData)
+		{
+			if (packet.offset != expected || packet.offset + packet.payload.size() > size)
+			{
+				// A packet is missing (older packets are duplicates after a go back and just ignored)
+				if (packet.offset > expected)
+				{
+					request_missing();
+				}
+				return;
+			}
+
+			for (std::size_t written = 0; written < packet.payload.size();)
+			{
+				const auto result = pwrite(fd, packet.payload.data() + written, packet.payload.size() - written,
+					static_cast<off_t>(expected + written));
+				if (result < 0 && errno != EINTR)
+				{
+					throw IoException("[FileTransfer::Receive()] Could not write to " + path + ": " + std::string(strerror(errno)));
+				}
+				written += static_cast<std::size_t>(std::max<ssize_t>(result, 0));
+			}
+			expected += packet.payload.size();
+			nak_sent = false;
+			if (expected - last_ack >= options_.ack_interval || expected == size)
+			{
+				WritePacket(stats, kAck, expected);
+				last_ack = expected;
+			}
+		}
+		else if (packet.type == kEnd)
+		{
+			if (expected == size)
+			{
+				WritePacket(stats, kEndAck, size);
+				finished = true;
+			}
+			else
+			{
+				request_missing();
+			}
+		}
+	};
+
+	int retries = 0;
+	while (!finished)
+	{
+		const auto corrupted = stats.corrupted_packets;
+		if (ReadPackets(options_.timeout, stats, on_packet))
+		{
+			retries = 0;
+			if (stats.corrupted_packets != corrupted && announced)
+			{
+				request_missing();
+			}
+			continue;
+		}
+
+		++stats.timeouts;
+		if (++retries > options_.max_retries)
+		{
+			throw IoException("[FileTransfer::Receive()] Transfer timed out at offset " + std::to_string(expected) + ".");
+		}
+		if (announced)
+		{
+			// Our request may have been lost
+			nak_sent = false;
+			request_missing();
+		}
+	}
+
+	stats.elapsed = std::chrono::steady_clock::now() - started;
+	return stats;
+}
+
+void serial_port::FileTransfer::WritePacket(TransferStats& stats, const std::uint8_t type, const std::uint64_t offset)
+{
+	tx_buffer_.clear();
+	AppendPacket(tx_buffer_, type, offset, nullptr, 0);
+	WriteBuffer(stats);
+}
+
+void serial_port::FileTransfer::AppendPacket(std::vector<char>& out, const std::uint8_t type, const std::uint64_t offset,
+	const char* payload, const std::size_t num_bytes) const
+{
+	const auto start = out.size();
+	out.resize(start + kHeaderSize + num_bytes + kTrailerSize);
+	auto* packet = out.data() + start;
+	packet[0] = kMagic;
+	packet[1] = static_cast<char>(type);
+	put_le(packet + 2, offset, 8);
+	put_le(packet + 10, num_bytes, 2);
+	if (num_bytes > 0)
+	{
+		std::memcpy(packet + kHeaderSize, payload, num_bytes);
+	}
+	put_le(packet + kHeaderSize + num_bytes, checksum::Crc32(packet + 1, kHeaderSize - 1 + num_bytes), 4);
+}
+
+void serial_port::FileTransfer::WriteBuffer(TransferStats& stats)
+{
+	std::size_t num_written = 0;
+	while (num_written < tx_buffer_.size())
+	{
+		const auto num_bytes = tx_buffer_.size() - num_written;
+		const auto result = port_.WriteData(tx_buffer_.data() + num_written, static_cast<unsigned long>(num_bytes));
+		if (result == 0 || result > num_bytes)
+		{
+			throw IoException("[FileTransfer::WriteBuffer()] Error writing to the port.");
+		}
+		num_written += result;
+	}
+	stats.wire_bytes += num_written;
+}
+
+bool serial_port::FileTransfer::ReadPackets(const std::chrono::milliseconds timeout, TransferStats& stats,
+	const std::function<void(const Packet&)>& handler)
+{
+	if (!port_.WaitForData(timeout))
+	{
+		return false;
+	}
+	const auto num_bytes = std::clamp<unsigned long>(port_.NumBytesAvailable(), 1, static_cast<unsigned long>(chunk_.size()));
+	const auto num_bytes_read = port_.ReadData(chunk_.data(), num_bytes);
+	// Nothing after WaitForData() means that the device hung up
+	if (num_bytes_read == 0 || num_bytes_read > num_bytes)
+	{
+		throw IoException("[FileTransfer::ReadPackets()] Error reading from the port.");
+	}
+	rx_buffer_.append(chunk_.data(), num_bytes_read);
+	stats.wire_bytes += num_bytes_read;
+
+	std::size_t pos = 0;
+	while (true)
+	{
+		pos = rx_buffer_.find(kMagic, pos);
+		if (pos == std::string::npos || rx_buffer_.size() - pos < kHeaderSize)
+		{
+			break;
+		}
+		const auto* packet = rx_buffer_.data() + pos;
+		const auto payload_size = static_cast<std::size_t>(get_le(packet + 10, 2));
+		if (payload_size > kMaxBlockSize)
+		{
+			++pos;
+			continue;
+		}
+		if (rx_buffer_.size() - pos < kHeaderSize + payload_size + kTrailerSize)
+		{
+			break;
+		}
+		const auto crc = static_cast<std::uint32_t>(get_le(packet + kHeaderSize + payload_size, 4));
+		if (crc != checksum::Crc32(packet + 1, kHeaderSize - 1 + payload_size))
+		{
+			// Only count what looks like a damaged data packet, not every stray magic byte
+			if (static_cast<std::uint8_t>(packet[1]) == kData)
+			{
+				++stats.corrupted_packets;
+			}
+			++pos;
+			continue;
+		}
+
+		handler({ static_cast<std::uint8_t>(packet[1]), get_le(packet + 2, 8), std::string_view(packet + kHeaderSize, payload_size) });
+		pos += kHeaderSize + payload_size + kTrailerSize;
+	}
+	rx_buffer_.erase(0, std::min(pos, rx_buffer_.size()));
+	return true;
+}
+
+double serial_port::FileTransfer::LineCapacity() const
+{
+	// Every byte is framed by a start bit, an optional parity bit and one or two stop bits
+	const auto& settings = port_.GetSettings();
+	const auto bits_per_byte = 1 + 8 + (settings.parity == Parity::kNone ? 0 : 1) + (settings.num_stop_bits == NumStopBits::kTwo ? 2 : 1);
+	return static_cast<double>(settings.baud_rate) / bits_per_byte;
+}
+
+#endif // __linux__
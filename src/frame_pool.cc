@@ -0,0 +1,201 @@
+#include "serial_port/frame_pool.h"
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	// Marks the end of the free list
+	constexpr std::uint32_t kNoBlock = UINT32_MAX;
+	// Blocks start on their own cache line, so that releasing one does not disturb the neighbours
+	constexpr std::size_t kBlockAlignment = 64;
+
+	std::size_t align(const std::size_t size, const std::size_t alignment)
+	{
+		return (size + alignment - 1) / alignment * alignment;
+	}
+
+	// The free list head holds the index of the first free block in the lower 32 bits and a counter
+	// that changes with every update in the upper 32 bits, so that a head that was popped and pushed
+	// again in between (ABA) fails the compare-and-swap
+	constexpr std::uint64_t make_head(const std::uint64_t tag, const std::uint32_t index)
+	{
+		return (tag << 32) | index;
+	}
+}
+
+struct serial_port::FramePoolCore
+{
+	std::size_t buffer_size{ 0 };
+	std::size_t num_buffers{ 0 };
+	std::size_t stride{ 0 };
+	std::unique_ptr<char[]> storage;
+	// First block, aligned within storage
+	char* blocks{ nullptr };
+
+	std::atomic<std::uint64_t> free_head{ make_head(0, kNoBlock) };
+	// The pool itself and every buffer taken from it
+	std::atomic<std::size_t> num_refs{ 1 };
+
+	std::atomic<std::uint64_t> num_hits{ 0 };
+	std::atomic<std::uint64_t> num_misses{ 0 };
+	std::atomic<std::size_t> num_free{ 0 };
+
+	FrameBlock* Block(const std::uint32_t index) const
+	{
+		return reinterpret_cast<FrameBlock*>(blocks + index * stride);
+	}
+
+	FrameBlock* Pop()
+	{
+		auto head = free_head.load(std::memory_order_acquire);
+		while (true)
+		{
+			const auto index = static_cast<std::uint32_t>(head);
+			if (index == kNoBlock)
+			{
+				return nullptr;
+			}
+			auto* block = Block(index);
+			const auto next = make_head((head >> 32) + 1, block->next_free.load(std::memory_order_relaxed));
+			if (free_head.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire))
+			{
+				return block;
+			}
+		}
+	}
+
+	void Push(FrameBlock* block)
+	{
+		auto head = free_head.load(std::memory_order_relaxed);
+		do
+		{
+			block->next_free.store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+		} while (!free_head.compare_exchange_weak(head, make_head((head >> 32) + 1, block->index),
+			std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	void Unref()
+	{
+		if (num_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			delete this;
+		}
+	}
+};
+
+void serial_port::FrameBuffer::Reset() noexcept
+{
+	auto* block = std::exchange(block_, nullptr);
+	if (block == nullptr || block->num_refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+	{
+		return;
+	}
+
+	auto* core = block->core;
+	if (core == nullptr)
+	{
+		// Allocated because the pool was empty
+		block->~FrameBlock();
+		delete[] reinterpret_cast<char*>(block);
+		return;
+	}
+	block->size = 0;
+	block->num_refs.store(1, std::memory_order_relaxed);
+	core->Push(block);
+	core->num_free.fetch_add(1, std::memory_order_relaxed);
+	core->Unref();
+}
+
+void serial_port::FrameBuffer::Resize(const std::size_t size)
+{
+	if (size > Capacity())
+	{
+		throw std::invalid_argument("[FrameBuffer::Resize()] The size exceeds the capacity of " + std::to_string(Capacity()) + " bytes.");
+	}
+	block_->size = size;
+}
+
+serial_port::FramePool::FramePool(const FramePoolOptions& options)
+{
+	if (options.buffer_size == 0 || options.num_buffers >= kNoBlock)
+	{
+		throw std::invalid_argument("[FramePool::FramePool()] Invalid buffer size or number of buffers.");
+	}
+
+	auto core = std::make_unique<FramePoolCore>();
+	core->buffer_size = options.buffer_size;
+	core->num_buffers = options.num_buffers;
+	core->stride = align(align(sizeof(FrameBlock), alignof(std::max_align_t)) + options.buffer_size, kBlockAlignment);
+	core->storage = std::make_unique<char[]>(core->stride * options.num_buffers + kBlockAlignment);
+	const auto address = reinterpret_cast<std::uintptr_t>(core->storage.get());
+	core->blocks = core->storage.get() + (align(address, kBlockAlignment) - address);
+
+	// Push in reverse, so that the first buffers are handed out first
+	for (auto i = static_cast<std::uint32_t>(options.num_buffers); i-- > 0;)
+	{
+		auto* block = new (core->Block(i)) FrameBlock;
+		block->index = i;
+		block->capacity = options.buffer_size;
+		block->core = core.get();
+		block->data = reinterpret_cast<char*>(block) + align(sizeof(FrameBlock), alignof(std::max_align_t));
+		core->Push(block);
+	}
+	core->num_free = options.num_buffers;
+	core_ = core.release();
+}
+
+serial_port::FramePool::~FramePool()
+{
+	core_->Unref();
+}
+
+serial_port::FrameBuffer serial_port::FramePool::Acquire()
+{
+	if (auto* block = core_->Pop(); block != nullptr)
+	{
+		core_->num_refs.fetch_add(1, std::memory_order_relaxed);
+		core_->num_free.fetch_sub(1, std::memory_order_relaxed);
+		core_->num_hits.fetch_add(1, std::memory_order_relaxed);
+		return FrameBuffer(block);
+	}
+
+	core_->num_misses.fetch_add(1, std::memory_order_relaxed);
+	const auto header_size = align(sizeof(FrameBlock), alignof(std::max_align_t));
+	auto* memory = new char[header_size + core_->buffer_size];
+	auto* block = new (memory) FrameBlock;
+	block->capacity = core_->buffer_size;
+	block->data = memory + header_size;
+	return FrameBuffer(block);
+}
+
+serial_port::Result<serial_port::FrameBuffer> serial_port::FramePool::ReadFrom(const SerialPort& port,
+	const std::chrono::milliseconds timeout)
+{
+	auto buffer = Acquire();
+	const auto result = port.TryReadData(buffer.Data(), buffer.Capacity(), timeout);
+	if (!result)
+	{
+		return result.Error();
+	}
+	buffer.Resize(*result);
+	return buffer;
+}
+
+std::size_t serial_port::FramePool::BufferSize() const
+{
+	return core_->buffer_size;
+}
+
+serial_port::FramePoolStats serial_port::FramePool::GetStats() const
+{
+	FramePoolStats stats;
+	stats.num_hits = core_->num_hits;
+	stats.num_misses = core_->num_misses;
+	stats.num_buffers = core_->num_buffers;
+	stats.num_free = core_->num_free;
+	return stats;
+}
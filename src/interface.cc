@@ -1,5 +1,57 @@
 #include "interface.h"
 
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+	// Copy lines into a vector of strings, assigning to the existing strings so that their capacity is reused.
+	// Surplus strings from an earlier, larger burst are emptied but kept, so that their capacity survives
+	// smaller bursts as well.
+	template <typename Vector>
+	std::size_t assign_lines(Vector& lines, const std::pmr::vector<std::string_view>& views)
+	{
+		for (std::size_t i = 0; i < views.size(); ++i)
+		{
+			if (i < lines.size())
+			{
+				lines[i].assign(views[i]);
+			}
+			else
+			{
+				lines.emplace_back(views[i]);
+			}
+		}
+		for (auto i = views.size(); i < lines.size(); ++i)
+		{
+			lines[i].clear();
+		}
+
+		return views.size();
+	}
+
+	// Turn the exception being handled into an error code
+	std::error_code current_error() noexcept
+	{
+		try
+		{
+			throw;
+		}
+		catch (const std::system_error& e)
+		{
+			return e.code();
+		}
+		catch (const std::invalid_argument&)
+		{
+			return std::make_error_code(std::errc::invalid_argument);
+		}
+		catch (...)
+		{
+			return std::make_error_code(std::errc::io_error);
+		}
+	}
+}
+
 
 serial_port::Interface::Interface(const serial_port::Settings& settings) : settings_(settings)
 {
@@ -23,20 +75,320 @@ const serial_port::Settings& serial_port::Interface::GetSettings() const
     return settings_;
 }
 
+void serial_port::Interface::ApplySettings(const Settings& settings, const bool drain)
+{
+	(void)drain;
+	if (IsOpen() && settings.port_name != settings_.port_name)
+	{
+		throw std::invalid_argument("[Interface::ApplySettings()] Cannot change the name of an open port.");
+	}
+
+	settings_ = settings;
+	if (IsOpen())
+	{
+		Open();
+	}
+}
+
+bool serial_port::Interface::WaitForData(const std::chrono::milliseconds timeout)
+{
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+	while (NumBytesAvailable() == 0)
+	{
+		if (std::chrono::steady_clock::now() >= deadline)
+		{
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+serial_port::LineCounters serial_port::Interface::GetLineCounters()
+{
+	throw IoException("[Interface::GetLineCounters()] Line counters are not supported on this platform.");
+}
+
+serial_port::ModemLine serial_port::Interface::GetModemLines()
+{
+	throw IoException("[Interface::GetModemLines()] Modem lines are not supported on this platform.");
+}
+
+serial_port::ModemLine serial_port::Interface::WaitForModemLineChange(const ModemLine lines)
+{
+	(void)lines;
+	throw IoException("[Interface::WaitForModemLineChange()] Waiting for modem lines is not supported on this platform.");
+}
+
+void serial_port::Interface::SetBusyPoll(const std::chrono::nanoseconds spin_budget)
+{
+	if (spin_budget.count() > 0)
+	{
+		throw IoException("[Interface::SetBusyPoll()] Busy polling is not supported on this platform.");
+	}
+}
+
+serial_port::BusyPollStats serial_port::Interface::GetBusyPollStats() const
+{
+	return {};
+}
+
 std::string serial_port::Interface::ReadString()
 {
-	char c{ 'a' };
-	std::string str;
-	while (c != '\n')
+	return std::string(ReadLine());
+}
+
+std::size_t serial_port::Interface::ReadString(std::string& str)
+{
+	str.assign(ReadLine());
+	return str.size();
+}
+
+std::size_t serial_port::Interface::ReadString(std::pmr::string& str)
+{
+	str.assign(ReadLine());
+	return str.size();
+}
+
+unsigned long serial_port::Interface::NumBytesBuffered() const
+{
+	return static_cast<unsigned long>(read_buffer_.size() - read_pos_);
+}
+
+unsigned long serial_port::Interface::ReadBufferedData(char* data, const unsigned long num_bytes)
+{
+	if (NumBytesBuffered() == 0)
+	{
+		return ReadData(data, num_bytes);
+	}
+
+	const auto num_bytes_copied = std::min(num_bytes, NumBytesBuffered());
+	read_buffer_.copy(data, num_bytes_copied, read_pos_);
+	read_pos_ += num_bytes_copied;
+	scan_pos_ = std::max(scan_pos_, read_pos_);
+	return num_bytes_copied;
+}
+
+void serial_port::Interface::ClearBufferedData()
+{
+	read_buffer_.clear();
+	read_pos_ = 0;
+	scan_pos_ = 0;
+}
+
+std::size_t serial_port::Interface::ReadLines(std::vector<std::string>& lines, const std::size_t max_lines)
+{
+	return assign_lines(lines, ReadLineViews(max_lines));
+}
+
+std::size_t serial_port::Interface::ReadLines(std::pmr::vector<std::pmr::string>& lines, const std::size_t max_lines)
+{
+	return assign_lines(lines, ReadLineViews(max_lines));
+}
+
+const std::pmr::vector<std::string_view>& serial_port::Interface::ReadLineViews(const std::size_t max_lines)
+{
+	line_views_.clear();
+	FillReadBuffer(false);
+
+	std::string_view line;
+	while (line_views_.size() < max_lines && NextLine(line))
 	{
-		ReadData(&c, 1);
-		str.push_back(c);
+		line_views_.push_back(line);
 	}
 
-	return str;
+	return line_views_;
+}
+
+void serial_port::Interface::SetMemoryResource(std::pmr::memory_resource* resource)
+{
+	// Move the unconsumed bytes into a buffer allocated from the new resource
+	std::pmr::string read_buffer(read_buffer_.substr(read_pos_), resource);
+	read_buffer_.swap(read_buffer);
+	scan_pos_ -= read_pos_;
+	read_pos_ = 0;
+
+	std::pmr::vector<std::string_view> line_views(resource);
+	line_views_.swap(line_views);
+}
+
+void serial_port::Interface::FillReadBuffer(const bool blocking)
+{
+	// Drop the consumed bytes. This invalidates views handed out previously.
+	if (read_pos_ > 0)
+	{
+		read_buffer_.erase(0, read_pos_);
+		scan_pos_ -= read_pos_;
+		read_pos_ = 0;
+	}
+
+	auto num_bytes = NumBytesAvailable();
+	if (num_bytes == 0)
+	{
+		if (!blocking)
+		{
+			return;
+		}
+		num_bytes = 1;
+	}
+
+	const auto old_size = read_buffer_.size();
+	read_buffer_.resize(old_size + num_bytes);
+	const auto num_bytes_read = ReadData(read_buffer_.data() + old_size, num_bytes);
+	// Anything larger than requested is an error code
+	const auto failed = num_bytes_read > num_bytes || (blocking && num_bytes_read == 0);
+	read_buffer_.resize(old_size + (failed ? 0 : num_bytes_read));
+	if (failed)
+	{
+		// E.g. the device was disconnected, so retrying would never end
+		throw IoException("[Interface::FillReadBuffer()] Error reading from the port.");
+	}
+}
+
+bool serial_port::Interface::NextLine(std::string_view& line)
+{
+	const auto pos = read_buffer_.find('\n', scan_pos_);
+	if (pos == std::string::npos)
+	{
+		scan_pos_ = read_buffer_.size();
+		return false;
+	}
+
+	line = std::string_view(read_buffer_).substr(read_pos_, pos + 1 - read_pos_);
+	read_pos_ = pos + 1;
+	scan_pos_ = read_pos_;
+	return true;
+}
+
+std::string_view serial_port::Interface::ReadLine()
+{
+	std::string_view line;
+	while (!NextLine(line))
+	{
+		FillReadBuffer(true);
+	}
+	return line;
 }
 
 unsigned long serial_port::Interface::WriteString(const std::string& str)
 {
 	return WriteData(str.c_str(), static_cast<unsigned long>(str.size()));
 }
+
+std::error_code serial_port::Interface::TryOpen() noexcept
+{
+	try
+	{
+		Open();
+		return {};
+	}
+	catch (...)
+	{
+		return current_error();
+	}
+}
+
+serial_port::Result<std::size_t> serial_port::Interface::TryNumBytesAvailable() noexcept
+{
+	try
+	{
+		if (!IsOpen())
+		{
+			return Errc::kNotOpen;
+		}
+		return static_cast<std::size_t>(NumBytesAvailable());
+	}
+	catch (...)
+	{
+		return current_error();
+	}
+}
+
+std::error_code serial_port::Interface::TryFlushBuffer() noexcept
+{
+	try
+	{
+		if (!IsOpen())
+		{
+			return Errc::kNotOpen;
+		}
+		FlushBuffer();
+		return {};
+	}
+	catch (...)
+	{
+		return current_error();
+	}
+}
+
+serial_port::Result<serial_port::LineCounters> serial_port::Interface::TryGetLineCounters() noexcept
+{
+	try
+	{
+		return GetLineCounters();
+	}
+	catch (...)
+	{
+		return current_error();
+	}
+}
+
+serial_port::Result<serial_port::ModemLine> serial_port::Interface::TryGetModemLines() noexcept
+{
+	try
+	{
+		return GetModemLines();
+	}
+	catch (...)
+	{
+		return current_error();
+	}
+}
+
+serial_port::Result<std::size_t> serial_port::Interface::TryReadData(char* data, const std::size_t num_bytes,
+	const std::chrono::milliseconds timeout) noexcept
+{
+	try
+	{
+		if (!IsOpen())
+		{
+			return Errc::kNotOpen;
+		}
+		if (timeout.count() >= 0 && !WaitForData(timeout))
+		{
+			return timeout.count() == 0 ? Errc::kWouldBlock : Errc::kTimeout;
+		}
+		const auto num_read = ReadData(data, static_cast<unsigned long>(num_bytes));
+		if (num_read > num_bytes)
+		{
+			// A failed read reported as a negative count
+			return std::make_error_code(std::errc::io_error);
+		}
+		return static_cast<std::size_t>(num_read);
+	}
+	catch (...)
+	{
+		return current_error();
+	}
+}
+
+serial_port::Result<std::size_t> serial_port::Interface::TryWriteData(const char* data, const std::size_t num_bytes) noexcept
+{
+	try
+	{
+		if (!IsOpen())
+		{
+			return Errc::kNotOpen;
+		}
+		const auto num_written = WriteData(data, static_cast<unsigned long>(num_bytes));
+		if (num_written > num_bytes)
+		{
+			return std::make_error_code(std::errc::io_error);
+		}
+		return static_cast<std::size_t>(num_written);
+	}
+	catch (...)
+	{
+		return current_error();
+	}
+}
@@ -1,8 +1,14 @@
 #ifndef SERIAL_PORT_INTERFACE_H
 #define SERIAL_PORT_INTERFACE_H
 
+#include <chrono>
+#include <limits>
+#include <memory_resource>
 #include <string>
+#include <string_view>
+#include <vector>
 
+#include "serial_port/result.h"
 #include "serial_port/types.h"
 
 namespace serial_port
@@ -38,22 +44,84 @@ namespace serial_port
         virtual void Open() = 0;
         virtual void Close() = 0;
         virtual bool IsOpen() = 0;
+        [[nodiscard]] virtual NativeHandle GetNativeHandle() const = 0;
         [[nodiscard]] const Settings& GetSettings() const;
+        // Change the settings of an open port without reopening it. The default implementation reopens the port.
+        virtual void ApplySettings(const Settings& settings, bool drain);
 
         virtual unsigned long NumBytesAvailable() = 0;
         virtual void FlushBuffer() const = 0;
+        // Block until data is available or the timeout expires. Returns true if data is available.
+        // The default implementation polls NumBytesAvailable(); derived classes should wait on the handle.
+        virtual bool WaitForData(std::chrono::milliseconds timeout);
+
+        // Driver counters and modem lines. Not all platforms and devices support them, so the default
+        // implementations throw an IoException.
+        virtual LineCounters GetLineCounters();
+        virtual ModemLine GetModemLines();
+        // Block until one of the given status lines changes and return the new state of all lines.
+        // May return early (with unchanged lines) if the thread is interrupted by a signal.
+        virtual ModemLine WaitForModemLineChange(ModemLine lines);
+
+        // Spin for up to spin_budget before sleeping when a read has to wait for data (0 disables spinning).
+        // The default implementation does not support spinning and throws an IoException.
+        virtual void SetBusyPoll(std::chrono::nanoseconds spin_budget);
+        [[nodiscard]] virtual BusyPollStats GetBusyPollStats() const;
 
     	virtual unsigned long ReadData(char* data, unsigned long num_bytes) = 0;
         virtual std::string ReadString();
+        // Read a line into an existing string, reusing its capacity. Returns the length of the line.
+        std::size_t ReadString(std::string& str);
+        std::size_t ReadString(std::pmr::string& str);
+
+        // Lines are read in bulk into an internal read buffer. Bytes that were read from the port but not
+        // consumed yet are served from this buffer first.
+        [[nodiscard]] unsigned long NumBytesBuffered() const;
+        unsigned long ReadBufferedData(char* data, unsigned long num_bytes);
+        void ClearBufferedData();
+        // Return all complete lines that are currently available (without blocking), at most max_lines, in the
+        // first elements of lines. Surplus strings are emptied but kept so that their capacity is reused.
+        std::size_t ReadLines(std::vector<std::string>& lines, std::size_t max_lines = std::numeric_limits<std::size_t>::max());
+        std::size_t ReadLines(std::pmr::vector<std::pmr::string>& lines, std::size_t max_lines = std::numeric_limits<std::size_t>::max());
+        // Same as ReadLines(), but return views into the read buffer that are valid until the next read
+        const std::pmr::vector<std::string_view>& ReadLineViews(std::size_t max_lines = std::numeric_limits<std::size_t>::max());
+        // Allocate the internal read buffers from a memory resource (the default resource is used otherwise)
+        void SetMemoryResource(std::pmr::memory_resource* resource);
 
     	virtual unsigned long WriteData(const char* data, unsigned long num_bytes) = 0;
         virtual unsigned long WriteString(const std::string& str);
 
+        // Non-throwing variants that report errors as error codes (see Errc) instead of exceptions or
+        // byte counts. The default implementations wrap the throwing methods; derived classes should
+        // map the system errors directly.
+        virtual std::error_code TryOpen() noexcept;
+        virtual Result<std::size_t> TryNumBytesAvailable() noexcept;
+        virtual std::error_code TryFlushBuffer() noexcept;
+        virtual Result<LineCounters> TryGetLineCounters() noexcept;
+        virtual Result<ModemLine> TryGetModemLines() noexcept;
+        // Wait up to timeout for data (0: do not wait, negative: wait forever) and read what is available.
+        // Reads the port only; SerialPort serves the internal read buffer first.
+        virtual Result<std::size_t> TryReadData(char* data, std::size_t num_bytes, std::chrono::milliseconds timeout) noexcept;
+        virtual Result<std::size_t> TryWriteData(const char* data, std::size_t num_bytes) noexcept;
+
         // **************************************************************************
         // **************************************************************************
 
     protected:
         Settings settings_;
+
+    private:
+        // Append the bytes available at the port to the read buffer. If blocking, read at least one byte.
+        void FillReadBuffer(bool blocking);
+        // Find the next complete line in the read buffer and consume it
+        bool NextLine(std::string_view& line);
+        // Block until a complete line is available and consume it
+        std::string_view ReadLine();
+
+        std::pmr::string read_buffer_;
+        std::size_t read_pos_{ 0 };
+        std::size_t scan_pos_{ 0 };
+        std::pmr::vector<std::string_view> line_views_;
     };
 
 }
@@ -0,0 +1,125 @@
+#include "serial_port/io_thread.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <numeric>
+#include <string>
+
+#if defined(__linux__)
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+#if defined(__linux__)
+	constexpr std::size_t kPageSize = 4096;
+
+	// Touch every page of the stack below the caller so that later calls do not fault
+	void prefault_stack(const std::size_t num_bytes)
+	{
+		auto* stack = static_cast<volatile char*>(alloca(num_bytes));
+		for (std::size_t i = 0; i < num_bytes; i += kPageSize)
+		{
+			stack[i] = 0;
+		}
+	}
+
+	std::string describe(const int error)
+	{
+		std::string description = strerror(error);
+		if (error == EPERM)
+		{
+			description += " (real-time scheduling and memory locking require CAP_SYS_NICE/CAP_IPC_LOCK or suitable rlimits)";
+		}
+		return description;
+	}
+#endif
+}
+
+void serial_port::ApplyIoThreadConfig(const IoThreadConfig& config)
+{
+#if defined(__linux__)
+	if (!config.cpus.empty())
+	{
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		for (const auto cpu : config.cpus)
+		{
+			if (cpu < 0 || cpu >= CPU_SETSIZE)
+			{
+				throw std::invalid_argument("[ApplyIoThreadConfig()] Invalid CPU " + std::to_string(cpu) + ".");
+			}
+			CPU_SET(cpu, &cpus);
+		}
+		if (const auto error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus); error != 0)
+		{
+			throw IoException("[ApplyIoThreadConfig()] Could not set the CPU affinity: " + describe(error));
+		}
+	}
+
+	if (config.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+	{
+		throw IoException("[ApplyIoThreadConfig()] Could not lock memory: " + describe(errno));
+	}
+
+	if (config.realtime_priority != 0)
+	{
+		if (config.realtime_priority < sched_get_priority_min(SCHED_FIFO) || config.realtime_priority > sched_get_priority_max(SCHED_FIFO))
+		{
+			throw std::invalid_argument("[ApplyIoThreadConfig()] Invalid real-time priority " + std::to_string(config.realtime_priority) + ".");
+		}
+		sched_param param{};
+		param.sched_priority = config.realtime_priority;
+		if (const auto error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param); error != 0)
+		{
+			throw IoException("[ApplyIoThreadConfig()] Could not enable real-time scheduling: " + describe(error));
+		}
+	}
+
+	if (config.prefault_stack > 0)
+	{
+		prefault_stack(config.prefault_stack);
+	}
+#else
+	if (config != IoThreadConfig{})
+	{
+		throw IoException("[ApplyIoThreadConfig()] Thread configuration is not supported on this platform.");
+	}
+#endif
+}
+
+serial_port::SchedulingLatencyStats serial_port::MeasureSchedulingLatency(const IoThreadConfig& config,
+	const std::chrono::microseconds period, const std::size_t num_samples)
+{
+	std::vector<std::chrono::nanoseconds> delays;
+	delays.reserve(num_samples);
+	auto thread = StartIoThread(config, [&delays, period, num_samples]
+	{
+		// Absolute wake-up times, so that the delays do not accumulate
+		auto wake_up = std::chrono::steady_clock::now();
+		for (std::size_t i = 0; i < num_samples; ++i)
+		{
+			wake_up += period;
+			std::this_thread::sleep_until(wake_up);
+			delays.push_back(std::chrono::steady_clock::now() - wake_up);
+		}
+	});
+	thread.join();
+
+	SchedulingLatencyStats stats;
+	stats.num_samples = delays.size();
+	if (delays.empty())
+	{
+		return stats;
+	}
+	std::sort(delays.begin(), delays.end());
+	stats.min = delays.front();
+	stats.max = delays.back();
+	stats.p99 = delays[std::min(delays.size() - 1, delays.size() * 99 / 100)];
+	stats.average = std::accumulate(delays.begin(), delays.end(), std::chrono::nanoseconds(0)) / static_cast<long long>(delays.size());
+	return stats;
+}
@@ -0,0 +1,278 @@
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include "serial_port/link_emulator.h"
+
+namespace
+{
+	constexpr std::size_t kChunkSize = 4096;
+	// Longest sleep of the relay thread, which bounds the time it takes to stop
+	constexpr auto kMaxSleep = std::chrono::milliseconds(10);
+
+	std::chrono::nanoseconds line_time(const int num_bits, const int baud_rate)
+	{
+		return std::chrono::nanoseconds(1'000'000'000LL * num_bits / baud_rate);
+	}
+
+	int baud_rate_of(const speed_t speed)
+	{
+		static constexpr std::pair<speed_t, int> kBaudRates[]{
+			{ B50, 50 }, { B75, 75 }, { B110, 110 }, { B134, 134 }, { B150, 150 }, { B200, 200 }, { B300, 300 },
+			{ B600, 600 }, { B1200, 1200 }, { B1800, 1800 }, { B2400, 2400 }, { B4800, 4800 }, { B9600, 9600 },
+			{ B19200, 19200 }, { B38400, 38400 }, { B57600, 57600 }, { B115200, 115200 }, { B230400, 230400 },
+			{ B460800, 460800 }, { B500000, 500000 }, { B576000, 576000 }, { B921600, 921600 }, { B1000000, 1000000 },
+			{ B1152000, 1152000 }, { B1500000, 1500000 }, { B2000000, 2000000 }, { B2500000, 2500000 },
+			{ B3000000, 3000000 }, { B3500000, 3500000 }, { B4000000, 4000000 } };
+		for (const auto& [constant, baud_rate] : kBaudRates)
+		{
+			if (constant == speed)
+			{
+				return baud_rate;
+			}
+		}
+		return 0;
+	}
+
+	// Character time of the framing that the port opened on a pseudo terminal configured.
+	// The termios of a pseudo terminal's master are those of its slave, except for the parity, which the
+	// kernel clears.
+	std::chrono::nanoseconds configured_character_time(const int master, const serial_port::Parity parity)
+	{
+		termios tty{};
+		if (tcgetattr(master, &tty) != 0)
+		{
+			return serial_port::CharacterTime(9600, parity);
+		}
+		const auto baud_rate = baud_rate_of(cfgetospeed(&tty));
+		int num_data_bits = 8;
+		switch (tty.c_cflag & CSIZE)
+		{
+			case CS5:
+				num_data_bits = 5;
+				break;
+			case CS6:
+				num_data_bits = 6;
+				break;
+			case CS7:
+				num_data_bits = 7;
+				break;
+			default:
+				break;
+		}
+		const auto num_bits = 1 + num_data_bits + (parity == serial_port::Parity::kNone ? 0 : 1) + ((tty.c_cflag & CSTOPB) != 0 ? 2 : 1);
+		return line_time(num_bits, baud_rate > 0 ? baud_rate : 9600);
+	}
+}
+
+serial_port::LinkEmulator::LinkEmulator(const LinkEmulatorOptions& options)
+	: options_(options), random_(options.seed)
+{
+	if (options_.baud_rate < 0 || options_.latency.count() < 0 || options_.tx_buffer_size == 0
+		|| options_.drop_probability < 0.0 || options_.drop_probability > 1.0
+		|| options_.bit_flip_probability < 0.0 || options_.bit_flip_probability > 1.0)
+	{
+		throw std::invalid_argument("[LinkEmulator::LinkEmulator()] Invalid options.");
+	}
+
+	for (auto& end : ends_)
+	{
+		end.master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+		if (end.master < 0 || grantpt(end.master) != 0 || unlockpt(end.master) != 0)
+		{
+			const auto error = errno;
+			Close();
+			throw IoException("[LinkEmulator::LinkEmulator()] Could not create pseudo terminal: " + std::string(strerror(error)));
+		}
+		end.slave_name = ptsname(end.master);
+		end.slave = open(end.slave_name.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+		if (end.slave < 0)
+		{
+			const auto error = errno;
+			Close();
+			throw IoException("[LinkEmulator::LinkEmulator()] Could not open " + end.slave_name + ": " + std::string(strerror(error)));
+		}
+
+		// Raw until a port configures it, so that nothing is echoed back onto the line
+		termios tty{};
+		tcgetattr(end.master, &tty);
+		cfmakeraw(&tty);
+		tcsetattr(end.master, TCSANOW, &tty);
+	}
+	lines_[0].from = &ends_[0];
+	lines_[0].to = &ends_[1];
+	lines_[1].from = &ends_[1];
+	lines_[1].to = &ends_[0];
+
+	try
+	{
+		thread_ = StartIoThread(options_.io_thread, [this] { Run(); });
+	}
+	catch (...)
+	{
+		Close();
+		throw;
+	}
+}
+
+serial_port::LinkEmulator::~LinkEmulator()
+{
+	running_ = false;
+	thread_.join();
+	Close();
+}
+
+void serial_port::LinkEmulator::Close()
+{
+	for (auto& end : ends_)
+	{
+		if (end.slave >= 0)
+		{
+			close(end.slave);
+		}
+		if (end.master >= 0)
+		{
+			close(end.master);
+		}
+		end.slave = -1;
+		end.master = -1;
+	}
+}
+
+serial_port::LinkStats serial_port::LinkEmulator::GetStats(const LinkDirection direction) const
+{
+	const std::lock_guard<std::mutex> lock(mutex_);
+	return lines_[direction == LinkDirection::kAToB ? 0 : 1].stats;
+}
+
+void serial_port::LinkEmulator::Run()
+{
+	while (running_)
+	{
+		auto now = std::chrono::steady_clock::now();
+		auto wake_up = now + kMaxSleep;
+		pollfd pfds[2]{};
+		nfds_t num_pfds = 0;
+		{
+			const std::lock_guard<std::mutex> lock(mutex_);
+			for (auto& line : lines_)
+			{
+				Deliver(line, now);
+				Transmit(line, now);
+				if (!line.in_flight.empty())
+				{
+					wake_up = std::min(wake_up, line.in_flight.front().arrival);
+				}
+				if (NumQueued(line, now) < options_.tx_buffer_size)
+				{
+					pfds[num_pfds++] = { line.from->master, POLLIN, 0 };
+				}
+				else
+				{
+					// Until the transmit buffer has room again
+					wake_up = std::min(wake_up, line.free_at - line.character_time * static_cast<long>(options_.tx_buffer_size - 1));
+				}
+			}
+		}
+
+		now = std::chrono::steady_clock::now();
+		const auto timeout = std::chrono::duration_cast<std::chrono::nanoseconds>(std::max(wake_up - now, std::chrono::steady_clock::duration::zero()));
+		const timespec ts{ static_cast<time_t>(timeout.count() / 1'000'000'000), static_cast<long>(timeout.count() % 1'000'000'000) };
+		ppoll(pfds, num_pfds, &ts, nullptr);
+	}
+}
+
+std::size_t serial_port::LinkEmulator::NumQueued(const Line& line, const TimePoint now) const
+{
+	if (line.free_at <= now || line.character_time.count() == 0)
+	{
+		return 0;
+	}
+	// Rounded up, as the byte on the line still occupies the buffer
+	const auto busy = std::chrono::duration_cast<std::chrono::nanoseconds>(line.free_at - now);
+	return static_cast<std::size_t>((busy + line.character_time - std::chrono::nanoseconds(1)) / line.character_time);
+}
+
+void serial_port::LinkEmulator::Transmit(Line& line, const TimePoint now)
+{
+	const auto num_queued = NumQueued(line, now);
+	if (num_queued >= options_.tx_buffer_size)
+	{
+		return;
+	}
+	char data[kChunkSize];
+	const auto num_bytes = read(line.from->master, data, std::min(options_.tx_buffer_size - num_queued, sizeof(data)));
+	if (num_bytes <= 0)
+	{
+		return;
+	}
+
+	// Follow the port's settings, which may change at any time
+	line.character_time = options_.baud_rate == 0 ? configured_character_time(line.from->master, options_.parity)
+		: CharacterTime(options_.baud_rate, options_.parity, options_.num_stop_bits);
+	auto departure = std::max(now, line.free_at);
+	for (ssize_t i = 0; i < num_bytes; ++i)
+	{
+		// A byte is received once its last stop bit is
+		departure += line.character_time;
+		line.in_flight.push_back({ departure + options_.latency, data[i] });
+	}
+	line.free_at = departure;
+	line.stats.num_sent += static_cast<std::uint64_t>(num_bytes);
+}
+
+void serial_port::LinkEmulator::Deliver(Line& line, const TimePoint now)
+{
+	std::uniform_real_distribution<double> chance(0.0, 1.0);
+	std::uniform_int_distribution<int> bit(0, 7);
+	delivered_.clear();
+	while (!line.in_flight.empty() && line.in_flight.front().arrival <= now)
+	{
+		auto byte = line.in_flight.front().byte;
+		line.in_flight.pop_front();
+		if (options_.drop_probability > 0.0 && chance(random_) < options_.drop_probability)
+		{
+			++line.stats.num_dropped;
+			continue;
+		}
+		if (options_.bit_flip_probability > 0.0 && chance(random_) < options_.bit_flip_probability)
+		{
+			byte = static_cast<char>(byte ^ (1 << bit(random_)));
+			++line.stats.num_corrupted;
+		}
+		delivered_.push_back(byte);
+	}
+	if (delivered_.empty())
+	{
+		return;
+	}
+
+	// Whatever does not fit into the receiver's buffer is lost, as with a real UART
+	auto room = delivered_.size();
+	if (options_.rx_buffer_size > 0)
+	{
+		int num_buffered = 0;
+		ioctl(line.to->slave, FIONREAD, &num_buffered);
+		const auto buffered = static_cast<std::size_t>(std::max(num_buffered, 0));
+		room = std::min(room, options_.rx_buffer_size > buffered ? options_.rx_buffer_size - buffered : 0);
+	}
+	std::size_t num_written = 0;
+	if (room > 0)
+	{
+		const auto result = write(line.to->master, delivered_.data(), room);
+		num_written = result > 0 ? static_cast<std::size_t>(result) : 0;
+	}
+	line.stats.num_delivered += num_written;
+	line.stats.num_overruns += delivered_.size() - num_written;
+}
+
+#endif // __linux__
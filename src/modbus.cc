@@ -0,0 +1,582 @@
+#include "serial_port/modbus.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+#include "checksum.h"
+
+namespace
+{
+	using serial_port::modbus::FunctionCode;
+
+	void append_u16(std::vector<std::uint8_t>& frame, const std::uint16_t value)
+	{
+		frame.push_back(static_cast<std::uint8_t>(value >> 8));
+		frame.push_back(static_cast<std::uint8_t>(value & 0xFF));
+	}
+
+	void append_crc(std::vector<std::uint8_t>& frame)
+	{
+		const auto crc = serial_port::checksum::Crc16Modbus(frame.data(), frame.size());
+		// The CRC is the only field that is transmitted low byte first
+		frame.push_back(static_cast<std::uint8_t>(crc & 0xFF));
+		frame.push_back(static_cast<std::uint8_t>(crc >> 8));
+	}
+
+	bool crc_matches(const std::vector<std::uint8_t>& frame, const std::size_t length)
+	{
+		const auto crc = serial_port::checksum::Crc16Modbus(frame.data(), length - 2);
+		return frame[length - 2] == (crc & 0xFF) && frame[length - 1] == (crc >> 8);
+	}
+
+	std::uint16_t read_u16(const std::uint8_t* data)
+	{
+		return static_cast<std::uint16_t>((data[0] << 8) | data[1]);
+	}
+
+	// Length of a regular response to a read request
+	std::size_t read_response_length(const std::uint16_t count)
+	{
+		return 5 + 2 * static_cast<std::size_t>(count);
+	}
+
+	void check_read_arguments(const FunctionCode function, const std::uint16_t count)
+	{
+		if (function != FunctionCode::kReadHoldingRegisters && function != FunctionCode::kReadInputRegisters)
+		{
+			throw std::invalid_argument("Function code " + std::to_string(static_cast<int>(function)) + " is not a register read!");
+		}
+		if (count == 0 || count > serial_port::modbus::kMaxReadRegisters)
+		{
+			throw std::invalid_argument("Cannot read " + std::to_string(count) + " registers with one request!");
+		}
+	}
+
+	// The silent interval t3.5 required between two frames (fixed to 1750 us above 19200 baud)
+	std::chrono::microseconds default_inter_frame_delay(const int baud_rate)
+	{
+		if (baud_rate <= 0 || baud_rate > 19200)
+		{
+			return std::chrono::microseconds(1750);
+		}
+		// 3.5 characters of 11 bits each
+		return std::chrono::microseconds(38500000 / baud_rate + 1);
+	}
+
+	// Pause of background polling on a bus whose port failed
+	constexpr std::chrono::milliseconds kPortErrorBackoff{ 500 };
+	// Longest time that Stop() waits for a pausing bus thread
+	constexpr std::chrono::milliseconds kStopCheckInterval{ 10 };
+
+	const char* status_string(const serial_port::modbus::Status status)
+	{
+		switch (status)
+		{
+		case serial_port::modbus::Status::kOk:
+			return "ok";
+		case serial_port::modbus::Status::kTimeout:
+			return "timeout";
+		case serial_port::modbus::Status::kCrcError:
+			return "CRC error";
+		case serial_port::modbus::Status::kException:
+			return "exception response";
+		case serial_port::modbus::Status::kInvalidResponse:
+			return "invalid response";
+		case serial_port::modbus::Status::kPortError:
+			return "port error";
+		}
+		return "unknown";
+	}
+}
+
+serial_port::modbus::Master::Master(SerialPort& port, const std::chrono::milliseconds response_timeout)
+	: port_(port), response_timeout_(response_timeout),
+	inter_frame_delay_(default_inter_frame_delay(port.GetSettings().baud_rate))
+{
+	response_.reserve(read_response_length(kMaxReadRegisters));
+}
+
+std::vector<std::uint16_t> serial_port::modbus::Master::ReadHoldingRegisters(const std::uint8_t slave,
+	const std::uint16_t address, const std::uint16_t count)
+{
+	return ReadRegisters(slave, FunctionCode::kReadHoldingRegisters, address, count);
+}
+
+std::vector<std::uint16_t> serial_port::modbus::Master::ReadInputRegisters(const std::uint8_t slave,
+	const std::uint16_t address, const std::uint16_t count)
+{
+	return ReadRegisters(slave, FunctionCode::kReadInputRegisters, address, count);
+}
+
+void serial_port::modbus::Master::WriteSingleRegister(const std::uint8_t slave, const std::uint16_t address,
+	const std::uint16_t value)
+{
+	std::vector<std::uint8_t> request{ slave, static_cast<std::uint8_t>(FunctionCode::kWriteSingleRegister) };
+	append_u16(request, address);
+	append_u16(request, value);
+	append_crc(request);
+
+	// The response is an echo of the request
+	Execute(request, 8);
+}
+
+void serial_port::modbus::Master::WriteMultipleRegisters(const std::uint8_t slave, const std::uint16_t address,
+	const std::vector<std::uint16_t>& values)
+{
+	if (values.empty() || values.size() > kMaxWriteRegisters)
+	{
+		throw std::invalid_argument("Cannot write " + std::to_string(values.size()) + " registers with one request!");
+	}
+
+	std::vector<std::uint8_t> request{ slave, static_cast<std::uint8_t>(FunctionCode::kWriteMultipleRegisters) };
+	request.reserve(9 + 2 * values.size());
+	append_u16(request, address);
+	append_u16(request, static_cast<std::uint16_t>(values.size()));
+	request.push_back(static_cast<std::uint8_t>(2 * values.size()));
+	for (const auto value : values)
+	{
+		append_u16(request, value);
+	}
+	append_crc(request);
+
+	Execute(request, 8);
+}
+
+serial_port::modbus::Status serial_port::modbus::Master::Transact(const std::vector<std::uint8_t>& request,
+	std::vector<std::uint8_t>& response, const std::size_t expected_length)
+{
+	const std::uint8_t slave = request.at(0);
+
+	// Respect the silent interval after the previous frame, but do not wait any longer than that
+	std::this_thread::sleep_until(last_frame_end_ + inter_frame_delay_);
+
+	response.resize(std::max<std::size_t>(expected_length, 5));
+	std::size_t needed = expected_length;
+	std::size_t received = 0;
+	auto status = Status::kOk;
+	auto start = std::chrono::steady_clock::now();
+	try
+	{
+		// Get rid of stale bytes, e.g. a late response to a request that timed out
+		if (port_.NumBytesAvailable() > 0)
+		{
+			port_.FlushBuffer();
+		}
+
+		start = std::chrono::steady_clock::now();
+		const auto deadline = start + response_timeout_;
+		for (std::size_t written = 0; written < request.size();)
+		{
+			const auto num_bytes_written = port_.WriteData(reinterpret_cast<const char*>(request.data() + written),
+				static_cast<unsigned long>(request.size() - written));
+			if (num_bytes_written == 0 || num_bytes_written > request.size() - written)
+			{
+				throw IoException("[Master::Transact()] Error writing to the port.");
+			}
+			written += num_bytes_written;
+		}
+
+		while (received < needed)
+		{
+			const auto now = std::chrono::steady_clock::now();
+			if (now >= deadline
+				|| !port_.WaitForData(std::chrono::ceil<std::chrono::milliseconds>(deadline - now)))
+			{
+				status = Status::kTimeout;
+				break;
+			}
+
+			const auto num_bytes_read = port_.ReadData(reinterpret_cast<char*>(response.data() + received),
+				static_cast<unsigned long>(needed - received));
+			// Nothing after WaitForData() means that the device hung up
+			if (num_bytes_read == 0 || num_bytes_read > needed - received)
+			{
+				throw IoException("[Master::Transact()] Error reading from the port.");
+			}
+			received += num_bytes_read;
+
+			// An exception response is shorter than the regular response
+			if (received >= 2 && (response[1] & 0x80) != 0)
+			{
+				needed = 5;
+			}
+		}
+	}
+	catch (const IoException&)
+	{
+		status = Status::kPortError;
+	}
+	last_frame_end_ = std::chrono::steady_clock::now();
+
+	if (status == Status::kOk)
+	{
+		if (!crc_matches(response, needed))
+		{
+			status = Status::kCrcError;
+		}
+		else if (response[0] != slave || (response[1] & 0x7F) != request[1])
+		{
+			status = Status::kInvalidResponse;
+		}
+		else if ((response[1] & 0x80) != 0)
+		{
+			status = Status::kException;
+		}
+	}
+	response.resize(std::min(received, needed));
+
+	const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(last_frame_end_ - start);
+	std::lock_guard<std::mutex> lock(stats_mutex_);
+	auto& stats = stats_[slave];
+	++stats.requests;
+	switch (status)
+	{
+	case Status::kTimeout:
+		++stats.timeouts;
+		return status;
+	case Status::kPortError:
+		++stats.port_errors;
+		return status;
+	case Status::kCrcError:
+	case Status::kInvalidResponse:
+		++stats.errors;
+		return status;
+	case Status::kException:
+		++stats.exceptions;
+		break;
+	case Status::kOk:
+		break;
+	}
+	++stats.responses;
+	stats.total_latency += latency;
+	stats.min_latency = std::min(stats.min_latency, latency);
+	stats.max_latency = std::max(stats.max_latency, latency);
+
+	return status;
+}
+
+std::vector<std::uint8_t> serial_port::modbus::Master::MakeReadRequest(const std::uint8_t slave, const FunctionCode function,
+	const std::uint16_t address, const std::uint16_t count)
+{
+	check_read_arguments(function, count);
+
+	std::vector<std::uint8_t> request{ slave, static_cast<std::uint8_t>(function) };
+	request.reserve(8);
+	append_u16(request, address);
+	append_u16(request, count);
+	append_crc(request);
+	return request;
+}
+
+std::map<std::uint8_t, serial_port::modbus::SlaveStats> serial_port::modbus::Master::GetSlaveStats() const
+{
+	std::lock_guard<std::mutex> lock(stats_mutex_);
+	return stats_;
+}
+
+std::vector<std::uint16_t> serial_port::modbus::Master::ReadRegisters(const std::uint8_t slave, const FunctionCode function,
+	const std::uint16_t address, const std::uint16_t count)
+{
+	Execute(MakeReadRequest(slave, function, address, count), read_response_length(count));
+	if (response_[2] != 2 * count)
+	{
+		throw IoException("[Master::ReadRegisters()] Unexpected byte count in response.");
+	}
+
+	std::vector<std::uint16_t> values(count);
+	for (std::uint16_t i = 0; i < count; ++i)
+	{
+		values[i] = read_u16(&response_[3 + 2 * i]);
+	}
+	return values;
+}
+
+void serial_port::modbus::Master::Execute(const std::vector<std::uint8_t>& request, const std::size_t expected_length)
+{
+	const auto status = Transact(request, response_, expected_length);
+	if (status == Status::kException)
+	{
+		throw IoException("[Master::Execute()] Slave " + std::to_string(request[0])
+			+ " returned exception code " + std::to_string(response_[2]) + ".");
+	}
+	if (status != Status::kOk)
+	{
+		throw IoException("[Master::Execute()] Request to slave " + std::to_string(request[0])
+			+ " failed: " + status_string(status) + ".");
+	}
+}
+
+serial_port::modbus::PollScheduler::PollScheduler(const std::chrono::milliseconds response_timeout)
+	: response_timeout_(response_timeout)
+{
+}
+
+serial_port::modbus::PollScheduler::~PollScheduler()
+{
+	Stop();
+}
+
+std::size_t serial_port::modbus::PollScheduler::AddBus(SerialPort& port)
+{
+	if (running_)
+	{
+		throw std::logic_error("Cannot add a bus while polling.");
+	}
+
+	auto bus = std::make_unique<Bus>();
+	bus->master = std::make_unique<Master>(port, response_timeout_);
+	bus->response.reserve(read_response_length(kMaxReadRegisters));
+	bus->values.reserve(kMaxReadRegisters);
+	buses_.push_back(std::move(bus));
+	return buses_.size() - 1;
+}
+
+serial_port::modbus::Master& serial_port::modbus::PollScheduler::GetMaster(const std::size_t bus)
+{
+	return *buses_.at(bus)->master;
+}
+
+void serial_port::modbus::PollScheduler::AddRead(const std::size_t bus, const std::uint8_t slave, const FunctionCode function,
+	const std::uint16_t address, const std::uint16_t count, PollCallback callback)
+{
+	check_read_arguments(function, count);
+	if (running_)
+	{
+		throw std::logic_error("Cannot add a read while polling.");
+	}
+
+	auto& b = *buses_.at(bus);
+	b.items.push_back({ slave, function, address, count, std::move(callback) });
+	b.planned = false;
+}
+
+void serial_port::modbus::PollScheduler::SetMaxGap(const std::uint16_t num_registers)
+{
+	if (running_)
+	{
+		throw std::logic_error("Cannot change the maximum gap while polling.");
+	}
+
+	max_gap_ = num_registers;
+	for (auto& bus : buses_)
+	{
+		bus->planned = false;
+	}
+}
+
+std::size_t serial_port::modbus::PollScheduler::NumRequests(const std::size_t bus)
+{
+	auto& b = *buses_.at(bus);
+	if (!b.planned)
+	{
+		Plan(b);
+	}
+	return b.requests.size();
+}
+
+void serial_port::modbus::PollScheduler::PollOnce(const IoThreadConfig& io_thread)
+{
+	if (running_)
+	{
+		throw std::logic_error("Cannot poll manually while polling in the background.");
+	}
+
+	for (auto& bus : buses_)
+	{
+		if (!bus->planned)
+		{
+			Plan(*bus);
+		}
+	}
+
+	// The calling thread serves the first bus, one additional thread serves each other bus
+	std::vector<std::thread> threads;
+	threads.reserve(buses_.size());
+	try
+	{
+		for (std::size_t i = 1; i < buses_.size(); ++i)
+		{
+			threads.push_back(StartIoThread(io_thread, [this, i] { RunCycle(*buses_[i]); }));
+		}
+	}
+	catch (...)
+	{
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		throw;
+	}
+	if (!buses_.empty())
+	{
+		RunCycle(*buses_.front());
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+void serial_port::modbus::PollScheduler::Start(const std::chrono::milliseconds cycle_period, const IoThreadConfig& io_thread)
+{
+	if (running_)
+	{
+		return;
+	}
+
+	for (auto& bus : buses_)
+	{
+		if (!bus->planned)
+		{
+			Plan(*bus);
+		}
+	}
+
+	running_ = true;
+	try
+	{
+		for (auto& bus : buses_)
+		{
+			threads_.push_back(StartIoThread(io_thread, [this, &b = *bus, cycle_period]
+			{
+				while (running_)
+				{
+					const auto cycle_start = std::chrono::steady_clock::now();
+					auto next_cycle = cycle_start + cycle_period;
+					if (!RunCycle(b))
+					{
+						// Do not hammer a failed port, e.g. an unplugged adapter
+						next_cycle = std::max(next_cycle, cycle_start + kPortErrorBackoff);
+					}
+					while (running_ && std::chrono::steady_clock::now() < next_cycle)
+					{
+						std::this_thread::sleep_until(std::min(next_cycle, std::chrono::steady_clock::now() + kStopCheckInterval));
+					}
+				}
+			}));
+		}
+	}
+	catch (...)
+	{
+		Stop();
+		throw;
+	}
+}
+
+void serial_port::modbus::PollScheduler::Stop()
+{
+	running_ = false;
+	for (auto& thread : threads_)
+	{
+		thread.join();
+	}
+	threads_.clear();
+}
+
+std::map<std::pair<std::size_t, std::uint8_t>, serial_port::modbus::SlaveStats>
+serial_port::modbus::PollScheduler::GetSlaveStats() const
+{
+	std::map<std::pair<std::size_t, std::uint8_t>, SlaveStats> stats;
+	for (std::size_t i = 0; i < buses_.size(); ++i)
+	{
+		for (const auto& [slave, slave_stats] : buses_[i]->master->GetSlaveStats())
+		{
+			stats[{ i, slave }] = slave_stats;
+		}
+	}
+	return stats;
+}
+
+void serial_port::modbus::PollScheduler::Plan(Bus& bus) const
+{
+	// Sort the blocks by slave, function and address so that neighbors can be merged in a single pass
+	std::vector<std::size_t> order(bus.items.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&items = bus.items](const std::size_t lhs, const std::size_t rhs)
+	{
+		const auto& a = items[lhs];
+		const auto& b = items[rhs];
+		return std::tie(a.slave, a.function, a.address) < std::tie(b.slave, b.function, b.address);
+	});
+
+	bus.requests.clear();
+	for (const auto index : order)
+	{
+		const auto& item = bus.items[index];
+		const auto item_end = static_cast<std::size_t>(item.address) + item.count;
+
+		if (!bus.requests.empty())
+		{
+			auto& request = bus.requests.back();
+			const auto request_end = static_cast<std::size_t>(request.address) + request.count;
+			const auto merged_end = std::max(request_end, item_end);
+			if (request.slave == item.slave && request.function == item.function
+				&& item.address <= request_end + max_gap_
+				&& merged_end - request.address <= kMaxReadRegisters)
+			{
+				request.count = static_cast<std::uint16_t>(merged_end - request.address);
+				request.items.push_back(index);
+				continue;
+			}
+		}
+		bus.requests.push_back({ item.slave, item.function, item.address, item.count, {}, { index } });
+	}
+
+	for (auto& request : bus.requests)
+	{
+		request.frame = Master::MakeReadRequest(request.slave, request.function, request.address, request.count);
+	}
+	bus.planned = true;
+}
+
+bool serial_port::modbus::PollScheduler::RunCycle(Bus& bus) const
+{
+	bool port_failed = false;
+	for (const auto& request : bus.requests)
+	{
+		// Once the port has failed, the remaining requests would fail as well
+		auto status = port_failed ? Status::kPortError
+			: bus.master->Transact(request.frame, bus.response, read_response_length(request.count));
+		port_failed = status == Status::kPortError;
+		if (status == Status::kOk && bus.response[2] != 2 * request.count)
+		{
+			status = Status::kInvalidResponse;
+		}
+
+		if (status == Status::kOk)
+		{
+			bus.values.resize(request.count);
+			for (std::uint16_t i = 0; i < request.count; ++i)
+			{
+				bus.values[i] = read_u16(&bus.response[3 + 2 * i]);
+			}
+		}
+
+		for (const auto index : request.items)
+		{
+			const auto& item = bus.items[index];
+			PollResult result;
+			result.slave = item.slave;
+			result.function = item.function;
+			result.address = item.address;
+			result.count = item.count;
+			result.status = status;
+			if (status == Status::kException)
+			{
+				result.exception_code = bus.response[2];
+			}
+			if (status == Status::kOk)
+			{
+				result.values = bus.values.data() + (item.address - request.address);
+			}
+			if (item.callback)
+			{
+				item.callback(result);
+			}
+		}
+	}
+	return !port_failed;
+}
@@ -0,0 +1,168 @@
+#if defined(__linux__)
+
+#include <pthread.h>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <string>
+
+#include "serial_port/modem_monitor.h"
+
+namespace
+{
+	void wake_up(int)
+	{
+	}
+
+	// The monitor's thread sleeps in an ioctl() that can only be interrupted by a signal. The handler
+	// is installed without SA_RESTART, so the ioctl() returns with EINTR. A handler that the
+	// application installed for the signal is never replaced.
+	void install_wake_up_handler()
+	{
+		static std::mutex mutex;
+		const std::lock_guard<std::mutex> lock(mutex);
+
+		struct sigaction old {};
+		if (sigaction(SIGRTMIN, nullptr, &old) != 0)
+		{
+			throw serial_port::IoException("[ModemLineMonitor::ModemLineMonitor()] Error from sigaction(): " + std::string(strerror(errno)));
+		}
+		if ((old.sa_flags & SA_SIGINFO) == 0 && old.sa_handler == wake_up)
+		{
+			return;
+		}
+		if ((old.sa_flags & SA_SIGINFO) != 0 || (old.sa_handler != SIG_DFL && old.sa_handler != SIG_IGN))
+		{
+			throw serial_port::IoException("[ModemLineMonitor::ModemLineMonitor()] The application handles SIGRTMIN, which is needed to stop the monitor.");
+		}
+
+		struct sigaction action {};
+		action.sa_handler = wake_up;
+		sigemptyset(&action.sa_mask);
+		action.sa_flags = 0;
+		if (sigaction(SIGRTMIN, &action, nullptr) != 0)
+		{
+			throw serial_port::IoException("[ModemLineMonitor::ModemLineMonitor()] Error from sigaction(): " + std::string(strerror(errno)));
+		}
+	}
+
+	// Watched lines whose transition counters differ between two snapshots
+	serial_port::ModemLine counted_changes(const serial_port::LineCounters& now, const serial_port::LineCounters& before)
+	{
+		const auto delta = now - before;
+		auto changed = serial_port::ModemLine::kNone;
+		if (delta.cts != 0)
+		{
+			changed = changed | serial_port::ModemLine::kCts;
+		}
+		if (delta.dsr != 0)
+		{
+			changed = changed | serial_port::ModemLine::kDsr;
+		}
+		if (delta.dcd != 0)
+		{
+			changed = changed | serial_port::ModemLine::kDcd;
+		}
+		if (delta.ring != 0)
+		{
+			changed = changed | serial_port::ModemLine::kRing;
+		}
+		return changed;
+	}
+}
+
+serial_port::ModemLineMonitor::ModemLineMonitor(SerialPort& port, ModemLineHandler handler, const ModemLine lines,
+	const IoThreadConfig& io_thread)
+	: port_(port), handler_(std::move(handler)), lines_(lines & ModemLine::kAllStatus)
+{
+	if (lines_ == ModemLine::kNone)
+	{
+		throw std::invalid_argument("[ModemLineMonitor::ModemLineMonitor()] Only status lines (CTS, DSR, DCD, RI) can be monitored.");
+	}
+
+	state_ = port_.GetModemLines();
+	try
+	{
+		counters_ = port_.GetLineCounters();
+		has_counters_ = true;
+	}
+	catch (const IoException&)
+	{
+		// Without counters, changes are detected by comparing the lines only
+	}
+
+	install_wake_up_handler();
+	thread_ = StartIoThread(io_thread, [this] { Run(); });
+}
+
+serial_port::ModemLineMonitor::~ModemLineMonitor()
+{
+	Join();
+}
+
+void serial_port::ModemLineMonitor::Stop()
+{
+	Join();
+	if (error_)
+	{
+		std::rethrow_exception(std::exchange(error_, nullptr));
+	}
+}
+
+void serial_port::ModemLineMonitor::Run()
+{
+	try
+	{
+		while (running_)
+		{
+			const auto state = port_.WaitForModemLineChange(lines_);
+			if (!running_)
+			{
+				break;
+			}
+
+			auto changed = static_cast<ModemLine>(static_cast<unsigned>(state) ^ static_cast<unsigned>(state_)) & lines_;
+			if (has_counters_)
+			{
+				const auto counters = port_.GetLineCounters();
+				changed = changed | (counted_changes(counters, counters_) & lines_);
+				counters_ = counters;
+			}
+			state_ = state;
+			// Nothing changed if the wait was interrupted by an unrelated signal
+			if (changed != ModemLine::kNone)
+			{
+				handler_(state, changed);
+			}
+		}
+	}
+	catch (...)
+	{
+		error_ = std::current_exception();
+	}
+
+	const std::lock_guard<std::mutex> lock(mutex_);
+	finished_ = true;
+	finished_condition_.notify_all();
+}
+
+void serial_port::ModemLineMonitor::Join()
+{
+	if (!thread_.joinable())
+	{
+		return;
+	}
+
+	running_ = false;
+	std::unique_lock<std::mutex> lock(mutex_);
+	// The signal may arrive just before the thread enters the wait, so repeat it until the thread has finished
+	while (!finished_)
+	{
+		pthread_kill(thread_.native_handle(), SIGRTMIN);
+		finished_condition_.wait_for(lock, std::chrono::milliseconds(10));
+	}
+	lock.unlock();
+	thread_.join();
+}
+
+#endif // __linux__
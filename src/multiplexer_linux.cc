@@ -0,0 +1,440 @@
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "serial_port/multiplexer.h"
+
+namespace
+{
+	// Number of chunks read from the port in a row before other events get a turn
+	constexpr int kMaxChunksPerWakeUp = 16;
+}
+
+serial_port::Multiplexer::Multiplexer(SerialPort& port, std::string socket_path, MultiplexerOptions options)
+	: port_(port), socket_path_(std::move(socket_path)), options_(std::move(options)),
+	port_fd_(port.GetNativeHandle()), rx_chunk_(4096)
+{
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (socket_path_.empty() || socket_path_.size() >= sizeof(address.sun_path))
+	{
+		throw std::invalid_argument("[Multiplexer::Multiplexer()] Invalid socket path: " + socket_path_);
+	}
+	std::memcpy(address.sun_path, socket_path_.c_str(), socket_path_.size() + 1);
+
+	unlink(socket_path_.c_str());
+	listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listen_fd_ < 0 || bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+		|| listen(listen_fd_, SOMAXCONN) != 0)
+	{
+		const auto error = errno;
+		if (listen_fd_ >= 0)
+		{
+			close(listen_fd_);
+		}
+		throw IoException("[Multiplexer::Multiplexer()] Could not listen on " + socket_path_ + ": " + std::string(strerror(error)));
+	}
+
+	saved_flags_ = fcntl(port_fd_, F_GETFL);
+	if (saved_flags_ < 0 || fcntl(port_fd_, F_SETFL, saved_flags_ | O_NONBLOCK) != 0)
+	{
+		const auto error = errno;
+		close(listen_fd_);
+		unlink(socket_path_.c_str());
+		throw IoException("[Multiplexer::Multiplexer()] Could not switch port to non-blocking mode: " + std::string(strerror(error)));
+	}
+
+	loop_.Post([this]
+	{
+		Accept();
+		ReadPort();
+	});
+	try
+	{
+		thread_ = StartIoThread(options_.io_thread, [this] { loop_.Run(); });
+	}
+	catch (...)
+	{
+		fcntl(port_fd_, F_SETFL, saved_flags_);
+		close(listen_fd_);
+		unlink(socket_path_.c_str());
+		throw;
+	}
+}
+
+serial_port::Multiplexer::~Multiplexer()
+{
+	loop_.Post([this]
+	{
+		loop_.Cancel(accept_op_, false);
+		loop_.Cancel(port_read_op_, false);
+		loop_.Cancel(port_write_op_, false);
+		while (!clients_.empty())
+		{
+			CloseClient(clients_.begin()->first);
+		}
+		loop_.Stop();
+	});
+	thread_.join();
+
+	fcntl(port_fd_, F_SETFL, saved_flags_);
+	close(listen_fd_);
+	unlink(socket_path_.c_str());
+}
+
+std::size_t serial_port::Multiplexer::NumClients() const
+{
+	std::lock_guard<std::mutex> lock(stats_mutex_);
+	return stats_.num_clients;
+}
+
+serial_port::MultiplexerStats serial_port::Multiplexer::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(stats_mutex_);
+	return stats_;
+}
+
+void serial_port::Multiplexer::Accept()
+{
+	while (true)
+	{
+		const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			break;
+		}
+
+		if (clients_.size() >= options_.max_clients)
+		{
+			close(fd);
+			std::lock_guard<std::mutex> lock(stats_mutex_);
+			++stats_.clients_rejected;
+			continue;
+		}
+
+		const auto id = next_client_id_++;
+		auto client = std::make_unique<Client>();
+		client->fd = fd;
+		clients_.emplace(id, std::move(client));
+		{
+			std::lock_guard<std::mutex> lock(stats_mutex_);
+			++stats_.clients_accepted;
+			stats_.num_clients = clients_.size();
+		}
+		ReadClient(id);
+	}
+
+	accept_op_ = loop_.WaitReadable(listen_fd_, EventLoop::Deadline::max(), [this](const std::error_code error)
+	{
+		accept_op_ = 0;
+		if (!error)
+		{
+			Accept();
+		}
+	});
+}
+
+void serial_port::Multiplexer::ReadPort()
+{
+	for (int i = 0; i < kMaxChunksPerWakeUp; ++i)
+	{
+		// The handle is non-blocking, so this returns right away
+		const auto num_bytes = port_.ReadData(rx_chunk_.data(), static_cast<unsigned long>(rx_chunk_.size()));
+		if (num_bytes > 0 && num_bytes <= rx_chunk_.size())
+		{
+			Broadcast(rx_chunk_.data(), num_bytes);
+			continue;
+		}
+		if (num_bytes == 0 || (errno != EAGAIN && errno != EINTR))
+		{
+			// The port is gone. Clients stay connected but do not receive anything any more.
+			return;
+		}
+		if (errno == EINTR)
+		{
+			continue;
+		}
+		break;
+	}
+
+	port_read_op_ = loop_.WaitReadable(port_fd_, EventLoop::Deadline::max(), [this](const std::error_code error)
+	{
+		port_read_op_ = 0;
+		if (!error)
+		{
+			ReadPort();
+		}
+	});
+}
+
+void serial_port::Multiplexer::WritePort()
+{
+	if (port_write_op_ != 0)
+	{
+		return;
+	}
+
+	while (tx_written_ < tx_frame_.size() || NextFrame())
+	{
+		const auto num_bytes = tx_frame_.size() - tx_written_;
+		const auto result = port_.WriteData(tx_frame_.data() + tx_written_, static_cast<unsigned long>(num_bytes));
+		if (result <= num_bytes)
+		{
+			tx_written_ += result;
+			std::lock_guard<std::mutex> lock(stats_mutex_);
+			stats_.tx_bytes += result;
+			stats_.tx_frames += tx_written_ == tx_frame_.size() ? 1 : 0;
+			continue;
+		}
+		if (errno == EINTR)
+		{
+			continue;
+		}
+		if (errno != EAGAIN)
+		{
+			// The port is gone. Drop the frame, so that queued frames do not pile up.
+			tx_written_ = tx_frame_.size();
+			continue;
+		}
+
+		port_write_op_ = loop_.WaitWritable(port_fd_, EventLoop::Deadline::max(), [this](const std::error_code error)
+		{
+			port_write_op_ = 0;
+			if (!error)
+			{
+				WritePort();
+			}
+		});
+		return;
+	}
+}
+
+bool serial_port::Multiplexer::NextFrame()
+{
+	// Take one frame from each client in turn
+	while (!tx_ready_.empty())
+	{
+		const auto id = tx_ready_.front();
+		tx_ready_.pop_front();
+		const auto it = clients_.find(id);
+		if (it == clients_.end() || it->second->tx_frames.empty())
+		{
+			continue;
+		}
+
+		auto& client = *it->second;
+		tx_frame_ = std::move(client.tx_frames.front());
+		tx_written_ = 0;
+		client.tx_frames.pop_front();
+		client.tx_queued -= tx_frame_.size();
+		if (!client.tx_frames.empty())
+		{
+			tx_ready_.push_back(id);
+		}
+		// Resume reading a client that was paused because its queue was full
+		if (client.read_op == 0 && client.tx_queued < options_.max_client_buffer)
+		{
+			WaitForClient(id, client);
+		}
+		return true;
+	}
+
+	tx_frame_.clear();
+	tx_written_ = 0;
+	return false;
+}
+
+void serial_port::Multiplexer::Broadcast(const char* data, const std::size_t num_bytes)
+{
+	{
+		std::lock_guard<std::mutex> lock(stats_mutex_);
+		stats_.rx_bytes += num_bytes;
+	}
+
+	std::vector<ClientId> ids;
+	ids.reserve(clients_.size());
+	for (const auto& client : clients_)
+	{
+		ids.push_back(client.first);
+	}
+
+	for (const auto id : ids)
+	{
+		auto& client = *clients_.at(id);
+		const auto num_queued = client.rx_queue.size() - client.rx_sent;
+		if (num_queued + num_bytes > options_.max_client_buffer)
+		{
+			if (options_.slow_client_policy == SlowClientPolicy::kDisconnect)
+			{
+				CloseClient(id);
+				std::lock_guard<std::mutex> lock(stats_mutex_);
+				++stats_.slow_clients_disconnected;
+				continue;
+			}
+
+			// Drop the oldest bytes that have not been sent yet (and the oldest new bytes if they alone are too many)
+			const auto num_dropped = num_queued + num_bytes - options_.max_client_buffer;
+			const auto num_dropped_queued = std::min(num_dropped, num_queued);
+			client.rx_queue.erase(client.rx_sent, num_dropped_queued);
+			const auto num_dropped_new = num_dropped - num_dropped_queued;
+			client.rx_queue.append(data + num_dropped_new, num_bytes - num_dropped_new);
+			std::lock_guard<std::mutex> lock(stats_mutex_);
+			stats_.rx_bytes_dropped += num_dropped;
+		}
+		else
+		{
+			client.rx_queue.append(data, num_bytes);
+		}
+		FlushClient(id);
+	}
+}
+
+void serial_port::Multiplexer::ReadClient(const ClientId id)
+{
+	auto& client = *clients_.at(id);
+	char buffer[4096];
+	while (client.tx_queued < options_.max_client_buffer)
+	{
+		const auto num_bytes = recv(client.fd, buffer, sizeof(buffer), 0);
+		if (num_bytes > 0)
+		{
+			client.tx_partial.append(buffer, static_cast<std::size_t>(num_bytes));
+			std::size_t frame_length;
+			while (!client.tx_partial.empty()
+				&& (frame_length = options_.tx_framer ? options_.tx_framer(client.tx_partial) : client.tx_partial.size()) != 0)
+			{
+				QueueFrame(id, client, client.tx_partial.substr(0, frame_length));
+				client.tx_partial.erase(0, frame_length);
+			}
+			// Do not wait forever for the end of an overlong frame
+			if (client.tx_partial.size() >= options_.max_client_buffer)
+			{
+				QueueFrame(id, client, std::move(client.tx_partial));
+				client.tx_partial.clear();
+			}
+			continue;
+		}
+		if (num_bytes < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (num_bytes == 0 || errno != EAGAIN)
+		{
+			CloseClient(id);
+			WritePort();
+			return;
+		}
+
+		WaitForClient(id, client);
+		break;
+	}
+
+	WritePort();
+}
+
+void serial_port::Multiplexer::FlushClient(const ClientId id)
+{
+	auto& client = *clients_.at(id);
+	while (client.rx_sent < client.rx_queue.size())
+	{
+		const auto num_bytes = send(client.fd, client.rx_queue.data() + client.rx_sent, client.rx_queue.size() - client.rx_sent,
+			MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (num_bytes >= 0)
+		{
+			client.rx_sent += static_cast<std::size_t>(num_bytes);
+			continue;
+		}
+		if (errno == EINTR)
+		{
+			continue;
+		}
+		if (errno != EAGAIN)
+		{
+			CloseClient(id);
+			return;
+		}
+
+		if (client.write_op == 0)
+		{
+			client.write_op = loop_.WaitWritable(client.fd, EventLoop::Deadline::max(), [this, id](const std::error_code error)
+			{
+				const auto it = clients_.find(id);
+				if (it == clients_.end())
+				{
+					return;
+				}
+				it->second->write_op = 0;
+				if (!error)
+				{
+					FlushClient(id);
+				}
+			});
+		}
+		// Keep the queue from growing at the front
+		if (client.rx_sent > client.rx_queue.size() / 2)
+		{
+			client.rx_queue.erase(0, client.rx_sent);
+			client.rx_sent = 0;
+		}
+		return;
+	}
+
+	client.rx_queue.clear();
+	client.rx_sent = 0;
+}
+
+void serial_port::Multiplexer::QueueFrame(const ClientId id, Client& client, std::string frame)
+{
+	if (client.tx_frames.empty())
+	{
+		tx_ready_.push_back(id);
+	}
+	client.tx_queued += frame.size();
+	client.tx_frames.push_back(std::move(frame));
+}
+
+void serial_port::Multiplexer::WaitForClient(const ClientId id, Client& client)
+{
+	client.read_op = loop_.WaitReadable(client.fd, EventLoop::Deadline::max(), [this, id](const std::error_code error)
+	{
+		const auto it = clients_.find(id);
+		if (it == clients_.end())
+		{
+			return;
+		}
+		it->second->read_op = 0;
+		if (!error)
+		{
+			ReadClient(id);
+		}
+	});
+}
+
+void serial_port::Multiplexer::CloseClient(const ClientId id)
+{
+	const auto it = clients_.find(id);
+	if (it == clients_.end())
+	{
+		return;
+	}
+
+	loop_.Cancel(it->second->read_op, false);
+	loop_.Cancel(it->second->write_op, false);
+	close(it->second->fd);
+	clients_.erase(it);
+
+	std::lock_guard<std::mutex> lock(stats_mutex_);
+	stats_.num_clients = clients_.size();
+}
+
+#endif // __linux__
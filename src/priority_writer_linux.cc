@@ -0,0 +1,171 @@
+#if defined(__linux__)
+
+#include <sys/ioctl.h>
+#include <algorithm>
+
+#include "serial_port/priority_writer.h"
+
+serial_port::PriorityWriter::PriorityWriter(SerialPort& port, const PriorityWriterOptions& options)
+	: port_(port), options_(options)
+{
+	if (options_.max_queued_bytes == 0)
+	{
+		throw std::invalid_argument("[PriorityWriter::PriorityWriter()] The output queue must hold at least one byte.");
+	}
+	const auto& settings = port_.GetSettings();
+	character_time_ = CharacterTime(settings.baud_rate, settings.parity, settings.num_stop_bits);
+	thread_ = StartIoThread(options_.io_thread, [this] { Run(); });
+}
+
+serial_port::PriorityWriter::~PriorityWriter()
+{
+	{
+		const std::lock_guard<std::mutex> lock(mutex_);
+		running_ = false;
+	}
+	queued_.notify_all();
+	thread_.join();
+}
+
+bool serial_port::PriorityWriter::Send(std::string frame, const TxPriority priority)
+{
+	if (frame.empty())
+	{
+		return true;
+	}
+	{
+		const std::lock_guard<std::mutex> lock(mutex_);
+		auto& lane = lanes_[static_cast<std::size_t>(priority)];
+		if (lane.num_pending_bytes + frame.size() > options_.max_pending_bytes)
+		{
+			++lane.stats.num_rejected;
+			return false;
+		}
+		lane.num_pending_bytes += frame.size();
+		lane.frames.push_back({ std::move(frame), std::chrono::steady_clock::now() });
+	}
+	queued_.notify_one();
+	return true;
+}
+
+bool serial_port::PriorityWriter::WaitUntilSent(const std::chrono::milliseconds timeout)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	return sent_.wait_for(lock, timeout, [this]
+	{
+		return !writing_ && std::all_of(lanes_.begin(), lanes_.end(), [](const Lane& lane) { return lane.frames.empty(); });
+	});
+}
+
+std::size_t serial_port::PriorityWriter::NumPendingBytes(const TxPriority priority) const
+{
+	const std::lock_guard<std::mutex> lock(mutex_);
+	return lanes_[static_cast<std::size_t>(priority)].num_pending_bytes;
+}
+
+serial_port::PriorityWriterStats serial_port::PriorityWriter::GetStats(const TxPriority priority) const
+{
+	const std::lock_guard<std::mutex> lock(mutex_);
+	return lanes_[static_cast<std::size_t>(priority)].stats;
+}
+
+void serial_port::PriorityWriter::Run()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true)
+	{
+		const auto lane = std::find_if(lanes_.begin(), lanes_.end(), [](const Lane& lane) { return !lane.frames.empty(); });
+		if (!running_)
+		{
+			break;
+		}
+		if (lane == lanes_.end())
+		{
+			writing_ = false;
+			sent_.notify_all();
+			queued_.wait(lock);
+			continue;
+		}
+
+		auto frame = std::move(lane->frames.front());
+		lane->frames.pop_front();
+		lane->num_pending_bytes -= frame.data.size();
+		writing_ = true;
+
+		lock.unlock();
+		const auto written = Write(frame.data);
+		const auto latency = std::chrono::steady_clock::now() - frame.queued;
+		lock.lock();
+
+		auto& stats = lane->stats;
+		if (written)
+		{
+			++stats.num_frames;
+			stats.num_bytes += frame.data.size();
+			stats.latency.Add(latency);
+		}
+		else
+		{
+			++stats.num_write_errors;
+		}
+	}
+	writing_ = false;
+	sent_.notify_all();
+}
+
+bool serial_port::PriorityWriter::Write(const std::string& data)
+{
+	std::size_t offset = 0;
+	while (offset < data.size())
+	{
+		if (!running_)
+		{
+			return false;
+		}
+
+		auto now = std::chrono::steady_clock::now();
+		const auto num_queued = NumQueued(now);
+		if (num_queued >= options_.max_queued_bytes)
+		{
+			// Sleep until the queue is expected to have room again
+			std::this_thread::sleep_for(character_time_ * static_cast<long>(num_queued - options_.max_queued_bytes + 1));
+			continue;
+		}
+
+		const auto num_bytes = std::min(options_.max_queued_bytes - num_queued, data.size() - offset);
+		const auto result = port_.TryWriteData(data.data() + offset, num_bytes);
+		if (!result)
+		{
+			if (result.Error() == Errc::kInterrupted || result.Error() == Errc::kWouldBlock)
+			{
+				continue;
+			}
+			return false;
+		}
+		offset += *result;
+
+		now = std::chrono::steady_clock::now();
+		drained_at_ = std::max(drained_at_, now) + character_time_ * static_cast<long>(*result);
+	}
+	return true;
+}
+
+std::size_t serial_port::PriorityWriter::NumQueued(const TimePoint now) const
+{
+	int num_queued = 0;
+	if (ioctl(port_.GetNativeHandle(), TIOCOUTQ, &num_queued) != 0)
+	{
+		num_queued = 0;
+	}
+	auto result = static_cast<std::size_t>(std::max(num_queued, 0));
+
+	if (options_.estimate_queue && drained_at_ > now)
+	{
+		// Rounded up, as the character on the line still occupies the queue
+		const auto busy = std::chrono::duration_cast<std::chrono::nanoseconds>(drained_at_ - now);
+		result = std::max(result, static_cast<std::size_t>((busy + character_time_ - std::chrono::nanoseconds(1)) / character_time_));
+	}
+	return result;
+}
+
+#endif // __linux__
@@ -0,0 +1,56 @@
+#include "serial_port/result.h"
+
+namespace
+{
+	class ErrorCategoryImpl : public std::error_category
+	{
+	public:
+		[[nodiscard]] const char* name() const noexcept override
+		{
+			return "serial_port";
+		}
+
+		[[nodiscard]] std::string message(const int error) const override
+		{
+			switch (static_cast<serial_port::Errc>(error))
+			{
+				case serial_port::Errc::kTimeout:
+					return "timeout";
+				case serial_port::Errc::kWouldBlock:
+					return "operation would block";
+				case serial_port::Errc::kInterrupted:
+					return "interrupted";
+				case serial_port::Errc::kDisconnected:
+					return "device disconnected";
+				case serial_port::Errc::kNotOpen:
+					return "port not open";
+			}
+			return "unknown error";
+		}
+
+		// Allow comparing with the portable conditions, e.g. error == std::errc::timed_out
+		[[nodiscard]] std::error_condition default_error_condition(const int error) const noexcept override
+		{
+			switch (static_cast<serial_port::Errc>(error))
+			{
+				case serial_port::Errc::kTimeout:
+					return std::errc::timed_out;
+				case serial_port::Errc::kWouldBlock:
+					return std::errc::operation_would_block;
+				case serial_port::Errc::kInterrupted:
+					return std::errc::interrupted;
+				case serial_port::Errc::kDisconnected:
+					return std::errc::no_such_device;
+				case serial_port::Errc::kNotOpen:
+					return std::errc::bad_file_descriptor;
+			}
+			return { error, *this };
+		}
+	};
+}
+
+const std::error_category& serial_port::ErrorCategory() noexcept
+{
+	static const ErrorCategoryImpl category;
+	return category;
+}
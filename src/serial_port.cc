@@ -1,6 +1,10 @@
 #include "serial_port/serial_port.h"
 #include "enumeration.h"
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 #if defined(_WIN32)
 #include "serial_port_windows.h"
 #elif defined(__linux__)
@@ -43,13 +47,71 @@ std::vector<serial_port::PortInfo> serial_port::SerialPort::EnumeratePorts()
 	return enumeration::enumerate();
 }
 
+std::vector<serial_port::OpenResult> serial_port::SerialPort::OpenAll(std::vector<SerialPort>& ports, const std::size_t max_workers,
+	const IoThreadConfig& io_thread)
+{
+	std::vector<OpenResult> results(ports.size());
+	std::atomic<std::size_t> next{ 0 };
+
+	const auto worker = [&ports, &results, &next]
+	{
+		for (auto i = next++; i < ports.size(); i = next++)
+		{
+			auto& result = results[i];
+			result.port_name = ports[i].GetSettings().port_name;
+			const auto start = std::chrono::steady_clock::now();
+			try
+			{
+				ports[i].Open();
+				result.success = true;
+			}
+			catch (const std::exception& e)
+			{
+				result.error = e.what();
+			}
+			result.latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+		}
+	};
+
+	const auto num_workers = std::min(std::max<std::size_t>(max_workers, 1), ports.size());
+	std::vector<std::thread> workers;
+	workers.reserve(num_workers);
+	try
+	{
+		for (std::size_t i = 1; i < num_workers; ++i)
+		{
+			workers.push_back(StartIoThread(io_thread, worker));
+		}
+		worker();
+	}
+	catch (...)
+	{
+		// Keep the workers that did start from taking further ports
+		next = ports.size();
+		for (auto& thread : workers)
+		{
+			thread.join();
+		}
+		throw;
+	}
+	for (auto& thread : workers)
+	{
+		thread.join();
+	}
+
+	return results;
+}
+
 void serial_port::SerialPort::Open() const
 {
+	// Bytes read ahead before belong to the previous session
+	sp_->ClearBufferedData();
 	sp_->Open();
 }
 
 void serial_port::SerialPort::Close() const
 {
+	sp_->ClearBufferedData();
 	sp_->Close();
 }
 
@@ -58,24 +120,65 @@ bool serial_port::SerialPort::IsOpen() const
 	return sp_->IsOpen();
 }
 
+serial_port::NativeHandle serial_port::SerialPort::GetNativeHandle() const
+{
+	return sp_->GetNativeHandle();
+}
+
 const serial_port::Settings& serial_port::SerialPort::GetSettings() const
 {
 	return sp_->GetSettings();
 }
 
+void serial_port::SerialPort::ApplySettings(const Settings& settings, const bool drain) const
+{
+	sp_->ApplySettings(settings, drain);
+}
+
 unsigned long serial_port::SerialPort::NumBytesAvailable() const
 {
-	return sp_->NumBytesAvailable();
+	return sp_->NumBytesBuffered() + sp_->NumBytesAvailable();
 }
 
 void serial_port::SerialPort::FlushBuffer() const
 {
+	sp_->ClearBufferedData();
 	return sp_->FlushBuffer();
 }
 
+bool serial_port::SerialPort::WaitForData(const std::chrono::milliseconds timeout) const
+{
+	return sp_->NumBytesBuffered() > 0 || sp_->WaitForData(timeout);
+}
+
+serial_port::LineCounters serial_port::SerialPort::GetLineCounters() const
+{
+	return sp_->GetLineCounters();
+}
+
+serial_port::ModemLine serial_port::SerialPort::GetModemLines() const
+{
+	return sp_->GetModemLines();
+}
+
+serial_port::ModemLine serial_port::SerialPort::WaitForModemLineChange(const ModemLine lines) const
+{
+	return sp_->WaitForModemLineChange(lines);
+}
+
+void serial_port::SerialPort::SetBusyPoll(const std::chrono::nanoseconds spin_budget) const
+{
+	sp_->SetBusyPoll(spin_budget);
+}
+
+serial_port::BusyPollStats serial_port::SerialPort::GetBusyPollStats() const
+{
+	return sp_->GetBusyPollStats();
+}
+
 unsigned long serial_port::SerialPort::ReadData(char* data, unsigned long num_bytes) const
 {
-	return sp_->ReadData(data, num_bytes);
+	return sp_->ReadBufferedData(data, num_bytes);
 }
 
 std::string serial_port::SerialPort::ReadString() const
@@ -83,6 +186,36 @@ std::string serial_port::SerialPort::ReadString() const
 	return sp_->ReadString();
 }
 
+std::size_t serial_port::SerialPort::ReadString(std::string& str) const
+{
+	return sp_->ReadString(str);
+}
+
+std::size_t serial_port::SerialPort::ReadString(std::pmr::string& str) const
+{
+	return sp_->ReadString(str);
+}
+
+std::size_t serial_port::SerialPort::ReadLines(std::vector<std::string>& lines, const std::size_t max_lines) const
+{
+	return sp_->ReadLines(lines, max_lines);
+}
+
+std::size_t serial_port::SerialPort::ReadLines(std::pmr::vector<std::pmr::string>& lines, const std::size_t max_lines) const
+{
+	return sp_->ReadLines(lines, max_lines);
+}
+
+const std::pmr::vector<std::string_view>& serial_port::SerialPort::ReadLineViews(const std::size_t max_lines) const
+{
+	return sp_->ReadLineViews(max_lines);
+}
+
+void serial_port::SerialPort::SetMemoryResource(std::pmr::memory_resource* resource) const
+{
+	sp_->SetMemoryResource(resource);
+}
+
 unsigned long serial_port::SerialPort::WriteData(const char* data, unsigned long num_bytes) const
 {
 	return sp_->WriteData(data, num_bytes);
@@ -92,3 +225,79 @@ unsigned long serial_port::SerialPort::WriteString(const std::string& str) const
 {
 	return sp_->WriteString(str);
 }
+
+std::error_code serial_port::SerialPort::TryOpen() const noexcept
+{
+	sp_->ClearBufferedData();
+	return sp_->TryOpen();
+}
+
+serial_port::Result<std::size_t> serial_port::SerialPort::TryNumBytesAvailable() const noexcept
+{
+	const auto result = sp_->TryNumBytesAvailable();
+	if (!result)
+	{
+		return result;
+	}
+	return *result + sp_->NumBytesBuffered();
+}
+
+std::error_code serial_port::SerialPort::TryFlushBuffer() const noexcept
+{
+	sp_->ClearBufferedData();
+	return sp_->TryFlushBuffer();
+}
+
+serial_port::Result<serial_port::LineCounters> serial_port::SerialPort::TryGetLineCounters() const noexcept
+{
+	return sp_->TryGetLineCounters();
+}
+
+serial_port::Result<serial_port::ModemLine> serial_port::SerialPort::TryGetModemLines() const noexcept
+{
+	return sp_->TryGetModemLines();
+}
+
+serial_port::Result<std::size_t> serial_port::SerialPort::TryReadData(char* data, const std::size_t num_bytes,
+	const std::chrono::milliseconds timeout) const noexcept
+{
+	// Bytes that were already read into the line buffer come first
+	if (num_bytes > 0 && sp_->NumBytesBuffered() > 0)
+	{
+		return static_cast<std::size_t>(sp_->ReadBufferedData(data, static_cast<unsigned long>(num_bytes)));
+	}
+	return sp_->TryReadData(data, num_bytes, timeout);
+}
+
+serial_port::Result<std::size_t> serial_port::SerialPort::TryWriteData(const char* data, const std::size_t num_bytes) const noexcept
+{
+	return sp_->TryWriteData(data, num_bytes);
+}
+
+void serial_port::SerialPort::WriteAll(const char* data, const std::size_t num_bytes) const
+{
+	std::size_t num_written = 0;
+	while (num_written < num_bytes)
+	{
+		const auto result = sp_->WriteData(data + num_written, static_cast<unsigned long>(num_bytes - num_written));
+		if (result == 0 || result > num_bytes - num_written)
+		{
+			throw IoException("[SerialPort::Write()] Error writing to the port.");
+		}
+		num_written += result;
+	}
+}
+
+void serial_port::SerialPort::ReadAll(char* data, const std::size_t num_bytes) const
+{
+	std::size_t num_read = 0;
+	while (num_read < num_bytes)
+	{
+		const auto result = sp_->ReadBufferedData(data + num_read, static_cast<unsigned long>(num_bytes - num_read));
+		if (result == 0 || result > num_bytes - num_read)
+		{
+			throw IoException("[SerialPort::Read()] Error reading from the port.");
+		}
+		num_read += result;
+	}
+}
@@ -2,15 +2,82 @@
 
 #include <fcntl.h>
 #include <cerrno>
+#include <algorithm>
 #include <cstring>
+#include <limits>
 #include <termios.h>
 #include <unistd.h>
+#include <poll.h>
 #include <sys/ioctl.h>
+#include <linux/serial.h>
 
 #include "serial_port_linux.h"
 
 namespace
 {
+    // Map the errno of a failed call to the error codes of the non-throwing API
+    std::error_code error_from_errno(const int error)
+    {
+        switch (error)
+        {
+            case EAGAIN:
+                return serial_port::Errc::kWouldBlock;
+            case EINTR:
+                return serial_port::Errc::kInterrupted;
+            // A hung up terminal fails with EIO, an unplugged USB adapter with ENODEV or ENXIO
+            case EIO:
+            case ENODEV:
+            case ENXIO:
+                return serial_port::Errc::kDisconnected;
+            case EBADF:
+                return serial_port::Errc::kNotOpen;
+            default:
+                return { error, std::system_category() };
+        }
+    }
+
+    // Timeout for poll(): negative waits forever, longer timeouts than poll() takes are clamped
+    int poll_timeout(const std::chrono::milliseconds timeout)
+    {
+        if (timeout.count() < 0)
+        {
+            return -1;
+        }
+        return static_cast<int>(std::min<std::chrono::milliseconds::rep>(timeout.count(), std::numeric_limits<int>::max()));
+    }
+
+    // Conversion between ModemLine masks and the TIOCM_* bits of the driver
+    constexpr std::pair<serial_port::ModemLine, int> kModemBits[] = {
+        { serial_port::ModemLine::kDtr, TIOCM_DTR }, { serial_port::ModemLine::kRts, TIOCM_RTS },
+        { serial_port::ModemLine::kCts, TIOCM_CTS }, { serial_port::ModemLine::kDsr, TIOCM_DSR },
+        { serial_port::ModemLine::kDcd, TIOCM_CD }, { serial_port::ModemLine::kRing, TIOCM_RNG } };
+
+    int to_modem_bits(const serial_port::ModemLine lines)
+    {
+        int bits = 0;
+        for (const auto& [line, bit] : kModemBits)
+        {
+            if (IsSet(lines, line))
+            {
+                bits |= bit;
+            }
+        }
+        return bits;
+    }
+
+    serial_port::ModemLine from_modem_bits(const int bits)
+    {
+        auto lines = serial_port::ModemLine::kNone;
+        for (const auto& [line, bit] : kModemBits)
+        {
+            if ((bits & bit) != 0)
+            {
+                lines = lines | line;
+            }
+        }
+        return lines;
+    }
+
     unsigned get_baud_rate(unsigned long baud) {
         unsigned baud_rate;
         switch (baud) {
@@ -108,86 +175,121 @@ namespace
                 baud_rate = B4000000;
                 break;
             default:
-                throw std::invalid_argument("Requested baud rate of " + std::to_string(baud_rate) + " not supported!");
+                throw std::invalid_argument("Requested baud rate of " + std::to_string(baud) + " not supported!");
         }
         return baud_rate;
     }
-}
 
-void serial_port::SerialPortLinux::Open()
-{
-    if(this->IsOpen())
+    // Apply the settings to a terminal configuration (without touching the port)
+    void configure_tty(termios& tty, const serial_port::Settings& settings)
     {
-        this->Close();
-    }
+        using serial_port::Parity;
+        using serial_port::NumStopBits;
+
+        // Parity
+        switch (settings.parity)
+        {
+            case Parity::kNone:
+                tty.c_cflag &= ~PARENB;
+                break;
+            case Parity::kOdd:
+                tty.c_cflag |= PARENB;
+                tty.c_cflag |= PARODD;
+                break;
+            case Parity::kEven:
+                tty.c_cflag |= PARENB;
+                tty.c_cflag &= ~PARODD;
+                break;
+        }
+        // Baud rate
+        const auto baud_rate = get_baud_rate(settings.baud_rate);
+        cfsetispeed(&tty, baud_rate);
+        cfsetospeed(&tty, baud_rate);
 
-	handle_ = open(settings_.port_name.c_str(), O_RDWR);
+        // Character size
+        tty.c_cflag &= ~CSIZE;
+        tty.c_cflag |= CS8;
 
-	if (handle_ < 0)
-	{
-		throw IoException("[SerialPortLinux::Open()] Could not open serial port.");
-	}
+        // Hardware flow control
+        if (settings.hardware_flow_control)
+        {
+            tty.c_cflag |= CRTSCTS;
+        }
+        else
+        {
+            tty.c_cflag &= ~CRTSCTS;
+        }
 
-    if (tcgetattr(handle_, &tty_) != 0)
-    {
-        throw IoException("[SerialPortLinux::Open()] Error from tcgetattr(): " + std::string(strerror(errno)));
+        // Use raw input
+        tty.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG | IEXTEN);
+
+        // Pass bytes through unmodified: no CR/NL translation, no software flow control, no output processing
+        tty.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF | IXANY);
+        tty.c_oflag &= ~OPOST;
+        tty.c_cflag |= CREAD | CLOCAL;
+
+        // Block in read() until at least one byte is available
+        tty.c_cc[VMIN] = 1;
+        tty.c_cc[VTIME] = 0;
+
+        // Stop bits
+        switch(settings.num_stop_bits)
+        {
+            case NumStopBits::kOne:
+                tty.c_cflag &= ~CSTOPB;
+                break;
+            case NumStopBits::kTwo:
+                tty.c_cflag |= CSTOPB;
+        }
+
+        // Timeout
+        // TODO: https://blog.mbedded.ninja/programming/operating-systems/linux/linux-serial-ports-using-c-cpp/
     }
+}
 
-    // Parity
-    switch (settings_.parity)
+void serial_port::SerialPortLinux::Open()
+{
+    if (const auto error = TryOpen())
     {
-        case Parity::kNone:
-            tty_.c_cflag &= ~PARENB;
-            break;
-        case Parity::kOdd:
-            tty_.c_cflag |= PARENB;
-            tty_.c_cflag |= PARODD;
-            break;
-        case Parity::kEven:
-            tty_.c_cflag |= PARENB;
-            tty_.c_cflag &= ~PARODD;
-            break;
+        if (error == std::errc::invalid_argument)
+        {
+            // Unsupported settings, e.g. the baud rate
+            throw std::invalid_argument("[SerialPortLinux::Open()] Invalid settings for " + settings_.port_name + ": " + error.message());
+        }
+        throw IoException("[SerialPortLinux::Open()] Could not open serial port: " + error.message());
     }
-    // Baud rate
-    cfsetispeed(&tty_, get_baud_rate(settings_.baud_rate));
-
-    // Character size
-    tty_.c_cflag &= ~CSIZE;
-    tty_.c_cflag |= CS8;
+}
 
-    // Hardware flow control
-    if (settings_.hardware_flow_control)
+void serial_port::SerialPortLinux::ApplySettings(const Settings& settings, const bool drain)
+{
+    if (!IsOpen())
     {
-        tty_.c_cflag |= CRTSCTS;
+        settings_ = settings;
+        return;
     }
-    else
+    if (settings.port_name != settings_.port_name)
     {
-        tty_.c_cflag &= ~CRTSCTS;
+        throw std::invalid_argument("[SerialPortLinux::ApplySettings()] Cannot change the name of an open port.");
     }
 
-    // Use raw input
-    tty_.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
-
-    // Stop bits
-    switch(settings_.num_stop_bits)
+    // Configure a copy so that nothing changes if the settings are invalid
+    auto tty = tty_;
+    configure_tty(tty, settings);
+    if (tcsetattr(handle_, drain ? TCSADRAIN : TCSANOW, &tty) != 0)
     {
-        case NumStopBits::kOne:
-            tty_.c_cflag &= ~CSTOPB;
-            break;
-        case NumStopBits::kTwo:
-            tty_.c_cflag |= CSTOPB;
+        throw IoException("[SerialPortLinux::ApplySettings()] Error from tcsetattr(): " + std::string(strerror(errno)));
     }
 
-    // Timeout
-    // TODO: https://blog.mbedded.ninja/programming/operating-systems/linux/linux-serial-ports-using-c-cpp/
-
-    // Set the settings
-    tcsetattr(handle_, TCSANOW, &tty_);
+    tty_ = tty;
+    settings_ = settings;
 }
 
 void serial_port::SerialPortLinux::Close()
 {
-	close(handle_);
+	if (handle_ >= 0)
+	{
+		close(handle_);
+	}
 	handle_ = -1;
 }
 
@@ -209,8 +311,143 @@ void serial_port::SerialPortLinux::FlushBuffer() const
     tcflush(handle_, TCIOFLUSH);
 }
 
+bool serial_port::SerialPortLinux::WaitForData(const std::chrono::milliseconds timeout)
+{
+    if (spin_budget_.load().count() > 0)
+    {
+        return BusyPollWait(timeout);
+    }
+
+    pollfd pfd{ handle_, POLLIN, 0 };
+    int result;
+    do
+    {
+        result = poll(&pfd, 1, poll_timeout(timeout));
+    } while (result < 0 && errno == EINTR);
+
+    // A hang-up or an error counts as well, so that the next read reports it rather than it looking like a timeout
+    return result > 0 && (pfd.revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+}
+
+serial_port::LineCounters serial_port::SerialPortLinux::GetLineCounters()
+{
+    const auto counters = TryGetLineCounters();
+    if (!counters)
+    {
+        throw IoException("[SerialPortLinux::GetLineCounters()] Error from ioctl(TIOCGICOUNT): " + counters.Error().message());
+    }
+    return *counters;
+}
+
+serial_port::ModemLine serial_port::SerialPortLinux::GetModemLines()
+{
+    const auto lines = TryGetModemLines();
+    if (!lines)
+    {
+        throw IoException("[SerialPortLinux::GetModemLines()] Error from ioctl(TIOCMGET): " + lines.Error().message());
+    }
+    return *lines;
+}
+
+serial_port::ModemLine serial_port::SerialPortLinux::WaitForModemLineChange(const ModemLine lines)
+{
+    if (!IsSet(lines, ModemLine::kAllStatus))
+    {
+        throw std::invalid_argument("[SerialPortLinux::WaitForModemLineChange()] Only changes of status lines (CTS, DSR, DCD, RI) can be waited for.");
+    }
+
+    // The driver puts the thread to sleep until an interrupt reports a change, so waiting costs no CPU
+    if (ioctl(handle_, TIOCMIWAIT, to_modem_bits(lines & ModemLine::kAllStatus)) != 0 && errno != EINTR)
+    {
+        throw IoException("[SerialPortLinux::WaitForModemLineChange()] Error from ioctl(TIOCMIWAIT): " + std::string(strerror(errno)));
+    }
+    return GetModemLines();
+}
+
+void serial_port::SerialPortLinux::SetBusyPoll(const std::chrono::nanoseconds spin_budget)
+{
+    spin_budget_ = std::max(spin_budget, std::chrono::nanoseconds(0));
+}
+
+serial_port::BusyPollStats serial_port::SerialPortLinux::GetBusyPollStats() const
+{
+    const std::lock_guard<std::mutex> lock(busy_poll_mutex_);
+    return busy_poll_stats_;
+}
+
+bool serial_port::SerialPortLinux::BusyPollWait(const std::chrono::milliseconds timeout)
+{
+    int available = 0;
+    if (ioctl(handle_, FIONREAD, &available) != 0 || available > 0)
+    {
+        // Data is already there (or the error shows up in the following read)
+        return true;
+    }
+
+    const auto spin_budget = spin_budget_.load();
+    const auto start = std::chrono::steady_clock::now();
+    const auto spin_end = start + (timeout.count() >= 0 ? std::min<std::chrono::nanoseconds>(spin_budget, timeout) : spin_budget);
+    auto now = start;
+    bool ready = false;
+    while (now < spin_end)
+    {
+        if (ioctl(handle_, FIONREAD, &available) == 0 && available > 0)
+        {
+            ready = true;
+            break;
+        }
+        now = std::chrono::steady_clock::now();
+    }
+    const auto spin_time = std::chrono::steady_clock::now() - start;
+
+    bool slept = false;
+    if (!ready)
+    {
+        slept = true;
+        const auto remaining = timeout.count() >= 0
+            ? std::max<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(timeout - spin_time).count(), 0)
+            : -1;
+        pollfd pfd{ handle_, POLLIN, 0 };
+        int result;
+        do
+        {
+            result = poll(&pfd, 1, poll_timeout(std::chrono::milliseconds(remaining)));
+        } while (result < 0 && errno == EINTR);
+        ready = result > 0;
+    }
+
+    const auto latency = std::chrono::steady_clock::now() - start;
+    const std::lock_guard<std::mutex> lock(busy_poll_mutex_);
+    auto& stats = busy_poll_stats_;
+    ++stats.num_waits;
+    stats.spin_time += spin_time;
+    if (slept)
+    {
+        ++stats.num_sleeps;
+    }
+    else
+    {
+        ++stats.num_spin_hits;
+    }
+    if (ready)
+    {
+        stats.latency.Add(latency);
+    }
+    else
+    {
+        ++stats.num_timeouts;
+    }
+    return ready;
+}
+
 unsigned long serial_port::SerialPortLinux::ReadData(char* data, unsigned long num_bytes)
 {
+    // Only a blocking descriptor waits here. Callers that switched it to O_NONBLOCK (e.g. AsyncPort or
+    // Multiplexer) expect EAGAIN instead of waiting.
+    if (spin_budget_.load().count() > 0 && (fcntl(handle_, F_GETFL) & O_NONBLOCK) == 0)
+    {
+        BusyPollWait(std::chrono::milliseconds(-1));
+    }
 	return read(handle_, data, num_bytes);
 }
 
@@ -219,5 +456,171 @@ unsigned long serial_port::SerialPortLinux::WriteData(const char* data, unsigned
 	return write(handle_, data, num_bytes);
 }
 
+std::error_code serial_port::SerialPortLinux::TryOpen() noexcept
+{
+    Close();
+
+    // Do not wait for the carrier (O_NONBLOCK) and do not become the controlling terminal (O_NOCTTY)
+    handle_ = open(settings_.port_name.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (handle_ < 0)
+    {
+        return error_from_errno(errno);
+    }
+
+    if (tcgetattr(handle_, &tty_) != 0)
+    {
+        const auto error = errno;
+        Close();
+        return error_from_errno(error);
+    }
+
+    try
+    {
+        configure_tty(tty_, settings_);
+    }
+    catch (const std::invalid_argument&)
+    {
+        Close();
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+
+    // Reads and writes block as usual
+    if (tcsetattr(handle_, TCSANOW, &tty_) != 0 || fcntl(handle_, F_SETFL, fcntl(handle_, F_GETFL) & ~O_NONBLOCK) != 0)
+    {
+        const auto error = errno;
+        Close();
+        return error_from_errno(error);
+    }
+    return {};
+}
+
+serial_port::Result<std::size_t> serial_port::SerialPortLinux::TryNumBytesAvailable() noexcept
+{
+    int num_bytes_available = 0;
+    if (ioctl(handle_, FIONREAD, &num_bytes_available) != 0)
+    {
+        return error_from_errno(errno);
+    }
+    return static_cast<std::size_t>(num_bytes_available);
+}
+
+std::error_code serial_port::SerialPortLinux::TryFlushBuffer() noexcept
+{
+    if (tcflush(handle_, TCIOFLUSH) != 0)
+    {
+        return error_from_errno(errno);
+    }
+    return {};
+}
+
+serial_port::Result<serial_port::LineCounters> serial_port::SerialPortLinux::TryGetLineCounters() noexcept
+{
+    serial_icounter_struct counters{};
+    if (ioctl(handle_, TIOCGICOUNT, &counters) != 0)
+    {
+        return error_from_errno(errno);
+    }
+
+    const auto count = [](const int value) { return static_cast<unsigned long>(static_cast<unsigned>(value)); };
+    LineCounters result;
+    result.rx = count(counters.rx);
+    result.tx = count(counters.tx);
+    result.overrun = count(counters.overrun);
+    result.frame = count(counters.frame);
+    result.parity = count(counters.parity);
+    result.brk = count(counters.brk);
+    result.buffer_overrun = count(counters.buf_overrun);
+    result.cts = count(counters.cts);
+    result.dsr = count(counters.dsr);
+    result.dcd = count(counters.dcd);
+    result.ring = count(counters.rng);
+    return result;
+}
+
+serial_port::Result<serial_port::ModemLine> serial_port::SerialPortLinux::TryGetModemLines() noexcept
+{
+    int bits = 0;
+    if (ioctl(handle_, TIOCMGET, &bits) != 0)
+    {
+        return error_from_errno(errno);
+    }
+    return from_modem_bits(bits);
+}
+
+serial_port::Result<std::size_t> serial_port::SerialPortLinux::TryReadData(char* data, const std::size_t num_bytes,
+    const std::chrono::milliseconds timeout) noexcept
+{
+    if (handle_ < 0)
+    {
+        return Errc::kNotOpen;
+    }
+    // read() would return 0, which means that the device hung up
+    if (num_bytes == 0)
+    {
+        return std::size_t{ 0 };
+    }
+
+    // The descriptor blocks, so wait here to be able to time out (and to not block at all with a zero timeout)
+    if (spin_budget_.load().count() > 0)
+    {
+        try
+        {
+            if (!BusyPollWait(timeout))
+            {
+                return timeout.count() == 0 ? Errc::kWouldBlock : Errc::kTimeout;
+            }
+        }
+        catch (const std::system_error& e)
+        {
+            // Locking the statistics failed
+            return e.code();
+        }
+    }
+    else if (timeout.count() >= 0)
+    {
+        pollfd pfd{ handle_, POLLIN, 0 };
+        const auto result = poll(&pfd, 1, poll_timeout(timeout));
+        if (result < 0)
+        {
+            return error_from_errno(errno);
+        }
+        if (result == 0)
+        {
+            return timeout.count() == 0 ? Errc::kWouldBlock : Errc::kTimeout;
+        }
+        if ((pfd.revents & POLLNVAL) != 0)
+        {
+            return Errc::kNotOpen;
+        }
+        // A hung up terminal reports POLLHUP and fails the read below
+    }
+
+    const auto num_read = read(handle_, data, num_bytes);
+    if (num_read < 0)
+    {
+        return error_from_errno(errno);
+    }
+    if (num_read == 0)
+    {
+        // With VMIN = 1 a read only returns nothing at the end of the file, i.e. after a hang-up
+        return Errc::kDisconnected;
+    }
+    return static_cast<std::size_t>(num_read);
+}
+
+serial_port::Result<std::size_t> serial_port::SerialPortLinux::TryWriteData(const char* data, const std::size_t num_bytes) noexcept
+{
+    if (handle_ < 0)
+    {
+        return Errc::kNotOpen;
+    }
+    const auto num_written = write(handle_, data, num_bytes);
+    if (num_written < 0)
+    {
+        return error_from_errno(errno);
+    }
+    return static_cast<std::size_t>(num_written);
+}
+
 
 #endif // __linux__
\ No newline at end of file
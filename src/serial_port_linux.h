@@ -5,6 +5,9 @@
 
 #include "termios.h"
 
+#include <atomic>
+#include <mutex>
+
 #include "serial_port/serial_port.h"
 #include "interface.h"
 
@@ -23,16 +26,42 @@ namespace serial_port
 		void Open() override;
 		void Close() override;
 		bool IsOpen() override;
+		void ApplySettings(const Settings& settings, bool drain) override;
+		[[nodiscard]] NativeHandle GetNativeHandle() const override { return handle_; }
 
 		unsigned long NumBytesAvailable() override;
 		void FlushBuffer() const override;
+		bool WaitForData(std::chrono::milliseconds timeout) override;
+
+		LineCounters GetLineCounters() override;
+		ModemLine GetModemLines() override;
+		ModemLine WaitForModemLineChange(ModemLine lines) override;
+
+		void SetBusyPoll(std::chrono::nanoseconds spin_budget) override;
+		[[nodiscard]] BusyPollStats GetBusyPollStats() const override;
 
 		unsigned long ReadData(char* data, unsigned long num_bytes) override;
 		unsigned long WriteData(const char* data, unsigned long num_bytes) override;
 
+		std::error_code TryOpen() noexcept override;
+		Result<std::size_t> TryNumBytesAvailable() noexcept override;
+		std::error_code TryFlushBuffer() noexcept override;
+		Result<LineCounters> TryGetLineCounters() noexcept override;
+		Result<ModemLine> TryGetModemLines() noexcept override;
+		Result<std::size_t> TryReadData(char* data, std::size_t num_bytes, std::chrono::milliseconds timeout) noexcept override;
+		Result<std::size_t> TryWriteData(const char* data, std::size_t num_bytes) noexcept override;
+
 	private:
+		// Wait for data, spinning on FIONREAD for the spin budget before sleeping in poll().
+		// A negative timeout waits forever. Returns false if the timeout expired.
+		bool BusyPollWait(std::chrono::milliseconds timeout);
+
 		int handle_{ -1 };
         struct termios tty_;
+		// Set by SetBusyPoll() while other threads may be reading
+		std::atomic<std::chrono::nanoseconds> spin_budget_{ std::chrono::nanoseconds(0) };
+		mutable std::mutex busy_poll_mutex_;
+		BusyPollStats busy_poll_stats_;
 	};
 }
 
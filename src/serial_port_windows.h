@@ -30,6 +30,7 @@ namespace serial_port
 		void Open() override;
 		void Close() override;
 		bool IsOpen() override;
+		[[nodiscard]] NativeHandle GetNativeHandle() const override { return handle_; }
 
 		unsigned long NumBytesAvailable() override;
 		void FlushBuffer() const override;
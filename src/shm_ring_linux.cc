@@ -0,0 +1,341 @@
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <new>
+
+#include "serial_port/shm_ring.h"
+
+namespace serial_port
+{
+	// The positions count bytes since the ring was created; the offset into the data area is position % capacity.
+	// Everything is accessed by several processes, so only lock-free atomics may be used.
+	struct ShmRingHeader
+	{
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint64_t capacity;
+		// The publisher is about to overwrite everything below reserve_position - capacity (seqlock style)
+		alignas(64) std::atomic<std::uint64_t> reserve_position;
+		// End of the last complete chunk
+		alignas(64) std::atomic<std::uint64_t> write_position;
+		std::atomic<std::uint64_t> num_chunks;
+		// Futex word incremented on every chunk, and the number of subscribers sleeping on it
+		alignas(64) std::atomic<std::uint32_t> notify;
+		std::atomic<std::uint32_t> num_waiters;
+		std::atomic<std::uint32_t> closed;
+	};
+}
+
+namespace
+{
+	static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free,
+		"The shared memory ring requires lock-free atomics.");
+
+	constexpr std::uint32_t kMagic = 0x53524E47;
+	constexpr std::uint32_t kVersion = 1;
+
+	// Precedes every chunk in the data area. Records never wrap around the end of the ring; a padding
+	// record (or, if not even a header fits, the end of the ring itself) makes readers skip to the start.
+	struct RecordHeader
+	{
+		std::uint32_t length;
+		std::uint32_t flags;
+		std::uint64_t sequence;
+		std::int64_t timestamp_ns;
+	};
+	constexpr std::uint32_t kPadding = 1;
+
+	constexpr std::uint64_t align8(const std::uint64_t num_bytes)
+	{
+		return (num_bytes + 7) & ~std::uint64_t{ 7 };
+	}
+
+	// Shared (not private) futex operations, so that they work between processes
+	long futex(std::atomic<std::uint32_t>& word, const int op, const std::uint32_t value, const timespec* timeout)
+	{
+		return syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), op, value, timeout, nullptr, 0);
+	}
+
+	void wake_all(serial_port::ShmRingHeader& header)
+	{
+		header.notify.fetch_add(1);
+		if (header.num_waiters.load() > 0)
+		{
+			futex(header.notify, FUTEX_WAKE, INT_MAX, nullptr);
+		}
+	}
+}
+
+serial_port::ShmRingPublisher::ShmRingPublisher(SerialPort& port, std::string name, const ShmRingOptions& options)
+	: port_(port), name_(std::move(name)), max_chunk_(options.max_chunk)
+{
+	if (name_.size() < 2 || name_.front() != '/' || name_.find('/', 1) != std::string::npos)
+	{
+		throw std::invalid_argument("[ShmRingPublisher::ShmRingPublisher()] Invalid shared memory name: " + name_);
+	}
+	const auto capacity = align8(options.capacity);
+	if (max_chunk_ == 0 || max_chunk_ > UINT32_MAX || capacity < 2 * align8(sizeof(RecordHeader) + max_chunk_))
+	{
+		throw std::invalid_argument("[ShmRingPublisher::ShmRingPublisher()] The capacity must hold at least two chunks of max_chunk bytes.");
+	}
+
+	shm_unlink(name_.c_str());
+	const auto fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0660);
+	if (fd < 0)
+	{
+		throw IoException("[ShmRingPublisher::ShmRingPublisher()] Could not create " + name_ + ": " + std::string(strerror(errno)));
+	}
+	mapping_size_ = sizeof(ShmRingHeader) + capacity;
+	if (ftruncate(fd, static_cast<off_t>(mapping_size_)) == 0)
+	{
+		mapping_ = mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	const auto error = errno;
+	close(fd);
+	if (mapping_ == nullptr || mapping_ == MAP_FAILED)
+	{
+		shm_unlink(name_.c_str());
+		throw IoException("[ShmRingPublisher::ShmRingPublisher()] Could not map " + name_ + ": " + std::string(strerror(error)));
+	}
+
+	header_ = new (mapping_) ShmRingHeader{};
+	header_->version = kVersion;
+	header_->capacity = capacity;
+	data_ = static_cast<char*>(mapping_) + sizeof(ShmRingHeader);
+	// Subscribers check the magic number last, so they never see a half-initialized header
+	std::atomic_thread_fence(std::memory_order_release);
+	header_->magic = kMagic;
+
+	try
+	{
+		thread_ = StartIoThread(options.io_thread, [this] { Run(); });
+	}
+	catch (...)
+	{
+		munmap(mapping_, mapping_size_);
+		shm_unlink(name_.c_str());
+		throw;
+	}
+}
+
+serial_port::ShmRingPublisher::~ShmRingPublisher()
+{
+	running_ = false;
+	thread_.join();
+
+	header_->closed.store(1);
+	wake_all(*header_);
+	munmap(mapping_, mapping_size_);
+	shm_unlink(name_.c_str());
+}
+
+std::uint64_t serial_port::ShmRingPublisher::NumChunks() const
+{
+	return header_->num_chunks.load();
+}
+
+void serial_port::ShmRingPublisher::Run()
+{
+	while (running_)
+	{
+		if (!port_.WaitForData(std::chrono::milliseconds(50)))
+		{
+			continue;
+		}
+
+		// Read straight into the ring, so the data is never copied in user space
+		auto* data = Reserve();
+		const auto num_bytes = port_.ReadData(data, static_cast<unsigned long>(max_chunk_));
+		if (num_bytes == 0 || num_bytes > max_chunk_)
+		{
+			// E.g. the other side of the line hung up
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			continue;
+		}
+		Commit(num_bytes);
+	}
+}
+
+char* serial_port::ShmRingPublisher::Reserve()
+{
+	const auto capacity = header_->capacity;
+	const auto record_size = align8(sizeof(RecordHeader) + max_chunk_);
+	auto offset = position_ % capacity;
+	auto end = position_ + record_size;
+	if (offset + record_size > capacity)
+	{
+		end += capacity - offset;
+	}
+	// Announce what is going to be overwritten before touching it, so that readers can detect it
+	header_->reserve_position.store(std::max(header_->reserve_position.load(std::memory_order_relaxed), end), std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	if (offset + record_size > capacity)
+	{
+		const auto skip = capacity - offset;
+		if (skip >= sizeof(RecordHeader))
+		{
+			const RecordHeader padding{ static_cast<std::uint32_t>(skip - sizeof(RecordHeader)), kPadding, 0, 0 };
+			std::memcpy(data_ + offset, &padding, sizeof(padding));
+		}
+		position_ += skip;
+		offset = 0;
+	}
+	return data_ + offset + sizeof(RecordHeader);
+}
+
+void serial_port::ShmRingPublisher::Commit(const std::size_t num_bytes)
+{
+	const auto sequence = header_->num_chunks.load(std::memory_order_relaxed);
+	const RecordHeader record{ static_cast<std::uint32_t>(num_bytes), 0, sequence,
+		std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() };
+	std::memcpy(data_ + position_ % header_->capacity, &record, sizeof(record));
+	position_ += align8(sizeof(RecordHeader) + num_bytes);
+
+	header_->num_chunks.store(sequence + 1, std::memory_order_relaxed);
+	header_->write_position.store(position_, std::memory_order_release);
+	num_bytes_ += num_bytes;
+	wake_all(*header_);
+}
+
+serial_port::ShmRingSubscriber::ShmRingSubscriber(const std::string& name)
+{
+	const auto fd = shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+	if (fd < 0)
+	{
+		throw IoException("[ShmRingSubscriber::ShmRingSubscriber()] Could not open " + name + ": " + std::string(strerror(errno)));
+	}
+	struct stat status {};
+	if (fstat(fd, &status) == 0 && static_cast<std::size_t>(status.st_size) > sizeof(ShmRingHeader))
+	{
+		mapping_size_ = static_cast<std::size_t>(status.st_size);
+		// Writable only for the futex word and the waiter count
+		mapping_ = mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (mapping_ == nullptr || mapping_ == MAP_FAILED)
+	{
+		throw IoException("[ShmRingSubscriber::ShmRingSubscriber()] Could not map " + name + ".");
+	}
+
+	header_ = static_cast<ShmRingHeader*>(mapping_);
+	const auto magic = header_->magic;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (magic != kMagic || header_->version != kVersion || sizeof(ShmRingHeader) + header_->capacity != mapping_size_)
+	{
+		munmap(mapping_, mapping_size_);
+		throw IoException("[ShmRingSubscriber::ShmRingSubscriber()] " + name + " is not a ring of this version.");
+	}
+	capacity_ = header_->capacity;
+	data_ = static_cast<const char*>(mapping_) + sizeof(ShmRingHeader);
+	position_ = header_->write_position.load(std::memory_order_acquire);
+	next_sequence_ = UINT64_MAX;
+}
+
+serial_port::ShmRingSubscriber::~ShmRingSubscriber()
+{
+	munmap(mapping_, mapping_size_);
+}
+
+serial_port::ShmReadStatus serial_port::ShmRingSubscriber::Next(ShmChunk& chunk, const std::chrono::milliseconds timeout)
+{
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+	while (true)
+	{
+		const auto write_position = header_->write_position.load(std::memory_order_acquire);
+		if (position_ == write_position)
+		{
+			if (header_->closed.load() != 0 && header_->write_position.load(std::memory_order_acquire) == position_)
+			{
+				return ShmReadStatus::kClosed;
+			}
+			const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+			if (timeout.count() == 0 || (timeout.count() > 0 && remaining.count() <= 0))
+			{
+				return ShmReadStatus::kEmpty;
+			}
+			Wait(timeout.count() < 0 ? timeout : remaining);
+			continue;
+		}
+
+		const auto overrun = [this, write_position]
+		{
+			position_ = write_position;
+			++num_overruns_;
+			return ShmReadStatus::kOverrun;
+		};
+		if (write_position - position_ > capacity_)
+		{
+			return overrun();
+		}
+
+		const auto offset = position_ % capacity_;
+		if (capacity_ - offset < sizeof(RecordHeader))
+		{
+			position_ += capacity_ - offset;
+			continue;
+		}
+		RecordHeader record;
+		std::memcpy(&record, data_ + offset, sizeof(record));
+		// The copy of the header is only usable if the publisher did not start overwriting it meanwhile
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (header_->reserve_position.load(std::memory_order_relaxed) > position_ + capacity_)
+		{
+			return overrun();
+		}
+		if ((record.flags & kPadding) != 0)
+		{
+			position_ += capacity_ - offset;
+			continue;
+		}
+
+		chunk.sequence = record.sequence;
+		chunk.timestamp = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(record.timestamp_ns));
+		chunk.data = std::string_view(data_ + offset + sizeof(RecordHeader), record.length);
+		chunk.position = position_;
+		if (next_sequence_ != UINT64_MAX && record.sequence > next_sequence_)
+		{
+			num_lost_chunks_ += record.sequence - next_sequence_;
+		}
+		next_sequence_ = record.sequence + 1;
+		position_ += align8(sizeof(RecordHeader) + record.length);
+		return ShmReadStatus::kOk;
+	}
+}
+
+bool serial_port::ShmRingSubscriber::IsValid(const ShmChunk& chunk) const
+{
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return header_->reserve_position.load(std::memory_order_relaxed) <= chunk.position + capacity_;
+}
+
+std::uint64_t serial_port::ShmRingSubscriber::Lag() const
+{
+	return header_->write_position.load(std::memory_order_acquire) - position_;
+}
+
+void serial_port::ShmRingSubscriber::Wait(const std::chrono::milliseconds timeout) const
+{
+	// Register as a waiter before sampling the futex word, so that the publisher cannot miss the wake-up
+	header_->num_waiters.fetch_add(1);
+	const auto value = header_->notify.load();
+	if (header_->write_position.load() == position_ && header_->closed.load() == 0)
+	{
+		timespec relative{};
+		relative.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+		relative.tv_nsec = static_cast<long>(timeout.count() % 1000) * 1000000;
+		futex(header_->notify, FUTEX_WAIT, value, timeout.count() < 0 ? nullptr : &relative);
+	}
+	header_->num_waiters.fetch_sub(1);
+}
+
+#endif // __linux__
@@ -0,0 +1,282 @@
+#include "serial_port/transaction.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	// Upper bound for a single wait so that the reader notices when it is stopped
+	constexpr std::chrono::milliseconds kMaxWait{ 50 };
+}
+
+serial_port::Framer serial_port::DelimiterFramer(const char delimiter)
+{
+	return [delimiter](const std::string& buffer) -> std::size_t
+	{
+		const auto pos = buffer.find(delimiter);
+		return pos == std::string::npos ? 0 : pos + 1;
+	};
+}
+
+serial_port::Matcher serial_port::PrefixMatcher(const std::string& prefix)
+{
+	return [prefix](const std::string& frame)
+	{
+		return frame.compare(0, prefix.size(), prefix) == 0;
+	};
+}
+
+serial_port::TransactionManager::TransactionManager(SerialPort& port, Framer framer, const std::size_t max_in_flight,
+	const IoThreadConfig& io_thread)
+	: port_(port), framer_(std::move(framer)), max_in_flight_(std::max<std::size_t>(max_in_flight, 1))
+{
+	reader_ = StartIoThread(io_thread, [this] { Run(); });
+}
+
+serial_port::TransactionManager::~TransactionManager()
+{
+	running_ = false;
+	reader_.join();
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (auto& pending : pending_)
+	{
+		pending.promise.set_value(std::nullopt);
+	}
+}
+
+std::optional<std::string> serial_port::TransactionManager::Transact(const std::string& request, Matcher matcher,
+	const std::chrono::milliseconds timeout)
+{
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+	std::uint64_t id = 0;
+	auto future = Submit(request, std::move(matcher), deadline, id);
+
+	// Do not rely on the reader to expire the request, it only checks the deadlines now and then
+	if (future.wait_until(deadline) == std::future_status::timeout)
+	{
+		Cancel(id);
+	}
+	return future.get();
+}
+
+std::future<std::optional<std::string>> serial_port::TransactionManager::Submit(const std::string& request, Matcher matcher,
+	const std::chrono::milliseconds timeout)
+{
+	std::uint64_t id = 0;
+	return Submit(request, std::move(matcher), std::chrono::steady_clock::now() + timeout, id);
+}
+
+std::future<std::optional<std::string>> serial_port::TransactionManager::Submit(const std::string& request, Matcher matcher,
+	const std::chrono::steady_clock::time_point deadline, std::uint64_t& id)
+{
+	std::future<std::optional<std::string>> future;
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (error_)
+		{
+			throw IoException("[TransactionManager::Submit()] The port failed: " + error_.message());
+		}
+		if (!slot_available_.wait_until(lock, deadline, [this] { return pending_.size() < max_in_flight_ || error_; }))
+		{
+			std::promise<std::optional<std::string>> expired;
+			expired.set_value(std::nullopt);
+			return expired.get_future();
+		}
+		if (error_)
+		{
+			throw IoException("[TransactionManager::Submit()] The port failed: " + error_.message());
+		}
+
+		// Register the request before sending it so that a fast response cannot be missed
+		id = next_id_++;
+		pending_.push_back({ id, std::move(matcher), deadline, {} });
+		future = pending_.back().promise.get_future();
+	}
+
+	std::lock_guard<std::mutex> lock(write_mutex_);
+	for (std::size_t written = 0; written < request.size();)
+	{
+		const auto result = port_.TryWriteData(request.data() + written, request.size() - written);
+		if (!result)
+		{
+			if (result.Error() == Errc::kInterrupted)
+			{
+				continue;
+			}
+			// Free the slot at once instead of waiting for the deadline
+			Cancel(id);
+			throw IoException("[TransactionManager::Submit()] Could not send the request: " + result.Error().message());
+		}
+		written += *result;
+	}
+	return future;
+}
+
+void serial_port::TransactionManager::SetUnsolicitedHandler(FrameHandler handler)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	unsolicited_handler_ = std::move(handler);
+}
+
+std::optional<std::string> serial_port::TransactionManager::ReadUnsolicited(const std::chrono::milliseconds timeout)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (!unsolicited_available_.wait_for(lock, timeout, [this] { return !unsolicited_.empty(); }))
+	{
+		return std::nullopt;
+	}
+
+	auto frame = std::move(unsolicited_.front());
+	unsolicited_.pop_front();
+	return frame;
+}
+
+void serial_port::TransactionManager::SetMaxUnsolicited(const std::size_t num_frames)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	max_unsolicited_ = num_frames;
+	while (unsolicited_.size() > max_unsolicited_)
+	{
+		unsolicited_.pop_front();
+		++num_unsolicited_dropped_;
+	}
+}
+
+std::size_t serial_port::TransactionManager::NumInFlight() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return pending_.size();
+}
+
+std::error_code serial_port::TransactionManager::Error() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return error_;
+}
+
+void serial_port::TransactionManager::Run()
+{
+	std::string buffer;
+	std::vector<char> chunk(4096);
+
+	while (running_)
+	{
+		// Sleep until data arrives or the next deadline expires, without spinning
+		auto wait = kMaxWait;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			const auto now = std::chrono::steady_clock::now();
+			for (const auto& pending : pending_)
+			{
+				wait = std::min(wait, std::chrono::ceil<std::chrono::milliseconds>(pending.deadline - now));
+			}
+		}
+
+		if (wait.count() > 0)
+		{
+			const auto result = port_.TryReadData(chunk.data(), chunk.size(), wait);
+			if (result)
+			{
+				buffer.append(chunk.data(), *result);
+
+				std::size_t frame_length;
+				while (!buffer.empty() && (frame_length = framer_(buffer)) != 0)
+				{
+					Dispatch(buffer.substr(0, frame_length));
+					buffer.erase(0, frame_length);
+				}
+			}
+			else if (result.Error() != Errc::kTimeout && result.Error() != Errc::kInterrupted)
+			{
+				// E.g. the device was disconnected: no response can arrive anymore
+				Fail(result.Error());
+				return;
+			}
+		}
+
+		ExpireDeadlines(std::chrono::steady_clock::now());
+	}
+}
+
+void serial_port::TransactionManager::Dispatch(std::string frame)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	for (auto it = pending_.begin(); it != pending_.end(); ++it)
+	{
+		if (it->matcher(frame))
+		{
+			it->promise.set_value(std::move(frame));
+			pending_.erase(it);
+			slot_available_.notify_one();
+			return;
+		}
+	}
+
+	if (unsolicited_handler_)
+	{
+		// Call the handler without holding the lock so that it may start new transactions
+		auto handler = unsolicited_handler_;
+		lock.unlock();
+		handler(frame);
+		return;
+	}
+
+	if (max_unsolicited_ == 0)
+	{
+		++num_unsolicited_dropped_;
+		return;
+	}
+	if (unsolicited_.size() >= max_unsolicited_)
+	{
+		unsolicited_.pop_front();
+		++num_unsolicited_dropped_;
+	}
+	unsolicited_.push_back(std::move(frame));
+	unsolicited_available_.notify_one();
+}
+
+void serial_port::TransactionManager::Cancel(const std::uint64_t id)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (auto it = pending_.begin(); it != pending_.end(); ++it)
+	{
+		if (it->id == id)
+		{
+			it->promise.set_value(std::nullopt);
+			pending_.erase(it);
+			slot_available_.notify_one();
+			return;
+		}
+	}
+}
+
+void serial_port::TransactionManager::Fail(const std::error_code error)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	error_ = error;
+	for (auto& pending : pending_)
+	{
+		pending.promise.set_value(std::nullopt);
+	}
+	pending_.clear();
+	slot_available_.notify_all();
+}
+
+void serial_port::TransactionManager::ExpireDeadlines(const std::chrono::steady_clock::time_point now)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (auto it = pending_.begin(); it != pending_.end();)
+	{
+		if (it->deadline <= now)
+		{
+			it->promise.set_value(std::nullopt);
+			it = pending_.erase(it);
+			slot_available_.notify_one();
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
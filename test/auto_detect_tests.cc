@@ -0,0 +1,220 @@
+#include <gtest/gtest.h>
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "serial_port/auto_detect.h"
+#include "pty_pair.h"
+
+using namespace serial_port;
+
+namespace
+{
+	// The baud rate the slave side of a pty is configured with
+	int receiver_baud_rate(const int master)
+	{
+		static const std::vector<std::pair<speed_t, int>> kSpeeds{ { B1200, 1200 }, { B2400, 2400 }, { B4800, 4800 },
+			{ B9600, 9600 }, { B19200, 19200 }, { B38400, 38400 }, { B57600, 57600 }, { B115200, 115200 },
+			{ B230400, 230400 }, { B460800, 460800 }, { B921600, 921600 } };
+		termios tty{};
+		tcgetattr(master, &tty);
+		for (const auto& [speed, baud_rate] : kSpeeds)
+		{
+			if (cfgetispeed(&tty) == speed)
+			{
+				return baud_rate;
+			}
+		}
+		return 0;
+	}
+
+	// The bytes a UART at rx_baud (8N1) receives from a device sending at tx_baud (8N1). Characters
+	// without a stop bit (framing errors) are delivered as NUL, like the Linux tty layer does.
+	std::string resample(const std::string& data, const int tx_baud, const int rx_baud)
+	{
+		std::vector<bool> bits(20, true);
+		for (const auto c : data)
+		{
+			bits.push_back(false);
+			for (int i = 0; i < 8; ++i)
+			{
+				bits.push_back(((static_cast<unsigned char>(c) >> i) & 1) != 0);
+			}
+			bits.push_back(true);
+		}
+		bits.insert(bits.end(), 20, true);
+
+		// Bits sent per bit received
+		const auto ratio = static_cast<double>(tx_baud) / rx_baud;
+		std::string received;
+		double position = 0;
+		while (true)
+		{
+			// Hunt for the falling edge of a start bit
+			auto edge = static_cast<std::size_t>(position);
+			while (edge < bits.size() && bits[edge])
+			{
+				++edge;
+			}
+			if (static_cast<double>(edge) + 10 * ratio >= static_cast<double>(bits.size()))
+			{
+				break;
+			}
+			const auto sample = [&](const int bit) { return bits[static_cast<std::size_t>(static_cast<double>(edge) + (bit + 0.5) * ratio)]; };
+			if (sample(0))
+			{
+				position = static_cast<double>(edge) + 1;
+				continue;
+			}
+			unsigned char c = 0;
+			for (int i = 0; i < 8; ++i)
+			{
+				c |= sample(1 + i) ? static_cast<unsigned char>(1U << i) : 0U;
+			}
+			received += sample(9) ? static_cast<char>(c) : '\0';
+			position = static_cast<double>(edge) + 9.5 * ratio;
+		}
+		return received;
+	}
+
+	// A device on the master side of a pty that sends a message at a fixed baud rate. What arrives at
+	// the slave depends on the baud rate the slave is configured with, as it would on a real line.
+	class FakeDevice
+	{
+	public:
+		// If query is set, the device only answers when it receives the query at its baud rate
+		FakeDevice(const PtyPair& pty, const int baud_rate, std::string message, std::string query = {})
+			: master_(pty.Master()), baud_rate_(baud_rate), message_(std::move(message)), query_(std::move(query))
+		{
+			fcntl(master_, F_SETFL, fcntl(master_, F_GETFL) | O_NONBLOCK);
+			thread_ = std::thread([this] { Run(); });
+		}
+		~FakeDevice()
+		{
+			running_ = false;
+			thread_.join();
+		}
+
+	private:
+		void Run() const
+		{
+			std::string received;
+			while (running_)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+				const auto rx_baud = receiver_baud_rate(master_);
+				if (!query_.empty())
+				{
+					char chunk[64];
+					const auto n = read(master_, chunk, sizeof(chunk));
+					if (n <= 0 || rx_baud != baud_rate_)
+					{
+						continue;
+					}
+					received.append(chunk, static_cast<std::size_t>(n));
+					if (received.find(query_) == std::string::npos)
+					{
+						continue;
+					}
+					received.clear();
+				}
+				const auto bytes = resample(message_, baud_rate_, rx_baud);
+				// Dropped if the pty is full, like bytes nobody reads
+				(void)!write(master_, bytes.data(), bytes.size());
+			}
+		}
+
+		int master_;
+		int baud_rate_;
+		std::string message_;
+		std::string query_;
+		std::atomic<bool> running_{ true };
+		std::thread thread_;
+	};
+}
+
+// Test detecting the baud rate of a device that sends text
+TEST(AutoDetectTests, Text)
+{
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 9600);
+	port.Open();
+	FakeDevice device(pty, 57600, "T=23.5 H=41 P=1013\r\n");
+
+	const auto result = DetectSettings(port);
+	std::cout << result << std::endl;
+	ASSERT_TRUE(result.found);
+	EXPECT_EQ(result.settings.baud_rate, 57600);
+	EXPECT_EQ(result.settings.parity, Parity::kNone);
+	EXPECT_EQ(port.GetSettings().baud_rate, 57600);
+	EXPECT_LT(result.elapsed, std::chrono::seconds(1));
+}
+
+// Test detecting a device that sends binary frames with a known preamble
+TEST(AutoDetectTests, Preamble)
+{
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 9600);
+	port.Open();
+	FakeDevice device(pty, 19200, std::string("\xAA\x55\x03\x81\x7F\x10\xC4\x09", 8));
+
+	AutoDetectOptions options;
+	options.text = false;
+	options.preamble = "\xAA\x55";
+	const auto result = DetectSettings(port, options);
+	std::cout << result << std::endl;
+	ASSERT_TRUE(result.found);
+	EXPECT_EQ(result.settings.baud_rate, 19200);
+	EXPECT_LT(result.elapsed, std::chrono::seconds(1));
+}
+
+// Test detecting a device that only answers a query
+TEST(AutoDetectTests, Probe)
+{
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 9600);
+	port.Open();
+	FakeDevice device(pty, 4800, "OK\r\n", "?\r");
+
+	AutoDetectOptions options;
+	options.baud_rates = { 9600, 4800 };
+	options.parities = { Parity::kNone };
+	options.probe = "?\r";
+	options.sample_size = 4;
+	options.listen_time = std::chrono::milliseconds(50);
+	const auto result = DetectSettings(port, options);
+	std::cout << result << std::endl;
+	ASSERT_TRUE(result.found);
+	EXPECT_EQ(result.settings.baud_rate, 4800);
+	EXPECT_EQ(result.num_candidates, 2);
+}
+
+// Test that the original settings are restored if nothing is detected
+TEST(AutoDetectTests, Silence)
+{
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 38400);
+	port.Open();
+
+	AutoDetectOptions options;
+	options.baud_rates = { 9600, 19200 };
+	options.listen_time = std::chrono::milliseconds(10);
+	const auto result = DetectSettings(port, options);
+	std::cout << result << std::endl;
+	EXPECT_FALSE(result.found);
+	// Parity is skipped where the driver does not support it (e.g. on ptys)
+	EXPECT_GE(result.num_candidates, 2);
+	EXPECT_EQ(port.GetSettings().baud_rate, 38400);
+	EXPECT_EQ(receiver_baud_rate(pty.Master()), 38400);
+	// Input checking is only enabled while detecting
+	termios tty{};
+	ASSERT_EQ(tcgetattr(port.GetNativeHandle(), &tty), 0);
+	EXPECT_EQ(tty.c_iflag & INPCK, 0U);
+}
+
+#endif
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+
+#if defined(__linux__)
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "serial_port/batch_writer.h"
+#include "pty_pair.h"
+
+using namespace serial_port;
+
+namespace
+{
+	// Ports on pseudo terminals, declared before the writer so that they outlive it
+	struct PortSet
+	{
+		explicit PortSet(const std::size_t num_ports)
+		{
+			for (std::size_t i = 0; i < num_ports; ++i)
+			{
+				ptys.push_back(std::make_unique<PtyPair>());
+				ports.push_back(std::make_unique<SerialPort>(ptys.back()->SlaveName(), 115200));
+				ports.back()->Open();
+			}
+		}
+
+		[[nodiscard]] std::vector<const SerialPort*> Pointers() const
+		{
+			std::vector<const SerialPort*> pointers;
+			for (const auto& port : ports)
+			{
+				pointers.push_back(port.get());
+			}
+			return pointers;
+		}
+
+		std::vector<std::unique_ptr<PtyPair>> ptys;
+		std::vector<std::unique_ptr<SerialPort>> ports;
+	};
+}
+
+// Test sending the same frame to many ports
+TEST(BatchWriterTests, Broadcast)
+{
+	constexpr std::size_t kNumPorts = 32;
+	PortSet set(kNumPorts);
+	BatchWriter writer(set.Pointers());
+	ASSERT_EQ(writer.NumPorts(), kNumPorts);
+
+	for (int round = 0; round < 3; ++round)
+	{
+		const auto result = writer.Broadcast("SYNC\n");
+		std::cout << result << std::endl;
+		ASSERT_TRUE(result.Success());
+		for (std::size_t i = 0; i < kNumPorts; ++i)
+		{
+			const auto& port = result.ports[i];
+			EXPECT_EQ(port.num_written, 5);
+			EXPECT_GE(port.submitted, result.start);
+			EXPECT_GE(port.completed, port.submitted);
+			EXPECT_EQ(set.ptys[i]->Read(5), "SYNC\n");
+		}
+	}
+}
+
+// Test sending one buffer per port from several workers
+TEST(BatchWriterTests, PerPortBuffers)
+{
+	constexpr std::size_t kNumPorts = 8;
+	PortSet set(kNumPorts);
+	BatchWriterOptions options;
+	options.num_workers = 3;
+	BatchWriter writer(set.Pointers(), options);
+
+	std::vector<std::string> data;
+	std::vector<std::string_view> buffers;
+	for (std::size_t i = 0; i < kNumPorts; ++i)
+	{
+		data.push_back(i == 5 ? "" : "port" + std::to_string(i));
+	}
+	buffers.assign(data.begin(), data.end());
+	const auto result = writer.Write(buffers);
+	std::cout << result << std::endl;
+	ASSERT_TRUE(result.Success());
+	for (std::size_t i = 0; i < kNumPorts; ++i)
+	{
+		if (i == 5)
+		{
+			EXPECT_EQ(result.ports[i].num_written, 0);
+			EXPECT_EQ(set.ptys[i]->Read(1, std::chrono::milliseconds(10)), "");
+		}
+		else
+		{
+			EXPECT_EQ(set.ptys[i]->Read(data[i].size()), data[i]);
+		}
+	}
+
+	EXPECT_THROW(writer.Write({ "too few" }), std::invalid_argument);
+}
+
+// Test that a port whose transmit buffer is full neither blocks nor delays the others
+TEST(BatchWriterTests, FullPort)
+{
+	constexpr std::size_t kNumPorts = 4;
+	PortSet set(kNumPorts);
+
+	// Fill the buffer of the last port (nobody reads the master side)
+	const auto fd = open(set.ptys.back()->SlaveName().c_str(), O_WRONLY | O_NOCTTY | O_NONBLOCK);
+	ASSERT_GE(fd, 0);
+	const std::string chunk(1024, 'x');
+	while (write(fd, chunk.data(), chunk.size()) > 0)
+	{
+	}
+	close(fd);
+
+	BatchWriterOptions options;
+	options.timeout = std::chrono::milliseconds(50);
+	BatchWriter writer(set.Pointers(), options);
+	const auto result = writer.Broadcast("TRIGGER\n");
+	std::cout << result << std::endl;
+	for (std::size_t i = 0; i + 1 < kNumPorts; ++i)
+	{
+		EXPECT_TRUE(result.ports[i].success);
+		EXPECT_LT(result.ports[i].completed - result.start, std::chrono::milliseconds(10));
+	}
+	EXPECT_FALSE(result.ports.back().success);
+	EXPECT_EQ(result.ports.back().error, Errc::kTimeout);
+	EXPECT_FALSE(result.Success());
+}
+
+// Test that only open ports are accepted
+TEST(BatchWriterTests, ClosedPort)
+{
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	EXPECT_THROW(BatchWriter({ &port }), std::invalid_argument);
+}
+
+#endif
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+
+#if defined(__linux__)
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <thread>
+
+#include "serial_port/bridge.h"
+#include "pty_pair.h"
+
+using namespace serial_port;
+
+namespace
+{
+	// A temporary file that is removed again
+	class TempFile
+	{
+	public:
+		TempFile()
+		{
+			char name[] = "/tmp/serial_port_bridge_XXXXXX";
+			fd_ = mkstemp(name);
+			if (fd_ < 0)
+			{
+				throw std::runtime_error("Could not create temporary file.");
+			}
+			unlink(name);
+		}
+		~TempFile() { close(fd_); }
+
+		TempFile(const TempFile&) = delete;
+		TempFile& operator=(const TempFile&) = delete;
+
+		[[nodiscard]] int Fd() const { return fd_; }
+
+		[[nodiscard]] std::string Contents() const
+		{
+			std::string contents(static_cast<std::size_t>(lseek(fd_, 0, SEEK_END)), '\0');
+			const auto num_bytes = pread(fd_, contents.data(), contents.size(), 0);
+			contents.resize(static_cast<std::size_t>(std::max<ssize_t>(num_bytes, 0)));
+			return contents;
+		}
+
+	private:
+		int fd_{ -1 };
+	};
+
+	std::string make_stream(const std::size_t num_bytes)
+	{
+		std::string stream(num_bytes, '\0');
+		for (std::size_t i = 0; i < num_bytes; ++i)
+		{
+			stream[i] = static_cast<char>('A' + i % 61);
+		}
+		return stream;
+	}
+
+	// Bridge a port to a file and a socket, and return the statistics
+	BridgeStats port_to_file_and_socket(const BridgeMode mode, const std::string& stream)
+	{
+		PtyPair pty;
+		SerialPort port(pty.SlaveName(), 115200);
+		port.Open();
+		TempFile file;
+		int sockets[2];
+		EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets), 0);
+
+		std::string socket_data;
+		std::thread socket_reader([&socket_data, &sockets, &stream]
+		{
+			std::vector<char> buffer(65536);
+			while (socket_data.size() < stream.size())
+			{
+				const auto num_bytes = read(sockets[1], buffer.data(), buffer.size());
+				if (num_bytes <= 0)
+				{
+					break;
+				}
+				socket_data.append(buffer.data(), static_cast<std::size_t>(num_bytes));
+			}
+		});
+		std::thread writer([&pty, &stream] { pty.Write(stream); });
+
+		Bridge bridge(port, { file.Fd(), sockets[0] }, mode);
+		EXPECT_EQ(bridge.Transfer(stream.size(), std::chrono::milliseconds(1000)), stream.size());
+		EXPECT_EQ(bridge.IsZeroCopy(), mode != BridgeMode::kCopy);
+		writer.join();
+		socket_reader.join();
+		close(sockets[0]);
+		close(sockets[1]);
+
+		EXPECT_TRUE(file.Contents() == stream);
+		EXPECT_TRUE(socket_data == stream);
+		return bridge.GetStats();
+	}
+}
+
+// Test that a port stream is duplicated into a file and a socket, with and without splice()
+TEST(BridgeTests, PortToFileAndSocket)
+{
+	const auto stream = make_stream(8 << 20);
+	const auto splice_stats = port_to_file_and_socket(BridgeMode::kSplice, stream);
+	const auto copy_stats = port_to_file_and_socket(BridgeMode::kCopy, stream);
+	std::cout << "splice: " << splice_stats << std::endl << "copy:   " << copy_stats << std::endl;
+}
+
+// Test sending a file to a port
+TEST(BridgeTests, FileToPort)
+{
+	const auto stream = make_stream(1 << 20);
+	TempFile file;
+	ASSERT_EQ(pwrite(file.Fd(), stream.data(), stream.size(), 0), static_cast<ssize_t>(stream.size()));
+
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+	std::string received;
+	std::thread reader([&pty, &received, &stream] { received = pty.Read(stream.size()); });
+
+	Bridge bridge(file.Fd(), port);
+	// The transfer ends at the end of the file
+	EXPECT_EQ(bridge.Transfer(2 * stream.size(), std::chrono::milliseconds(1000)), stream.size());
+	EXPECT_TRUE(bridge.IsZeroCopy());
+	reader.join();
+	EXPECT_TRUE(received == stream);
+}
+
+#endif // __linux__
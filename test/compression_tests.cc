@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+
+#if defined(__linux__)
+
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "serial_port/compression.h"
+#include "pty_pair.h"
+
+using namespace serial_port;
+
+namespace
+{
+	std::vector<std::string> make_telemetry(const std::size_t num_messages)
+	{
+		std::mt19937 random(42);
+		std::uniform_real_distribution<double> temperature(20.0, 25.0);
+		std::uniform_int_distribution<int> rssi(-90, -60);
+
+		std::vector<std::string> messages;
+		for (std::size_t i = 0; i < num_messages; ++i)
+		{
+			messages.push_back("{\"device\":\"sensor-07\",\"seq\":" + std::to_string(i)
+				+ ",\"temperature\":" + std::to_string(temperature(random))
+				+ ",\"humidity\":" + std::to_string(40 + i % 7)
+				+ ",\"rssi\":" + std::to_string(rssi(random))
+				+ ",\"status\":\"ok\",\"battery\":\"good\"}\n");
+		}
+		return messages;
+	}
+
+	// Capture the frames a channel writes, so that they can be replayed (and tampered with) later
+	std::vector<std::string> make_frames(const std::vector<std::string>& messages, const CompressionOptions& options)
+	{
+		PtyPair pty;
+		SerialPort port(pty.SlaveName(), 115200);
+		port.Open();
+		CompressedChannel channel(port, options);
+
+		std::vector<std::string> frames;
+		for (const auto& message : messages)
+		{
+			const auto frame_size = channel.WriteMessage(message);
+			frames.push_back(pty.Read(frame_size));
+		}
+		return frames;
+	}
+}
+
+// Test that a frame that cannot be written throws and is not counted
+TEST(CompressionTests, WriteAfterHangUp)
+{
+	auto pty = std::make_unique<PtyPair>();
+	SerialPort port(pty->SlaveName(), 115200);
+	port.Open();
+	CompressedChannel channel(port);
+
+	pty.reset();
+	EXPECT_THROW(channel.WriteMessage("hello"), IoException);
+	EXPECT_EQ(channel.GetStats().messages_written, 0);
+	EXPECT_EQ(channel.GetStats().wire_bytes_written, 0);
+}
+
+// Test that streamed telemetry arrives intact and compresses well
+TEST(CompressionTests, StreamingTelemetry)
+{
+	const auto messages = make_telemetry(500);
+	NullModem null_modem;
+	SerialPort sender_port(null_modem.PortNameA(), 57600);
+	SerialPort receiver_port(null_modem.PortNameB(), 57600);
+	sender_port.Open();
+	receiver_port.Open();
+	CompressedChannel sender(sender_port);
+	CompressedChannel receiver(receiver_port);
+
+	std::thread writer([&]
+	{
+		for (const auto& message : messages)
+		{
+			sender.WriteMessage(message);
+		}
+	});
+
+	std::string message;
+	for (const auto& expected : messages)
+	{
+		ASSERT_TRUE(receiver.ReadMessage(message, std::chrono::milliseconds(2000)));
+		EXPECT_EQ(message, expected);
+	}
+	writer.join();
+
+	const auto& tx = sender.GetStats();
+	const auto& rx = receiver.GetStats();
+	std::cout << tx << std::endl << rx << std::endl;
+	EXPECT_GT(tx.CompressionRatio(), 2.0);
+	EXPECT_EQ(rx.messages_read, messages.size());
+	EXPECT_EQ(rx.wire_bytes_read, tx.wire_bytes_written);
+	EXPECT_EQ(rx.frames_dropped, 0);
+}
+
+// Test that a corrupted frame is dropped and the receiver resynchronizes at the next context reset
+TEST(CompressionTests, Resynchronize)
+{
+	CompressionOptions options;
+	options.reset_interval = 4;
+	const auto messages = make_telemetry(12);
+	auto frames = make_frames(messages, options);
+	frames[5][frames[5].size() / 2] ^= 0x10;
+
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+	CompressedChannel receiver(port, options);
+	for (const auto& frame : frames)
+	{
+		pty.Write(frame);
+	}
+
+	// Frames 5 to 7 are lost (7 depends on the context of 5), frame 8 resets the context
+	std::string message;
+	for (const std::size_t i : { 0, 1, 2, 3, 4, 8, 9, 10, 11 })
+	{
+		ASSERT_TRUE(receiver.ReadMessage(message, std::chrono::milliseconds(1000)));
+		EXPECT_EQ(message, messages[i]);
+	}
+	EXPECT_FALSE(receiver.ReadMessage(message, std::chrono::milliseconds(50)));
+	EXPECT_EQ(receiver.GetStats().frames_dropped, 3);
+}
+
+// Test that independently compressed messages can use a dictionary and that incompressible data passes unchanged
+TEST(CompressionTests, DictionaryWithoutStreaming)
+{
+	CompressionOptions options;
+	options.streaming = false;
+	options.dictionary = make_telemetry(1).front();
+
+	std::mt19937 random(7);
+	std::string noise(300, '\0');
+	for (auto& c : noise)
+	{
+		c = static_cast<char>(random());
+	}
+	auto messages = make_telemetry(20);
+	messages.push_back(noise);
+	messages.emplace_back();
+
+	const auto frames = make_frames(messages, options);
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+	CompressedChannel receiver(port, options);
+
+	std::string message;
+	for (std::size_t i = 0; i < messages.size(); ++i)
+	{
+		pty.Write(frames[i]);
+		ASSERT_TRUE(receiver.ReadMessage(message, std::chrono::milliseconds(1000)));
+		EXPECT_EQ(message, messages[i]);
+	}
+	// The dictionary alone makes each telemetry message compress to a fraction of its size
+	EXPECT_LT(frames[10].size() * 2, messages[10].size());
+	EXPECT_LT(frames[20].size(), messages[20].size() + 16);
+}
+
+#endif // __linux__
@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include "serial_port/cyclic_scheduler.h"
+#include "pty_pair.h"
+
+using namespace serial_port;
+
+// Test fixed and produced frames on two ports from one thread
+TEST(CyclicSchedulerTests, FixedPeriods)
+{
+	PtyPair pty_a;
+	PtyPair pty_b;
+	SerialPort port_a(pty_a.SlaveName(), 115200);
+	SerialPort port_b(pty_b.SlaveName(), 115200);
+	port_a.Open();
+	port_b.Open();
+
+	CyclicScheduler scheduler;
+	const auto keep_alive = scheduler.AddStream(port_a, std::chrono::milliseconds(1), std::string("K"));
+	char counter = 0;
+	const auto setpoint = scheduler.AddStream(port_b, std::chrono::milliseconds(4), [&counter](std::string& frame)
+	{
+		frame.push_back(static_cast<char>('a' + counter++ % 26));
+	}, std::chrono::milliseconds(2));
+
+	scheduler.Start();
+	std::this_thread::sleep_for(std::chrono::milliseconds(400));
+	scheduler.Stop();
+
+	const auto keep_alive_stats = scheduler.GetStats(keep_alive);
+	const auto setpoint_stats = scheduler.GetStats(setpoint);
+	std::cout << "Keep-alive: " << keep_alive_stats << std::endl << "Setpoint:   " << setpoint_stats << std::endl;
+
+	// Sent and missed cycles add up to the elapsed time, so the schedule does not drift
+	EXPECT_NEAR(static_cast<double>(keep_alive_stats.num_sent + keep_alive_stats.num_missed), 400.0, 20.0);
+	EXPECT_NEAR(static_cast<double>(setpoint_stats.num_sent + setpoint_stats.num_missed), 100.0, 5.0);
+	EXPECT_EQ(keep_alive_stats.num_write_errors, 0);
+	EXPECT_EQ(keep_alive_stats.lateness.count, keep_alive_stats.num_sent);
+
+	EXPECT_EQ(pty_a.Read(keep_alive_stats.num_sent, std::chrono::milliseconds(100)), std::string(keep_alive_stats.num_sent, 'K'));
+	const auto setpoints = pty_b.Read(setpoint_stats.num_sent, std::chrono::milliseconds(100));
+	ASSERT_EQ(setpoints.size(), setpoint_stats.num_sent);
+	EXPECT_EQ(setpoints.substr(0, 3), "abc");
+}
+
+// Test that cycles are skipped rather than sent in a burst when the thread falls behind
+TEST(CyclicSchedulerTests, MissedDeadlines)
+{
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+
+	CyclicScheduler scheduler;
+	int cycle = 0;
+	const auto stream = scheduler.AddStream(port, std::chrono::milliseconds(2), [&cycle](std::string& frame)
+	{
+		if (++cycle == 10)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(21));
+		}
+		frame = "x";
+	});
+	scheduler.Start();
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	scheduler.Stop();
+
+	const auto stats = scheduler.GetStats(stream);
+	std::cout << stats << std::endl;
+	EXPECT_GE(stats.num_missed, 10);
+	EXPECT_GE(stats.lateness.max, std::chrono::milliseconds(20));
+	EXPECT_THROW((void)scheduler.GetStats(stream + 1), std::invalid_argument);
+}
+
+// Test that a producer (or a write) that blocks does not block the other methods
+TEST(CyclicSchedulerTests, BlockedProducer)
+{
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+
+	CyclicScheduler scheduler;
+	std::atomic<bool> producing{ false };
+	std::atomic<bool> release{ false };
+	const auto blocked = scheduler.AddStream(port, std::chrono::milliseconds(1), [&](std::string& frame)
+	{
+		producing = true;
+		while (!release)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		frame = "B";
+	});
+	scheduler.Start();
+	while (!producing)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	EXPECT_EQ(scheduler.GetStats(blocked).num_sent, 0);
+	const auto other = scheduler.AddStream(port, std::chrono::milliseconds(10), std::string("O"));
+	scheduler.RemoveStream(other);
+	EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+
+	// Removing the blocked stream waits until its frame has been written
+	std::thread releaser([&release]
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		release = true;
+	});
+	scheduler.RemoveStream(blocked);
+	EXPECT_TRUE(release);
+	EXPECT_EQ(pty.Read(1, std::chrono::milliseconds(100)), "B");
+	releaser.join();
+
+	scheduler.Stop();
+	EXPECT_FALSE(scheduler.Error());
+}
+
+// Test that a throwing producer costs its cycles only
+TEST(CyclicSchedulerTests, ThrowingProducer)
+{
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+
+	CyclicScheduler scheduler;
+	int cycle = 0;
+	const auto stream = scheduler.AddStream(port, std::chrono::milliseconds(2), [&cycle](std::string& frame)
+	{
+		if (++cycle % 2 == 0)
+		{
+			throw std::runtime_error("No data");
+		}
+		frame = "x";
+	});
+	scheduler.Start();
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	EXPECT_TRUE(scheduler.IsRunning());
+	scheduler.Stop();
+
+	const auto stats = scheduler.GetStats(stream);
+	std::cout << stats << std::endl;
+	EXPECT_GT(stats.num_sent, 10);
+	EXPECT_GT(stats.num_write_errors, 10);
+	EXPECT_FALSE(scheduler.Error());
+}
+
+#endif // __linux__
@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cctype>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "serial_port/decode_pool.h"
+#include "pty_pair.h"
+
+using namespace serial_port;
+
+namespace
+{
+	// CPU-bound work proportional to rounds
+	std::uint32_t burn(const std::string& data, const int rounds)
+	{
+		std::uint32_t hash = 2166136261U;
+		for (int round = 0; round < rounds; ++round)
+		{
+			for (const auto c : data)
+			{
+				hash = (hash ^ static_cast<unsigned char>(c)) * 16777619U;
+			}
+		}
+		return hash;
+	}
+}
+
+// Test that every stream is handled in order although frames are decoded out of order
+TEST(DecodePoolTests, Ordering)
+{
+	constexpr std::size_t kNumStreams = 4;
+	constexpr int kNumFrames = 2000;
+
+	std::vector<std::vector<int>> handled(kNumStreams);
+	DecodePoolOptions options;
+	options.num_workers = 4;
+	options.max_in_flight = 256;
+	DecodePool pool([](std::string& frame)
+	{
+		// Uneven work, so that later frames overtake earlier ones
+		const auto number = std::stoi(frame);
+		frame += std::to_string(burn(frame, number % 5 == 0 ? 400 : 1) & 1);
+	}, [&handled](const std::size_t stream, std::string& frame)
+	{
+		handled[stream].push_back(std::stoi(frame));
+	}, options);
+
+	std::vector<DecodePool::StreamId> streams;
+	std::vector<std::thread> submitters;
+	for (std::size_t i = 0; i < kNumStreams; ++i)
+	{
+		streams.push_back(pool.AddStream());
+	}
+	for (const auto stream : streams)
+	{
+		submitters.emplace_back([&pool, stream]
+		{
+			for (int n = 0; n < kNumFrames; ++n)
+			{
+				pool.Submit(stream, std::to_string(n) + ":");
+			}
+		});
+	}
+	for (auto& submitter : submitters)
+	{
+		submitter.join();
+	}
+	ASSERT_TRUE(pool.Drain(std::chrono::seconds(10)));
+
+	const auto stats = pool.GetStats();
+	std::cout << stats << std::endl;
+	EXPECT_EQ(stats.num_submitted, kNumStreams * kNumFrames);
+	EXPECT_EQ(stats.num_handled, kNumStreams * kNumFrames);
+	EXPECT_EQ(stats.num_errors, 0);
+	for (const auto& numbers : handled)
+	{
+		ASSERT_EQ(numbers.size(), kNumFrames);
+		for (int n = 0; n < kNumFrames; ++n)
+		{
+			ASSERT_EQ(numbers[n], n);
+		}
+	}
+}
+
+// Test that frames whose decoding fails are skipped without stalling the stream
+TEST(DecodePoolTests, DecoderErrors)
+{
+	std::vector<std::string> handled;
+	DecodePoolOptions options;
+	options.num_workers = 2;
+	DecodePool pool([](std::string& frame)
+	{
+		if (frame == "bad")
+		{
+			throw std::runtime_error("Corrupt frame");
+		}
+	}, [&handled](std::size_t, std::string& frame) { handled.push_back(frame); }, options);
+
+	const auto stream = pool.AddStream();
+	for (const auto* frame : { "a", "bad", "b", "bad", "c" })
+	{
+		pool.Submit(stream, frame);
+	}
+	ASSERT_TRUE(pool.Drain(std::chrono::seconds(2)));
+	EXPECT_EQ(handled, (std::vector<std::string>{ "a", "b", "c" }));
+	EXPECT_EQ(pool.GetStats().num_errors, 2);
+	EXPECT_THROW(pool.Submit(stream + 1, "x"), std::invalid_argument);
+}
+
+// Test that decode throughput grows with the number of workers
+TEST(DecodePoolTests, Scaling)
+{
+	const auto num_cores = std::thread::hardware_concurrency();
+	if (num_cores < 4)
+	{
+		GTEST_SKIP() << "Needs at least 4 cores, found " << num_cores;
+	}
+
+	const auto measure = [](const std::size_t num_workers)
+	{
+		DecodePoolOptions options;
+		options.num_workers = num_workers;
+		std::atomic<std::uint32_t> sink{ 0 };
+		DecodePool pool([&sink](std::string& frame) { sink += burn(frame, 200); }, [](std::size_t, std::string&) {}, options);
+		const auto stream = pool.AddStream();
+		const std::string frame(256, 'f');
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < 4000; ++i)
+		{
+			pool.Submit(stream, frame);
+		}
+		EXPECT_TRUE(pool.Drain(std::chrono::seconds(60)));
+		const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << num_workers << " workers: " << 4000 / elapsed << " frames/s, " << pool.GetStats() << std::endl;
+		return 4000 / elapsed;
+	};
+
+	const auto single = measure(1);
+	const auto multiple = measure(4);
+	EXPECT_GT(multiple, 2.0 * single);
+}
+
+#if defined(__linux__)
+// Test reading, decoding and handling frames from several ports
+TEST(DecodePoolTests, Ports)
+{
+	constexpr int kNumPorts = 3;
+	constexpr int kNumLines = 200;
+
+	// Declared before the pool, so that they outlive its readers
+	std::vector<std::unique_ptr<PtyPair>> ptys;
+	std::vector<std::unique_ptr<SerialPort>> ports;
+	std::mutex mutex;
+	std::vector<std::vector<std::string>> handled(kNumPorts);
+	DecodePoolOptions options;
+	options.num_workers = 3;
+	DecodePool pool([](std::string& frame)
+	{
+		for (auto& c : frame)
+		{
+			c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+		}
+	}, [&](const std::size_t stream, std::string& frame)
+	{
+		const std::lock_guard<std::mutex> lock(mutex);
+		handled[stream].push_back(frame);
+	}, options);
+
+	for (int i = 0; i < kNumPorts; ++i)
+	{
+		ptys.push_back(std::make_unique<PtyPair>());
+		ports.push_back(std::make_unique<SerialPort>(ptys.back()->SlaveName(), 115200));
+		ports.back()->Open();
+		ASSERT_EQ(pool.AddPort(*ports.back()), static_cast<DecodePool::StreamId>(i));
+	}
+
+	for (int n = 0; n < kNumLines; ++n)
+	{
+		for (int i = 0; i < kNumPorts; ++i)
+		{
+			ptys[i]->Write("port" + std::to_string(i) + " line" + std::to_string(n) + "\n");
+		}
+	}
+
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (pool.GetStats().num_handled < kNumPorts * kNumLines && std::chrono::steady_clock::now() < deadline)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	const std::lock_guard<std::mutex> lock(mutex);
+	for (int i = 0; i < kNumPorts; ++i)
+	{
+		ASSERT_EQ(handled[i].size(), kNumLines);
+		for (int n = 0; n < kNumLines; ++n)
+		{
+			EXPECT_EQ(handled[i][n], "PORT" + std::to_string(i) + " LINE" + std::to_string(n) + "\n");
+		}
+	}
+}
+#endif
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+
+#if defined(__linux__) && defined(__cpp_impl_coroutine)
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "serial_port/event_loop.h"
+#include "pty_pair.h"
+
+using namespace serial_port;
+
+namespace
+{
+	// Answer one line with an acknowledgment, in straight-line code
+	DetachedTask echo_line(AsyncPort& port, std::string& line, int& num_done)
+	{
+		const auto read = co_await port.AsyncReadLine(line, std::chrono::milliseconds(2000));
+		if (read.error)
+		{
+			co_return;
+		}
+		const auto reply = "ACK " + line;
+		const auto written = co_await port.AsyncWrite(reply.data(), reply.size());
+		if (!written.error && written.num_bytes == reply.size())
+		{
+			++num_done;
+		}
+	}
+
+	DetachedTask read_some(AsyncPort& port, std::chrono::milliseconds timeout, IoResult& result, bool& done)
+	{
+		char buffer[16];
+		result = co_await port.AsyncRead(buffer, sizeof(buffer), timeout);
+		done = true;
+	}
+}
+
+// Test serving many ports from a single thread with coroutines
+TEST(EventLoopTests, ManyPortsOneThread)
+{
+	constexpr int kNumPorts = 50;
+	EventLoop loop;
+	std::vector<std::unique_ptr<PtyPair>> ptys;
+	std::vector<std::unique_ptr<SerialPort>> ports;
+	std::vector<std::unique_ptr<AsyncPort>> async_ports;
+	std::vector<std::string> lines(kNumPorts);
+	int num_done = 0;
+
+	for (int i = 0; i < kNumPorts; ++i)
+	{
+		ptys.push_back(std::make_unique<PtyPair>());
+		ports.push_back(std::make_unique<SerialPort>(ptys.back()->SlaveName(), 115200));
+		ports.back()->Open();
+		async_ports.push_back(std::make_unique<AsyncPort>(loop, *ports.back()));
+		echo_line(*async_ports.back(), lines[i], num_done);
+	}
+
+	for (int i = 0; i < kNumPorts; ++i)
+	{
+		ptys[i]->Write("hello " + std::to_string(i) + "\n");
+	}
+
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (num_done < kNumPorts && std::chrono::steady_clock::now() < deadline)
+	{
+		loop.RunOnce(std::chrono::milliseconds(100));
+	}
+	ASSERT_EQ(num_done, kNumPorts);
+
+	for (int i = 0; i < kNumPorts; ++i)
+	{
+		const auto expected = "ACK hello " + std::to_string(i) + "\n";
+		EXPECT_EQ(ptys[i]->Read(expected.size()), expected);
+	}
+}
+
+// Test that a read without data times out
+TEST(EventLoopTests, Timeout)
+{
+	EventLoop loop;
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+	AsyncPort async_port(loop, port);
+
+	IoResult result;
+	bool done = false;
+	const auto start = std::chrono::steady_clock::now();
+	read_some(async_port, std::chrono::milliseconds(20), result, done);
+	while (!done)
+	{
+		loop.RunOnce(std::chrono::milliseconds(100));
+	}
+	EXPECT_EQ(result.error, std::errc::timed_out);
+	EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+}
+
+// Test cancelling a pending read from another thread
+TEST(EventLoopTests, Cancel)
+{
+	EventLoop loop;
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+	AsyncPort async_port(loop, port);
+
+	IoResult result;
+	bool done = false;
+	read_some(async_port, kNoTimeout, result, done);
+
+	std::thread canceller([&async_port, &loop]
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		async_port.Cancel();
+		loop.Stop();
+	});
+	loop.Run();
+	canceller.join();
+
+	EXPECT_TRUE(done);
+	EXPECT_EQ(result.error, std::errc::operation_canceled);
+}
+
+// Test that a cancellation posted from another thread is harmless once the port is gone
+TEST(EventLoopTests, CancelAfterDestruction)
+{
+	EventLoop loop;
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+	auto async_port = std::make_unique<AsyncPort>(loop, port);
+
+	IoResult result;
+	bool done = false;
+	read_some(*async_port, kNoTimeout, result, done);
+	std::thread canceller([&async_port] { async_port->Cancel(); });
+	canceller.join();
+
+	async_port.reset();
+	loop.RunOnce(std::chrono::milliseconds(10));
+	EXPECT_FALSE(done);
+}
+
+// Test reading data that arrives after the coroutine suspended
+TEST(EventLoopTests, ReadAfterSuspend)
+{
+	EventLoop loop;
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+	AsyncPort async_port(loop, port);
+
+	IoResult result;
+	bool done = false;
+	read_some(async_port, std::chrono::milliseconds(2000), result, done);
+	EXPECT_FALSE(done);
+
+	pty.Write("data");
+	while (!done)
+	{
+		loop.RunOnce(std::chrono::milliseconds(100));
+	}
+	EXPECT_FALSE(result.error);
+	EXPECT_EQ(result.num_bytes, 4);
+}
+
+#endif // __linux__ && __cpp_impl_coroutine
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#if defined(__linux__)
+
+#include <unistd.h>
+
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+#include "serial_port/file_transfer.h"
+#include "pty_pair.h"
+
+using namespace serial_port;
+
+namespace
+{
+	std::string make_path(const std::string& name)
+	{
+		return "/tmp/serial_port_transfer_" + std::to_string(getpid()) + "_" + name;
+	}
+
+	std::string make_firmware(const std::size_t num_bytes)
+	{
+		std::mt19937 random(1);
+		std::string data(num_bytes, '\0');
+		for (auto& c : data)
+		{
+			c = static_cast<char>(random());
+		}
+		return data;
+	}
+
+	void write_file(const std::string& path, const std::string& data)
+	{
+		std::ofstream(path, std::ios::binary) << data;
+	}
+
+	std::string read_file(const std::string& path)
+	{
+		std::ostringstream data;
+		data << std::ifstream(path, std::ios::binary).rdbuf();
+		return data.str();
+	}
+
+	// Transfer a file from port A to port B of a null modem and check that it arrives intact
+	std::pair<TransferStats, TransferStats> transfer(const NullModem& null_modem, const std::string& name, const std::string& firmware,
+		const TransferOptions& options = {})
+	{
+		const auto source = make_path(name + "_source.bin");
+		const auto destination = make_path(name + "_destination.bin");
+		write_file(source, firmware);
+
+		SerialPort sender_port(null_modem.PortNameA(), 921600);
+		SerialPort receiver_port(null_modem.PortNameB(), 921600);
+		sender_port.Open();
+		receiver_port.Open();
+
+		auto received = std::async(std::launch::async, [&receiver_port, &destination, &options]
+		{
+			return FileTransfer(receiver_port, options).Receive(destination);
+		});
+		const auto sender_stats = FileTransfer(sender_port, options).Send(source);
+		const auto receiver_stats = received.get();
+
+		EXPECT_TRUE(read_file(destination) == firmware);
+		std::remove(source.c_str());
+		std::remove(destination.c_str());
+		return { sender_stats, receiver_stats };
+	}
+}
+
+// Test a transfer over a clean line
+TEST(FileTransferTests, Loopback)
+{
+	const NullModem null_modem;
+	const auto firmware = make_firmware(1 << 20);
+	const auto [sender, receiver] = transfer(null_modem, "loopback", firmware);
+	std::cout << "Sender:   " << sender << std::endl << "Receiver: " << receiver << std::endl;
+
+	EXPECT_EQ(sender.file_size, firmware.size());
+	EXPECT_EQ(receiver.file_size, firmware.size());
+	EXPECT_EQ(sender.retransmitted_bytes, 0);
+	// The protocol overhead is small
+	EXPECT_LT(sender.wire_bytes, firmware.size() * 102 / 100);
+}
+
+// Test that corrupted and lost data is sent again
+TEST(FileTransferTests, Recovery)
+{
+	std::size_t num_relayed = 0;
+	const NullModem null_modem([&num_relayed](std::string& data)
+	{
+		const auto before = num_relayed;
+		num_relayed += data.size();
+		if (before < 100000 && num_relayed >= 100000)
+		{
+			data[data.size() / 2] ^= 0x04;
+		}
+		if (before < 300000 && num_relayed >= 300000)
+		{
+			data.clear();
+		}
+	});
+
+	TransferOptions options;
+	options.timeout = std::chrono::milliseconds(200);
+	const auto firmware = make_firmware(512 * 1024);
+	const auto [sender, receiver] = transfer(null_modem, "recovery", firmware, options);
+	std::cout << "Sender:   " << sender << std::endl << "Receiver: " << receiver << std::endl;
+
+	EXPECT_GE(receiver.corrupted_packets, 1);
+	EXPECT_GE(receiver.naks, 2);
+	EXPECT_GT(sender.retransmitted_bytes, 0);
+}
+
+// Test transferring an empty file
+TEST(FileTransferTests, EmptyFile)
+{
+	const NullModem null_modem;
+	const auto [sender, receiver] = transfer(null_modem, "empty", "");
+	EXPECT_EQ(sender.file_size, 0);
+	EXPECT_EQ(receiver.file_size, 0);
+}
+
+#endif // __linux__
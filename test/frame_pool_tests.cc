@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "serial_port/frame_pool.h"
+#include "pty_pair.h"
+
+using namespace serial_port;
+
+// Test that buffers are taken from the pool until it is empty and then allocated on the heap
+TEST(FramePoolTests, HitsAndMisses)
+{
+	FramePoolOptions options;
+	options.buffer_size = 64;
+	options.num_buffers = 4;
+	FramePool pool(options);
+
+	std::vector<FrameBuffer> buffers;
+	for (int i = 0; i < 5; ++i)
+	{
+		buffers.push_back(pool.Acquire());
+		EXPECT_EQ(buffers.back().Size(), 0);
+		EXPECT_EQ(buffers.back().Capacity(), 64);
+	}
+	auto stats = pool.GetStats();
+	EXPECT_EQ(stats.num_hits, 4);
+	EXPECT_EQ(stats.num_misses, 1);
+	EXPECT_EQ(stats.num_free, 0);
+
+	buffers.clear();
+	stats = pool.GetStats();
+	EXPECT_EQ(stats.num_free, 4);
+	auto buffer = pool.Acquire();
+	EXPECT_EQ(pool.GetStats().num_hits, 5);
+	EXPECT_THROW(buffer.Resize(65), std::invalid_argument);
+	std::cout << pool.GetStats() << std::endl;
+}
+
+// Test that copies share the bytes and the buffer returns to the pool with the last copy
+TEST(FramePoolTests, Sharing)
+{
+	FramePoolOptions options;
+	options.num_buffers = 2;
+	FramePool pool(options);
+
+	auto frame = pool.Acquire();
+	std::memcpy(frame.Data(), "frame", 5);
+	frame.Resize(5);
+
+	std::vector<FrameBuffer> consumers(3, frame);
+	EXPECT_EQ(frame.UseCount(), 4);
+	for (const auto& consumer : consumers)
+	{
+		EXPECT_EQ(consumer.Data(), frame.Data());
+		EXPECT_EQ(consumer.View(), "frame");
+	}
+
+	frame.Reset();
+	EXPECT_FALSE(frame);
+	EXPECT_EQ(pool.GetStats().num_free, 1);
+	consumers.clear();
+	EXPECT_EQ(pool.GetStats().num_free, 2);
+}
+
+// Test that buffers stay valid after the pool has been destroyed
+TEST(FramePoolTests, OutlivePool)
+{
+	FrameBuffer frame;
+	{
+		FramePool pool;
+		frame = pool.Acquire();
+	}
+	std::memcpy(frame.Data(), "late", 4);
+	frame.Resize(4);
+	EXPECT_EQ(frame.View(), "late");
+}
+
+// Test taking and releasing buffers on many threads at once
+TEST(FramePoolTests, Concurrency)
+{
+	constexpr int kNumThreads = 4;
+	constexpr int kNumIterations = 50000;
+
+	FramePoolOptions options;
+	options.buffer_size = 32;
+	options.num_buffers = 8;
+	FramePool pool(options);
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < kNumThreads; ++t)
+	{
+		threads.emplace_back([&pool, t]
+		{
+			for (int i = 0; i < kNumIterations; ++i)
+			{
+				auto frame = pool.Acquire();
+				frame.Data()[0] = static_cast<char>(t);
+				frame.Resize(1);
+				const auto copy = frame;
+				frame.Reset();
+				// Nobody else may have been handed the same buffer meanwhile
+				ASSERT_EQ(copy.View()[0], static_cast<char>(t));
+			}
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	const auto stats = pool.GetStats();
+	std::cout << stats << std::endl;
+	EXPECT_EQ(stats.num_hits + stats.num_misses, kNumThreads * kNumIterations);
+	EXPECT_EQ(stats.num_free, options.num_buffers);
+}
+
+#if defined(__linux__)
+// Test reading from a port straight into a pooled buffer
+TEST(FramePoolTests, ReadFrom)
+{
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+	FramePool pool;
+
+	pty.Write("hello");
+	const auto result = pool.ReadFrom(port, std::chrono::milliseconds(1000));
+	ASSERT_TRUE(result);
+	EXPECT_EQ(result.Value().View(), "hello");
+
+	const auto timeout = pool.ReadFrom(port, std::chrono::milliseconds(10));
+	ASSERT_FALSE(timeout);
+	EXPECT_EQ(timeout.Error(), Errc::kTimeout);
+	EXPECT_EQ(pool.GetStats().num_free, pool.GetStats().num_buffers - 1);
+}
+#endif
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include <iostream>
+
+#include "serial_port/io_thread.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace serial_port;
+
+#if defined(__linux__)
+
+namespace
+{
+	// The last CPU the process may run on (containers often restrict the set)
+	int last_allowed_cpu()
+	{
+		cpu_set_t cpus;
+		sched_getaffinity(0, sizeof(cpus), &cpus);
+		int cpu = 0;
+		for (int i = 0; i < CPU_SETSIZE; ++i)
+		{
+			if (CPU_ISSET(i, &cpus))
+			{
+				cpu = i;
+			}
+		}
+		return cpu;
+	}
+}
+
+// Test that a thread is pinned before it runs its function
+TEST(IoThreadTests, Affinity)
+{
+	IoThreadConfig config;
+	config.cpus = { last_allowed_cpu() };
+	config.prefault_stack = 64 * 1024;
+
+	int cpu = -1;
+	auto thread = StartIoThread(config, [&cpu] { cpu = sched_getcpu(); });
+	thread.join();
+	EXPECT_EQ(cpu, config.cpus.front());
+}
+
+// Test that invalid settings fail in the starting thread and the function is never run
+TEST(IoThreadTests, InvalidConfig)
+{
+	bool ran = false;
+	IoThreadConfig config;
+	config.cpus = { -1 };
+	EXPECT_THROW(StartIoThread(config, [&ran] { ran = true; }), std::invalid_argument);
+	config.cpus.clear();
+	config.realtime_priority = 1000;
+	EXPECT_THROW(StartIoThread(config, [&ran] { ran = true; }), std::invalid_argument);
+	EXPECT_FALSE(ran);
+}
+
+// Test real-time scheduling where the process is allowed to use it
+TEST(IoThreadTests, RealtimePriority)
+{
+	IoThreadConfig config;
+	config.realtime_priority = 10;
+	int policy = -1;
+	sched_param param{};
+	try
+	{
+		auto thread = StartIoThread(config, [&policy, &param] { pthread_getschedparam(pthread_self(), &policy, &param); });
+		thread.join();
+	}
+	catch (const IoException& e)
+	{
+		GTEST_SKIP() << e.what();
+	}
+	EXPECT_EQ(policy, SCHED_FIFO);
+	EXPECT_EQ(param.sched_priority, 10);
+	std::cout << "SCHED_FIFO: " << MeasureSchedulingLatency(config, std::chrono::microseconds(500), 500) << std::endl;
+}
+
+#endif // __linux__
+
+// Test measuring the wake-up latency of a default thread
+TEST(IoThreadTests, SchedulingLatency)
+{
+	const auto stats = MeasureSchedulingLatency({}, std::chrono::microseconds(500), 500);
+	std::cout << "Default:    " << stats << std::endl;
+	EXPECT_EQ(stats.num_samples, 500);
+	EXPECT_LE(stats.min, stats.average);
+	EXPECT_LE(stats.p99, stats.max);
+	EXPECT_GE(stats.min.count(), 0);
+}
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+#include "serial_port/link_emulator.h"
+
+using namespace serial_port;
+
+namespace
+{
+	// Receive up to num_bytes, giving up once nothing arrives for the timeout
+	std::string receive(const SerialPort& port, const std::size_t num_bytes,
+		const std::chrono::milliseconds timeout = std::chrono::milliseconds(500))
+	{
+		std::string data(num_bytes, '\0');
+		std::size_t received = 0;
+		while (received < num_bytes && port.WaitForData(timeout))
+		{
+			received += port.ReadData(data.data() + received, static_cast<unsigned long>(num_bytes - received));
+		}
+		data.resize(received);
+		return data;
+	}
+
+	double elapsed_ms(const std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+TEST(LinkEmulatorTests, CharacterTime)
+{
+	EXPECT_EQ(CharacterTime(9600).count(), 1'041'666);
+	EXPECT_EQ(CharacterTime(9600, Parity::kEven, NumStopBits::kTwo).count(), 1'250'000);
+	EXPECT_EQ(CharacterTime(115200).count(), 86'805);
+	EXPECT_THROW(static_cast<void>(CharacterTime(0)), std::invalid_argument);
+}
+
+// Test that the bytes take as long as on a real line with the framing the sending port configured
+TEST(LinkEmulatorTests, Throughput)
+{
+	LinkEmulatorOptions options;
+	options.parity = Parity::kEven;
+	LinkEmulator link(options);
+	SerialPort port_a(link.PortNameA(), 9600, Parity::kEven, NumStopBits::kTwo);
+	SerialPort port_b(link.PortNameB(), 115200);
+	port_a.Open();
+	port_b.Open();
+
+	// 160 characters of 12 bits at 9600 baud
+	const std::string slow(160, 's');
+	auto start = std::chrono::steady_clock::now();
+	port_a.WriteString(slow);
+	EXPECT_EQ(receive(port_b, slow.size()), slow);
+	const auto slow_ms = elapsed_ms(start);
+
+	// 2000 characters of 11 bits at 115200 baud
+	std::string fast(2000, '\0');
+	for (std::size_t i = 0; i < fast.size(); ++i)
+	{
+		fast[i] = static_cast<char>(i);
+	}
+	start = std::chrono::steady_clock::now();
+	port_b.WriteString(fast);
+	EXPECT_EQ(receive(port_a, fast.size()), fast);
+	const auto fast_ms = elapsed_ms(start);
+
+	std::cout << "9600 8E2: " << slow_ms << " ms, 115200 8E1: " << fast_ms << " ms" << std::endl;
+	EXPECT_GE(slow_ms, 199.0);
+	EXPECT_LT(slow_ms, 250.0);
+	EXPECT_GE(fast_ms, 190.0);
+	EXPECT_LT(fast_ms, 240.0);
+
+	const auto stats = link.GetStats(LinkDirection::kBToA);
+	EXPECT_EQ(stats.num_sent, fast.size());
+	EXPECT_EQ(stats.num_delivered, fast.size());
+}
+
+TEST(LinkEmulatorTests, Latency)
+{
+	LinkEmulatorOptions options;
+	options.latency = std::chrono::milliseconds(30);
+	LinkEmulator link(options);
+	SerialPort port_a(link.PortNameA(), 115200);
+	SerialPort port_b(link.PortNameB(), 115200);
+	port_a.Open();
+	port_b.Open();
+
+	const auto start = std::chrono::steady_clock::now();
+	port_a.WriteString("x");
+	EXPECT_FALSE(port_b.WaitForData(std::chrono::milliseconds(20)));
+	EXPECT_EQ(receive(port_b, 1), "x");
+	const auto latency_ms = elapsed_ms(start);
+	std::cout << "Latency: " << latency_ms << " ms" << std::endl;
+	EXPECT_GE(latency_ms, 30.0);
+	EXPECT_LT(latency_ms, 45.0);
+}
+
+TEST(LinkEmulatorTests, Faults)
+{
+	LinkEmulatorOptions options;
+	options.baud_rate = 4'000'000;
+	options.drop_probability = 0.1;
+	options.bit_flip_probability = 0.05;
+	LinkEmulator link(options);
+	SerialPort port_a(link.PortNameA(), 115200);
+	SerialPort port_b(link.PortNameB(), 115200);
+	port_a.Open();
+	port_b.Open();
+
+	const std::string sent(20000, 'U');
+	port_a.WriteString(sent);
+	const auto received = receive(port_b, sent.size(), std::chrono::milliseconds(300));
+
+	const auto stats = link.GetStats(LinkDirection::kAToB);
+	std::cout << stats << std::endl;
+	EXPECT_EQ(stats.num_sent, sent.size());
+	EXPECT_EQ(stats.num_delivered + stats.num_dropped + stats.num_overruns, stats.num_sent);
+	EXPECT_EQ(stats.num_overruns, 0);
+	EXPECT_NEAR(static_cast<double>(stats.num_dropped), 2000.0, 300.0);
+	EXPECT_NEAR(static_cast<double>(stats.num_corrupted), 900.0, 200.0);
+
+	ASSERT_EQ(received.size(), stats.num_delivered);
+	const auto num_corrupted = std::count_if(received.begin(), received.end(), [](const char c) { return c != 'U'; });
+	EXPECT_EQ(static_cast<std::uint64_t>(num_corrupted), stats.num_corrupted);
+
+	// The same seed gives the same faults
+	LinkEmulator repeated(options);
+	SerialPort port_c(repeated.PortNameA(), 115200);
+	SerialPort port_d(repeated.PortNameB(), 115200);
+	port_c.Open();
+	port_d.Open();
+	port_c.WriteString(sent);
+	EXPECT_EQ(receive(port_d, sent.size(), std::chrono::milliseconds(300)), received);
+}
+
+// Test that bytes are lost while the receiver does not read
+TEST(LinkEmulatorTests, Overrun)
+{
+	LinkEmulatorOptions options;
+	options.baud_rate = 4'000'000;
+	options.rx_buffer_size = 256;
+	LinkEmulator link(options);
+	SerialPort port_a(link.PortNameA(), 115200);
+	SerialPort port_b(link.PortNameB(), 115200);
+	port_a.Open();
+	port_b.Open();
+
+	port_a.WriteString(std::string(2000, 'o'));
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	const auto stats = link.GetStats(LinkDirection::kAToB);
+	std::cout << stats << std::endl;
+	EXPECT_EQ(stats.num_sent, 2000);
+	EXPECT_GE(stats.num_delivered, 256);
+	EXPECT_LT(stats.num_delivered, 512);
+	EXPECT_EQ(stats.num_delivered + stats.num_overruns, stats.num_sent);
+	EXPECT_EQ(receive(port_b, 2000, std::chrono::milliseconds(100)).size(), stats.num_delivered);
+}
+
+#endif // __linux__
@@ -0,0 +1,170 @@
+#ifndef MODBUS_SLAVE_SIMULATOR_H
+#define MODBUS_SLAVE_SIMULATOR_H
+
+#if defined(__linux__)
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "src/checksum.h"
+
+// Simulates Modbus RTU slaves on the master side of a pseudo terminal.
+// Every register of a simulated slave initially holds its own address.
+class ModbusSlaveSimulator
+{
+public:
+	// Simulate the given slaves, answering requests on the file descriptor fd
+	ModbusSlaveSimulator(const int fd, const std::set<std::uint8_t>& slaves, const std::uint16_t num_registers = 1000)
+		: fd_(fd)
+	{
+		for (const auto slave : slaves)
+		{
+			auto& registers = registers_[slave];
+			registers.resize(num_registers);
+			for (std::uint16_t i = 0; i < num_registers; ++i)
+			{
+				registers[i] = i;
+			}
+		}
+		thread_ = std::thread([this] { Run(); });
+	}
+
+	~ModbusSlaveSimulator()
+	{
+		running_ = false;
+		thread_.join();
+	}
+
+	// Number of requests received so far
+	[[nodiscard]] unsigned long NumRequests() const { return num_requests_; }
+
+	// Get a register value of a slave
+	std::uint16_t GetRegister(const std::uint8_t slave, const std::uint16_t address)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return registers_.at(slave).at(address);
+	}
+
+private:
+	void Run()
+	{
+		std::vector<std::uint8_t> buffer;
+		while (running_)
+		{
+			pollfd pfd{ fd_, POLLIN, 0 };
+			if (poll(&pfd, 1, 10) <= 0 || (pfd.revents & POLLIN) == 0)
+			{
+				continue;
+			}
+			std::uint8_t chunk[256];
+			const auto num_bytes = read(fd_, chunk, sizeof(chunk));
+			if (num_bytes <= 0)
+			{
+				continue;
+			}
+			buffer.insert(buffer.end(), chunk, chunk + num_bytes);
+
+			std::size_t length;
+			while ((length = RequestLength(buffer)) != 0 && buffer.size() >= length)
+			{
+				const std::vector<std::uint8_t> request(buffer.begin(), buffer.begin() + static_cast<long>(length));
+				buffer.erase(buffer.begin(), buffer.begin() + static_cast<long>(length));
+				++num_requests_;
+				Respond(request);
+			}
+		}
+	}
+
+	static std::size_t RequestLength(const std::vector<std::uint8_t>& buffer)
+	{
+		if (buffer.size() < 2)
+		{
+			return 0;
+		}
+		if (buffer[1] == 0x10)
+		{
+			return buffer.size() < 7 ? 0 : 9 + static_cast<std::size_t>(buffer[6]);
+		}
+		return 8;
+	}
+
+	void Respond(const std::vector<std::uint8_t>& request)
+	{
+		const auto crc = serial_port::checksum::Crc16Modbus(request.data(), request.size() - 2);
+		if (request[request.size() - 2] != (crc & 0xFF) || request[request.size() - 1] != (crc >> 8))
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		const auto slave = registers_.find(request[0]);
+		if (slave == registers_.end())
+		{
+			// Unknown slaves do not answer
+			return;
+		}
+		auto& registers = slave->second;
+
+		const auto function = request[1];
+		const auto address = static_cast<std::uint16_t>((request[2] << 8) | request[3]);
+		const auto count = static_cast<std::uint16_t>((request[4] << 8) | request[5]);
+		std::vector<std::uint8_t> response{ request[0], function };
+
+		switch (function)
+		{
+		case 0x03:
+		case 0x04:
+			if (static_cast<std::size_t>(address) + count > registers.size())
+			{
+				response = { request[0], static_cast<std::uint8_t>(function | 0x80), 0x02 };
+				break;
+			}
+			response.push_back(static_cast<std::uint8_t>(2 * count));
+			for (std::uint16_t i = 0; i < count; ++i)
+			{
+				response.push_back(static_cast<std::uint8_t>(registers[address + i] >> 8));
+				response.push_back(static_cast<std::uint8_t>(registers[address + i] & 0xFF));
+			}
+			break;
+		case 0x06:
+			registers.at(address) = count;
+			response.assign(request.begin(), request.end() - 2);
+			break;
+		case 0x10:
+			for (std::uint16_t i = 0; i < count; ++i)
+			{
+				registers.at(address + i) = static_cast<std::uint16_t>((request[7 + 2 * i] << 8) | request[8 + 2 * i]);
+			}
+			response.assign(request.begin(), request.begin() + 6);
+			break;
+		default:
+			response = { request[0], static_cast<std::uint8_t>(function | 0x80), 0x01 };
+			break;
+		}
+
+		const auto response_crc = serial_port::checksum::Crc16Modbus(response.data(), response.size());
+		response.push_back(static_cast<std::uint8_t>(response_crc & 0xFF));
+		response.push_back(static_cast<std::uint8_t>(response_crc >> 8));
+		const auto written = write(fd_, response.data(), response.size());
+		(void)written;
+	}
+
+	int fd_;
+	std::map<std::uint8_t, std::vector<std::uint16_t>> registers_;
+	std::mutex mutex_;
+	std::atomic<unsigned long> num_requests_{ 0 };
+	std::atomic<bool> running_{ true };
+	std::thread thread_;
+};
+
+#endif // __linux__
+
+#endif // MODBUS_SLAVE_SIMULATOR_H
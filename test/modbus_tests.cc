@@ -0,0 +1,177 @@
+#include <gtest/gtest.h>
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "serial_port/modbus.h"
+#include "modbus_slave_simulator.h"
+#include "pty_pair.h"
+
+using namespace serial_port;
+
+// Test reading and writing registers of a simulated slave
+TEST(ModbusTests, ReadWriteRegisters)
+{
+	PtyPair pty;
+	ModbusSlaveSimulator simulator(pty.Master(), { 1 });
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+
+	modbus::Master master(port);
+	EXPECT_EQ(master.ReadHoldingRegisters(1, 10, 3), (std::vector<std::uint16_t>{ 10, 11, 12 }));
+
+	master.WriteSingleRegister(1, 10, 0xABCD);
+	master.WriteMultipleRegisters(1, 11, { 0x1234, 0x0D0A });
+	EXPECT_EQ(master.ReadInputRegisters(1, 10, 3), (std::vector<std::uint16_t>{ 0xABCD, 0x1234, 0x0D0A }));
+
+	const auto stats = master.GetSlaveStats().at(1);
+	EXPECT_EQ(stats.requests, 4);
+	EXPECT_EQ(stats.responses, 4);
+	EXPECT_GT(stats.max_latency.count(), 0);
+}
+
+// Test that exception responses and missing responses are reported
+TEST(ModbusTests, ExceptionsAndTimeouts)
+{
+	PtyPair pty;
+	ModbusSlaveSimulator simulator(pty.Master(), { 1 }, 100);
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+
+	modbus::Master master(port, std::chrono::milliseconds(50));
+	EXPECT_THROW(master.ReadHoldingRegisters(1, 99, 2), IoException);
+	EXPECT_THROW(master.ReadHoldingRegisters(7, 0, 1), IoException);
+	EXPECT_EQ(master.ReadHoldingRegisters(1, 0, 1), std::vector<std::uint16_t>{ 0 });
+
+	const auto stats = master.GetSlaveStats();
+	EXPECT_EQ(stats.at(1).exceptions, 1);
+	EXPECT_EQ(stats.at(7).timeouts, 1);
+}
+
+// Test that an unplugged bus is reported instead of ending the process
+TEST(ModbusTests, PollSchedulerPortError)
+{
+	auto pty = std::make_unique<PtyPair>();
+	SerialPort port(pty->SlaveName(), 115200);
+	port.Open();
+
+	modbus::PollScheduler scheduler(std::chrono::milliseconds(20));
+	const auto bus = scheduler.AddBus(port);
+	std::atomic<unsigned long> num_port_errors{ 0 };
+	const auto count_errors = [&num_port_errors](const modbus::PollResult& result)
+	{
+		if (result.status == modbus::Status::kPortError)
+		{
+			++num_port_errors;
+		}
+	};
+	scheduler.AddRead(bus, 1, modbus::FunctionCode::kReadHoldingRegisters, 0, 1, count_errors);
+	scheduler.AddRead(bus, 2, modbus::FunctionCode::kReadHoldingRegisters, 0, 1, count_errors);
+
+	pty.reset();
+	scheduler.Start();
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	scheduler.Stop();
+
+	// The first request fails on the port, the second one is not sent at all in the same cycle
+	EXPECT_GE(num_port_errors, 2);
+	const auto stats = scheduler.GetSlaveStats();
+	EXPECT_GE(stats.at({ bus, 1 }).port_errors, 1);
+	EXPECT_EQ(stats.count({ bus, 2 }), 0);
+}
+
+// Test that adjacent blocks are coalesced into a single request
+TEST(ModbusTests, PollSchedulerCoalescing)
+{
+	PtyPair pty;
+	ModbusSlaveSimulator simulator(pty.Master(), { 1, 2 });
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+
+	modbus::PollScheduler scheduler;
+	const auto bus = scheduler.AddBus(port);
+	std::vector<std::uint16_t> values(6);
+	const auto store = [&values](const std::size_t offset)
+	{
+		return [&values, offset](const modbus::PollResult& result)
+		{
+			ASSERT_EQ(result.status, modbus::Status::kOk);
+			for (std::uint16_t i = 0; i < result.count; ++i)
+			{
+				values[offset + i] = result.values[i];
+			}
+		};
+	};
+	scheduler.AddRead(bus, 1, modbus::FunctionCode::kReadHoldingRegisters, 102, 2, store(2));
+	scheduler.AddRead(bus, 1, modbus::FunctionCode::kReadHoldingRegisters, 100, 2, store(0));
+	scheduler.AddRead(bus, 1, modbus::FunctionCode::kReadHoldingRegisters, 110, 1, store(4));
+	scheduler.AddRead(bus, 2, modbus::FunctionCode::kReadHoldingRegisters, 104, 1, store(5));
+
+	EXPECT_EQ(scheduler.NumRequests(bus), 3);
+	scheduler.SetMaxGap(10);
+	EXPECT_EQ(scheduler.NumRequests(bus), 2);
+
+	scheduler.PollOnce();
+	EXPECT_EQ(simulator.NumRequests(), 2);
+	EXPECT_EQ(values, (std::vector<std::uint16_t>{ 100, 101, 102, 103, 110, 104 }));
+}
+
+// Test polling several buses in parallel in the background
+TEST(ModbusTests, PollSchedulerParallelBuses)
+{
+	constexpr std::size_t kNumBuses = 4;
+	std::vector<std::unique_ptr<PtyPair>> ptys;
+	std::vector<std::unique_ptr<ModbusSlaveSimulator>> simulators;
+	std::vector<SerialPort> ports;
+	modbus::PollScheduler scheduler;
+	std::atomic<unsigned long> num_results{ 0 };
+
+	for (std::size_t i = 0; i < kNumBuses; ++i)
+	{
+		ptys.push_back(std::make_unique<PtyPair>());
+		simulators.push_back(std::make_unique<ModbusSlaveSimulator>(ptys.back()->Master(), std::set<std::uint8_t>{ 1, 2, 3 }));
+		ports.emplace_back(ptys.back()->SlaveName(), 115200);
+		ports.back().Open();
+	}
+	for (std::size_t i = 0; i < kNumBuses; ++i)
+	{
+		const auto bus = scheduler.AddBus(ports[i]);
+		scheduler.GetMaster(bus).SetInterFrameDelay(std::chrono::microseconds(0));
+		for (std::uint8_t slave = 1; slave <= 3; ++slave)
+		{
+			for (std::uint16_t address = 0; address < 500; address += 10)
+			{
+				scheduler.AddRead(bus, slave, modbus::FunctionCode::kReadInputRegisters, address, 10,
+					[&num_results](const modbus::PollResult& result)
+					{
+						if (result.status == modbus::Status::kOk && result.values[0] == result.address)
+						{
+							++num_results;
+						}
+					});
+			}
+		}
+		// Blocks of 10 registers are merged into requests of at most 120 registers: 5 requests per slave
+		EXPECT_EQ(scheduler.NumRequests(bus), 15);
+	}
+
+	scheduler.Start();
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	scheduler.Stop();
+
+	EXPECT_GT(num_results, 0);
+	const auto stats = scheduler.GetSlaveStats();
+	EXPECT_EQ(stats.size(), kNumBuses * 3);
+	for (const auto& [key, slave_stats] : stats)
+	{
+		std::cout << "Bus " << key.first << ", slave " << static_cast<int>(key.second) << ": " << slave_stats << std::endl;
+		EXPECT_GT(slave_stats.responses, 0);
+		EXPECT_EQ(slave_stats.errors, 0);
+	}
+}
+
+#endif // __linux__
@@ -0,0 +1,246 @@
+#include <gtest/gtest.h>
+
+#if defined(__linux__)
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <set>
+#include <thread>
+
+#include "serial_port/multiplexer.h"
+#include "pty_pair.h"
+
+using namespace serial_port;
+
+namespace
+{
+	std::string make_socket_path(const std::string& name)
+	{
+		return "/tmp/serial_port_mux_" + std::to_string(getpid()) + "_" + name + ".sock";
+	}
+
+	// A client process of the multiplexer
+	class Client
+	{
+	public:
+		explicit Client(const std::string& socket_path)
+		{
+			fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			sockaddr_un address{};
+			address.sun_family = AF_UNIX;
+			std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+			if (fd_ < 0 || connect(fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+			{
+				throw std::runtime_error("Could not connect to the multiplexer.");
+			}
+		}
+		~Client() { close(fd_); }
+
+		Client(const Client&) = delete;
+		Client& operator=(const Client&) = delete;
+
+		void Send(const std::string& data) const
+		{
+			ASSERT_EQ(send(fd_, data.data(), data.size(), MSG_NOSIGNAL), static_cast<ssize_t>(data.size()));
+		}
+
+		// Receive up to num_bytes, waiting at most timeout for each chunk. Returns less on timeout or hang up.
+		[[nodiscard]] std::string Receive(const std::size_t num_bytes,
+			const std::chrono::milliseconds timeout = std::chrono::milliseconds(1000)) const
+		{
+			std::string data(num_bytes, '\0');
+			std::size_t received = 0;
+			while (received < num_bytes)
+			{
+				pollfd pfd{ fd_, POLLIN, 0 };
+				if (poll(&pfd, 1, static_cast<int>(timeout.count())) <= 0)
+				{
+					break;
+				}
+				const auto result = recv(fd_, data.data() + received, num_bytes - received, 0);
+				if (result <= 0)
+				{
+					break;
+				}
+				received += static_cast<std::size_t>(result);
+			}
+			data.resize(received);
+			return data;
+		}
+
+	private:
+		int fd_{ -1 };
+	};
+
+	void wait_for_clients(const Multiplexer& multiplexer, const std::size_t num_clients)
+	{
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+		while (multiplexer.NumClients() != num_clients && std::chrono::steady_clock::now() < deadline)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		ASSERT_EQ(multiplexer.NumClients(), num_clients);
+	}
+
+	// A stream of numbered NMEA-like sentences
+	std::string make_stream(const std::size_t num_bytes)
+	{
+		std::string stream;
+		for (int i = 0; stream.size() < num_bytes; ++i)
+		{
+			stream += "$GPGGA," + std::to_string(i) + ",4807.038,N,01131.000,E,1,08,0.9,545.4,M*47\r\n";
+		}
+		stream.resize(num_bytes);
+		return stream;
+	}
+
+	// Write a stream at a limited rate, so that clients that do read can keep up
+	void write_paced(const PtyPair& pty, const std::string& stream)
+	{
+		constexpr std::size_t kChunkSize = 4096;
+		for (std::size_t pos = 0; pos < stream.size(); pos += kChunkSize)
+		{
+			pty.Write(stream.substr(pos, kChunkSize));
+			std::this_thread::sleep_for(std::chrono::microseconds(500));
+		}
+	}
+}
+
+// Test that every client receives the data of the port
+TEST(MultiplexerTests, FanOut)
+{
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+	Multiplexer multiplexer(port, make_socket_path("fan_out"));
+
+	Client a(multiplexer.GetSocketPath());
+	Client b(multiplexer.GetSocketPath());
+	Client c(multiplexer.GetSocketPath());
+	wait_for_clients(multiplexer, 3);
+
+	const auto stream = make_stream(20000);
+	pty.Write(stream);
+	EXPECT_EQ(a.Receive(stream.size()), stream);
+	EXPECT_EQ(b.Receive(stream.size()), stream);
+	EXPECT_EQ(c.Receive(stream.size()), stream);
+	EXPECT_EQ(multiplexer.GetStats().rx_bytes, stream.size());
+}
+
+// Test that frames sent by clients reach the port without being interleaved
+TEST(MultiplexerTests, MergeTx)
+{
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+	Multiplexer multiplexer(port, make_socket_path("merge_tx"));
+
+	constexpr int kNumFrames = 200;
+	Client a(multiplexer.GetSocketPath());
+	Client b(multiplexer.GetSocketPath());
+	wait_for_clients(multiplexer, 2);
+
+	std::set<std::string> expected;
+	std::thread sender_b([&b]
+	{
+		for (int i = 0; i < kNumFrames; ++i)
+		{
+			// Sent in two pieces to check that partial frames are held back
+			const auto frame = "B:" + std::to_string(i) + ":the quick brown fox\n";
+			b.Send(frame.substr(0, 5));
+			b.Send(frame.substr(5));
+		}
+	});
+	for (int i = 0; i < kNumFrames; ++i)
+	{
+		const auto frame_a = "A:" + std::to_string(i) + ":jumps over the lazy dog\n";
+		a.Send(frame_a);
+		expected.insert(frame_a);
+		expected.insert("B:" + std::to_string(i) + ":the quick brown fox\n");
+	}
+	sender_b.join();
+
+	std::size_t num_bytes = 0;
+	for (const auto& frame : expected)
+	{
+		num_bytes += frame.size();
+	}
+	const auto received = pty.Read(num_bytes);
+	ASSERT_EQ(received.size(), num_bytes);
+
+	std::set<std::string> frames;
+	std::size_t start = 0;
+	for (auto end = received.find('\n'); end != std::string::npos; end = received.find('\n', start))
+	{
+		frames.insert(received.substr(start, end + 1 - start));
+		start = end + 1;
+	}
+	EXPECT_EQ(frames, expected);
+	// The last frame is counted right after it has been written
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+	while (multiplexer.GetStats().tx_frames != 2 * kNumFrames && std::chrono::steady_clock::now() < deadline)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	EXPECT_EQ(multiplexer.GetStats().tx_frames, 2 * kNumFrames);
+}
+
+// Test that a client that does not read is disconnected without holding up the others
+TEST(MultiplexerTests, DisconnectSlowClient)
+{
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+	MultiplexerOptions options;
+	options.max_client_buffer = 16384;
+	Multiplexer multiplexer(port, make_socket_path("disconnect"), options);
+
+	Client fast(multiplexer.GetSocketPath());
+	Client slow(multiplexer.GetSocketPath());
+	wait_for_clients(multiplexer, 2);
+
+	// More than the socket buffers of the slow client can hold
+	const auto stream = make_stream(2 << 20);
+	std::thread writer([&pty, &stream] { write_paced(pty, stream); });
+	EXPECT_EQ(fast.Receive(stream.size()), stream);
+	writer.join();
+
+	const auto stats = multiplexer.GetStats();
+	EXPECT_EQ(stats.slow_clients_disconnected, 1);
+	EXPECT_EQ(stats.num_clients, 1);
+}
+
+// Test that a slow client keeps receiving the newest data when old data is dropped
+TEST(MultiplexerTests, DropOldest)
+{
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+	MultiplexerOptions options;
+	options.max_client_buffer = 16384;
+	options.slow_client_policy = SlowClientPolicy::kDropOldest;
+	Multiplexer multiplexer(port, make_socket_path("drop_oldest"), options);
+
+	Client fast(multiplexer.GetSocketPath());
+	Client slow(multiplexer.GetSocketPath());
+	wait_for_clients(multiplexer, 2);
+
+	// More than the socket buffers of the slow client can hold
+	const auto stream = make_stream(2 << 20);
+	std::thread writer([&pty, &stream] { write_paced(pty, stream); });
+	EXPECT_EQ(fast.Receive(stream.size()), stream);
+	writer.join();
+
+	// The slow client gets the beginning (stuck in the socket) and the end of the stream
+	const auto received = slow.Receive(stream.size(), std::chrono::milliseconds(200));
+	const auto stats = multiplexer.GetStats();
+	EXPECT_EQ(stats.num_clients, 2);
+	EXPECT_EQ(received.size() + stats.rx_bytes_dropped, stream.size());
+	EXPECT_EQ(received.substr(received.size() - 1000), stream.substr(stream.size() - 1000));
+}
+
+#endif // __linux__
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "serial_port/link_emulator.h"
+#include "serial_port/priority_writer.h"
+#include "pty_pair.h"
+
+using namespace serial_port;
+
+// Test that urgent frames overtake a bulk transfer within a bounded latency, without splitting frames
+TEST(PriorityWriterTests, UrgentPreemptsBulk)
+{
+	constexpr int kBaudRate = 460800;
+	constexpr std::size_t kBulkFrameSize = 512;
+	constexpr int kNumBulkFrames = 40;
+	constexpr int kNumUrgentFrames = 10;
+
+	LinkEmulator link;
+	SerialPort tx(link.PortNameA(), kBaudRate);
+	SerialPort rx(link.PortNameB(), kBaudRate);
+	tx.Open();
+	rx.Open();
+
+	// Receive everything, noting when each urgent frame arrived
+	std::string received;
+	std::vector<std::chrono::steady_clock::time_point> urgent_arrivals;
+	std::thread receiver([&]
+	{
+		char buffer[4096];
+		while (true)
+		{
+			const auto result = rx.TryReadData(buffer, sizeof(buffer), std::chrono::milliseconds(300));
+			if (!result)
+			{
+				break;
+			}
+			const auto now = std::chrono::steady_clock::now();
+			received.append(buffer, *result);
+			urgent_arrivals.insert(urgent_arrivals.end(), std::count(buffer, buffer + *result, 'U'), now);
+		}
+	});
+
+	PriorityWriterOptions options;
+	options.max_queued_bytes = 64;
+	options.estimate_queue = true;
+	PriorityWriter writer(tx, options);
+
+	// About 450 ms of bulk data
+	const auto bulk_frame = "[" + std::string(kBulkFrameSize - 2, '.') + "]";
+	for (int i = 0; i < kNumBulkFrames; ++i)
+	{
+		ASSERT_TRUE(writer.Send(bulk_frame, TxPriority::kBulk));
+	}
+	std::vector<std::chrono::steady_clock::time_point> urgent_sent;
+	for (int i = 0; i < kNumUrgentFrames; ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(25));
+		urgent_sent.push_back(std::chrono::steady_clock::now());
+		ASSERT_TRUE(writer.Send(std::string("U") + static_cast<char>('0' + i), TxPriority::kUrgent));
+	}
+	EXPECT_TRUE(writer.WaitUntilSent(std::chrono::seconds(2)));
+	receiver.join();
+
+	ASSERT_EQ(received.size(), kNumBulkFrames * kBulkFrameSize + kNumUrgentFrames * 2);
+	ASSERT_EQ(urgent_arrivals.size(), kNumUrgentFrames);
+
+	// Frames are whole and in order within their priority
+	std::size_t num_bulk_frames = 0;
+	int next_urgent = 0;
+	for (std::size_t i = 0; i < received.size();)
+	{
+		if (received[i] == 'U')
+		{
+			EXPECT_EQ(received[i + 1], '0' + next_urgent++);
+			i += 2;
+			continue;
+		}
+		ASSERT_EQ(received.compare(i, kBulkFrameSize, bulk_frame), 0) << "at " << i;
+		++num_bulk_frames;
+		i += kBulkFrameSize;
+	}
+	EXPECT_EQ(num_bulk_frames, kNumBulkFrames);
+	EXPECT_EQ(next_urgent, kNumUrgentFrames);
+
+	// Worst case: the rest of a bulk frame, the output queue and the urgent frame itself
+	const auto character_time = CharacterTime(kBaudRate);
+	const auto bound = character_time * static_cast<long>(kBulkFrameSize + options.max_queued_bytes + 2) + std::chrono::milliseconds(5);
+	std::chrono::nanoseconds worst{ 0 };
+	for (int i = 0; i < kNumUrgentFrames; ++i)
+	{
+		worst = std::max(worst, std::chrono::duration_cast<std::chrono::nanoseconds>(urgent_arrivals[i] - urgent_sent[i]));
+	}
+	const auto urgent_stats = writer.GetStats(TxPriority::kUrgent);
+	std::cout << "Urgent: " << urgent_stats << std::endl << "Bulk: " << writer.GetStats(TxPriority::kBulk) << std::endl
+		<< "Worst-case urgent latency on the wire: " << std::chrono::duration<double, std::milli>(worst).count()
+		<< " ms (bound " << std::chrono::duration<double, std::milli>(bound).count() << " ms)" << std::endl;
+	EXPECT_LT(worst, bound);
+	EXPECT_EQ(urgent_stats.num_frames, kNumUrgentFrames);
+	EXPECT_LT(urgent_stats.latency.max, bound);
+}
+
+// Test that frames are rejected once a priority's queue is full
+TEST(PriorityWriterTests, QueueLimit)
+{
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 9600);
+	port.Open();
+
+	PriorityWriterOptions options;
+	options.estimate_queue = true;
+	options.max_pending_bytes = 1000;
+	PriorityWriter writer(port, options);
+
+	int num_accepted = 0;
+	for (int i = 0; i < 5; ++i)
+	{
+		num_accepted += writer.Send(std::string(400, 'n')) ? 1 : 0;
+	}
+	EXPECT_GE(num_accepted, 2);
+	EXPECT_LE(num_accepted, 3);
+	EXPECT_EQ(writer.GetStats(TxPriority::kNormal).num_rejected, 5 - num_accepted);
+	EXPECT_LE(writer.NumPendingBytes(TxPriority::kNormal), options.max_pending_bytes);
+
+	// Other priorities have their own queues
+	EXPECT_TRUE(writer.Send("urgent", TxPriority::kUrgent));
+	EXPECT_FALSE(writer.WaitUntilSent(std::chrono::milliseconds(10)));
+}
+
+#endif // __linux__
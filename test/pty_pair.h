@@ -0,0 +1,154 @@
+#ifndef PTY_PAIR_H
+#define PTY_PAIR_H
+
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+// A pseudo terminal pair for testing without physical or socat-emulated ports.
+// Open a SerialPort on SlaveName() and talk to it through the master file descriptor.
+class PtyPair
+{
+public:
+	PtyPair()
+	{
+		master_ = posix_openpt(O_RDWR | O_NOCTTY);
+		if (master_ < 0 || grantpt(master_) != 0 || unlockpt(master_) != 0)
+		{
+			throw std::runtime_error("Could not create pseudo terminal.");
+		}
+		slave_name_ = ptsname(master_);
+
+		// Make the slave raw until a SerialPort configures it
+		termios tty{};
+		tcgetattr(master_, &tty);
+		cfmakeraw(&tty);
+		tcsetattr(master_, TCSANOW, &tty);
+	}
+	~PtyPair() { close(master_); }
+
+	PtyPair(const PtyPair&) = delete;
+	PtyPair& operator=(const PtyPair&) = delete;
+
+	[[nodiscard]] int Master() const { return master_; }
+	[[nodiscard]] const std::string& SlaveName() const { return slave_name_; }
+
+	// Write all bytes to the master side
+	void Write(const std::string& data) const
+	{
+		std::size_t written = 0;
+		while (written < data.size())
+		{
+			const auto result = write(master_, data.data() + written, data.size() - written);
+			if (result < 0)
+			{
+				throw std::runtime_error("Could not write to pseudo terminal.");
+			}
+			written += static_cast<std::size_t>(result);
+		}
+	}
+
+	// Read up to num_bytes from the master side, waiting at most timeout for each chunk
+	[[nodiscard]] std::string Read(const std::size_t num_bytes,
+		const std::chrono::milliseconds timeout = std::chrono::milliseconds(1000)) const
+	{
+		std::string data(num_bytes, '\0');
+		std::size_t received = 0;
+		while (received < num_bytes)
+		{
+			pollfd pfd{ master_, POLLIN, 0 };
+			if (poll(&pfd, 1, static_cast<int>(timeout.count())) <= 0)
+			{
+				break;
+			}
+			const auto result = read(master_, data.data() + received, num_bytes - received);
+			if (result <= 0)
+			{
+				break;
+			}
+			received += static_cast<std::size_t>(result);
+		}
+		data.resize(received);
+		return data;
+	}
+
+private:
+	int master_{ -1 };
+	std::string slave_name_;
+};
+
+// Two pseudo terminals whose master sides are connected by a relay thread, like a null modem cable.
+// Open one SerialPort on PortNameA() and another one on PortNameB().
+class NullModem
+{
+public:
+	// Called on the relay thread with every chunk of data sent from A to B, e.g. to damage it
+	using Filter = std::function<void(std::string& data)>;
+
+	explicit NullModem(Filter a_to_b = {}) : a_to_b_(std::move(a_to_b)), thread_([this] { Run(); }) {}
+	~NullModem()
+	{
+		running_ = false;
+		thread_.join();
+	}
+
+	[[nodiscard]] const std::string& PortNameA() const { return a_.SlaveName(); }
+	[[nodiscard]] const std::string& PortNameB() const { return b_.SlaveName(); }
+
+private:
+	void Run() const
+	{
+		char buffer[4096];
+		while (running_)
+		{
+			pollfd pfds[2]{ { a_.Master(), POLLIN, 0 }, { b_.Master(), POLLIN, 0 } };
+			if (poll(pfds, 2, 10) <= 0)
+			{
+				continue;
+			}
+			for (int i = 0; i < 2; ++i)
+			{
+				// A hung up side (no port open) reports POLLHUP without data
+				if ((pfds[i].revents & POLLIN) == 0)
+				{
+					continue;
+				}
+				const auto num_bytes = read(pfds[i].fd, buffer, sizeof(buffer));
+				if (num_bytes > 0)
+				{
+					std::string data(buffer, static_cast<std::size_t>(num_bytes));
+					if (i == 0 && a_to_b_)
+					{
+						a_to_b_(data);
+					}
+					(i == 0 ? b_ : a_).Write(data);
+				}
+			}
+			if (((pfds[0].revents | pfds[1].revents) & POLLIN) == 0)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+	}
+
+	PtyPair a_;
+	PtyPair b_;
+	Filter a_to_b_;
+	std::atomic<bool> running_{ true };
+	std::thread thread_;
+};
+
+#endif // __linux__
+
+#endif // PTY_PAIR_H
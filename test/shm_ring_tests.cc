@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+
+#if defined(__linux__)
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <thread>
+
+#include "serial_port/shm_ring.h"
+#include "pty_pair.h"
+
+using namespace serial_port;
+
+namespace
+{
+	std::string make_ring_name(const std::string& name)
+	{
+		return "/serial_port_ring_" + std::to_string(getpid()) + "_" + name;
+	}
+
+	std::string make_stream(const std::size_t num_bytes)
+	{
+		std::string stream(num_bytes, '\0');
+		for (std::size_t i = 0; i < num_bytes; ++i)
+		{
+			stream[i] = static_cast<char>(i * 7 + i / 251);
+		}
+		return stream;
+	}
+
+	// Collect num_bytes from a subscriber. Returns less on an overrun or timeout.
+	std::string collect(ShmRingSubscriber& subscriber, const std::size_t num_bytes)
+	{
+		std::string received;
+		ShmChunk chunk;
+		while (received.size() < num_bytes && subscriber.Next(chunk, std::chrono::milliseconds(1000)) == ShmReadStatus::kOk)
+		{
+			received.append(chunk.data);
+			if (!subscriber.IsValid(chunk))
+			{
+				break;
+			}
+		}
+		return received;
+	}
+}
+
+// Test that a subscriber in this process and one in a child process both receive the whole stream
+TEST(ShmRingTests, FanOut)
+{
+	const auto stream = make_stream(4 << 20);
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+	// The name contains the pid, so it must be made before forking
+	const auto name = make_ring_name("fan_out");
+	ShmRingPublisher publisher(port, name);
+
+	int ready[2];
+	ASSERT_EQ(pipe(ready), 0);
+	const auto child = fork();
+	ASSERT_GE(child, 0);
+	if (child == 0)
+	{
+		try
+		{
+			ShmRingSubscriber subscriber(name);
+			(void)write(ready[1], "x", 1);
+			const auto received = collect(subscriber, stream.size());
+			_exit(received == stream && subscriber.NumOverruns() == 0 ? 0 : 1);
+		}
+		catch (...)
+		{
+			_exit(2);
+		}
+	}
+	char c;
+	ASSERT_EQ(read(ready[0], &c, 1), 1);
+	close(ready[0]);
+	close(ready[1]);
+
+	ShmRingSubscriber subscriber(name);
+	std::string received;
+	std::thread reader([&subscriber, &received, &stream] { received = collect(subscriber, stream.size()); });
+	pty.Write(stream);
+	reader.join();
+
+	int status = 0;
+	ASSERT_EQ(waitpid(child, &status, 0), child);
+	EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	EXPECT_TRUE(received == stream);
+	EXPECT_EQ(subscriber.NumOverruns(), 0);
+	EXPECT_EQ(subscriber.NumLostChunks(), 0);
+	EXPECT_EQ(subscriber.Lag(), 0);
+	EXPECT_EQ(publisher.NumBytes(), stream.size());
+	std::cout << publisher.NumChunks() << " chunks published" << std::endl;
+}
+
+// Test that a subscriber that does not keep up notices the overrun and continues with new data
+TEST(ShmRingTests, Overrun)
+{
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+	ShmRingOptions options;
+	options.capacity = 64 * 1024;
+	options.max_chunk = 4096;
+	ShmRingPublisher publisher(port, make_ring_name("overrun"), options);
+	ShmRingSubscriber subscriber(make_ring_name("overrun"));
+
+	ShmChunk chunk;
+	EXPECT_EQ(subscriber.Next(chunk), ShmReadStatus::kEmpty);
+	pty.Write("first");
+	ASSERT_EQ(subscriber.Next(chunk, std::chrono::milliseconds(1000)), ShmReadStatus::kOk);
+	EXPECT_EQ(chunk.data, "first");
+	const auto first = chunk;
+
+	// Publish much more than the capacity without reading
+	const auto stream = make_stream(1 << 20);
+	pty.Write(stream);
+	while (publisher.NumBytes() < stream.size() + 5)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	EXPECT_FALSE(subscriber.IsValid(first));
+	EXPECT_GT(subscriber.Lag(), options.capacity);
+	EXPECT_EQ(subscriber.Next(chunk), ShmReadStatus::kOverrun);
+	EXPECT_EQ(subscriber.NumOverruns(), 1);
+
+	pty.Write("again");
+	ASSERT_EQ(subscriber.Next(chunk, std::chrono::milliseconds(1000)), ShmReadStatus::kOk);
+	EXPECT_EQ(chunk.data, "again");
+	EXPECT_TRUE(subscriber.IsValid(chunk));
+	EXPECT_GT(subscriber.NumLostChunks(), 0);
+}
+
+// Test that subscribers learn when the publisher goes away
+TEST(ShmRingTests, Closed)
+{
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+	auto publisher = std::make_unique<ShmRingPublisher>(port, make_ring_name("closed"));
+	ShmRingSubscriber subscriber(make_ring_name("closed"));
+	EXPECT_THROW(ShmRingSubscriber(make_ring_name("missing")), IoException);
+
+	std::thread closer([&publisher]
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		publisher.reset();
+	});
+	ShmChunk chunk;
+	EXPECT_EQ(subscriber.Next(chunk, std::chrono::milliseconds(-1)), ShmReadStatus::kClosed);
+	closer.join();
+}
+
+#endif // __linux__
@@ -0,0 +1,464 @@
+// Soak and stress test: many ports, each with several concurrent writers in both directions.
+//
+// Every port is a pseudo terminal. The SerialPort side and the master (peer) side each have a number of
+// writer threads that send frames with a stream id, a sequence number, a send timestamp and a CRC-32,
+// and one reader thread that checks them. The test reports aggregate throughput, how evenly the ports
+// were served and the latency distribution, and fails on any corrupted, lost or reordered frame.
+//
+// Usage: serial_port_stress [--ports N] [--writers M] [--duration SECONDS] [--max-payload BYTES] [--busy-poll MICROSECONDS]
+
+#if defined(__linux__)
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "serial_port/serial_port.h"
+#include "src/checksum.h"
+#include "pty_pair.h"
+
+using namespace serial_port;
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	constexpr std::uint8_t kMagic = 0xA5;
+	// Magic, stream id, payload length, sequence number and send timestamp
+	constexpr std::size_t kHeaderSize = 16;
+	constexpr std::size_t kCrcSize = 4;
+
+	struct Options
+	{
+		std::size_t num_ports{ 8 };
+		std::size_t num_writers{ 2 };
+		double duration_s{ 5.0 };
+		std::size_t max_payload{ 256 };
+		// Spin budget of the SerialPort readers (0: blocking reads)
+		std::chrono::microseconds busy_poll{ 0 };
+	};
+
+	std::uint64_t now_ns()
+	{
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+	}
+
+	void make_frame(std::vector<char>& frame, const std::uint8_t stream, const std::uint32_t sequence, const std::uint16_t length)
+	{
+		frame.resize(kHeaderSize + length + kCrcSize);
+		const auto timestamp = now_ns();
+		frame[0] = static_cast<char>(kMagic);
+		frame[1] = static_cast<char>(stream);
+		std::memcpy(&frame[2], &length, sizeof(length));
+		std::memcpy(&frame[4], &sequence, sizeof(sequence));
+		std::memcpy(&frame[8], &timestamp, sizeof(timestamp));
+		for (std::size_t i = 0; i < length; ++i)
+		{
+			frame[kHeaderSize + i] = static_cast<char>(sequence * 31 + i);
+		}
+		const auto crc = checksum::Crc32(frame.data(), kHeaderSize + length);
+		std::memcpy(&frame[kHeaderSize + length], &crc, sizeof(crc));
+	}
+
+	// Parses and verifies the frames of one direction of one port
+	class FrameChecker
+	{
+	public:
+		FrameChecker(const std::size_t num_streams, const std::size_t max_payload)
+			: expected_(num_streams, 0), max_payload_(max_payload)
+		{
+		}
+
+		void Consume(const char* data, const std::size_t num_bytes)
+		{
+			buffer_.append(data, num_bytes);
+			const auto received = now_ns();
+			std::size_t pos = 0;
+			while (buffer_.size() - pos >= kHeaderSize)
+			{
+				if (static_cast<std::uint8_t>(buffer_[pos]) != kMagic)
+				{
+					++num_resync_bytes;
+					++pos;
+					continue;
+				}
+				std::uint16_t length;
+				std::memcpy(&length, &buffer_[pos + 2], sizeof(length));
+				const auto stream = static_cast<std::uint8_t>(buffer_[pos + 1]);
+				if (length > max_payload_ || stream >= expected_.size())
+				{
+					++num_resync_bytes;
+					++pos;
+					continue;
+				}
+				const auto frame_size = kHeaderSize + length + kCrcSize;
+				if (buffer_.size() - pos < frame_size)
+				{
+					break;
+				}
+
+				std::uint32_t crc;
+				std::memcpy(&crc, &buffer_[pos + kHeaderSize + length], sizeof(crc));
+				if (checksum::Crc32(&buffer_[pos], kHeaderSize + length) != crc)
+				{
+					++num_crc_errors;
+					++pos;
+					continue;
+				}
+
+				std::uint32_t sequence;
+				std::uint64_t timestamp;
+				std::memcpy(&sequence, &buffer_[pos + 4], sizeof(sequence));
+				std::memcpy(&timestamp, &buffer_[pos + 8], sizeof(timestamp));
+				if (sequence != expected_[stream])
+				{
+					++num_sequence_errors;
+				}
+				expected_[stream] = sequence + 1;
+				++num_frames;
+				num_bytes_ += frame_size;
+				latencies_us.push_back(static_cast<std::uint32_t>((received - timestamp) / 1000));
+				pos += frame_size;
+			}
+			buffer_.erase(0, pos);
+		}
+
+		[[nodiscard]] std::uint64_t NumBytes() const { return num_bytes_; }
+
+		std::uint64_t num_frames{ 0 };
+		std::uint64_t num_crc_errors{ 0 };
+		std::uint64_t num_sequence_errors{ 0 };
+		std::uint64_t num_resync_bytes{ 0 };
+		std::vector<std::uint32_t> latencies_us;
+
+	private:
+		std::string buffer_;
+		std::vector<std::uint32_t> expected_;
+		std::size_t max_payload_;
+		std::uint64_t num_bytes_{ 0 };
+	};
+
+	// One pseudo terminal with a SerialPort on its slave side
+	struct PortUnderTest
+	{
+		explicit PortUnderTest(const Options& options)
+			: port(pty.SlaveName(), 921600), to_peer(options.num_writers, options.max_payload),
+			to_port(options.num_writers, options.max_payload)
+		{
+			port.Open();
+			port.SetBusyPoll(options.busy_poll);
+		}
+
+		PtyPair pty;
+		SerialPort port;
+		// Writers of one side share the side's lock, so that frames are not interleaved
+		std::mutex port_write_mutex;
+		std::mutex peer_write_mutex;
+		std::atomic<std::uint64_t> frames_to_peer{ 0 };
+		std::atomic<std::uint64_t> frames_to_port{ 0 };
+		FrameChecker to_peer;
+		FrameChecker to_port;
+	};
+
+	void write_to_fd(const int fd, const char* data, std::size_t num_bytes)
+	{
+		while (num_bytes > 0)
+		{
+			const auto result = write(fd, data, num_bytes);
+			if (result < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (result <= 0)
+			{
+				throw IoException("Could not write to pseudo terminal: " + std::string(strerror(errno)));
+			}
+			data += result;
+			num_bytes -= static_cast<std::size_t>(result);
+		}
+	}
+
+	void run_writer(PortUnderTest& unit, const bool from_port, const std::uint8_t stream, const std::size_t max_payload,
+		const std::atomic<bool>& stop, const std::uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_int_distribution<std::size_t> payload_size(1, max_payload);
+		std::vector<char> frame;
+		for (std::uint32_t sequence = 0; !stop; ++sequence)
+		{
+			make_frame(frame, stream, sequence, static_cast<std::uint16_t>(payload_size(random)));
+			if (from_port)
+			{
+				const std::lock_guard<std::mutex> lock(unit.port_write_mutex);
+				unit.port.Write<Endian::kNative>(frame.data(), frame.size());
+				++unit.frames_to_peer;
+			}
+			else
+			{
+				const std::lock_guard<std::mutex> lock(unit.peer_write_mutex);
+				write_to_fd(unit.pty.Master(), frame.data(), frame.size());
+				++unit.frames_to_port;
+			}
+		}
+	}
+
+	// A reader finishes when all frames that were sent have arrived, or when nothing arrives any more
+	constexpr auto kIdleTimeout = std::chrono::milliseconds(1000);
+
+	void run_port_reader(PortUnderTest& unit, const std::atomic<bool>& writers_done)
+	{
+		std::vector<char> buffer(65536);
+		auto last_data = Clock::now();
+		while (!writers_done || unit.to_port.num_frames + unit.to_port.num_crc_errors < unit.frames_to_port)
+		{
+			if (!unit.port.WaitForData(std::chrono::milliseconds(50)))
+			{
+				if (writers_done && Clock::now() - last_data > kIdleTimeout)
+				{
+					break;
+				}
+				continue;
+			}
+			const auto num_bytes = unit.port.ReadData(buffer.data(), static_cast<unsigned long>(buffer.size()));
+			if (num_bytes > buffer.size())
+			{
+				throw IoException("Could not read from port: " + std::string(strerror(errno)));
+			}
+			unit.to_port.Consume(buffer.data(), num_bytes);
+			last_data = Clock::now();
+		}
+	}
+
+	void run_peer_reader(PortUnderTest& unit, const std::atomic<bool>& writers_done)
+	{
+		std::vector<char> buffer(65536);
+		auto last_data = Clock::now();
+		while (!writers_done || unit.to_peer.num_frames + unit.to_peer.num_crc_errors < unit.frames_to_peer)
+		{
+			pollfd pfd{ unit.pty.Master(), POLLIN, 0 };
+			if (poll(&pfd, 1, 50) <= 0)
+			{
+				if (writers_done && Clock::now() - last_data > kIdleTimeout)
+				{
+					break;
+				}
+				continue;
+			}
+			const auto num_bytes = read(unit.pty.Master(), buffer.data(), buffer.size());
+			if (num_bytes > 0)
+			{
+				unit.to_peer.Consume(buffer.data(), static_cast<std::size_t>(num_bytes));
+				last_data = Clock::now();
+			}
+		}
+	}
+
+	std::uint32_t percentile(std::vector<std::uint32_t>& values, const double fraction)
+	{
+		if (values.empty())
+		{
+			return 0;
+		}
+		const auto index = std::min(values.size() - 1, static_cast<std::size_t>(fraction * static_cast<double>(values.size())));
+		std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index), values.end());
+		return values[index];
+	}
+
+	Options parse_options(const int argc, char** argv)
+	{
+		Options options;
+		for (int i = 1; i + 1 < argc; i += 2)
+		{
+			const std::string name = argv[i];
+			const std::string value = argv[i + 1];
+			if (name == "--ports")
+			{
+				options.num_ports = std::stoul(value);
+			}
+			else if (name == "--writers")
+			{
+				options.num_writers = std::stoul(value);
+			}
+			else if (name == "--duration")
+			{
+				options.duration_s = std::stod(value);
+			}
+			else if (name == "--max-payload")
+			{
+				options.max_payload = std::stoul(value);
+			}
+			else if (name == "--busy-poll")
+			{
+				options.busy_poll = std::chrono::microseconds(std::stoul(value));
+			}
+			else
+			{
+				throw std::invalid_argument("Unknown option " + name);
+			}
+		}
+		if (options.num_ports == 0 || options.num_writers == 0 || options.num_writers > 255
+			|| options.max_payload == 0 || options.max_payload > 65535)
+		{
+			throw std::invalid_argument("Invalid options");
+		}
+		return options;
+	}
+}
+
+int main(const int argc, char** argv)
+{
+	Options options;
+	try
+	{
+		options = parse_options(argc, argv);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl
+			<< "Usage: " << argv[0] << " [--ports N] [--writers M] [--duration SECONDS] [--max-payload BYTES] [--busy-poll MICROSECONDS]" << std::endl;
+		return 2;
+	}
+
+	std::cout << options.num_ports << " ports, " << options.num_writers << " writers per port and direction, "
+		<< options.duration_s << " s, payloads of up to " << options.max_payload << " bytes" << std::endl;
+
+	std::vector<std::unique_ptr<PortUnderTest>> units;
+	for (std::size_t i = 0; i < options.num_ports; ++i)
+	{
+		units.push_back(std::make_unique<PortUnderTest>(options));
+	}
+
+	std::atomic<bool> stop{ false };
+	std::atomic<bool> writers_done{ false };
+	std::atomic<std::uint64_t> num_failures{ 0 };
+	const auto guarded = [&num_failures](auto&& function)
+	{
+		return [&num_failures, function]
+		{
+			try
+			{
+				function();
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << "Thread failed: " << e.what() << std::endl;
+				++num_failures;
+			}
+		};
+	};
+
+	const auto started = Clock::now();
+	std::vector<std::thread> readers;
+	std::vector<std::thread> writers;
+	for (std::size_t i = 0; i < units.size(); ++i)
+	{
+		auto& unit = *units[i];
+		readers.emplace_back(guarded([&unit, &writers_done] { run_port_reader(unit, writers_done); }));
+		readers.emplace_back(guarded([&unit, &writers_done] { run_peer_reader(unit, writers_done); }));
+		for (std::size_t w = 0; w < options.num_writers; ++w)
+		{
+			const auto stream = static_cast<std::uint8_t>(w);
+			const auto seed = static_cast<std::uint32_t>(i * 512 + w * 2);
+			writers.emplace_back(guarded([&unit, &stop, &options, stream, seed]
+			{
+				run_writer(unit, true, stream, options.max_payload, stop, seed);
+			}));
+			writers.emplace_back(guarded([&unit, &stop, &options, stream, seed]
+			{
+				run_writer(unit, false, stream, options.max_payload, stop, seed + 1);
+			}));
+		}
+	}
+
+	std::this_thread::sleep_for(std::chrono::duration<double>(options.duration_s));
+	stop = true;
+	for (auto& writer : writers)
+	{
+		writer.join();
+	}
+	writers_done = true;
+	for (auto& reader : readers)
+	{
+		reader.join();
+	}
+	const auto elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+
+	std::uint64_t num_frames = 0;
+	std::uint64_t num_bytes = 0;
+	std::uint64_t num_lost = 0;
+	std::uint64_t num_crc_errors = 0;
+	std::uint64_t num_sequence_errors = 0;
+	std::uint64_t num_resync_bytes = 0;
+	std::vector<double> port_throughputs;
+	std::vector<std::uint32_t> latencies_us;
+	for (const auto& unit : units)
+	{
+		for (const auto* checker : { &unit->to_peer, &unit->to_port })
+		{
+			num_frames += checker->num_frames;
+			num_bytes += checker->NumBytes();
+			num_crc_errors += checker->num_crc_errors;
+			num_sequence_errors += checker->num_sequence_errors;
+			num_resync_bytes += checker->num_resync_bytes;
+			latencies_us.insert(latencies_us.end(), checker->latencies_us.begin(), checker->latencies_us.end());
+		}
+		const auto sent = unit->frames_to_peer + unit->frames_to_port;
+		const auto received = unit->to_peer.num_frames + unit->to_port.num_frames;
+		num_lost += sent > received ? sent - received : 0;
+		port_throughputs.push_back(static_cast<double>(unit->to_peer.NumBytes() + unit->to_port.NumBytes()) / elapsed);
+	}
+
+	// Jain's fairness index: 1 if all ports got the same throughput, 1/n if a single port got everything
+	double sum = 0.0;
+	double sum_of_squares = 0.0;
+	for (const auto throughput : port_throughputs)
+	{
+		sum += throughput;
+		sum_of_squares += throughput * throughput;
+	}
+	const auto fairness = sum_of_squares == 0.0 ? 0.0 : sum * sum / (static_cast<double>(port_throughputs.size()) * sum_of_squares);
+	const auto [min_throughput, max_throughput] = std::minmax_element(port_throughputs.begin(), port_throughputs.end());
+
+	std::cout
+		<< "Frames: " << num_frames << ", " << static_cast<double>(num_bytes) / 1e6 << " MB in " << elapsed << " s: "
+		<< static_cast<double>(num_bytes) / elapsed / 1e6 << " MB/s, " << static_cast<double>(num_frames) / elapsed << " frames/s" << std::endl
+		<< "Per port: " << *min_throughput / 1e6 << " to " << *max_throughput / 1e6 << " MB/s, fairness index " << fairness << std::endl
+		<< "Latency [us]: p50 " << percentile(latencies_us, 0.5) << ", p99 " << percentile(latencies_us, 0.99)
+		<< ", p99.9 " << percentile(latencies_us, 0.999) << ", max " << percentile(latencies_us, 1.0) << std::endl
+		<< "Errors: " << num_lost << " lost, " << num_crc_errors << " CRC, " << num_sequence_errors << " sequence, "
+		<< num_resync_bytes << " bytes skipped, " << num_failures << " failed threads" << std::endl;
+	if (options.busy_poll.count() > 0)
+	{
+		std::cout << "Busy poll of the first port: " << units.front()->port.GetBusyPollStats() << std::endl;
+	}
+
+	const bool passed = num_frames > 0 && num_lost == 0 && num_crc_errors == 0 && num_sequence_errors == 0
+		&& num_resync_bytes == 0 && num_failures == 0;
+	std::cout << (passed ? "PASSED" : "FAILED") << std::endl;
+	return passed ? 0 : 1;
+}
+
+#else
+
+#include <iostream>
+
+int main()
+{
+	std::cout << "The stress test uses pseudo terminals and only runs on Linux." << std::endl;
+	return 0;
+}
+
+#endif // __linux__
@@ -3,9 +3,13 @@
 #include <cstring>
 #include <iostream>
 #include <chrono>
+#include <memory_resource>
+#include <sstream>
 #include <thread>
 
 #include "serial_port/serial_port.h"
+#include "serial_port/modem_monitor.h"
+#include "pty_pair.h"
 
 #if defined (__linux__)
 #define output_port_name "/dev/pts/0"
@@ -166,3 +170,523 @@ TEST(SerialPortTests, Enumerate)
 
 	// No way to check automatically if port names are correct or complete. But at least it is not throwing an error if this passes.
 }
+
+#if defined (__linux__)
+// Test reading a burst of lines with a single call
+TEST(SerialPortTests, ReadLines)
+{
+	PtyPair pty;
+	serial_port::SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+
+	std::string burst;
+	for (int i = 0; i < 100; ++i)
+	{
+		burst += "line " + std::to_string(i) + "\n";
+	}
+	pty.Write(burst + "partial");
+	ASSERT_TRUE(port.WaitForData(std::chrono::milliseconds(1000)));
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+	std::vector<std::string> lines(200, std::string(64, 'x'));
+	EXPECT_EQ(port.ReadLines(lines, 60), 60);
+	// The surplus strings are kept for later bursts
+	EXPECT_EQ(lines.size(), 200);
+	EXPECT_TRUE(lines[60].empty());
+	EXPECT_GE(lines[60].capacity(), 64);
+	EXPECT_EQ(lines.front(), "line 0\n");
+	EXPECT_EQ(lines[59], "line 59\n");
+
+	// The remaining lines are served from the internal buffer
+	const auto& views = port.ReadLineViews();
+	ASSERT_EQ(views.size(), 40);
+	EXPECT_EQ(views.front(), "line 60\n");
+	EXPECT_EQ(views.back(), "line 99\n");
+	EXPECT_EQ(port.NumBytesAvailable(), 7);
+
+	// The incomplete line is completed by subsequent data
+	pty.Write(" line\nrest");
+	ASSERT_TRUE(port.WaitForData(std::chrono::milliseconds(1000)));
+	EXPECT_EQ(port.ReadString(), "partial line\n");
+	char rest[4];
+	EXPECT_EQ(port.ReadData(rest, 4), 4);
+	EXPECT_EQ(std::string(rest, 4), "rest");
+	EXPECT_TRUE(port.ReadLineViews().empty());
+
+	// Reopening discards what was read ahead
+	pty.Write("old\nstale");
+	EXPECT_EQ(port.ReadString(), "old\n");
+	port.Close();
+	port.Open();
+	EXPECT_EQ(port.NumBytesAvailable(), 0);
+}
+
+// Test that reading a line fails instead of hanging when the device disconnects
+TEST(SerialPortTests, ReadStringHangUp)
+{
+	auto pty = std::make_unique<PtyPair>();
+	serial_port::SerialPort port(pty->SlaveName(), 115200);
+	port.Open();
+	pty->Write("incomplete");
+	ASSERT_TRUE(port.WaitForData(std::chrono::milliseconds(1000)));
+	pty.reset();
+	EXPECT_THROW((void)port.ReadString(), serial_port::IoException);
+
+	// A hang-up does not look like a timeout
+	pty = std::make_unique<PtyPair>();
+	serial_port::SerialPort other_port(pty->SlaveName(), 115200);
+	other_port.Open();
+	pty.reset();
+	const auto start = std::chrono::steady_clock::now();
+	EXPECT_TRUE(other_port.WaitForData(std::chrono::hours(24 * 365)));
+	EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(1000));
+}
+
+// A memory resource that counts the allocations it forwards to its upstream resource
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+	explicit CountingResource(std::pmr::memory_resource* upstream) : upstream_(upstream) {}
+	[[nodiscard]] unsigned long NumAllocations() const { return num_allocations_; }
+
+private:
+	void* do_allocate(const std::size_t bytes, const std::size_t alignment) override
+	{
+		++num_allocations_;
+		return upstream_->allocate(bytes, alignment);
+	}
+	void do_deallocate(void* p, const std::size_t bytes, const std::size_t alignment) override
+	{
+		upstream_->deallocate(p, bytes, alignment);
+	}
+	[[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+
+	std::pmr::memory_resource* upstream_;
+	unsigned long num_allocations_{ 0 };
+};
+
+// Test that reading lines in steady state does not allocate
+TEST(SerialPortTests, ReadWithoutAllocations)
+{
+	PtyPair pty;
+	serial_port::SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+
+	std::pmr::unsynchronized_pool_resource pool;
+	CountingResource resource(&pool);
+	port.SetMemoryResource(&resource);
+
+	std::pmr::vector<std::pmr::string> lines(&resource);
+	std::pmr::string line(&resource);
+	std::string plain_line;
+	const auto read_burst = [&]
+	{
+		pty.Write("first line of the burst\nsecond line of the burst\nthird line\nsingle line\nanother single line\n");
+		while (port.NumBytesAvailable() < 82)
+		{
+			ASSERT_TRUE(port.WaitForData(std::chrono::milliseconds(1000)));
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		ASSERT_EQ(port.ReadLines(lines, 3), 3);
+		EXPECT_EQ(lines[1], "second line of the burst\n");
+		port.ReadString(line);
+		EXPECT_EQ(line, "single line\n");
+		port.ReadString(plain_line);
+		EXPECT_EQ(plain_line, "another single line\n");
+	};
+
+	// Let the buffers grow to their steady-state size
+	read_burst();
+	const auto num_allocations = resource.NumAllocations();
+	const auto capacity = plain_line.capacity();
+	for (int i = 0; i < 100; ++i)
+	{
+		read_burst();
+	}
+	EXPECT_EQ(resource.NumAllocations(), num_allocations);
+	EXPECT_EQ(plain_line.capacity(), capacity);
+}
+
+// Test that alternating large and small bursts do not allocate either
+TEST(SerialPortTests, ReadVaryingBurstsWithoutAllocations)
+{
+	PtyPair pty;
+	serial_port::SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+
+	std::pmr::unsynchronized_pool_resource pool;
+	CountingResource resource(&pool);
+	port.SetMemoryResource(&resource);
+	std::pmr::vector<std::pmr::string> lines(&resource);
+
+	const auto read_burst = [&](const std::size_t num_lines)
+	{
+		std::string burst;
+		for (std::size_t i = 0; i < num_lines; ++i)
+		{
+			burst += "a line longer than the small string buffer " + std::to_string(i % 10) + "\n";
+		}
+		pty.Write(burst);
+		while (port.NumBytesAvailable() < burst.size())
+		{
+			ASSERT_TRUE(port.WaitForData(std::chrono::milliseconds(1000)));
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		ASSERT_EQ(port.ReadLines(lines), num_lines);
+		EXPECT_EQ(std::string_view(lines[num_lines - 1]), "a line longer than the small string buffer " + std::to_string((num_lines - 1) % 10) + "\n");
+	};
+
+	read_burst(20);
+	const auto num_allocations = resource.NumAllocations();
+	for (int i = 0; i < 20; ++i)
+	{
+		read_burst(2);
+		read_burst(20);
+	}
+	EXPECT_EQ(resource.NumAllocations(), num_allocations);
+}
+#endif
+
+#if defined (__linux__)
+// Test changing the settings of an open port without reopening it
+TEST(SerialPortTests, ApplySettings)
+{
+	PtyPair pty;
+	serial_port::SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+	const auto handle = port.GetNativeHandle();
+
+	pty.Write("before\n");
+	ASSERT_TRUE(port.WaitForData(std::chrono::milliseconds(1000)));
+
+	auto settings = port.GetSettings();
+	settings.baud_rate = 3000000;
+	settings.parity = serial_port::Parity::kEven;
+	settings.num_stop_bits = serial_port::NumStopBits::kTwo;
+	port.ApplySettings(settings, true);
+
+	EXPECT_EQ(port.GetNativeHandle(), handle);
+	EXPECT_EQ(port.GetSettings(), settings);
+	termios tty{};
+	ASSERT_EQ(tcgetattr(handle, &tty), 0);
+	EXPECT_EQ(cfgetospeed(&tty), static_cast<speed_t>(B3000000));
+	EXPECT_EQ(cfgetispeed(&tty), static_cast<speed_t>(B3000000));
+	// Pseudo terminals do not support parity, so only the stop bits can be checked
+	EXPECT_TRUE(tty.c_cflag & CSTOPB);
+
+	// Data received before the change is still there
+	EXPECT_EQ(port.ReadString(), "before\n");
+
+	// Invalid settings leave the port untouched
+	settings.baud_rate = 12345;
+	EXPECT_THROW(port.ApplySettings(settings), std::invalid_argument);
+	EXPECT_EQ(port.GetSettings().baud_rate, 3000000);
+	settings.baud_rate = 9600;
+	settings.port_name = "/dev/null";
+	EXPECT_THROW(port.ApplySettings(settings), std::invalid_argument);
+}
+#endif
+
+#if defined (__linux__)
+// Test opening many ports at once
+TEST(SerialPortTests, OpenAll)
+{
+	constexpr std::size_t kNumPorts = 32;
+	std::vector<std::unique_ptr<PtyPair>> ptys;
+	std::vector<serial_port::SerialPort> ports;
+	for (std::size_t i = 0; i < kNumPorts; ++i)
+	{
+		ptys.push_back(std::make_unique<PtyPair>());
+		ports.emplace_back(ptys.back()->SlaveName(), 115200);
+	}
+	ports.emplace_back("/dev/does_not_exist", 115200);
+
+	const auto results = serial_port::SerialPort::OpenAll(ports, 8);
+	ASSERT_EQ(results.size(), kNumPorts + 1);
+	for (std::size_t i = 0; i < kNumPorts; ++i)
+	{
+		EXPECT_TRUE(results[i].success) << results[i];
+		EXPECT_EQ(results[i].port_name, ptys[i]->SlaveName());
+		EXPECT_TRUE(ports[i].IsOpen());
+	}
+	EXPECT_FALSE(results.back().success);
+	EXPECT_FALSE(results.back().error.empty());
+	EXPECT_FALSE(ports.back().IsOpen());
+	std::cout << results.back() << std::endl;
+
+	// Opened ports are fully functional (and block as usual)
+	ptys.front()->Write("hello\n");
+	EXPECT_EQ(ports.front().ReadString(), "hello\n");
+}
+
+// Test that OpenAll() reports worker threads that cannot be configured
+TEST(SerialPortTests, OpenAllInvalidThreadConfig)
+{
+	std::vector<std::unique_ptr<PtyPair>> ptys;
+	std::vector<serial_port::SerialPort> ports;
+	for (std::size_t i = 0; i < 4; ++i)
+	{
+		ptys.push_back(std::make_unique<PtyPair>());
+		ports.emplace_back(ptys.back()->SlaveName(), 115200);
+	}
+
+	serial_port::IoThreadConfig io_thread;
+	io_thread.realtime_priority = 1000;
+	EXPECT_THROW(serial_port::SerialPort::OpenAll(ports, 4, io_thread), std::invalid_argument);
+}
+#endif
+
+namespace
+{
+	// Laid out without padding, like the packed structs exchanged with devices
+	struct Sample
+	{
+		std::uint16_t channel;
+		std::uint16_t flags;
+		std::int32_t value;
+		float scale;
+	};
+	static_assert(sizeof(Sample) == 12);
+
+	void SwapEndian(Sample& sample)
+	{
+		serial_port::SwapBytes(sample.channel);
+		serial_port::SwapBytes(sample.flags);
+		serial_port::SwapBytes(sample.value);
+		serial_port::SwapBytes(sample.scale);
+	}
+}
+
+// Test the compile-time byte swap
+static_assert(serial_port::ByteSwap(std::uint16_t{ 0x1234 }) == 0x3412);
+static_assert(serial_port::ByteSwap(std::uint32_t{ 0x12345678 }) == 0x78563412);
+static_assert(serial_port::ByteSwap(std::uint64_t{ 0x0123456789ABCDEF }) == 0xEFCDAB8967452301);
+
+#if defined (__linux__)
+// Test reading and writing binary values in both byte orders
+TEST(SerialPortTests, TypedReadWrite)
+{
+	PtyPair pty;
+	serial_port::SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+
+	port.Write<serial_port::Endian::kBig>(std::uint32_t{ 0x12345678 });
+	port.Write<serial_port::Endian::kLittle>(std::int16_t{ -2 });
+	EXPECT_EQ(pty.Read(6), std::string("\x12\x34\x56\x78\xFE\xFF", 6));
+
+	const std::uint16_t samples[] = { 0x0102, 0x0304, 0x0506 };
+	port.Write<serial_port::Endian::kBig>(samples, 3);
+	EXPECT_EQ(pty.Read(6), std::string("\x01\x02\x03\x04\x05\x06", 6));
+
+	// Arrays larger than the conversion chunk
+	std::vector<std::uint32_t> counts(1000);
+	std::string expected;
+	for (std::uint32_t i = 0; i < counts.size(); ++i)
+	{
+		counts[i] = i;
+		expected += std::string{ '\0', '\0', static_cast<char>(i >> 8), static_cast<char>(i & 0xFF) };
+	}
+	port.Write<serial_port::Endian::kBig>(counts.data(), counts.size());
+	EXPECT_EQ(pty.Read(expected.size()), expected);
+
+	pty.Write(std::string("\x00\x2A\x80\x01\xFF\xFF\xFF\xFE\x3F\x80\x00\x00", 12));
+	const auto sample = port.Read<Sample, serial_port::Endian::kBig>();
+	EXPECT_EQ(sample.channel, 42);
+	EXPECT_EQ(sample.flags, 0x8001);
+	EXPECT_EQ(sample.value, -2);
+	EXPECT_EQ(sample.scale, 1.0f);
+
+	// Arrays arrive in one piece even if they are split on the wire
+	std::thread writer([&pty]
+	{
+		pty.Write(std::string("\x01\x00\x02", 3));
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		pty.Write(std::string("\x00\x03\x00", 3));
+	});
+	std::array<std::uint16_t, 3> values{};
+	port.Read(values.data(), values.size());
+	writer.join();
+	EXPECT_EQ(values, (std::array<std::uint16_t, 3>{ 1, 2, 3 }));
+
+	// A whole array type round trips as one value
+	port.Write<serial_port::Endian::kBig>(values);
+	pty.Write(pty.Read(6));
+	EXPECT_EQ((port.Read<std::array<std::uint16_t, 3>, serial_port::Endian::kBig>()), values);
+}
+#endif
+
+#if defined (__linux__)
+// Test modem line masks, line counters, and that ptys (which have neither) report errors
+TEST(SerialPortTests, ModemLinesAndCounters)
+{
+	constexpr auto mask = serial_port::ModemLine::kCts | serial_port::ModemLine::kDcd;
+	static_assert(serial_port::IsSet(mask, serial_port::ModemLine::kCts));
+	static_assert(!serial_port::IsSet(mask, serial_port::ModemLine::kDsr));
+	std::ostringstream names;
+	names << mask << " " << serial_port::ModemLine::kNone;
+	EXPECT_EQ(names.str(), "CTS|DCD none");
+
+	serial_port::LineCounters before;
+	before.rx = 100;
+	before.overrun = 1;
+	serial_port::LineCounters after = before;
+	after.rx = 250;
+	after.overrun = 3;
+	after.parity = 1;
+	const auto delta = after - before;
+	EXPECT_EQ(delta.rx, 150);
+	EXPECT_EQ(delta.Errors(), 3);
+	// The driver's 32-bit counters wrap around
+	before.rx = 0xFFFFFFF0;
+	after.rx = 0x10;
+	EXPECT_EQ((after - before).rx, 0x20);
+
+	PtyPair pty;
+	serial_port::SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+	EXPECT_THROW((void)port.GetLineCounters(), serial_port::IoException);
+	EXPECT_THROW((void)port.GetModemLines(), serial_port::IoException);
+	EXPECT_THROW(port.WaitForModemLineChange(serial_port::ModemLine::kCts), serial_port::IoException);
+	EXPECT_THROW(port.WaitForModemLineChange(serial_port::ModemLine::kRts), std::invalid_argument);
+	EXPECT_THROW(serial_port::ModemLineMonitor(port, [](serial_port::ModemLine, serial_port::ModemLine) {}),
+		serial_port::IoException);
+}
+#endif
+
+#if defined (__linux__)
+// Test that busy-poll reads spin for their budget and then fall back to sleeping
+TEST(SerialPortTests, BusyPoll)
+{
+	PtyPair pty;
+	serial_port::SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+	char c;
+
+	// Data that arrives within the budget is picked up while spinning
+	port.SetBusyPoll(std::chrono::seconds(2));
+	std::thread writer([&pty]
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		pty.Write("a");
+	});
+	EXPECT_EQ(port.ReadData(&c, 1), 1);
+	writer.join();
+	auto stats = port.GetBusyPollStats();
+	EXPECT_EQ(stats.num_waits, 1);
+	EXPECT_EQ(stats.num_spin_hits, 1);
+	EXPECT_GE(stats.latency.max, std::chrono::milliseconds(4));
+
+	// Data that arrives later is waited for in poll()
+	port.SetBusyPoll(std::chrono::microseconds(100));
+	writer = std::thread([&pty]
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		pty.Write("b");
+	});
+	EXPECT_EQ(port.ReadData(&c, 1), 1);
+	EXPECT_EQ(c, 'b');
+	writer.join();
+	EXPECT_FALSE(port.WaitForData(std::chrono::milliseconds(10)));
+
+	stats = port.GetBusyPollStats();
+	std::cout << stats << std::endl;
+	EXPECT_EQ(stats.num_waits, 3);
+	EXPECT_EQ(stats.num_sleeps, 2);
+	EXPECT_EQ(stats.num_timeouts, 1);
+	EXPECT_EQ(stats.latency.count, 2);
+	EXPECT_LE(stats.latency.Percentile(0.5), stats.latency.Percentile(1.0));
+
+	// Data that is already there does not count as a wait. The pty delivers it to the slave side
+	// asynchronously, so make sure it has arrived first.
+	pty.Write("c");
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+	while (port.NumBytesAvailable() == 0 && std::chrono::steady_clock::now() < deadline)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	EXPECT_TRUE(port.WaitForData(std::chrono::milliseconds(100)));
+	EXPECT_EQ(port.ReadData(&c, 1), 1);
+	EXPECT_EQ(port.GetBusyPollStats().num_waits, 3);
+
+	// A descriptor in non-blocking mode (as used by AsyncPort) is not waited for
+	const auto handle = port.GetNativeHandle();
+	fcntl(handle, F_SETFL, fcntl(handle, F_GETFL) | O_NONBLOCK);
+	const auto start = std::chrono::steady_clock::now();
+	EXPECT_GT(port.ReadData(&c, 1), 1);
+	EXPECT_EQ(errno, EAGAIN);
+	EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+	EXPECT_EQ(port.GetBusyPollStats().num_waits, 3);
+}
+#endif
+
+#if defined (__linux__)
+// Test that the non-throwing API tells errors apart from data
+TEST(SerialPortTests, TryApi)
+{
+	serial_port::SerialPort missing("/dev/serial_port_does_not_exist", 115200);
+	EXPECT_EQ(missing.TryOpen(), std::errc::no_such_file_or_directory);
+	char buffer[16];
+	EXPECT_EQ(missing.TryReadData(buffer, sizeof(buffer), std::chrono::milliseconds(0)).Error(), serial_port::Errc::kNotOpen);
+	EXPECT_THROW(static_cast<void>(missing.TryNumBytesAvailable().Value()), serial_port::IoException);
+
+	auto pty = std::make_unique<PtyPair>();
+	serial_port::SerialPort port(pty->SlaveName(), 115200);
+	ASSERT_FALSE(port.TryOpen());
+
+	auto result = port.TryReadData(buffer, sizeof(buffer), std::chrono::milliseconds(0));
+	EXPECT_EQ(result.Error(), serial_port::Errc::kWouldBlock);
+	result = port.TryReadData(buffer, 0, std::chrono::milliseconds(0));
+	ASSERT_TRUE(result);
+	EXPECT_EQ(*result, 0);
+	const auto start = std::chrono::steady_clock::now();
+	result = port.TryReadData(buffer, sizeof(buffer), std::chrono::milliseconds(20));
+	EXPECT_EQ(result.Error(), serial_port::Errc::kTimeout);
+	EXPECT_EQ(result.Error(), std::errc::timed_out);
+	EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+	EXPECT_EQ(result.ValueOr(0), 0);
+
+	pty->Write("abc");
+	result = port.TryReadData(buffer, sizeof(buffer), std::chrono::milliseconds(100));
+	ASSERT_TRUE(result);
+	EXPECT_EQ(std::string(buffer, *result), "abc");
+
+	const auto written = port.TryWriteData("xyz", 3);
+	ASSERT_TRUE(written);
+	EXPECT_EQ(written.Value(), 3);
+	EXPECT_EQ(pty->Read(3), "xyz");
+
+	pty->Write("de");
+	ASSERT_TRUE(port.WaitForData(std::chrono::milliseconds(100)));
+	EXPECT_EQ(port.TryNumBytesAvailable().Value(), 2);
+	EXPECT_FALSE(port.TryFlushBuffer());
+	EXPECT_EQ(port.TryNumBytesAvailable().Value(), 0);
+
+	// Bytes that ReadString() read ahead are not lost
+	pty->Write("line\nrest");
+	EXPECT_EQ(port.ReadString(), "line\n");
+	EXPECT_EQ(port.TryNumBytesAvailable().Value(), 4);
+	result = port.TryReadData(buffer, sizeof(buffer), std::chrono::milliseconds(0));
+	ASSERT_TRUE(result);
+	EXPECT_EQ(std::string(buffer, *result), "rest");
+	pty->Write("more\nx");
+	EXPECT_EQ(port.ReadString(), "more\n");
+	EXPECT_FALSE(port.TryFlushBuffer());
+	EXPECT_EQ(port.TryNumBytesAvailable().Value(), 0);
+
+	// Pseudo terminals have no modem lines; the system error is passed on
+	const auto lines = port.TryGetModemLines();
+	EXPECT_FALSE(lines);
+	EXPECT_EQ(lines.Error(), std::errc::inappropriate_io_control_operation);
+	EXPECT_EQ(lines.Error().category(), std::system_category());
+
+	// Closing the master side hangs up the terminal
+	pty.reset();
+	result = port.TryReadData(buffer, sizeof(buffer), std::chrono::milliseconds(100));
+	EXPECT_EQ(result.Error(), serial_port::Errc::kDisconnected);
+	EXPECT_EQ(result.Error().message(), "device disconnected");
+	EXPECT_STREQ(result.Error().category().name(), "serial_port");
+}
+#endif
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "serial_port/transaction.h"
+#include "pty_pair.h"
+
+using namespace serial_port;
+
+namespace
+{
+	// Reads newline-terminated requests "<id> <command>" from the master side and hands them to a responder
+	class LineDevice
+	{
+	public:
+		LineDevice(const PtyPair& pty, std::function<void(const std::string&)> responder)
+			: pty_(pty), responder_(std::move(responder)), thread_([this] { Run(); })
+		{
+		}
+		~LineDevice()
+		{
+			running_ = false;
+			thread_.join();
+		}
+
+	private:
+		void Run()
+		{
+			std::string buffer;
+			while (running_)
+			{
+				buffer += pty_.Read(1, std::chrono::milliseconds(10));
+				const auto pos = buffer.find('\n');
+				if (pos != std::string::npos)
+				{
+					responder_(buffer.substr(0, pos));
+					buffer.erase(0, pos + 1);
+				}
+			}
+		}
+
+		const PtyPair& pty_;
+		std::function<void(const std::string&)> responder_;
+		std::atomic<bool> running_{ true };
+		std::thread thread_;
+	};
+}
+
+// Test that responses are matched while unsolicited frames are routed to the side channel
+TEST(TransactionTests, UnsolicitedFrames)
+{
+	PtyPair pty;
+	LineDevice device(pty, [&pty](const std::string& request)
+	{
+		pty.Write("EVT status\n");
+		pty.Write("OK " + request + "\n");
+	});
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+
+	TransactionManager transactions(port);
+	const auto response = transactions.Transact("1 ping\n", PrefixMatcher("OK 1"), std::chrono::milliseconds(1000));
+	ASSERT_TRUE(response.has_value());
+	EXPECT_EQ(*response, "OK 1 ping\n");
+	EXPECT_EQ(transactions.ReadUnsolicited(std::chrono::milliseconds(1000)), std::string("EVT status\n"));
+	EXPECT_EQ(transactions.NumInFlight(), 0);
+}
+
+// Test that a request without a response expires at its deadline
+TEST(TransactionTests, Deadline)
+{
+	PtyPair pty;
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+
+	TransactionManager transactions(port);
+	const auto start = std::chrono::steady_clock::now();
+	const auto response = transactions.Transact("1 ping\n", PrefixMatcher("OK 1"), std::chrono::milliseconds(30));
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+	EXPECT_FALSE(response.has_value());
+	EXPECT_GE(elapsed, std::chrono::milliseconds(30));
+	EXPECT_LT(elapsed, std::chrono::milliseconds(500));
+}
+
+// Test that pending requests fail at once when the device disconnects
+TEST(TransactionTests, Disconnect)
+{
+	auto pty = std::make_unique<PtyPair>();
+	SerialPort port(pty->SlaveName(), 115200);
+	port.Open();
+
+	TransactionManager transactions(port);
+	auto future = transactions.Submit("1 ping\n", PrefixMatcher("OK 1"), std::chrono::milliseconds(5000));
+	EXPECT_EQ(pty->Read(7), "1 ping\n");
+	const auto start = std::chrono::steady_clock::now();
+	pty.reset();
+	EXPECT_FALSE(future.get().has_value());
+	EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(1000));
+	EXPECT_EQ(transactions.NumInFlight(), 0);
+	EXPECT_EQ(transactions.Error(), Errc::kDisconnected);
+	EXPECT_THROW(transactions.Transact("2 ping\n", PrefixMatcher("OK 2"), std::chrono::milliseconds(100)), IoException);
+}
+
+// Test several requests in flight that are answered in reverse order
+TEST(TransactionTests, MultipleInFlight)
+{
+	constexpr int kNumRequests = 4;
+	PtyPair pty;
+	std::vector<std::string> requests;
+	LineDevice device(pty, [&pty, &requests](const std::string& request)
+	{
+		requests.push_back(request);
+		if (requests.size() == kNumRequests)
+		{
+			for (auto it = requests.rbegin(); it != requests.rend(); ++it)
+			{
+				pty.Write("OK " + *it + "\n");
+			}
+		}
+	});
+	SerialPort port(pty.SlaveName(), 115200);
+	port.Open();
+
+	TransactionManager transactions(port, DelimiterFramer('\n'), kNumRequests);
+	std::vector<std::future<std::optional<std::string>>> futures;
+	for (int i = 0; i < kNumRequests; ++i)
+	{
+		const auto id = std::to_string(i);
+		futures.push_back(transactions.Submit(id + " read\n", PrefixMatcher("OK " + id + " "), std::chrono::milliseconds(1000)));
+	}
+	for (int i = 0; i < kNumRequests; ++i)
+	{
+		EXPECT_EQ(futures[i].get(), "OK " + std::to_string(i) + " read\n");
+	}
+}
+
+#endif // __linux__